@@ -9,9 +9,11 @@ static struct argp_option options[] = {
   {"port",                  'p', "4840",       0, "Port to bind to."},
   {"server-ip-address",     'a', "",           0, "[not yet available] Server address to bind to."},
   {"device",                'd', "/dev/i2c-1", 0, "Linux block device path."},
-  {"slave-address-list",    's', "0x58",       0, "Comma separated list of slave I2C addresses."},
+  {"slave-address-list",    's', "0x58",       0, "Comma separated list of slave I2C addresses. \
+                                                   An address can be prefixed by its block device, i.e. /dev/i2c-2:0x58"},
   {"mode",                  'm', "0",          0, "Set different modes of operation of coupler. Default (0) is set attached \
-                                                   I2C's state state. Virtual (1) which does NOT set any I2C slaves' state."},
+                                                   I2C's state state. Virtual (1) which does NOT set any I2C slaves' state. \
+                                                   Simulated (2) which drives simulated MOD-IOs instead (see -B)."},
   {"username",              'u', "",           0, "Username."},
   {"password",              'w', "",           0, "Password."},
   {"key",                   'k', "",           0, "x509 key."},
@@ -21,11 +23,51 @@ static struct argp_option options[] = {
   {"heart-beat-interval",   't', "50",         0, "Heart beat interval in ms."},
   {"heart-beat-timeout-interval",
                             'o', "100",        0, "Heart beat timeout interval in ms."},
+  {"heart-beat-legacy-format",
+                            'f', "0",          0, "Publish / subscribe heart beats in the legacy <ID>.<heart_beats> Float format \
+                                                   instead of <coupler ID, sequence, timestamp>."},
   {"heart-beat-id-list",    'l', "",           0, "Comma separated list of IDs of couplers to watch for heart beats. \
                                                    If a heart beat is missing coupler goes to safe mode."},
   {"network-address-url-data-type",
                             'n', "opc.udp://224.0.0.22:4840/", 0, "Network address URL type used for Pub/Sub."},
   {"network-interface",     'j', "",           0, "Network interface to use for Pub/Sub."},
+  {"io-scan-interval",      'r', "20",         0, "Interval in ms at which MOD-IO inputs are scanned."},
+  {"analog-deadband",       'A', "0",          0, "Analog input changes of at most this many ADC counts are not written \
+                                                   to the ain* variables (no data change notification), 0 notifies every change."},
+  {"time-base-clock",       'g', "monotonic",  0, "Clock of all keep-alive timestamps: monotonic, monotonic_raw or tai \
+                                                   (tai only if couplers are synchronized with PTP)."},
+  {"numeric-node-id",       'e', "0",          0, "Use numeric NodeIds (ns=1;i=1000..) instead of string NodeIds \
+                                                   for I/O and heart beat variables. BrowseNames stay the same."},
+  {"rt-priority",           'y', "0",          0, "Run I/O scan, heart beats and Pub/Sub in a real-time thread with this \
+                                                   SCHED_FIFO priority (1..99). 0 disables real-time mode."},
+  {"rt-cpu",                'z', "-1",         0, "CPU to pin the real-time thread to (-1 for no affinity)."},
+  {"rt-cycle-interval",     'x', "1000",       0, "Base cycle of the real-time thread in us."},
+  {"pubsub-transport",      'T', "udp",        0, "Transport of Pub/Sub heart beats: udp (multicast) or eth (raw Ethernet frames, \
+                                                   needs a network interface)."},
+  {"eth-destination-mac",   'M', DEFAULT_ETH_DESTINATION_MAC,
+                                               0, "Destination MAC of Ethernet heart beats."},
+  {"eth-vlan-id",           'N', "0",          0, "VLAN ID of Ethernet heart beats (0 for untagged frames)."},
+  {"eth-pcp",               'P', "0",          0, "VLAN priority code point (0..7) of Ethernet heart beats."},
+  {"eth-txtime-offset",     'X', "0",          0, "Send Ethernet heart beats with SO_TXTIME at now + offset in us \
+                                                   (needs an ETF qdisc, 0 disables SO_TXTIME)."},
+  {"eth-socket-priority",   'Q', "3",          0, "Socket priority of SO_TXTIME heart beats (mapped to the ETF queue)."},
+  {"pubsub-fixed-offset",   'R', "0",          0, "Encode / decode heart beats at precomputed fixed offsets (real-time Pub/Sub). \
+                                                   All couplers must use the same setting."},
+  {"config",                'C', "",           0, "Configuration file overlaying the command line, reloaded on SIGHUP."},
+  {"metrics-socket",        'D', "",           0, "Unix socket serving all metrics in Prometheus text format \
+                                                   (i.e. /run/coupler.metrics), empty disables it."},
+  {"trace-file",            'E', "",           0, "Trace heart beats, state changes, I2C transactions and OPC UA callbacks \
+                                                   into per thread rings dumped to this file on SIGUSR1 and at exit, \
+                                                   empty disables tracing."},
+  {"gpio-chip",             'G', DEFAULT_GPIO_CHIP_NAME,
+                                               0, "GPIO chip of the measurement lines."},
+  {"gpio-line-list",        'L', "",           0, "Comma separated offsets of the GPIO measurement lines toggled on heart beat \
+                                                   received, relay write (i2c0.relay0) and set in safe mode, i.e. 7,8,9 \
+                                                   (-1 or missing disables a line)."},
+  {"i2c-simulation",        'B', "",           0, "Simulated I2C buses (-m 2), comma separated: clock (kHz, 100), \
+                                                   overhead (us per transaction), nak, timeout, stuck (probabilities \
+                                                   per transaction), timeout-time, stuck-time (ms), loopback (0 / 1: \
+                                                   inputs follow relays), seed, i.e. clock=400,nak=0.001."},
   {0}
 };
 
@@ -45,8 +87,29 @@ struct arguments
     int heart_beat_interval;
     int heart_beat_timeout_interval;
     char *heart_beat_id_list;
+    bool heart_beat_legacy_format;
     char *network_address_url_data_type;
     char *network_interface;
+    int io_scan_interval;
+    int analog_deadband;
+    bool numeric_node_id;
+    char *time_base_clock;
+    int rt_priority;
+    int rt_cpu;
+    int rt_cycle_interval;
+    char *pubsub_transport;
+    char *eth_destination_mac;
+    int eth_vlan_id;
+    int eth_pcp;
+    int eth_txtime_offset;
+    int eth_socket_priority;
+    bool pubsub_fixed_offset;
+    char *config;
+    char *metrics_socket;
+    char *trace_file;
+    char *gpio_chip;
+    char *gpio_line_list;
+    char *i2c_simulation;
 };
 
 static error_t parse_opt(int key, char *arg, struct argp_state *state)
@@ -95,12 +158,75 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'l':
       arguments->heart_beat_id_list = arg;
       break;
+    case 'f':
+      arguments->heart_beat_legacy_format = atoi (arg);
+      break;
     case 'n':
       arguments->network_address_url_data_type = arg;
       break;
     case 'j':
       arguments->network_interface = arg;
       break;
+    case 'r':
+      arguments->io_scan_interval = arg ? atoi (arg) : DEFAULT_IO_SCAN_INTERVAL;
+      break;
+    case 'A':
+      arguments->analog_deadband = atoi (arg);
+      break;
+    case 'g':
+      arguments->time_base_clock = arg;
+      break;
+    case 'e':
+      arguments->numeric_node_id = atoi (arg);
+      break;
+    case 'y':
+      arguments->rt_priority = atoi (arg);
+      break;
+    case 'z':
+      arguments->rt_cpu = atoi (arg);
+      break;
+    case 'x':
+      arguments->rt_cycle_interval = arg ? atoi (arg) : DEFAULT_RT_CYCLE_INTERVAL;
+      break;
+    case 'T':
+      arguments->pubsub_transport = arg;
+      break;
+    case 'M':
+      arguments->eth_destination_mac = arg;
+      break;
+    case 'N':
+      arguments->eth_vlan_id = atoi (arg);
+      break;
+    case 'P':
+      arguments->eth_pcp = atoi (arg);
+      break;
+    case 'X':
+      arguments->eth_txtime_offset = atoi (arg);
+      break;
+    case 'Q':
+      arguments->eth_socket_priority = arg ? atoi (arg) : DEFAULT_ETH_SOCKET_PRIORITY;
+      break;
+    case 'R':
+      arguments->pubsub_fixed_offset = atoi (arg);
+      break;
+    case 'C':
+      arguments->config = arg;
+      break;
+    case 'D':
+      arguments->metrics_socket = arg;
+      break;
+    case 'E':
+      arguments->trace_file = arg;
+      break;
+    case 'G':
+      arguments->gpio_chip = arg;
+      break;
+    case 'L':
+      arguments->gpio_line_list = arg;
+      break;
+    case 'B':
+      arguments->i2c_simulation = arg;
+      break;
     case ARGP_KEY_ARG:
       return 0;
     default: 
@@ -133,8 +259,29 @@ void handleCLI(int argc, char **argv) {
     arguments.heart_beat_interval = DEFAULT_HEART_BEAT_INTERVAL;
     arguments.heart_beat_timeout_interval = DEFAULT_HEART_BEAT_TIMEOUT_INTERVAL;
     arguments.heart_beat_id_list = "";
+    arguments.heart_beat_legacy_format = false;
     arguments.network_address_url_data_type = NETWORK_ADDRESS_URL_DATA_TYPE;
     arguments.network_interface = "";
+    arguments.io_scan_interval = DEFAULT_IO_SCAN_INTERVAL;
+    arguments.analog_deadband = 0;
+    arguments.numeric_node_id = false;
+    arguments.time_base_clock = "monotonic";
+    arguments.rt_priority = 0;
+    arguments.rt_cpu = -1;
+    arguments.rt_cycle_interval = DEFAULT_RT_CYCLE_INTERVAL;
+    arguments.pubsub_transport = "udp";
+    arguments.eth_destination_mac = DEFAULT_ETH_DESTINATION_MAC;
+    arguments.eth_vlan_id = 0;
+    arguments.eth_pcp = 0;
+    arguments.eth_txtime_offset = 0;
+    arguments.eth_socket_priority = DEFAULT_ETH_SOCKET_PRIORITY;
+    arguments.pubsub_fixed_offset = false;
+    arguments.config = "";
+    arguments.metrics_socket = "";
+    arguments.trace_file = "";
+    arguments.gpio_chip = DEFAULT_GPIO_CHIP_NAME;
+    arguments.gpio_line_list = "";
+    arguments.i2c_simulation = "";
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
 
     printf("Mode=%d\n", arguments.mode);
@@ -149,17 +296,36 @@ void handleCLI(int argc, char **argv) {
     printf("Heart beat interval=%d ms\n", arguments.heart_beat_interval);
     printf("Heart beat timeout interval=%d ms\n", arguments.heart_beat_timeout_interval);
     printf("Heart beat ID list=%s\n", arguments.heart_beat_id_list);
+    printf("Heart beat legacy format=%d\n", arguments.heart_beat_legacy_format);
     printf("Network address URL data type=%s\n", arguments.network_address_url_data_type);
     printf("Network interface=%s\n", arguments.network_interface);
+    printf("I/O scan interval=%d ms\n", arguments.io_scan_interval);
+    printf("Analog deadband=%d\n", arguments.analog_deadband);
+    printf("Numeric NodeIds=%d\n", arguments.numeric_node_id);
+    printf("Time base clock=%s\n", arguments.time_base_clock);
+    printf("Real-time priority=%d\n", arguments.rt_priority);
+    printf("Real-time CPU=%d\n", arguments.rt_cpu);
+    printf("Real-time cycle interval=%d us\n", arguments.rt_cycle_interval);
+    printf("Pub/Sub transport=%s\n", arguments.pubsub_transport);
+    printf("Ethernet destination MAC=%s, VLAN ID=%d, PCP=%d\n", arguments.eth_destination_mac,
+           arguments.eth_vlan_id, arguments.eth_pcp);
+    printf("Ethernet SO_TXTIME offset=%d us, socket priority=%d\n", arguments.eth_txtime_offset,
+           arguments.eth_socket_priority);
+    printf("Pub/Sub fixed offsets=%d\n", arguments.pubsub_fixed_offset);
+    printf("Configuration file=%s\n", arguments.config);
+    printf("Metrics socket=%s\n", arguments.metrics_socket);
+    printf("Trace file=%s\n", arguments.trace_file);
+    printf("GPIO chip=%s, lines=%s\n", arguments.gpio_chip, arguments.gpio_line_list);
+    printf("I2C simulation=%s\n", arguments.i2c_simulation);
 
     // transfer to global variables (CLI input)
     COUPLER_ID = arguments.id;
-    OPERATIONAL_MODE = arguments.mode;
-    I2C_VIRTUAL_MODE = OPERATIONAL_MODE;
+    setOperationalMode(arguments.mode);
     I2C_BLOCK_DEVICE_NAME = arguments.device;
     HEART_BEAT_INTERVAL = arguments.heart_beat_interval;
     PUBLISHING_INTERVAL = HEART_BEAT_INTERVAL; // we assume that each heart_beat leads to a publish event
     HEART_BEAT_TIMEOUT_INTERVAL = arguments.heart_beat_timeout_interval;
+    HEART_BEAT_LEGACY_FORMAT = arguments.heart_beat_legacy_format;
     NETWORK_ADDRESS_URL_DATA_TYPE = arguments.network_address_url_data_type;
     NETWORK_INTERFACE = arguments.network_interface;
     USERNAME = arguments.username;
@@ -171,30 +337,83 @@ void handleCLI(int argc, char **argv) {
     ENABLE_HEART_BEAT = arguments.heart_beat;
     X509_KEY_FILENAME = arguments.key;
     X509_CERTIFICATE_FILENAME = arguments.certificate;
+    ENABLE_NUMERIC_NODE_ID = arguments.numeric_node_id;
+    if (setTimeBaseClock(arguments.time_base_clock) < 0)
+    {
+      printf("Unknown or unavailable time base clock (%s), using monotonic.\n", arguments.time_base_clock);
+    }
+    if (arguments.io_scan_interval > 0) IO_SCAN_INTERVAL = arguments.io_scan_interval;
+    if (arguments.analog_deadband >= 0) IO_SCAN_ANALOG_DEADBAND = arguments.analog_deadband;
+    RT_PRIORITY = arguments.rt_priority;
+    RT_CPU = arguments.rt_cpu;
+    if (arguments.rt_cycle_interval > 0) RT_CYCLE_INTERVAL = arguments.rt_cycle_interval;
+    if (selectPubSubTransport(arguments.pubsub_transport) < 0)
+    {
+      printf("Unknown Pub/Sub transport (%s), using udp.\n", arguments.pubsub_transport);
+    }
+    if (PUBSUB_TRANSPORT == PUBSUB_TRANSPORT_ETH && strlen(NETWORK_INTERFACE) == 0)
+    {
+      printf("Ethernet Pub/Sub transport needs a network interface (-j).\n");
+    }
+    ETH_DESTINATION_MAC = arguments.eth_destination_mac;
+    ETH_VLAN_ID = arguments.eth_vlan_id;
+    ETH_PCP = arguments.eth_pcp;
+    ETH_SOCKET_PRIORITY = arguments.eth_socket_priority;
+    if (arguments.eth_txtime_offset > 0)
+      ETH_TXTIME_OFFSET = arguments.eth_txtime_offset * NANO_SECONDS_PER_MICRO_SECOND;
+    ENABLE_PUBSUB_FIXED_OFFSET = arguments.pubsub_fixed_offset;
+    CONFIG_FILENAME = arguments.config;
+    METRICS_SOCKET_PATH = arguments.metrics_socket;
+    TRACE_FILENAME = arguments.trace_file;
+    TRACE_ENABLED = strlen(TRACE_FILENAME) > 0;
+    GPIO_CHIP_NAME = arguments.gpio_chip;
+    if (parseGPIOLineOffsetList(arguments.gpio_line_list, GPIO_LINE_OFFSET_LIST) < 0)
+    {
+      printf("Invalid GPIO line list (%s), GPIO measurement disabled.\n", arguments.gpio_line_list);
+      parseGPIOLineOffsetList("", GPIO_LINE_OFFSET_LIST);
+    }
+    if (parseI2CSimulationConfig(arguments.i2c_simulation, &I2C_SIMULATION_CONFIG) < 0)
+    {
+      printf("Invalid I2C simulation (%s), partly applied.\n", arguments.i2c_simulation);
+    }
 
-    // convert arguments.slave_address_list -> I2C_SLAVE_ADDR_LIST
+    // convert arguments.slave_address_list -> I2C_SLAVE_ADDR_LIST (and I2C_SLAVE_DEVICE_LIST)
     i = 0;
     char *token = strtok(arguments.slave_address_list, ",");
-    while (token != NULL)
+    while (token != NULL && i < MAX_I2C_SLAVE_COUNT)
     {
+        // optional block device prefix (/dev/i2c-2:0x58)
+        char *separator = strrchr(token, ':');
+        if (separator != NULL)
+        {
+            *separator = '\0';
+            I2C_SLAVE_DEVICE_LIST[i] = token;
+            token = separator + 1;
+        }
         // from CLI we get a hexidecimal string as a char (0x58 for example), convert to decimal
         result = strtol(token, &eptr, 16);
         I2C_SLAVE_ADDR_LIST[i++] = result;
         token = strtok(NULL, ",");
     }
 
-    // convert arguments.heart_beat_id_list -> HEART_BEAT_ID_LIST
-    i = 0;
+    // convert arguments.heart_beat_id_list -> watched peers of LIVENESS_TABLE
+    initLivenessTable(&LIVENESS_TABLE);
     char *tk= strtok(arguments.heart_beat_id_list, ",");
     while (tk != NULL)
     {
       // from CLI we get a  comma separated list on INTs representing coupler' ID
       result = strtol(tk, &eptr, 16);
-      HEART_BEAT_ID_LIST[i++] = result;
-      // enable heart beat checks
-      ENABLE_HEART_BEAT_CHECK = true;
-      tk = strtok(NULL, ",");
+      if (watchPeer(&LIVENESS_TABLE, result, STATE_NO_INITIAL_HEART_BEAT) < 0)
+      {
+        printf("Coupler ID out of range (max %d): %s\n", MAX_COUPLER_COUNT - 1, tk);
+      }
+      else
+      {
+        // enable heart beat checks
+        ENABLE_HEART_BEAT_CHECK = true;
       }
+      tk = strtok(NULL, ",");
+    }
 
     printf("Heart beat check=%d\n", ENABLE_HEART_BEAT_CHECK);
 
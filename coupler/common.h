@@ -4,7 +4,9 @@
 
 #include <sys/time.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <open62541/server.h>
+#include "time_base.h"
 
 unsigned long int getMilliSecondsSinceEpoch() {
   /*
@@ -0,0 +1,688 @@
+/*
+ * Configuration file, reloaded on SIGHUP.
+ *
+ * An INI file (-C) overlays the command line, i.e.:
+ *
+ *   [coupler]
+ *   heart-beat-id-list = 1,2,3
+ *   io-scan-interval = 10
+ *
+ *   [i2c0]
+ *   address = 0x58
+ *   device = /dev/i2c-1
+ *   channels = relay, in0, ain
+ *
+ * Keys of [coupler] are the long command line options. [i2cN] is the slave
+ * exposing the i2cN.* variables: if any is present the file's slaves replace
+ * the ones of the command line. channels selects the exposed variables
+ * (relay, in, ain or a single one like relay2, default all).
+ *
+ * On SIGHUP the file is parsed again and compared to the running
+ * configuration. Slaves, their channels, watched peers, the I/O scan interval,
+ * the analog deadband and the heart beat timeout are applied live, from the server thread.
+ * Unchanged slaves are left alone and keep their relays' state. Other
+ * settings need a restart. A file which does not parse is ignored as a whole.
+ */
+#include <ctype.h>
+#include <signal.h>
+
+#define MAX_CONFIG_LINE_LENGTH 256
+#define MAX_CONFIG_VALUE_LENGTH 128
+
+// interval in ms at which the server thread checks for a reload request
+#define CONFIG_RELOAD_CHECK_INTERVAL 200
+
+// what changed for a slave between two configurations
+#define CONFIG_SLAVE_UNCHANGED 0
+#define CONFIG_SLAVE_ADDED 1
+#define CONFIG_SLAVE_REMOVED 2
+#define CONFIG_SLAVE_REPLACED 3             // address or block device changed
+#define CONFIG_SLAVE_CHANNELS_CHANGED 4
+
+typedef struct {
+    int address;                            // 0 - no slave
+    char device[MAX_CONFIG_VALUE_LENGTH];   // empty - the coupler's block device
+    uint16_t channel_mask;                  // 0 - all channels
+} config_slave_t;
+
+typedef struct {
+    // applied live
+    config_slave_t slave_list[MAX_I2C_SLAVE_COUNT];
+    uint8_t peer_list[MAX_COUPLER_COUNT];   // 1 - heart beats of this coupler are watched
+    int io_scan_interval;
+    int analog_deadband;
+    int heart_beat_timeout_interval;
+    // need a restart
+    int id;
+    int mode;
+    char device[MAX_CONFIG_VALUE_LENGTH];
+    bool heart_beat;
+    int heart_beat_interval;
+    int pubsub_transport;
+    char network_address_url_data_type[MAX_CONFIG_VALUE_LENGTH];
+    char network_interface[MAX_CONFIG_VALUE_LENGTH];
+} coupler_config_t;
+
+// the command line only (base of every reload) and the running configuration
+static coupler_config_t CLI_COUPLER_CONFIG;
+static coupler_config_t COUPLER_CONFIG;
+
+// block devices of slaves set by the file (I2C_SLAVE_DEVICE_LIST points here)
+static char CONFIG_SLAVE_DEVICE_LIST[MAX_I2C_SLAVE_COUNT][MAX_CONFIG_VALUE_LENGTH];
+
+static volatile sig_atomic_t CONFIG_RELOAD_REQUESTED = 0;
+
+static char *trimConfigString(char *s)
+{
+    char *end;
+
+    while (isspace((unsigned char)*s))
+        s++;
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+        end--;
+    *end = '\0';
+    return s;
+}
+
+static int copyConfigString(char *destination, const char *value)
+{
+    if (strlen(value) >= MAX_CONFIG_VALUE_LENGTH)
+        return -1;
+    strcpy(destination, value);
+    return 0;
+}
+
+static int parseConfigInteger(const char *value, int base, int *result)
+{
+    char *eptr;
+    long number = strtol(value, &eptr, base);
+
+    if (eptr == value || *eptr != '\0')
+        return -1;
+    *result = (int)number;
+    return 0;
+}
+
+static int parseChannelMask(char *value, uint16_t *mask)
+{
+    /*
+     * Convert a list of channels (relay, in, ain or relay0, in3, ..) to a mask.
+     * Return -1 on unknown channel.
+     */
+    int bit;
+    int first;
+    int count;
+    char *name;
+    char *save;
+    char *token = strtok_r(value, ", ", &save);
+
+    *mask = 0;
+    while (token != NULL)
+    {
+        if (strncmp(token, "relay", 5) == 0)
+        {
+            name = token + 5;
+            first = 0;
+            count = MOD_IO_RELAY_COUNT;
+        }
+        else if (strncmp(token, "ain", 3) == 0)
+        {
+            name = token + 3;
+            first = MOD_IO_RELAY_COUNT + MOD_IO_DIGITAL_INPUT_COUNT;
+            count = MOD_IO_ANALOG_INPUT_COUNT;
+        }
+        else if (strncmp(token, "in", 2) == 0)
+        {
+            name = token + 2;
+            first = MOD_IO_RELAY_COUNT;
+            count = MOD_IO_DIGITAL_INPUT_COUNT;
+        }
+        else if (strcmp(token, "all") == 0)
+        {
+            *mask = MOD_IO_CHANNEL_MASK_ALL;
+            token = strtok_r(NULL, ", ", &save);
+            continue;
+        }
+        else
+        {
+            return -1;
+        }
+
+        if (*name == '\0')
+        {
+            // all channels of this kind
+            *mask |= ((1U << count) - 1) << first;
+        }
+        else
+        {
+            if (parseConfigInteger(name, 10, &bit) < 0 || bit < 0 || bit >= count)
+                return -1;
+            *mask |= 1U << (first + bit);
+        }
+        token = strtok_r(NULL, ", ", &save);
+    }
+    return *mask != 0 ? 0 : -1;
+}
+
+static int parsePeerList(char *value, uint8_t *peer_list)
+{
+    /*
+     * Convert a comma separated list of coupler IDs (hexadecimal as on the
+     * command line) to watched peers. Return -1 if an ID is out of range.
+     */
+    int coupler_id;
+    char *save;
+    char *token = strtok_r(value, ", ", &save);
+
+    memset(peer_list, 0, MAX_COUPLER_COUNT);
+    while (token != NULL)
+    {
+        if (parseConfigInteger(token, 16, &coupler_id) < 0 ||
+            coupler_id < 0 || coupler_id >= MAX_COUPLER_COUNT)
+            return -1;
+        peer_list[coupler_id] = 1;
+        token = strtok_r(NULL, ", ", &save);
+    }
+    return 0;
+}
+
+static int setCouplerConfigValue(coupler_config_t *config, const char *key, char *value)
+{
+    /*
+     * Set a [coupler] key. Return -1 on unknown key or invalid value.
+     */
+    int number;
+
+    if (strcmp(key, "heart-beat-id-list") == 0)
+        return parsePeerList(value, config->peer_list);
+    if (strcmp(key, "device") == 0)
+        return copyConfigString(config->device, value);
+    if (strcmp(key, "network-address-url-data-type") == 0)
+        return copyConfigString(config->network_address_url_data_type, value);
+    if (strcmp(key, "network-interface") == 0)
+        return copyConfigString(config->network_interface, value);
+    if (strcmp(key, "pubsub-transport") == 0)
+    {
+        if (strcmp(value, "udp") == 0)
+            config->pubsub_transport = PUBSUB_TRANSPORT_UDP;
+        else if (strcmp(value, "eth") == 0)
+            config->pubsub_transport = PUBSUB_TRANSPORT_ETH;
+        else
+            return -1;
+        return 0;
+    }
+
+    // all other keys are integers
+    if (parseConfigInteger(value, 10, &number) < 0)
+        return -1;
+    if (strcmp(key, "id") == 0)
+        config->id = number;
+    else if (strcmp(key, "mode") == 0)
+        config->mode = number;
+    else if (strcmp(key, "heart-beat") == 0)
+        config->heart_beat = number;
+    else if (strcmp(key, "heart-beat-interval") == 0 && number > 0)
+        config->heart_beat_interval = number;
+    else if (strcmp(key, "heart-beat-timeout-interval") == 0 && number > 0)
+        config->heart_beat_timeout_interval = number;
+    else if (strcmp(key, "io-scan-interval") == 0 && number > 0)
+        config->io_scan_interval = number;
+    else if (strcmp(key, "analog-deadband") == 0 && number >= 0)
+        config->analog_deadband = number;
+    else
+        return -1;
+    return 0;
+}
+
+static int setSlaveConfigValue(config_slave_t *slave, const char *key, char *value)
+{
+    /*
+     * Set a [i2cN] key. Return -1 on unknown key or invalid value.
+     */
+    if (strcmp(key, "address") == 0)
+    {
+        // a hexadecimal address as on the command line (0x58)
+        if (parseConfigInteger(value, 16, &slave->address) < 0 ||
+            slave->address <= 0 || slave->address > 0x7f)
+            return -1;
+        return 0;
+    }
+    if (strcmp(key, "device") == 0)
+        return copyConfigString(slave->device, value);
+    if (strcmp(key, "channels") == 0)
+        return parseChannelMask(value, &slave->channel_mask);
+    return -1;
+}
+
+static int parseCouplerConfig(const char *filename, coupler_config_t *config)
+{
+    /*
+     * Overlay a configuration file on config. Return -1 if the file can not
+     * be read or has an error (config is then partly overwritten).
+     */
+    int slave_index;
+    int line_number = 0;
+    bool slave_list_replaced = false;
+    char line[MAX_CONFIG_LINE_LENGTH];
+    char *key, *value, *separator;
+    config_slave_t *slave = NULL;
+    bool in_coupler_section = false;
+    FILE *file = fopen(filename, "r");
+
+    if (file == NULL)
+    {
+        printf("Can not open configuration file %s.\n", filename);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        key = trimConfigString(line);
+        if (*key == '\0' || *key == '#' || *key == ';')
+            continue;
+
+        if (*key == '[')
+        {
+            separator = strchr(key, ']');
+            if (separator == NULL)
+                goto error;
+            *separator = '\0';
+            key = trimConfigString(key + 1);
+            in_coupler_section = strcmp(key, "coupler") == 0;
+            slave = NULL;
+            if (in_coupler_section)
+                continue;
+            if (strncmp(key, "i2c", 3) != 0 || parseConfigInteger(key + 3, 10, &slave_index) < 0 ||
+                slave_index < 0 || slave_index >= MAX_I2C_SLAVE_COUNT)
+                goto error;
+            if (!slave_list_replaced)
+            {
+                // the file's slaves replace the ones of the command line
+                memset(config->slave_list, 0, sizeof(config->slave_list));
+                slave_list_replaced = true;
+            }
+            slave = &config->slave_list[slave_index];
+            continue;
+        }
+
+        separator = strchr(key, '=');
+        if (separator == NULL)
+            goto error;
+        *separator = '\0';
+        value = trimConfigString(separator + 1);
+        key = trimConfigString(key);
+        if (in_coupler_section)
+        {
+            if (setCouplerConfigValue(config, key, value) < 0)
+                goto error;
+        }
+        else if (slave == NULL || setSlaveConfigValue(slave, key, value) < 0)
+        {
+            goto error;
+        }
+    }
+    fclose(file);
+
+    // a slave section without address
+    for (slave_index = 0; slave_index < MAX_I2C_SLAVE_COUNT; slave_index++)
+    {
+        slave = &config->slave_list[slave_index];
+        if (slave->address == 0 && (slave->device[0] != '\0' || slave->channel_mask != 0))
+        {
+            printf("Configuration file %s: i2c%d has no address.\n", filename, slave_index);
+            return -1;
+        }
+    }
+    return 0;
+
+error:
+    printf("Configuration file %s: error at line %d.\n", filename, line_number);
+    fclose(file);
+    return -1;
+}
+
+static void captureCouplerConfig(coupler_config_t *config)
+{
+    /*
+     * Take the configuration of the global variables (i.e. the command line).
+     */
+    int i;
+    char *device;
+
+    memset(config, 0, sizeof(coupler_config_t));
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        config->slave_list[i].address = I2C_SLAVE_ADDR_LIST[i];
+        device = I2C_SLAVE_DEVICE_LIST[i];
+        if (device != NULL)
+            snprintf(config->slave_list[i].device, MAX_CONFIG_VALUE_LENGTH, "%s", device);
+        config->slave_list[i].channel_mask = MOD_IO_CHANNEL_MASK_LIST[i];
+    }
+    for (i = 0; i < LIVENESS_TABLE.watched_count; i++)
+    {
+        config->peer_list[LIVENESS_TABLE.watched_id_list[i]] = 1;
+    }
+    config->io_scan_interval = IO_SCAN_INTERVAL;
+    config->analog_deadband = IO_SCAN_ANALOG_DEADBAND;
+    config->heart_beat_timeout_interval = HEART_BEAT_TIMEOUT_INTERVAL;
+    config->id = COUPLER_ID;
+    config->mode = getOperationalMode();
+    snprintf(config->device, MAX_CONFIG_VALUE_LENGTH, "%s", I2C_BLOCK_DEVICE_NAME);
+    config->heart_beat = ENABLE_HEART_BEAT;
+    config->heart_beat_interval = HEART_BEAT_INTERVAL;
+    config->pubsub_transport = PUBSUB_TRANSPORT;
+    snprintf(config->network_address_url_data_type, MAX_CONFIG_VALUE_LENGTH, "%s", NETWORK_ADDRESS_URL_DATA_TYPE);
+    snprintf(config->network_interface, MAX_CONFIG_VALUE_LENGTH, "%s", NETWORK_INTERFACE);
+}
+
+static int diffConfigSlave(const config_slave_t *running, const config_slave_t *wanted)
+{
+    /*
+     * Return what changed (CONFIG_SLAVE_*) for a slave.
+     */
+    uint16_t running_mask = running->channel_mask ? running->channel_mask : MOD_IO_CHANNEL_MASK_ALL;
+    uint16_t wanted_mask = wanted->channel_mask ? wanted->channel_mask : MOD_IO_CHANNEL_MASK_ALL;
+
+    if (running->address == 0 && wanted->address == 0)
+        return CONFIG_SLAVE_UNCHANGED;
+    if (running->address == 0)
+        return CONFIG_SLAVE_ADDED;
+    if (wanted->address == 0)
+        return CONFIG_SLAVE_REMOVED;
+    if (running->address != wanted->address || strcmp(running->device, wanted->device) != 0)
+        return CONFIG_SLAVE_REPLACED;
+    if (running_mask != wanted_mask)
+        return CONFIG_SLAVE_CHANNELS_CHANGED;
+    return CONFIG_SLAVE_UNCHANGED;
+}
+
+static void setConfigSlave(int slave_index, const config_slave_t *slave)
+{
+    /*
+     * Set the global slave list entry of a slave.
+     */
+    I2C_SLAVE_ADDR_LIST[slave_index] = slave->address;
+    I2C_SLAVE_DEVICE_LIST[slave_index] = NULL;
+    if (slave->device[0] != '\0')
+    {
+        strcpy(CONFIG_SLAVE_DEVICE_LIST[slave_index], slave->device);
+        I2C_SLAVE_DEVICE_LIST[slave_index] = CONFIG_SLAVE_DEVICE_LIST[slave_index];
+    }
+    MOD_IO_CHANNEL_MASK_LIST[slave_index] = slave->channel_mask;
+}
+
+static void applyStartupCouplerConfig(const coupler_config_t *config)
+{
+    /*
+     * Set the global variables from a configuration, before anything is started.
+     */
+    int i;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        setConfigSlave(i, &config->slave_list[i]);
+    }
+    initLivenessTable(&LIVENESS_TABLE);
+    for (i = 0; i < MAX_COUPLER_COUNT; i++)
+    {
+        if (config->peer_list[i])
+            watchPeer(&LIVENESS_TABLE, i, STATE_NO_INITIAL_HEART_BEAT);
+    }
+    ENABLE_HEART_BEAT_CHECK = LIVENESS_TABLE.watched_count > 0;
+    IO_SCAN_INTERVAL = config->io_scan_interval;
+    IO_SCAN_ANALOG_DEADBAND = config->analog_deadband;
+    HEART_BEAT_TIMEOUT_INTERVAL = config->heart_beat_timeout_interval;
+
+    COUPLER_ID = config->id;
+    setOperationalMode(config->mode);
+    I2C_BLOCK_DEVICE_NAME = strdup(config->device);
+    ENABLE_HEART_BEAT = config->heart_beat;
+    HEART_BEAT_INTERVAL = config->heart_beat_interval;
+    PUBLISHING_INTERVAL = HEART_BEAT_INTERVAL;
+    PUBSUB_TRANSPORT = config->pubsub_transport;
+    NETWORK_ADDRESS_URL_DATA_TYPE = strdup(config->network_address_url_data_type);
+    NETWORK_INTERFACE = strdup(config->network_interface);
+}
+
+static int loadCouplerConfig()
+{
+    /*
+     * Overlay the configuration file (if any) on the command line.
+     * Return -1 if it can not be parsed.
+     */
+    if (strlen(CONFIG_FILENAME) == 0)
+        return 0;
+
+    captureCouplerConfig(&CLI_COUPLER_CONFIG);
+    COUPLER_CONFIG = CLI_COUPLER_CONFIG;
+    if (parseCouplerConfig(CONFIG_FILENAME, &COUPLER_CONFIG) < 0)
+        return -1;
+    applyStartupCouplerConfig(&COUPLER_CONFIG);
+    printf("Configuration file applied, heart beat check=%d\n", ENABLE_HEART_BEAT_CHECK);
+    return 0;
+}
+
+static void detachConfigSlave(UA_Server *server, int slave_index)
+{
+    /*
+     * Switch off the relays of a slave and forget it.
+     */
+    removeModIOSlaveVariables(server, slave_index);
+    pthread_mutex_lock(&IO_SCAN_LOCK);
+    pthread_mutex_lock(&I2C_RELAY_LOCK);
+    setI2CSlaveRelayState(slave_index, 0x00);
+    memset(&RELAY_OUTPUT_LIST[slave_index], 0, sizeof(relay_output_t));
+    I2C_SLAVE_ADDR_LIST[slave_index] = 0;
+    I2C_SLAVE_DEVICE_LIST[slave_index] = NULL;
+    MOD_IO_CHANNEL_MASK_LIST[slave_index] = 0;
+    pthread_mutex_unlock(&I2C_RELAY_LOCK);
+    pthread_mutex_unlock(&IO_SCAN_LOCK);
+    updateModIOChannelListLength();
+}
+
+static int attachConfigSlave(UA_Server *server, int slave_index, const config_slave_t *slave)
+{
+    /*
+     * Open the bus of a new slave, start it with its relays off and expose it.
+     * Return -1 if its bus can not be opened (the slave stays detached).
+     */
+    const char *device = slave->device[0] != '\0' ? slave->device : I2C_BLOCK_DEVICE_NAME;
+    i2c_bus_t *bus;
+
+    pthread_mutex_lock(&IO_SCAN_LOCK);
+    // the probe selects the slave on a bus shared with pending relay writes
+    pthread_mutex_lock(&I2C_RELAY_LOCK);
+    if (!I2C_VIRTUAL_MODE)
+    {
+        bus = getI2CBus((char *)device);
+        if (bus == NULL || selectI2CSlave(bus, slave->address) < 0)
+        {
+            pthread_mutex_unlock(&I2C_RELAY_LOCK);
+            pthread_mutex_unlock(&IO_SCAN_LOCK);
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                         "Can not attach i2c%d (0x%x on %s)", slave_index, slave->address, device);
+            return -1;
+        }
+    }
+    setConfigSlave(slave_index, slave);
+    memset(&RELAY_OUTPUT_LIST[slave_index], 0, sizeof(relay_output_t));
+    setI2CSlaveRelayState(slave_index, 0x00);
+    pthread_mutex_unlock(&I2C_RELAY_LOCK);
+    pthread_mutex_unlock(&IO_SCAN_LOCK);
+    addModIOSlaveVariables(server, slave_index);
+    addI2CDiagnosticsVariables(server, slave_index);
+    return 0;
+}
+
+static void remapConfigSlave(UA_Server *server, int slave_index, uint16_t channel_mask)
+{
+    /*
+     * Change the exposed channels of a slave, relays no longer exposed are switched off.
+     */
+    int relay;
+    uint16_t mask = channel_mask ? channel_mask : MOD_IO_CHANNEL_MASK_ALL;
+
+    removeModIOSlaveVariables(server, slave_index);
+    MOD_IO_CHANNEL_MASK_LIST[slave_index] = channel_mask;
+    for (relay = 0; relay < MOD_IO_RELAY_COUNT; relay++)
+    {
+        if (!(mask & (1U << relay)) && (getRelayOutput(slave_index) & (1U << relay)))
+            setRelayOutput(slave_index, relay, false);
+    }
+    addModIOSlaveVariables(server, slave_index);
+}
+
+static void applyConfigSlaveList(UA_Server *server, coupler_config_t *running, const coupler_config_t *wanted)
+{
+    /*
+     * Attach, detach or remap the slaves which differ, running follows what is applied.
+     */
+    int i;
+    config_slave_t *slave;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        slave = &running->slave_list[i];
+        switch (diffConfigSlave(slave, &wanted->slave_list[i]))
+        {
+        case CONFIG_SLAVE_ADDED:
+            if (attachConfigSlave(server, i, &wanted->slave_list[i]) == 0)
+            {
+                *slave = wanted->slave_list[i];
+                UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Attached i2c%d (0x%x)", i, slave->address);
+            }
+            break;
+        case CONFIG_SLAVE_REMOVED:
+            detachConfigSlave(server, i);
+            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Detached i2c%d (0x%x)", i, slave->address);
+            memset(slave, 0, sizeof(config_slave_t));
+            break;
+        case CONFIG_SLAVE_REPLACED:
+            detachConfigSlave(server, i);
+            memset(slave, 0, sizeof(config_slave_t));
+            if (attachConfigSlave(server, i, &wanted->slave_list[i]) == 0)
+            {
+                *slave = wanted->slave_list[i];
+                UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Replaced i2c%d (0x%x)", i, slave->address);
+            }
+            break;
+        case CONFIG_SLAVE_CHANNELS_CHANGED:
+            remapConfigSlave(server, i, wanted->slave_list[i].channel_mask);
+            slave->channel_mask = wanted->slave_list[i].channel_mask;
+            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Changed channels of i2c%d (0x%x)",
+                        i, slave->address);
+            break;
+        }
+    }
+}
+
+static void applyConfigPeerList(UA_Server *server, coupler_config_t *running, const coupler_config_t *wanted)
+{
+    /*
+     * Watch / stop watching the heart beats of couplers, running follows what is applied.
+     */
+    int i;
+
+    for (i = 0; i < MAX_COUPLER_COUNT; i++)
+    {
+        if (running->peer_list[i] && !wanted->peer_list[i])
+        {
+            unwatchHeartBeatPeer(server, i);
+            running->peer_list[i] = 0;
+            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Stopped watching heart beats of %d", i);
+        }
+    }
+    for (i = 0; i < MAX_COUPLER_COUNT; i++)
+    {
+        if (!running->peer_list[i] && wanted->peer_list[i] && watchHeartBeatPeer(server, i) == 0)
+        {
+            running->peer_list[i] = 1;
+            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Watching heart beats of %d", i);
+        }
+    }
+}
+
+static void logRestartCouplerConfig(const coupler_config_t *running, const coupler_config_t *wanted)
+{
+    /*
+     * Warn about changed settings which are only read at startup.
+     */
+    if (running->id != wanted->id ||
+        running->mode != wanted->mode ||
+        strcmp(running->device, wanted->device) != 0 ||
+        running->heart_beat != wanted->heart_beat ||
+        running->heart_beat_interval != wanted->heart_beat_interval ||
+        running->pubsub_transport != wanted->pubsub_transport ||
+        strcmp(running->network_address_url_data_type, wanted->network_address_url_data_type) != 0 ||
+        strcmp(running->network_interface, wanted->network_interface) != 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                       "Configuration: id, mode, device, heart-beat, heart-beat-interval, pubsub-transport "
+                       "and network settings need a restart");
+    }
+}
+
+static int reloadCouplerConfig(UA_Server *server)
+{
+    /*
+     * Parse the configuration file again and apply what changed.
+     * Return -1 (and keep the running configuration) if it can not be parsed.
+     */
+    static coupler_config_t config;
+
+    config = CLI_COUPLER_CONFIG;
+    if (parseCouplerConfig(CONFIG_FILENAME, &config) < 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                     "Configuration file %s not reloaded", CONFIG_FILENAME);
+        return -1;
+    }
+
+    applyConfigSlaveList(server, &COUPLER_CONFIG, &config);
+    applyConfigPeerList(server, &COUPLER_CONFIG, &config);
+    if (config.io_scan_interval != COUPLER_CONFIG.io_scan_interval)
+    {
+        setIOScanInterval(config.io_scan_interval);
+        setInputChangeNotificationInterval(server);
+        COUPLER_CONFIG.io_scan_interval = config.io_scan_interval;
+    }
+    // read by the scanner at its next cycle
+    __atomic_store_n(&IO_SCAN_ANALOG_DEADBAND, config.analog_deadband, __ATOMIC_RELAXED);
+    COUPLER_CONFIG.analog_deadband = config.analog_deadband;
+    HEART_BEAT_TIMEOUT_INTERVAL = COUPLER_CONFIG.heart_beat_timeout_interval = config.heart_beat_timeout_interval;
+    logRestartCouplerConfig(&COUPLER_CONFIG, &config);
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Configuration file %s reloaded", CONFIG_FILENAME);
+    return 0;
+}
+
+static void reloadHandler(int sign)
+{
+    CONFIG_RELOAD_REQUESTED = 1;
+}
+
+static void callbackReloadCouplerConfig(UA_Server *server, void *data)
+{
+    /*
+     * Reload on the server thread, nodes can only be changed from there.
+     */
+    if (CONFIG_RELOAD_REQUESTED)
+    {
+        CONFIG_RELOAD_REQUESTED = 0;
+        reloadCouplerConfig(server);
+    }
+}
+
+static void enableCouplerConfigReload(UA_Server *server)
+{
+    /*
+     * Reload the configuration file on SIGHUP.
+     */
+    if (strlen(CONFIG_FILENAME) == 0)
+        return;
+
+    signal(SIGHUP, reloadHandler);
+    UA_Server_addRepeatedCallback(server, callbackReloadCouplerConfig, NULL,
+                                  CONFIG_RELOAD_CHECK_INTERVAL, NULL);
+}
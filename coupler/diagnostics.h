@@ -0,0 +1,398 @@
+/*
+ * Diagnostics of the coupler: the metrics histograms (metrics.h) exposed
+ *   - as read only variables under Objects/Diagnostics/<metric> (Count,
+ *     Mean, P50, P99, P999 and Max in ns), computed when read
+ *   - in Prometheus text format on a local Unix socket (CLI "-D"), one
+ *     dump per connection, i.e. socat - UNIX-CONNECT:/run/coupler.metrics
+ *
+ * Readers only take relaxed snapshots, recording is never slowed down.
+ *
+ * The event trace (trace.h, CLI "-E") is dumped to its file on SIGUSR1,
+ * from the server thread, and at exit.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DIAGNOSTICS_VARIABLE_SAMPLE_COUNT 0
+#define DIAGNOSTICS_VARIABLE_MEAN 1
+#define DIAGNOSTICS_VARIABLE_P50 2
+#define DIAGNOSTICS_VARIABLE_P99 3
+#define DIAGNOSTICS_VARIABLE_P999 4
+#define DIAGNOSTICS_VARIABLE_MAX 5
+#define DIAGNOSTICS_VARIABLE_COUNT 6
+
+// numeric NodeIds of a histogram are base + histogram * stride + variable (object is last)
+#define DIAGNOSTICS_NODE_ID_STRIDE 8
+
+// histograms are numbered METRIC_LIST first, then I2C_METRIC_LIST
+
+static const char *DIAGNOSTICS_VARIABLE_NAME_LIST[] = {"Count", "Mean", "P50", "P99", "P999", "Max"};
+
+static const char *METRIC_HELP_LIST[] = {
+    "Duration of an I/O scan cycle.",
+    "Duration of writing the changed inputs of a MOD-IO into their variables.",
+    "Duration of a MOD-IO variable write callback.",
+    "Deviation of the heart beat publish period from the heart beat interval.",
+    "Time between two heart beats of a watched coupler.",
+    "Duration of a heart beat check of all watched couplers."
+};
+
+static int METRICS_SOCKET = -1;
+static pthread_t METRICS_THREAD;
+
+// interval in ms at which the server thread checks for a trace dump request
+#define TRACE_DUMP_CHECK_INTERVAL 200
+
+static volatile sig_atomic_t TRACE_DUMP_REQUESTED = 0;
+
+static metric_histogram_t *getDiagnosticsHistogram(unsigned int histogram)
+{
+    if (histogram < METRIC_COUNT)
+        return &METRIC_LIST[histogram];
+    histogram -= METRIC_COUNT;
+    return &I2C_METRIC_LIST[histogram / METRIC_I2C_OP_COUNT][histogram % METRIC_I2C_OP_COUNT];
+}
+
+static void getDiagnosticsHistogramName(unsigned int histogram, char *name, size_t size)
+{
+    /*
+     * Name of a histogram, i.e. io_scan_cycle or i2c0.read
+     */
+    if (histogram < METRIC_COUNT)
+    {
+        snprintf(name, size, "%s", METRIC_NAME_LIST[histogram]);
+        return;
+    }
+    histogram -= METRIC_COUNT;
+    snprintf(name, size, "i2c%d.%s", histogram / METRIC_I2C_OP_COUNT,
+             METRIC_I2C_OP_NAME_LIST[histogram % METRIC_I2C_OP_COUNT]);
+}
+
+static uint64_t getDiagnosticsValue(const metric_histogram_t *histogram, unsigned int variable)
+{
+    switch (variable)
+    {
+    case DIAGNOSTICS_VARIABLE_SAMPLE_COUNT:
+        return __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    case DIAGNOSTICS_VARIABLE_MEAN:
+        return getMetricMean(histogram);
+    case DIAGNOSTICS_VARIABLE_P50:
+        return getMetricPercentile(histogram, 50.0);
+    case DIAGNOSTICS_VARIABLE_P99:
+        return getMetricPercentile(histogram, 99.0);
+    case DIAGNOSTICS_VARIABLE_P999:
+        return getMetricPercentile(histogram, 99.9);
+    default:
+        return __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    }
+}
+
+static UA_StatusCode readDiagnosticsVariable(UA_Server *server,
+                                             const UA_NodeId *sessionId, void *sessionContext,
+                                             const UA_NodeId *nodeId, void *nodeContext,
+                                             UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                                             UA_DataValue *dataValue)
+{
+    uintptr_t context = (uintptr_t)nodeContext;
+    UA_UInt64 value = getDiagnosticsValue(getDiagnosticsHistogram(context / DIAGNOSTICS_NODE_ID_STRIDE),
+                                          context % DIAGNOSTICS_NODE_ID_STRIDE);
+
+    UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_UINT64]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static void addDiagnosticsHistogramVariables(UA_Server *server, unsigned int histogram)
+{
+    /*
+     * Expose a histogram as an object with its statistics (read only).
+     */
+    int j;
+    char histogram_name[MAX_NODE_ID_NAME_LENGTH];
+    char name[MAX_NODE_ID_NAME_LENGTH];
+    node_id_t folder_node_id, histogram_node_id, variable_node_id;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_DataSource dataSource;
+    UA_UInt32 base = DIAGNOSTICS_NUMERIC_NODE_ID_BASE + histogram * DIAGNOSTICS_NODE_ID_STRIDE;
+
+    dataSource.read = readDiagnosticsVariable;
+    dataSource.write = NULL;
+    getDiagnosticsHistogramName(histogram, histogram_name, sizeof(histogram_name));
+    resolveNodeId(&folder_node_id, "diagnostics", DIAGNOSTICS_NUMERIC_NODE_ID);
+    snprintf(name, sizeof(name), "diagnostics.%s", histogram_name);
+    resolveNodeId(&histogram_node_id, name, base + DIAGNOSTICS_NODE_ID_STRIDE - 1);
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", histogram_name);
+    UA_Server_addObjectNode(server, histogram_node_id.node_id, folder_node_id.node_id,
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                            UA_QUALIFIEDNAME(1, histogram_name),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), oAttr, NULL, NULL);
+
+    for (j = 0; j < DIAGNOSTICS_VARIABLE_COUNT; j++)
+    {
+        UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+        vAttr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)DIAGNOSTICS_VARIABLE_NAME_LIST[j]);
+        vAttr.dataType = UA_TYPES[UA_TYPES_UINT64].typeId;
+        vAttr.accessLevel = UA_ACCESSLEVELMASK_READ;
+        snprintf(name, sizeof(name), "diagnostics.%s.%s", histogram_name, DIAGNOSTICS_VARIABLE_NAME_LIST[j]);
+        resolveNodeId(&variable_node_id, name, base + j);
+        UA_Server_addDataSourceVariableNode(server, variable_node_id.node_id, histogram_node_id.node_id,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                            UA_QUALIFIEDNAME(1, (char *)DIAGNOSTICS_VARIABLE_NAME_LIST[j]),
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                            vAttr, dataSource,
+                                            (void *)(uintptr_t)(histogram * DIAGNOSTICS_NODE_ID_STRIDE + j),
+                                            NULL);
+    }
+}
+
+static void addI2CDiagnosticsVariables(UA_Server *server, int slave_index)
+{
+    /*
+     * Expose the I2C transaction latency of a slave (already exposed ones are kept).
+     */
+    int op;
+
+    for (op = 0; op < METRIC_I2C_OP_COUNT; op++)
+        addDiagnosticsHistogramVariables(server, METRIC_COUNT + slave_index * METRIC_I2C_OP_COUNT + op);
+}
+
+static void addDiagnosticsVariables(UA_Server *server)
+{
+    /*
+     * Create Objects/Diagnostics with all histograms of attached slaves.
+     */
+    int i;
+    node_id_t folder_node_id;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Diagnostics");
+    resolveNodeId(&folder_node_id, "diagnostics", DIAGNOSTICS_NUMERIC_NODE_ID);
+    UA_Server_addObjectNode(server, folder_node_id.node_id, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                            UA_QUALIFIEDNAME(1, "Diagnostics"),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), oAttr, NULL, NULL);
+
+    for (i = 0; i < METRIC_COUNT; i++)
+        addDiagnosticsHistogramVariables(server, i);
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
+            addI2CDiagnosticsVariables(server, i);
+    }
+}
+
+static void dumpMetricHistogram(FILE *file, const char *name, const char *labels,
+                                const metric_histogram_t *histogram)
+{
+    /*
+     * Write a histogram in Prometheus text format (seconds), only non empty
+     * buckets are listed. labels is empty or i.e. op="read".
+     */
+    unsigned int i;
+    uint32_t count;
+    uint64_t cumulative = 0;
+    const char *separator = labels[0] != '\0' ? "," : "";
+
+    for (i = 0; i < METRIC_BUCKET_COUNT - 1; i++)
+    {
+        count = __atomic_load_n(&histogram->bucket_list[i], __ATOMIC_RELAXED);
+        if (count == 0)
+            continue;
+        cumulative += count;
+        // bucket bounds are integer ns, exact in exponent notation
+        fprintf(file, "%s_bucket{%s%sle=\"%llue-9\"} %llu\n", name, labels, separator,
+                (unsigned long long)getMetricBucketUpperBound(i), (unsigned long long)cumulative);
+    }
+    cumulative += __atomic_load_n(&histogram->bucket_list[METRIC_BUCKET_COUNT - 1], __ATOMIC_RELAXED);
+    fprintf(file, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator, (unsigned long long)cumulative);
+    fprintf(file, "%s_sum{%s} %llue-9\n", name, labels,
+            (unsigned long long)__atomic_load_n(&histogram->sum, __ATOMIC_RELAXED));
+    fprintf(file, "%s_count{%s} %llu\n", name, labels, (unsigned long long)cumulative);
+}
+
+static void dumpMetrics(FILE *file)
+{
+    /*
+     * Write all metrics in Prometheus text format.
+     */
+    int i, op, watched_count;
+    char name[64];
+    char labels[64];
+    uint16_t watched_id_list[MAX_COUPLER_COUNT];
+    liveness_t *peer;
+
+    for (i = 0; i < METRIC_COUNT; i++)
+    {
+        snprintf(name, sizeof(name), "coupler_%s_seconds", METRIC_NAME_LIST[i]);
+        fprintf(file, "# HELP %s %s\n# TYPE %s histogram\n", name, METRIC_HELP_LIST[i], name);
+        dumpMetricHistogram(file, name, "", &METRIC_LIST[i]);
+    }
+
+    fprintf(file, "# HELP coupler_i2c_transaction_seconds I2C transaction latency of a slave.\n"
+                  "# TYPE coupler_i2c_transaction_seconds histogram\n");
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] == 0)
+            continue;
+        for (op = 0; op < METRIC_I2C_OP_COUNT; op++)
+        {
+            snprintf(labels, sizeof(labels), "slave=\"%d\",address=\"0x%x\",op=\"%s\"",
+                     i, I2C_SLAVE_ADDR_LIST[i], METRIC_I2C_OP_NAME_LIST[op]);
+            dumpMetricHistogram(file, "coupler_i2c_transaction_seconds", labels, &I2C_METRIC_LIST[i][op]);
+        }
+    }
+
+    fprintf(file, "# HELP coupler_safe_mode_total Switches to safe mode.\n"
+                  "# TYPE coupler_safe_mode_total counter\n"
+                  "coupler_safe_mode_total %u\n", SAFE_MODE_STATE_COUNTER);
+    fprintf(file, "# HELP coupler_relay_writes_total Relay writes requested.\n"
+                  "# TYPE coupler_relay_writes_total counter\n"
+                  "coupler_relay_writes_total %u\n",
+            __atomic_load_n(&RELAY_OUTPUT_WRITE_COUNTER, __ATOMIC_RELAXED));
+    fprintf(file, "# HELP coupler_relay_i2c_writes_total I2C relay writes issued.\n"
+                  "# TYPE coupler_relay_i2c_writes_total counter\n"
+                  "coupler_relay_i2c_writes_total %u\n",
+            __atomic_load_n(&RELAY_OUTPUT_FLUSH_COUNTER, __ATOMIC_RELAXED));
+
+    fprintf(file, "# HELP coupler_peer_heart_beats_total Heart beats received from a watched coupler.\n"
+                  "# TYPE coupler_peer_heart_beats_total counter\n");
+    watched_count = copyWatchedPeerList(&LIVENESS_TABLE, watched_id_list);
+    for (i = 0; i < watched_count; i++)
+    {
+        peer = &LIVENESS_TABLE.peer_list[watched_id_list[i]];
+        fprintf(file, "coupler_peer_heart_beats_total{peer=\"%d\"} %u\n", watched_id_list[i],
+                __atomic_load_n(&peer->heart_beat_count, __ATOMIC_RELAXED));
+    }
+    fprintf(file, "# HELP coupler_peer_missed_total Heart beats missed from a watched coupler.\n"
+                  "# TYPE coupler_peer_missed_total counter\n");
+    for (i = 0; i < watched_count; i++)
+    {
+        peer = &LIVENESS_TABLE.peer_list[watched_id_list[i]];
+        fprintf(file, "coupler_peer_missed_total{peer=\"%d\"} %u\n", watched_id_list[i],
+                __atomic_load_n(&peer->missed_count, __ATOMIC_RELAXED));
+    }
+}
+
+static void *runMetricsSocket(void *arg)
+{
+    /*
+     * Serve one dump per connection until the socket is shut down.
+     */
+    int fd;
+    FILE *file;
+
+    for (;;)
+    {
+        fd = accept(METRICS_SOCKET, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        file = fdopen(fd, "w");
+        if (file == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        dumpMetrics(file);
+        fclose(file);
+    }
+    return NULL;
+}
+
+int startMetricsSocket()
+{
+    /*
+     * Listen on the Unix socket of the Prometheus dump (if any).
+     * Return -1 if it can not be created.
+     */
+    struct sockaddr_un address;
+
+    if (strlen(METRICS_SOCKET_PATH) == 0)
+        return 0;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(METRICS_SOCKET_PATH) >= sizeof(address.sun_path))
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Metrics socket path too long");
+        return -1;
+    }
+    strcpy(address.sun_path, METRICS_SOCKET_PATH);
+
+    METRICS_SOCKET = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (METRICS_SOCKET < 0)
+        return -1;
+    // a socket left over by a previous run
+    unlink(METRICS_SOCKET_PATH);
+    if (bind(METRICS_SOCKET, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(METRICS_SOCKET, 4) < 0 ||
+        pthread_create(&METRICS_THREAD, NULL, runMetricsSocket, NULL) != 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                     "Can not serve metrics on %s", METRICS_SOCKET_PATH);
+        close(METRICS_SOCKET);
+        METRICS_SOCKET = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void stopMetricsSocket()
+{
+    if (METRICS_SOCKET < 0)
+        return;
+
+    // wakes up accept()
+    shutdown(METRICS_SOCKET, SHUT_RDWR);
+    pthread_join(METRICS_THREAD, NULL);
+    close(METRICS_SOCKET);
+    METRICS_SOCKET = -1;
+    unlink(METRICS_SOCKET_PATH);
+}
+
+static void dumpTraceToFile()
+{
+    if (!TRACE_ENABLED)
+        return;
+    if (dumpTraceFile(TRACE_FILENAME, COUPLER_ID) < 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Can not dump trace to %s", TRACE_FILENAME);
+        return;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Trace dumped to %s", TRACE_FILENAME);
+}
+
+static void traceDumpHandler(int sign)
+{
+    TRACE_DUMP_REQUESTED = 1;
+}
+
+static void callbackDumpTrace(UA_Server *server, void *data)
+{
+    /*
+     * Dump on the server thread, never from the signal handler.
+     */
+    if (TRACE_DUMP_REQUESTED)
+    {
+        TRACE_DUMP_REQUESTED = 0;
+        dumpTraceToFile();
+    }
+}
+
+static void enableTraceDump(UA_Server *server)
+{
+    /*
+     * Dump the trace on SIGUSR1.
+     */
+    if (!TRACE_ENABLED)
+        return;
+
+    signal(SIGUSR1, traceDumpHandler);
+    UA_Server_addRepeatedCallback(server, callbackDumpTrace, NULL, TRACE_DUMP_CHECK_INTERVAL, NULL);
+}
@@ -1,60 +1,212 @@
+/*
+ * GPIO measurement lines (for timing with a logic analyzer).
+ *
+ * One output line per event class, all requested once at startup with the
+ * GPIO v2 character device API (one request, one file descriptor):
+ *   - heart beat received: toggled at every heart beat of a watched coupler
+ *   - relay write: toggled at every OPC UA write of the first relay of i2c0
+ *   - safe mode: high while in safe mode
+ * Any set of lines is changed with a single GPIO_V2_LINE_SET_VALUES_IOCTL,
+ * so a probe costs one system call and no longer distorts what it measures.
+ *
+ * The chip ("-G") and one offset per event class ("-L", -1 disables a
+ * class) are configurable. Schema for STMP15x-Shield on /dev/gpiochip1:
+ *   GND         : pin 2
+ *   line 7      : pin 9
+ *
+ * Legacy: CURRENT_GPIO_MODE=1 (heart beats) or 2 (first i2c0.relay0) in the
+ * environment selects line 7 for that event class if no offsets are given.
+ */
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include <linux/gpio.h>
 
-// the current GPI state (used for debuging)
-static unsigned int CURRENT_GPIO_STATE = 0;
+// event classes, each with a line of its own
+#define GPIO_EVENT_HEART_BEAT_RX 0
+#define GPIO_EVENT_RELAY_WRITE 1
+#define GPIO_EVENT_SAFE_MODE 2
+#define GPIO_EVENT_COUNT 3
+
+#define DEFAULT_GPIO_CHIP_NAME "/dev/gpiochip1"
+#define DEFAULT_GPIO_LINE_OFFSET 7
 
 /*
-*  variable representing the measurement mode over GPIO
+*  variable representing the legacy measurement mode over GPIO
 *  0: disabled
 *  1: enabled for keep-alive subsystem
 *  2: enabled for first i2c0.relay0
 */
 static unsigned int CURRENT_GPIO_MODE = 0;
 
-static int setGPIO() {
-  /*
-   * Set GPIO state (useful for debuging with logical analyzer)
-   */
-  int fd;
-  struct gpiohandle_request led;
-  struct gpiohandle_data data;
-
-  /* Schema for STMP15x-Shield
-   * GND         : pin 2
-   * Channel 0   : pin 9
-   */
-
-  fd = open("/dev/gpiochip1", O_RDWR);
-  if(fd < 0) {
-    perror("Error opening gpiochip");
-    return -1;
-  }
-
-  /* Setup GPIO to output */
-  led.flags = GPIOHANDLE_REQUEST_OUTPUT;
-  strcpy(led.consumer_label, "LED");
-  memset(led.default_values, 0, sizeof(led.default_values));
-  led.lines = 1;
-  led.lineoffsets[0] = 7;
-
-  if(ioctl(fd, GPIO_GET_LINEHANDLE_IOCTL, &led) < 0) {
-    perror("Error setting GPIO to output");
+static char *GPIO_CHIP_NAME = DEFAULT_GPIO_CHIP_NAME;
+
+// offset of the line of every event class on the chip (-1 disabled)
+static int GPIO_LINE_OFFSET_LIST[GPIO_EVENT_COUNT] = {-1, -1, -1};
+
+// the line request, -1 if no measurement line
+static int GPIO_LINE_FD = -1;
+
+// bit of every event class' line in the request (0 disabled)
+static uint64_t GPIO_EVENT_MASK_LIST[GPIO_EVENT_COUNT];
+
+// current values of all requested lines (bit per line)
+static uint64_t GPIO_LINE_VALUES = 0;
+
+static int parseGPIOLineOffsetList(char *text, int *offset_list)
+{
+    /*
+     * Convert a comma separated list of line offsets (heart beat received,
+     * relay write, safe mode) to offset_list. Missing ones are disabled.
+     * Return -1 if an offset is not a number.
+     */
+    int i;
+    long offset;
+    char *eptr;
+    char *save;
+    char *token = strtok_r(text, ",", &save);
+
+    for (i = 0; i < GPIO_EVENT_COUNT; i++)
+        offset_list[i] = -1;
+    for (i = 0; token != NULL && i < GPIO_EVENT_COUNT; i++)
+    {
+        offset = strtol(token, &eptr, 10);
+        if (eptr == token || *eptr != '\0' || offset < -1)
+            return -1;
+        offset_list[i] = (int)offset;
+        token = strtok_r(NULL, ",", &save);
+    }
+    return 0;
+}
+
+static unsigned int initGPIOLineRequest(struct gpio_v2_line_request *request, const int *offset_list,
+                                        uint64_t *mask_list)
+{
+    /*
+     * Fill a request of all enabled lines as outputs starting low. Event
+     * classes sharing an offset share its line. Return the number of lines.
+     */
+    int i;
+    unsigned int line;
+
+    memset(request, 0, sizeof(*request));
+    strncpy(request->consumer, "coupler", sizeof(request->consumer) - 1);
+    request->config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    for (i = 0; i < GPIO_EVENT_COUNT; i++)
+    {
+        mask_list[i] = 0;
+        if (offset_list[i] < 0)
+            continue;
+        for (line = 0; line < request->num_lines; line++)
+        {
+            if (request->offsets[line] == (uint32_t)offset_list[i])
+                break;
+        }
+        if (line == request->num_lines)
+            request->offsets[request->num_lines++] = offset_list[i];
+        mask_list[i] = 1ULL << line;
+    }
+    return request->num_lines;
+}
+
+static int openGPIO()
+{
+    /*
+     * Request the measurement lines (if any) once.
+     * Return -1 if they can not be requested (measurement stays disabled).
+     */
+    int fd;
+    int i;
+    struct gpio_v2_line_request request;
+
+    if (CURRENT_GPIO_MODE == 1 && GPIO_LINE_OFFSET_LIST[GPIO_EVENT_HEART_BEAT_RX] < 0)
+        GPIO_LINE_OFFSET_LIST[GPIO_EVENT_HEART_BEAT_RX] = DEFAULT_GPIO_LINE_OFFSET;
+    if (CURRENT_GPIO_MODE == 2 && GPIO_LINE_OFFSET_LIST[GPIO_EVENT_RELAY_WRITE] < 0)
+        GPIO_LINE_OFFSET_LIST[GPIO_EVENT_RELAY_WRITE] = DEFAULT_GPIO_LINE_OFFSET;
+
+    if (initGPIOLineRequest(&request, GPIO_LINE_OFFSET_LIST, GPIO_EVENT_MASK_LIST) == 0)
+        return 0;
+
+    fd = open(GPIO_CHIP_NAME, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("Error opening gpiochip");
+        memset(GPIO_EVENT_MASK_LIST, 0, sizeof(GPIO_EVENT_MASK_LIST));
+        return -1;
+    }
+    if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &request) < 0)
+    {
+        perror("Error setting GPIO to output");
+        close(fd);
+        memset(GPIO_EVENT_MASK_LIST, 0, sizeof(GPIO_EVENT_MASK_LIST));
+        return -1;
+    }
+    // the request outlives the chip's descriptor
     close(fd);
-    return -1;
-  }
+    GPIO_LINE_FD = request.fd;
+    for (i = 0; i < GPIO_EVENT_COUNT; i++)
+    {
+        if (GPIO_LINE_OFFSET_LIST[i] >= 0)
+            printf("GPIO measurement line %d: %s offset %d\n", i, GPIO_CHIP_NAME, GPIO_LINE_OFFSET_LIST[i]);
+    }
+    return 0;
+}
 
-  // revert previous state
-  if (CURRENT_GPIO_STATE) CURRENT_GPIO_STATE = 0;
-  else CURRENT_GPIO_STATE = 1;
+static void closeGPIO()
+{
+    if (GPIO_LINE_FD < 0)
+        return;
+    memset(GPIO_EVENT_MASK_LIST, 0, sizeof(GPIO_EVENT_MASK_LIST));
+    close(GPIO_LINE_FD);
+    GPIO_LINE_FD = -1;
+}
+
+static void setGPIOLineValues(uint64_t values, uint64_t mask)
+{
+    /*
+     * Set the lines of mask to values in one ioctl.
+     */
+    struct gpio_v2_line_values data;
+
+    data.bits = values;
+    data.mask = mask;
+    if (ioctl(GPIO_LINE_FD, GPIO_V2_LINE_SET_VALUES_IOCTL, &data) < 0)
+        perror("Error setting GPIO");
+}
 
-  // set actual GPI value
-  data.values[0] = CURRENT_GPIO_STATE;
-  if(ioctl(led.fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0)
-    perror("Error setting GPIO to 1");
+static inline void toggleGPIO(int event)
+{
+    /*
+     * Toggle the line of an event class (if enabled), from any thread.
+     */
+    uint64_t mask = GPIO_EVENT_MASK_LIST[event];
 
-  close(fd);
-  close(led.fd);
-  return 0;
+    if (__builtin_expect(mask != 0, 0))
+        setGPIOLineValues(__atomic_xor_fetch(&GPIO_LINE_VALUES, mask, __ATOMIC_RELAXED), mask);
 }
 
+static inline void setGPIO(int event, bool value)
+{
+    /*
+     * Set the line of an event class (if enabled) to a level, from any thread.
+     */
+    uint64_t mask = GPIO_EVENT_MASK_LIST[event];
+
+    if (__builtin_expect(mask != 0, 0))
+    {
+        if (value)
+            setGPIOLineValues(__atomic_or_fetch(&GPIO_LINE_VALUES, mask, __ATOMIC_RELAXED), mask);
+        else
+            setGPIOLineValues(__atomic_and_fetch(&GPIO_LINE_VALUES, ~mask, __ATOMIC_RELAXED), mask);
+    }
+}
 
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Persistent I2C bus handles.
+ *
+ * Each I2C block device (/dev/i2c-N) is opened only once and kept open for
+ * the whole lifetime of the coupler. The slave address last selected with
+ * ioctl(I2C_SLAVE) is cached per bus so re-addressing is skipped as long as
+ * consecutive transactions target the same MOD-IO.
+ *
+ * Transactions go through the bus backend chosen when a bus is opened
+ * (I2C_BUS_BACKEND): the kernel's i2c-dev interface by default, or the
+ * in-process simulator (i2c_bus_simulation.h).
+ */
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// the maximal number of I2C buses (block devices) a coupler can drive
+#define MAX_I2C_BUS_COUNT 8
+
+// no slave selected yet at this bus
+#define I2C_BUS_NO_SLAVE -1
+
+// the maximal number of registers read in one combined transaction
+// (two I2C messages per register, the kernel allows up to I2C_RDWR_IOCTL_MAX_MSGS)
+#define MAX_I2C_REGISTER_READ_COUNT 16
+
+typedef struct i2c_bus i2c_bus_t;
+
+// how transactions reach the slaves, all return -1 (errno set) on error
+typedef struct {
+    const char *name;
+    int (*open)(i2c_bus_t *bus);                                    // 0 if opened
+    void (*close)(i2c_bus_t *bus);
+    int (*select_slave)(i2c_bus_t *bus, int i2c_addr);              // 0 if addressed
+    int (*write)(i2c_bus_t *bus, const uint8_t *buf, uint16_t length);         // bytes written
+    int (*read)(i2c_bus_t *bus, uint8_t *buf, uint16_t length);                // bytes read
+    int (*transfer)(i2c_bus_t *bus, struct i2c_msg *msg_list, int count);     // messages transferred
+} i2c_bus_backend_t;
+
+struct i2c_bus {
+    char *device;                       // block device path, i.e. /dev/i2c-1
+    int fd;                             // opened file descriptor (-1 if none)
+    int slave_addr;                     // currently addressed slave (cached)
+    const i2c_bus_backend_t *backend;
+    void *context;                      // backend state
+};
+
+// all opened I2C buses
+static i2c_bus_t I2C_BUS_LIST[MAX_I2C_BUS_COUNT];
+static int I2C_BUS_COUNT = 0;
+
+static int openI2CDevBus(i2c_bus_t *bus)
+{
+    bus->fd = open(bus->device, O_RDWR);
+    return bus->fd < 0 ? -1 : 0;
+}
+
+static void closeI2CDevBus(i2c_bus_t *bus)
+{
+    close(bus->fd);
+    bus->fd = -1;
+}
+
+static int selectI2CDevSlave(i2c_bus_t *bus, int i2c_addr)
+{
+    return ioctl(bus->fd, I2C_SLAVE, i2c_addr) < 0 ? -1 : 0;
+}
+
+static int writeI2CDevSlave(i2c_bus_t *bus, const uint8_t *buf, uint16_t length)
+{
+    return write(bus->fd, buf, length);
+}
+
+static int readI2CDevSlave(i2c_bus_t *bus, uint8_t *buf, uint16_t length)
+{
+    return read(bus->fd, buf, length);
+}
+
+static int transferI2CDevMessageList(i2c_bus_t *bus, struct i2c_msg *msg_list, int count)
+{
+    struct i2c_rdwr_ioctl_data transaction;
+
+    transaction.msgs = msg_list;
+    transaction.nmsgs = count;
+    return ioctl(bus->fd, I2C_RDWR, &transaction);
+}
+
+// the kernel's i2c-dev interface (/dev/i2c-N)
+static const i2c_bus_backend_t I2C_DEV_BUS_BACKEND = {
+    "i2c-dev",
+    openI2CDevBus,
+    closeI2CDevBus,
+    selectI2CDevSlave,
+    writeI2CDevSlave,
+    readI2CDevSlave,
+    transferI2CDevMessageList
+};
+
+// backend of buses opened from now on
+static const i2c_bus_backend_t *I2C_BUS_BACKEND = &I2C_DEV_BUS_BACKEND;
+
+static i2c_bus_t *openI2CBus(char *device)
+{
+    /*
+     * Open an I2C block device and register it in the bus list.
+     * Return NULL if it can not be opened.
+     */
+    i2c_bus_t *bus;
+
+    if (I2C_BUS_COUNT >= MAX_I2C_BUS_COUNT)
+    {
+        printf("Error too many i2c buses (%s).\n", device);
+        return NULL;
+    }
+
+    bus = &I2C_BUS_LIST[I2C_BUS_COUNT];
+    bus->device = device;
+    bus->fd = -1;
+    bus->slave_addr = I2C_BUS_NO_SLAVE;
+    bus->backend = I2C_BUS_BACKEND;
+    bus->context = NULL;
+    if (bus->backend->open(bus) < 0)
+    {
+        /* ERROR HANDLING; you can check errno to see what went wrong */
+        printf("Error opening i2c device (%s).\n", device);
+        return NULL;
+    }
+    I2C_BUS_COUNT++;
+    return bus;
+}
+
+static i2c_bus_t *getI2CBus(char *device)
+{
+    /*
+     * Return the already opened bus for this block device or open it.
+     */
+    int i;
+    i2c_bus_t *bus;
+
+    for (i = 0; i < I2C_BUS_COUNT; i++)
+    {
+        bus = &I2C_BUS_LIST[i];
+        // most of the time callers pass the very same string so compare pointers first
+        if (bus->device == device || strcmp(bus->device, device) == 0)
+        {
+            return bus;
+        }
+    }
+    return openI2CBus(device);
+}
+
+static int selectI2CSlave(i2c_bus_t *bus, int i2c_addr)
+{
+    /*
+     * Address a slave on this bus unless it is already the addressed one.
+     */
+    if (bus->slave_addr == i2c_addr)
+    {
+        return 0;
+    }
+
+    if (bus->backend->select_slave(bus, i2c_addr) < 0)
+    {
+        // the kernel state is unknown now, force re-addressing next time
+        bus->slave_addr = I2C_BUS_NO_SLAVE;
+        return -1;
+    }
+    bus->slave_addr = i2c_addr;
+    return 0;
+}
+
+static int writeI2CSlave(i2c_bus_t *bus, const uint8_t *buf, uint16_t length)
+{
+    /*
+     * Write to the addressed slave. Return the number of bytes written or -1.
+     */
+    return bus->backend->write(bus, buf, length);
+}
+
+static int readI2CSlave(i2c_bus_t *bus, uint8_t *buf, uint16_t length)
+{
+    /*
+     * Read from the addressed slave. Return the number of bytes read or -1.
+     */
+    return bus->backend->read(bus, buf, length);
+}
+
+static int readI2CRegisterList(i2c_bus_t *bus, int i2c_addr, const uint8_t *reg_list,
+                               const uint16_t *length_list, int count, uint8_t *buf)
+{
+    /*
+     * Read a list of registers of a slave in one combined I2C_RDWR transaction.
+     * Each register is a write of its address followed by a read (repeated
+     * start, no STOP in between). Read bytes are stored consecutively in buf.
+     */
+    int i;
+    uint8_t reg_buf[MAX_I2C_REGISTER_READ_COUNT];
+    struct i2c_msg msg_list[2 * MAX_I2C_REGISTER_READ_COUNT];
+
+    if (count > MAX_I2C_REGISTER_READ_COUNT)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        reg_buf[i] = reg_list[i];
+
+        msg_list[2 * i].addr = i2c_addr;
+        msg_list[2 * i].flags = 0;
+        msg_list[2 * i].len = 1;
+        msg_list[2 * i].buf = &reg_buf[i];
+
+        msg_list[2 * i + 1].addr = i2c_addr;
+        msg_list[2 * i + 1].flags = I2C_M_RD;
+        msg_list[2 * i + 1].len = length_list[i];
+        msg_list[2 * i + 1].buf = buf;
+        buf += length_list[i];
+    }
+
+    if (bus->backend->transfer(bus, msg_list, 2 * count) != 2 * count)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int readI2CRegister(i2c_bus_t *bus, int i2c_addr, uint8_t reg, uint8_t *buf, uint16_t length)
+{
+    /*
+     * Read one register of a slave in one combined I2C_RDWR transaction.
+     */
+    return readI2CRegisterList(bus, i2c_addr, &reg, &length, 1, buf);
+}
+
+void closeI2CBusList()
+{
+    /*
+     * Close all opened I2C buses.
+     */
+    int i;
+
+    for (i = 0; i < I2C_BUS_COUNT; i++)
+    {
+        I2C_BUS_LIST[i].backend->close(&I2C_BUS_LIST[i]);
+        I2C_BUS_LIST[i].slave_addr = I2C_BUS_NO_SLAVE;
+    }
+    I2C_BUS_COUNT = 0;
+}
+
+#endif
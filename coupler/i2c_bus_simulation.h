@@ -0,0 +1,478 @@
+/*
+ * In-process I2C bus simulator (coupler "-m 2").
+ *
+ * A bus backend (i2c_bus.h) with simulated MOD-IOs instead of /dev/i2c-N,
+ * so the whole I2C path (relay writes, input scans, coalescing, safe mode)
+ * runs on any Linux host, i.e. in CI:
+ *   - register model of a MOD-IO: 0x10 relays (write), 0x20 IN0..3 and
+ *     0x30..0x33 AIN0..3 (read, 10 bit little endian). IN0..3 follow the
+ *     relays (loopback wiring) unless disabled, other inputs are set with
+ *     setI2CSimulatedModIOInput()
+ *   - timing: every transaction takes its bit time at the bus clock
+ *     (START, 9 clocks per byte incl. ACK, repeated START, STOP) plus a
+ *     fixed driver / system call overhead. Transactions of one bus are
+ *     serialized like on a real adapter
+ *   - faults injected per transaction with given probabilities: NAK
+ *     (ENXIO after the address byte), timeout (ETIMEDOUT) and stuck bus
+ *     (every transaction times out for a while, until bus recovery)
+ *
+ * Configured with "-B", i.e. "clock=400,nak=0.001,stuck=0.0001". Relies on
+ * the MOD-IO definitions of mod_io_i2c.h.
+ */
+#ifndef I2C_BUS_SIMULATION_H
+#define I2C_BUS_SIMULATION_H
+
+#include <errno.h>
+#include <pthread.h>
+#include "time_base.h"
+
+// the maximal number of simulated MOD-IOs on a bus
+#define MAX_I2C_SIMULATED_MOD_IO_COUNT 16
+
+#define DEFAULT_I2C_SIMULATION_CLOCK 100000             // Hz
+#define DEFAULT_I2C_SIMULATION_OVERHEAD 30000           // ns, driver and system call (assumed)
+#define DEFAULT_I2C_SIMULATION_TIMEOUT 25000000         // ns, SMBus clock low timeout
+#define DEFAULT_I2C_SIMULATION_STUCK_TIME 100000000     // ns until bus recovery
+
+// the end of a transaction is waited for busy, sleeping overshoots by the timer slack
+#define I2C_SIMULATION_SPIN_TIME 100000                 // ns
+
+// clocks of a message: (repeated) START, address byte, data bytes (9 clocks with ACK)
+#define I2C_SIMULATION_MESSAGE_CLOCKS(length) (1 + 9 + 9 * (length))
+
+typedef struct {
+    unsigned int clock;                 // Hz, 0 for transactions without duration
+    uint64_t overhead;                  // ns per transaction
+    uint64_t timeout;                   // ns until a timed out transaction fails
+    uint64_t stuck_time;                // ns a stuck bus stays stuck
+    double nak_probability;             // per transaction
+    double timeout_probability;
+    double stuck_probability;
+    bool loopback;                      // IN0..3 follow relays 0..3
+    bool auto_attach;                   // a MOD-IO answers at every addressed slave
+    unsigned int seed;                  // of the fault injection
+} i2c_simulation_config_t;
+
+typedef struct {
+    int address;
+    uint8_t relay;                      // relays 0..3 as bits 0..3
+    uint8_t pointer;                    // register last written
+    mod_io_input_t input;
+    uint64_t write_count;
+    uint64_t read_count;
+} i2c_simulated_mod_io_t;
+
+typedef struct {
+    pthread_mutex_t lock;               // one transaction at a time
+    i2c_simulated_mod_io_t mod_io_list[MAX_I2C_SIMULATED_MOD_IO_COUNT];
+    int mod_io_count;
+    unsigned int random_state;
+    uint64_t stuck_until;               // monotonic ns
+    // statistics
+    uint64_t transaction_count;
+    uint64_t nak_count;
+    uint64_t timeout_count;
+    uint64_t stuck_count;
+    uint64_t busy_time;                 // ns
+} i2c_simulated_bus_t;
+
+static i2c_simulation_config_t I2C_SIMULATION_CONFIG = {
+    DEFAULT_I2C_SIMULATION_CLOCK,
+    DEFAULT_I2C_SIMULATION_OVERHEAD,
+    DEFAULT_I2C_SIMULATION_TIMEOUT,
+    DEFAULT_I2C_SIMULATION_STUCK_TIME,
+    0.0,
+    0.0,
+    0.0,
+    true,
+    true,
+    1
+};
+
+// state of every simulated bus, as I2C_BUS_LIST
+static i2c_simulated_bus_t I2C_SIMULATED_BUS_LIST[MAX_I2C_BUS_COUNT];
+
+static int parseI2CSimulationConfig(char *text, i2c_simulation_config_t *config)
+{
+    /*
+     * Parse comma separated <key>=<value> settings into config:
+     *   clock (kHz), overhead (us), timeout-time (ms), stuck-time (ms),
+     *   nak, timeout, stuck (probabilities), loopback (0 / 1), seed
+     * Return -1 on an unknown key or invalid value.
+     */
+    char *save;
+    char *value;
+    char *eptr;
+    double number;
+    char *token = strtok_r(text, ",", &save);
+
+    for (; token != NULL; token = strtok_r(NULL, ",", &save))
+    {
+        value = strchr(token, '=');
+        if (value == NULL)
+            return -1;
+        *value++ = '\0';
+        number = strtod(value, &eptr);
+        if (eptr == value || *eptr != '\0' || number < 0)
+            return -1;
+        if (strcmp(token, "clock") == 0)
+            config->clock = (unsigned int)(number * 1000);
+        else if (strcmp(token, "overhead") == 0)
+            config->overhead = (uint64_t)(number * NANO_SECONDS_PER_MICRO_SECOND);
+        else if (strcmp(token, "timeout-time") == 0)
+            config->timeout = (uint64_t)(number * NANO_SECONDS_PER_MILLI_SECOND);
+        else if (strcmp(token, "stuck-time") == 0)
+            config->stuck_time = (uint64_t)(number * NANO_SECONDS_PER_MILLI_SECOND);
+        else if (strcmp(token, "nak") == 0 && number <= 1)
+            config->nak_probability = number;
+        else if (strcmp(token, "timeout") == 0 && number <= 1)
+            config->timeout_probability = number;
+        else if (strcmp(token, "stuck") == 0 && number <= 1)
+            config->stuck_probability = number;
+        else if (strcmp(token, "loopback") == 0)
+            config->loopback = number != 0;
+        else if (strcmp(token, "seed") == 0)
+            config->seed = (unsigned int)number;
+        else
+            return -1;
+    }
+    return 0;
+}
+
+static uint64_t getI2CSimulationTime(unsigned int clocks)
+{
+    /*
+     * Return the duration (ns) of a transaction of a number of bus clocks.
+     */
+    if (I2C_SIMULATION_CONFIG.clock == 0)
+        return 0;
+    return (uint64_t)clocks * NANO_SECONDS_PER_SECOND / I2C_SIMULATION_CONFIG.clock +
+           I2C_SIMULATION_CONFIG.overhead;
+}
+
+static i2c_simulated_mod_io_t *findI2CSimulatedModIO(i2c_simulated_bus_t *simulated_bus, int i2c_addr)
+{
+    /*
+     * Return the MOD-IO answering at an address (attached on first use if
+     * auto attach is on) or NULL.
+     */
+    int i;
+    i2c_simulated_mod_io_t *mod_io;
+
+    for (i = 0; i < simulated_bus->mod_io_count; i++)
+    {
+        if (simulated_bus->mod_io_list[i].address == i2c_addr)
+            return &simulated_bus->mod_io_list[i];
+    }
+    if (!I2C_SIMULATION_CONFIG.auto_attach || simulated_bus->mod_io_count == MAX_I2C_SIMULATED_MOD_IO_COUNT)
+        return NULL;
+    mod_io = &simulated_bus->mod_io_list[simulated_bus->mod_io_count++];
+    memset(mod_io, 0, sizeof(*mod_io));
+    mod_io->address = i2c_addr;
+    return mod_io;
+}
+
+static void beginI2CSimulatedTransaction(i2c_simulated_bus_t *simulated_bus, uint64_t *start)
+{
+    pthread_mutex_lock(&simulated_bus->lock);
+    *start = getMonotonicNanoSeconds();
+    simulated_bus->transaction_count++;
+}
+
+static int endI2CSimulatedTransaction(i2c_simulated_bus_t *simulated_bus, uint64_t start, uint64_t duration,
+                                      int result, int error)
+{
+    /*
+     * Hold the bus for the duration of the transaction. Return result
+     * (errno set to error if it failed).
+     */
+    if (duration > I2C_SIMULATION_SPIN_TIME)
+    {
+        while (sleepUntilMonotonicNanoSeconds(start + duration - I2C_SIMULATION_SPIN_TIME) == EINTR)
+            ;
+    }
+    while (getMonotonicNanoSeconds() < start + duration)
+        ;
+    simulated_bus->busy_time += duration;
+    pthread_mutex_unlock(&simulated_bus->lock);
+    if (result < 0)
+        errno = error;
+    return result;
+}
+
+static int injectI2CSimulationFault(i2c_simulated_bus_t *simulated_bus, uint64_t start, uint64_t *duration,
+                                    int *error)
+{
+    /*
+     * Roll the faults of a transaction. Return -1 with its duration and
+     * errno if it fails.
+     */
+    double roll;
+
+    if (start < simulated_bus->stuck_until)
+    {
+        simulated_bus->timeout_count++;
+        *duration = I2C_SIMULATION_CONFIG.timeout;
+        *error = ETIMEDOUT;
+        return -1;
+    }
+    if (I2C_SIMULATION_CONFIG.nak_probability == 0 && I2C_SIMULATION_CONFIG.timeout_probability == 0 &&
+        I2C_SIMULATION_CONFIG.stuck_probability == 0)
+        return 0;
+
+    roll = rand_r(&simulated_bus->random_state) / ((double)RAND_MAX + 1);
+    if (roll < I2C_SIMULATION_CONFIG.stuck_probability)
+    {
+        // SDA held low: nothing gets through until the bus is recovered
+        simulated_bus->stuck_until = start + I2C_SIMULATION_CONFIG.stuck_time;
+        simulated_bus->stuck_count++;
+        simulated_bus->timeout_count++;
+        *duration = I2C_SIMULATION_CONFIG.timeout;
+        *error = ETIMEDOUT;
+        return -1;
+    }
+    roll -= I2C_SIMULATION_CONFIG.stuck_probability;
+    if (roll < I2C_SIMULATION_CONFIG.timeout_probability)
+    {
+        simulated_bus->timeout_count++;
+        *duration = I2C_SIMULATION_CONFIG.timeout;
+        *error = ETIMEDOUT;
+        return -1;
+    }
+    roll -= I2C_SIMULATION_CONFIG.timeout_probability;
+    if (roll < I2C_SIMULATION_CONFIG.nak_probability)
+    {
+        simulated_bus->nak_count++;
+        *duration = getI2CSimulationTime(I2C_SIMULATION_MESSAGE_CLOCKS(0) + 1);
+        *error = ENXIO;
+        return -1;
+    }
+    return 0;
+}
+
+static void writeI2CSimulatedModIO(i2c_simulated_mod_io_t *mod_io, const uint8_t *buf, uint16_t length)
+{
+    /*
+     * A write selects a register, data written to 0x10 sets the relays.
+     */
+    if (length == 0)
+        return;
+    mod_io->pointer = buf[0];
+    if (buf[0] == MOD_IO_RELAY_REGISTER && length > 1)
+    {
+        mod_io->relay = buf[1] & 0x0F;
+        mod_io->write_count++;
+    }
+}
+
+static void readI2CSimulatedModIO(i2c_simulated_mod_io_t *mod_io, uint8_t *buf, uint16_t length)
+{
+    /*
+     * Read the register last written, an unknown one reads as a released bus.
+     */
+    uint8_t reg = mod_io->pointer;
+    uint16_t analog_input;
+
+    memset(buf, 0xFF, length);
+    mod_io->read_count++;
+    if (reg == MOD_IO_DIGITAL_INPUT_REGISTER && length > 0)
+    {
+        buf[0] = I2C_SIMULATION_CONFIG.loopback ? mod_io->relay : mod_io->input.digital_input & 0x0F;
+    }
+    else if (reg >= MOD_IO_ANALOG_INPUT_REGISTER &&
+             reg < MOD_IO_ANALOG_INPUT_REGISTER + MOD_IO_ANALOG_INPUT_COUNT)
+    {
+        analog_input = mod_io->input.analog_input[reg - MOD_IO_ANALOG_INPUT_REGISTER] & 0x3FF;
+        if (length > 0)
+            buf[0] = analog_input & 0xFF;
+        if (length > 1)
+            buf[1] = analog_input >> 8;
+    }
+}
+
+static int openI2CSimulatedBus(i2c_bus_t *bus)
+{
+    int index = bus - I2C_BUS_LIST;
+    i2c_simulated_bus_t *simulated_bus = &I2C_SIMULATED_BUS_LIST[index];
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+    memset(simulated_bus, 0, sizeof(*simulated_bus));
+    simulated_bus->lock = lock;
+    simulated_bus->random_state = I2C_SIMULATION_CONFIG.seed + index;
+    bus->context = simulated_bus;
+    return 0;
+}
+
+static void closeI2CSimulatedBus(i2c_bus_t *bus)
+{
+    bus->context = NULL;
+}
+
+static int selectI2CSimulatedSlave(i2c_bus_t *bus, int i2c_addr)
+{
+    // as i2c-dev: only remembered, a missing slave NAKs its transactions
+    return 0;
+}
+
+static int writeI2CSimulatedSlave(i2c_bus_t *bus, const uint8_t *buf, uint16_t length)
+{
+    i2c_simulated_bus_t *simulated_bus = (i2c_simulated_bus_t *)bus->context;
+    i2c_simulated_mod_io_t *mod_io;
+    uint64_t start, duration;
+    int error = 0;
+
+    beginI2CSimulatedTransaction(simulated_bus, &start);
+    if (injectI2CSimulationFault(simulated_bus, start, &duration, &error) < 0)
+        return endI2CSimulatedTransaction(simulated_bus, start, duration, -1, error);
+    mod_io = findI2CSimulatedModIO(simulated_bus, bus->slave_addr);
+    if (mod_io == NULL)
+    {
+        simulated_bus->nak_count++;
+        return endI2CSimulatedTransaction(simulated_bus, start,
+                                          getI2CSimulationTime(I2C_SIMULATION_MESSAGE_CLOCKS(0) + 1), -1, ENXIO);
+    }
+    writeI2CSimulatedModIO(mod_io, buf, length);
+    return endI2CSimulatedTransaction(simulated_bus, start,
+                                      getI2CSimulationTime(I2C_SIMULATION_MESSAGE_CLOCKS(length) + 1), length, 0);
+}
+
+static int readI2CSimulatedSlave(i2c_bus_t *bus, uint8_t *buf, uint16_t length)
+{
+    i2c_simulated_bus_t *simulated_bus = (i2c_simulated_bus_t *)bus->context;
+    i2c_simulated_mod_io_t *mod_io;
+    uint64_t start, duration;
+    int error = 0;
+
+    beginI2CSimulatedTransaction(simulated_bus, &start);
+    if (injectI2CSimulationFault(simulated_bus, start, &duration, &error) < 0)
+        return endI2CSimulatedTransaction(simulated_bus, start, duration, -1, error);
+    mod_io = findI2CSimulatedModIO(simulated_bus, bus->slave_addr);
+    if (mod_io == NULL)
+    {
+        simulated_bus->nak_count++;
+        return endI2CSimulatedTransaction(simulated_bus, start,
+                                          getI2CSimulationTime(I2C_SIMULATION_MESSAGE_CLOCKS(0) + 1), -1, ENXIO);
+    }
+    readI2CSimulatedModIO(mod_io, buf, length);
+    return endI2CSimulatedTransaction(simulated_bus, start,
+                                      getI2CSimulationTime(I2C_SIMULATION_MESSAGE_CLOCKS(length) + 1), length, 0);
+}
+
+static int transferI2CSimulatedMessageList(i2c_bus_t *bus, struct i2c_msg *msg_list, int count)
+{
+    /*
+     * A combined transaction: messages with repeated START, one STOP. It
+     * ends at the first message NAKed.
+     */
+    i2c_simulated_bus_t *simulated_bus = (i2c_simulated_bus_t *)bus->context;
+    i2c_simulated_mod_io_t *mod_io;
+    uint64_t start, duration;
+    unsigned int clocks = 1;
+    int error = 0;
+    int i;
+
+    beginI2CSimulatedTransaction(simulated_bus, &start);
+    if (injectI2CSimulationFault(simulated_bus, start, &duration, &error) < 0)
+        return endI2CSimulatedTransaction(simulated_bus, start, duration, -1, error);
+    for (i = 0; i < count; i++)
+    {
+        mod_io = findI2CSimulatedModIO(simulated_bus, msg_list[i].addr);
+        if (mod_io == NULL)
+        {
+            simulated_bus->nak_count++;
+            clocks += I2C_SIMULATION_MESSAGE_CLOCKS(0);
+            return endI2CSimulatedTransaction(simulated_bus, start, getI2CSimulationTime(clocks), -1, ENXIO);
+        }
+        if (msg_list[i].flags & I2C_M_RD)
+            readI2CSimulatedModIO(mod_io, msg_list[i].buf, msg_list[i].len);
+        else
+            writeI2CSimulatedModIO(mod_io, msg_list[i].buf, msg_list[i].len);
+        clocks += I2C_SIMULATION_MESSAGE_CLOCKS(msg_list[i].len);
+    }
+    return endI2CSimulatedTransaction(simulated_bus, start, getI2CSimulationTime(clocks), count, 0);
+}
+
+// simulated MOD-IOs
+static const i2c_bus_backend_t I2C_SIMULATED_BUS_BACKEND = {
+    "simulation",
+    openI2CSimulatedBus,
+    closeI2CSimulatedBus,
+    selectI2CSimulatedSlave,
+    writeI2CSimulatedSlave,
+    readI2CSimulatedSlave,
+    transferI2CSimulatedMessageList
+};
+
+static void enableI2CSimulation()
+{
+    /*
+     * Simulate all buses opened from now on.
+     */
+    I2C_BUS_BACKEND = &I2C_SIMULATED_BUS_BACKEND;
+}
+
+static i2c_simulated_bus_t *getI2CSimulatedBus(char *device)
+{
+    /*
+     * Return the simulated bus of a block device (opened if needed) or
+     * NULL if it is not simulated.
+     */
+    i2c_bus_t *bus = getI2CBus(device);
+
+    if (bus == NULL || bus->backend != &I2C_SIMULATED_BUS_BACKEND)
+        return NULL;
+    return (i2c_simulated_bus_t *)bus->context;
+}
+
+static i2c_simulated_mod_io_t *getI2CSimulatedModIO(char *device, int i2c_addr)
+{
+    /*
+     * Return the simulated MOD-IO at an address of a bus or NULL.
+     */
+    i2c_simulated_bus_t *simulated_bus = getI2CSimulatedBus(device);
+    i2c_simulated_mod_io_t *mod_io;
+
+    if (simulated_bus == NULL)
+        return NULL;
+    pthread_mutex_lock(&simulated_bus->lock);
+    mod_io = findI2CSimulatedModIO(simulated_bus, i2c_addr);
+    pthread_mutex_unlock(&simulated_bus->lock);
+    return mod_io;
+}
+
+static int setI2CSimulatedModIOInput(char *device, int i2c_addr, const mod_io_input_t *input)
+{
+    /*
+     * Drive the inputs of a simulated MOD-IO. Return -1 if there is none.
+     */
+    i2c_simulated_bus_t *simulated_bus = getI2CSimulatedBus(device);
+    i2c_simulated_mod_io_t *mod_io;
+
+    if (simulated_bus == NULL)
+        return -1;
+    pthread_mutex_lock(&simulated_bus->lock);
+    mod_io = findI2CSimulatedModIO(simulated_bus, i2c_addr);
+    if (mod_io != NULL)
+        mod_io->input = *input;
+    pthread_mutex_unlock(&simulated_bus->lock);
+    return mod_io != NULL ? 0 : -1;
+}
+
+static int stickI2CSimulatedBus(char *device, uint64_t duration)
+{
+    /*
+     * Make a simulated bus stuck for a duration (ns) from now.
+     * Return -1 if it is not simulated.
+     */
+    i2c_simulated_bus_t *simulated_bus = getI2CSimulatedBus(device);
+
+    if (simulated_bus == NULL)
+        return -1;
+    pthread_mutex_lock(&simulated_bus->lock);
+    simulated_bus->stuck_until = getMonotonicNanoSeconds() + duration;
+    simulated_bus->stuck_count++;
+    pthread_mutex_unlock(&simulated_bus->lock);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Cyclic I/O scanner.
+ *
+ * A dedicated thread polls the inputs of all attached MOD-IOs every
+ * IO_SCAN_INTERVAL ms, thus bus load depends only on the scan rate and not
+ * on how many clients are reading or subscribed.
+ *
+ * Each cycle also flushes pending (coalesced) relay outputs.
+ *
+ * Each new scan is diffed against the inputs last notified: digital inputs
+ * are packed one byte per slave and compared a 64 bit word at a time (XOR),
+ * analog inputs pass a deadband. Changed points are flagged with the scan
+ * time. The server thread takes them (callbackWriteInputChangeList in
+ * mod_io_opc_ua.h) and writes them into the address space, so OPC UA reads
+ * are served from the variables and monitored items fire on change without
+ * clients polling.
+ *
+ * In real-time mode there is no scanner thread: the scan cycle is a task of
+ * the real-time thread.
+ *
+ * The slave list may only change between two scan cycles (IO_SCAN_LOCK).
+ */
+#include <pthread.h>
+#include <time.h>
+#include "time_base.h"
+#include "rt_executive.h"
+
+// the default I/O scan interval (in ms)
+const int DEFAULT_IO_SCAN_INTERVAL = 20;
+static int IO_SCAN_INTERVAL = DEFAULT_IO_SCAN_INTERVAL;
+
+// AIN changes of at most this many counts (10 bit ADC) are not notified, 0 - every change
+static int IO_SCAN_ANALOG_DEADBAND = 0;
+
+// changed input points of a slave: bit i - digital input i (as in the DIN register),
+// bit INPUT_CHANGE_ANALOG_SHIFT + i - analog input i
+#define INPUT_CHANGE_ANALOG_SHIFT 8
+#define INPUT_POINT_COUNT (INPUT_CHANGE_ANALOG_SHIFT + MOD_IO_ANALOG_INPUT_COUNT)
+#define INPUT_CHANGE_ALL ((1U << INPUT_POINT_COUNT) - 1)
+
+typedef struct {
+    uint16_t pending;                                  // changes not yet written to the address space
+    UA_DateTime change_time_list[INPUT_POINT_COUNT];   // scan time of the last change of every point
+} input_change_t;
+
+// the inputs last notified, digital inputs packed one byte per slave for a word wide diff
+static uint8_t NOTIFIED_DIGITAL_INPUT_LIST[MAX_I2C_SLAVE_COUNT];
+static uint16_t NOTIFIED_ANALOG_INPUT_LIST[MAX_I2C_SLAVE_COUNT][MOD_IO_ANALOG_INPUT_COUNT];
+static input_change_t INPUT_CHANGE_LIST[MAX_I2C_SLAVE_COUNT];
+
+static pthread_t IO_SCANNER_THREAD;
+static volatile bool IO_SCANNER_RUNNING = false;
+
+// the I/O scan task of the real-time thread (real-time mode only)
+static uint64_t IO_SCAN_RT_TASK_ID = 0;
+
+// held for a whole scan cycle, attaching / detaching slaves waits for it
+static pthread_mutex_t IO_SCAN_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+static int diffInputList(const mod_io_input_t *input_list, uint8_t *digital_input_list,
+                         uint16_t (*analog_input_list)[MOD_IO_ANALOG_INPUT_COUNT],
+                         int analog_deadband, uint16_t *change_list)
+{
+    /*
+     * Compare a scan to the inputs last notified and update them. Set the
+     * changed points of every slave in change_list (INPUT_CHANGE_* bits).
+     * An analog input changes if it moved more than analog_deadband counts
+     * from its last notified value. Return the number of changed slaves.
+     */
+    uint8_t packed_list[MAX_I2C_SLAVE_COUNT];
+    uint64_t scanned, notified, changed;
+    unsigned int i, j, k;
+    int delta;
+    int changed_count = 0;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        packed_list[i] = input_list[i].digital_input;
+    }
+    memset(change_list, 0, MAX_I2C_SLAVE_COUNT * sizeof(uint16_t));
+
+    // 8 slaves per XOR, mostly static inputs cost a few instructions per cycle
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i += sizeof(uint64_t))
+    {
+        memcpy(&scanned, &packed_list[i], sizeof(uint64_t));
+        memcpy(&notified, &digital_input_list[i], sizeof(uint64_t));
+        changed = scanned ^ notified;
+        if (changed == 0)
+            continue;
+        for (j = i; j < i + sizeof(uint64_t); j++)
+        {
+            change_list[j] = packed_list[j] ^ digital_input_list[j];
+            if (change_list[j] != 0)
+                __atomic_store_n(&digital_input_list[j], packed_list[j], __ATOMIC_RELAXED);
+        }
+    }
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        for (k = 0; k < MOD_IO_ANALOG_INPUT_COUNT; k++)
+        {
+            delta = (int)input_list[i].analog_input[k] - (int)analog_input_list[i][k];
+            if (delta > analog_deadband || -delta > analog_deadband)
+            {
+                __atomic_store_n(&analog_input_list[i][k], input_list[i].analog_input[k], __ATOMIC_RELAXED);
+                change_list[i] |= 1U << (INPUT_CHANGE_ANALOG_SHIFT + k);
+            }
+        }
+        if (change_list[i] != 0)
+            changed_count++;
+    }
+    return changed_count;
+}
+
+static void flagInputChange(int slave_index, uint16_t change, UA_DateTime change_time)
+{
+    /*
+     * Mark points of a slave as changed at change_time, the server thread
+     * picks them up with takeInputChange().
+     */
+    unsigned int bit;
+
+    for (bit = 0; bit < INPUT_POINT_COUNT; bit++)
+    {
+        if (change & (1U << bit))
+            __atomic_store_n(&INPUT_CHANGE_LIST[slave_index].change_time_list[bit], change_time, __ATOMIC_RELAXED);
+    }
+    // publish last: a reader seeing the flag also sees the new values and time
+    __atomic_fetch_or(&INPUT_CHANGE_LIST[slave_index].pending, change, __ATOMIC_RELEASE);
+}
+
+static void notifyInputChangeList(const mod_io_input_t *input_list)
+{
+    /*
+     * Flag the points which changed since the last scan (scanner only).
+     */
+    uint16_t change_list[MAX_I2C_SLAVE_COUNT];
+    UA_DateTime now;
+    int i;
+
+    if (diffInputList(input_list, NOTIFIED_DIGITAL_INPUT_LIST, NOTIFIED_ANALOG_INPUT_LIST,
+                      __atomic_load_n(&IO_SCAN_ANALOG_DEADBAND, __ATOMIC_RELAXED), change_list) == 0)
+    {
+        return;
+    }
+    now = UA_DateTime_now();
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (change_list[i] != 0)
+            flagInputChange(i, change_list[i], now);
+    }
+}
+
+static uint16_t takeInputChange(int slave_index, mod_io_input_t *input)
+{
+    /*
+     * Return (and clear) the changed points of a slave and copy its
+     * notified inputs (server thread).
+     */
+    uint16_t change = __atomic_exchange_n(&INPUT_CHANGE_LIST[slave_index].pending, 0, __ATOMIC_ACQUIRE);
+    int k;
+
+    input->digital_input = __atomic_load_n(&NOTIFIED_DIGITAL_INPUT_LIST[slave_index], __ATOMIC_RELAXED);
+    for (k = 0; k < MOD_IO_ANALOG_INPUT_COUNT; k++)
+    {
+        input->analog_input[k] = __atomic_load_n(&NOTIFIED_ANALOG_INPUT_LIST[slave_index][k], __ATOMIC_RELAXED);
+    }
+    return change;
+}
+
+static UA_DateTime getInputChangeTime(int slave_index, unsigned int bit)
+{
+    return __atomic_load_n(&INPUT_CHANGE_LIST[slave_index].change_time_list[bit], __ATOMIC_RELAXED);
+}
+
+static void scanI2CSlaveList(mod_io_input_t *input_list)
+{
+    /*
+     * Read the inputs of all known I2C slaves.
+     */
+    int i;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
+        {
+            // on error keep last known inputs of this slave
+            getI2CSlaveInputState(i, &input_list[i]);
+        }
+    }
+}
+
+static void runIOScanCycle()
+{
+    /*
+     * One I/O scan cycle: flush relays, read inputs, flag changed inputs
+     * (scanner thread or real-time cyclic thread only).
+     */
+    static mod_io_input_t input_list[MAX_I2C_SLAVE_COUNT];
+
+    uint64_t start;
+
+    pthread_mutex_lock(&IO_SCAN_LOCK);
+    start = getTimeBaseNanoSeconds();
+    flushRelayOutputList();
+    scanI2CSlaveList(input_list);
+    notifyInputChangeList(input_list);
+    recordMetricSince(&METRIC_LIST[METRIC_IO_SCAN_CYCLE], start);
+    traceSpan(TRACE_IO_SCAN_CYCLE, 0, 0, start);
+    pthread_mutex_unlock(&IO_SCAN_LOCK);
+}
+
+static void callbackIOScanCycle(UA_Server *server, void *data)
+{
+    runIOScanCycle();
+}
+
+static void *runIOScanner(void *arg)
+{
+    /*
+     * Scan inputs at a fixed rate (absolute deadlines so scan time does not add up).
+     */
+    uint64_t next_scan;
+
+    next_scan = getMonotonicNanoSeconds();
+    while (IO_SCANNER_RUNNING)
+    {
+        runIOScanCycle();
+
+        next_scan += IO_SCAN_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND;
+        sleepUntilMonotonicNanoSeconds(next_scan);
+    }
+    return NULL;
+}
+
+int startIOScanner()
+{
+    /*
+     * Start the I/O scanner thread (or its task in the real-time thread).
+     */
+    if (isRTModeEnabled())
+    {
+        if (addRTTask(callbackIOScanCycle, NULL, NULL,
+                      IO_SCAN_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND, &IO_SCAN_RT_TASK_ID) < 0)
+        {
+            UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Error adding I/O scan to real-time thread");
+            return -1;
+        }
+        UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                    "I/O scan runs in real-time thread (interval=%d ms)", IO_SCAN_INTERVAL);
+        return 0;
+    }
+    IO_SCANNER_RUNNING = true;
+    if (pthread_create(&IO_SCANNER_THREAD, NULL, runIOScanner, NULL) != 0)
+    {
+        IO_SCANNER_RUNNING = false;
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Error starting I/O scanner");
+        return -1;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                "I/O scanner started (interval=%d ms)", IO_SCAN_INTERVAL);
+    return 0;
+}
+
+static void setIOScanInterval(int interval)
+{
+    /*
+     * Change the scan interval (in ms), effective after the current cycle.
+     */
+    IO_SCAN_INTERVAL = interval;
+    if (isRTModeEnabled())
+    {
+        changeRTTask(IO_SCAN_RT_TASK_ID, IO_SCAN_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND);
+    }
+}
+
+void stopIOScanner()
+{
+    /*
+     * Stop the I/O scanner thread and wait for its last scan.
+     */
+    if (!IO_SCANNER_RUNNING)
+    {
+        return;
+    }
+    IO_SCANNER_RUNNING = false;
+    pthread_join(IO_SCANNER_THREAD, NULL);
+}
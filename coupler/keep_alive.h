@@ -1,3 +1,5 @@
+#include "liveness_table.h"
+
 // OPC UA's Pub/Sub profile
 char *DEFAULT_TRANSPORT_PROFILE = "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp";
 char *NETWORK_ADDRESS_URL_DATA_TYPE = "opc.udp://224.0.0.22:4840/";
@@ -5,29 +7,56 @@ char *NETWORK_ADDRESS_URL_DATA_TYPE = "opc.udp://224.0.0.22:4840/";
 //network interface to use for Pub / Sub
 char *NETWORK_INTERFACE = "";
 
-// global HEART BEATs of coupler
-static unsigned int HEART_BEATS = 0;
+// global HEART BEATs of coupler (sequence number of published heart beats)
+static UA_UInt32 HEART_BEATS = 0;
+
+// heart beat DataSet: <coupler ID (UInt16), sequence (UInt32), monotonic send timestamp in ns (UInt64)>
+#define HEART_BEAT_FIELD_COUPLER_ID 0
+#define HEART_BEAT_FIELD_SEQUENCE 1
+#define HEART_BEAT_FIELD_TIMESTAMP 2
+#define HEART_BEAT_FIELD_COUNT 3
+
+// legacy heart beat DataSet: one Float formatted as <ID_of_coupler>.<heart_beats>
+static bool HEART_BEAT_LEGACY_FORMAT = false;
 
-// handling coupler's state
+// handling coupler's state (worst state of all watched peers)
 static unsigned int CURRENT_STATE;
-const int STATE_UP = 1;
-const int STATE_DOWN = 0;
-const int STATE_NO_INITIAL_HEART_BEAT = 2;
+const int STATE_UP = PEER_STATE_UP;
+const int STATE_DOWN = PEER_STATE_DOWN;
+const int STATE_NO_INITIAL_HEART_BEAT = PEER_STATE_NO_INITIAL;
+const int STATE_SUSPECT = PEER_STATE_SUSPECT;
 
 // number of times the coupler was in SAFE mode 
 static unsigned int SAFE_MODE_STATE_COUNTER = 0;
 
 // the heart beat interval (in ms)
-const int DEFAULT_HEART_BEAT_INTERVAL = 250;
+const int DEFAULT_HEART_BEAT_INTERVAL = LIVENESS_DEFAULT_HEART_BEAT_INTERVAL;
 static int HEART_BEAT_INTERVAL = DEFAULT_HEART_BEAT_INTERVAL;
 
 // the timeout in millis after which a coupler is considered down
-const int DEFAULT_HEART_BEAT_TIMEOUT_INTERVAL = 4 * DEFAULT_HEART_BEAT_INTERVAL;
+const int DEFAULT_HEART_BEAT_TIMEOUT_INTERVAL = LIVENESS_DEFAULT_DOWN_HEART_BEAT_COUNT * LIVENESS_DEFAULT_HEART_BEAT_INTERVAL;
 static int HEART_BEAT_TIMEOUT_INTERVAL = DEFAULT_HEART_BEAT_TIMEOUT_INTERVAL;
 
-// the list of couplers onto which we depend for properly running
-// XXX: assume ONLY 8 couplers!
-unsigned int HEART_BEAT_ID_LIST[] = {0, 0, 0, 0, 0, 0, 0, 0};
+// a peer is suspect (not yet down) if its last heart beat is older than (in heart beats)
+const int HEART_BEAT_SUSPECT_COUNT = LIVENESS_SUSPECT_HEART_BEAT_COUNT;
+
+// liveness of all couplers, the watched ones are those onto which we depend for properly running
+static liveness_table_t LIVENESS_TABLE;
+
+// fixed size Pub/Sub (CLI "-R"): the WriterGroup encodes its NetworkMessage
+// once and then only patches field values at fixed offsets, the ReaderGroup
+// decodes fields at fixed offsets straight into the subscribed values. All
+// couplers of a cell must use it as the message layouts have to match.
+static bool ENABLE_PUBSUB_FIXED_OFFSET = false;
+
+// UADP headers of heart beat messages in fixed size mode (same on publisher and subscriber)
+#define HEART_BEAT_NETWORK_MESSAGE_CONTENT_MASK \
+    (UA_UadpNetworkMessageContentMask)(UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID | \
+                                       UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER | \
+                                       UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID | \
+                                       UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER)
+#define HEART_BEAT_DATASET_MESSAGE_CONTENT_MASK \
+    (UA_UadpDataSetMessageContentMask)UA_UADPDATASETMESSAGECONTENTMASK_SEQUENCENUMBER
 
 // the interval for publishing messages
 static int PUBLISHING_INTERVAL = 10;
@@ -38,16 +67,34 @@ const int WRITER_GROUP_ID = 100;
 const int DATASET_WRITER_ID = 62541;
 const int PUBLISHER_ID = 2234;
 
+// heart beats are published with PublisherId HEART_BEAT_PUBLISHER_ID_BASE + coupler ID
+// so subscribers filter peers while decoding (legacy heart beats all use PUBLISHER_ID)
+const int HEART_BEAT_PUBLISHER_ID_BASE = LIVENESS_PUBLISHER_ID_BASE;
+
+static UA_UInt16 getHeartBeatPublisherId(unsigned int coupler_id) {
+  /*
+   * Return the PublisherId heart beats of a coupler are published with.
+   */
+  if (HEART_BEAT_LEGACY_FORMAT) {
+    return PUBLISHER_ID;
+  }
+  return HEART_BEAT_PUBLISHER_ID_BASE + coupler_id;
+}
+
 void gotoSafeMode() {
   /*
    * In this mode coupler will shutdown all
    * relays of attached I2C slaves
    */
+   traceEvent(TRACE_SAFE_MODE, 0, 1, 0);
+   setGPIO(GPIO_EVENT_SAFE_MODE, true);
    if (I2C_VIRTUAL_MODE==0) {
      UA_LOG_INFO(UA_Log_Stdout, \
                  UA_LOGCATEGORY_USERLAND, \
                  "Go to SAFE MODE");
 
+    // no pending relay write may sneak in between shutdown and virtual mode
+    pthread_mutex_lock(&I2C_RELAY_LOCK);
     if (OPERATIONAL_MODE==0) {
       // do shutdown all attached I2C slaves (MOD-IO's relays).
       // only if initial operational mode is appropriate.
@@ -57,6 +104,7 @@ void gotoSafeMode() {
     // set to virtual mode which means that coupler will mimic working but
     // not set any related relays' state
     I2C_VIRTUAL_MODE = 1;
+    pthread_mutex_unlock(&I2C_RELAY_LOCK);
   }
 
 }
@@ -71,6 +119,9 @@ void gotoNormalMode() {
   UA_LOG_INFO(UA_Log_Stdout, \
               UA_LOGCATEGORY_USERLAND, \
               "Go to NORMAL MODE");
-  I2C_VIRTUAL_MODE = 0;
+  traceEvent(TRACE_SAFE_MODE, 0, 0, 0);
+  setGPIO(GPIO_EVENT_SAFE_MODE, false);
+  // back to the mode selected over CLI ("-m 1" stays virtual)
+  I2C_VIRTUAL_MODE = OPERATIONAL_MODE;
 
 }
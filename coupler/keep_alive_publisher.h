@@ -4,6 +4,22 @@ Keep alive implementation for couplers based on OPC UA's pub/sub mechanism
 
 UA_NodeId connectionIdent, publishedDataSetIdent, writerGroupIdent;
 
+// NodeIds of heart beat variables resolved once when enabling publishing
+static node_id_t HEART_BEAT_NODE_ID_LIST[HEART_BEAT_FIELD_COUNT];
+
+// published heart beat values (HEART_BEATS is the sequence number)
+static UA_UInt16 HEART_BEAT_COUPLER_ID = 0;
+static UA_UInt64 HEART_BEAT_TIMESTAMP = 0;
+static UA_Float HEART_BEAT_LEGACY_VALUE = 0.0;
+
+// values of the heart beat nodes, referenced by their external value backend
+static UA_DataValue HEART_BEAT_DATA_VALUE_LIST[HEART_BEAT_FIELD_COUNT];
+static UA_DataValue *HEART_BEAT_DATA_VALUE_REFERENCE_LIST[HEART_BEAT_FIELD_COUNT] = {
+    &HEART_BEAT_DATA_VALUE_LIST[0],
+    &HEART_BEAT_DATA_VALUE_LIST[1],
+    &HEART_BEAT_DATA_VALUE_LIST[2]
+};
+
 static void addPubSubConnection(UA_Server *server, UA_String *transportProfile,
                     UA_NetworkAddressUrlDataType *networkAddressUrl){
     UA_PubSubConnectionConfig connectionConfig;
@@ -17,9 +33,10 @@ static void addPubSubConnection(UA_Server *server, UA_String *transportProfile,
     }
     UA_Variant_setScalar(&connectionConfig.address, networkAddressUrl,
                          &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
-    /* Changed to static publisherId from random generation to identify
-     * the publisher on Subscriber side */
-    connectionConfig.publisherId.numeric = PUBLISHER_ID;
+    /* PublisherId derived from the coupler ID so that subscribers'
+     * DataSetReaders identify the publisher while decoding */
+    connectionConfig.publisherId.numeric = getHeartBeatPublisherId(COUPLER_ID);
+    setPubSubConnectionProperties(&connectionConfig);
     UA_Server_addPubSubConnection(server, &connectionConfig, &connectionIdent);
 }
 
@@ -45,6 +62,10 @@ static void addWriterGroup(UA_Server *server) {
     writerGroupConfig.enabled = UA_FALSE;
     writerGroupConfig.writerGroupId = WRITER_GROUP_ID;
     writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    // in real-time mode publish from the real-time thread
+    setPubSubCallbackLifecycle(&writerGroupConfig.pubsubManagerCallback);
+    // with SO_TXTIME frames get a launch time
+    setWriterGroupTransportSettings(&writerGroupConfig);
     writerGroupConfig.messageSettings.encoding             = UA_EXTENSIONOBJECT_DECODED;
     writerGroupConfig.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPWRITERGROUPMESSAGEDATATYPE];
     /* The configuration flags for the messages are encapsulated inside the
@@ -55,16 +76,24 @@ static void addWriterGroup(UA_Server *server) {
     /* Change message settings of writerGroup to send PublisherId,
      * WriterGroupId in GroupHeader and DataSetWriterId in PayloadHeader
      * of NetworkMessage */
-    writerGroupMessage->networkMessageContentMask          = (UA_UadpNetworkMessageContentMask)(UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID |
-                                                              (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER |
-                                                              (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID |
-                                                              (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER);
+    writerGroupMessage->networkMessageContentMask          = HEART_BEAT_NETWORK_MESSAGE_CONTENT_MASK;
     writerGroupConfig.messageSettings.content.decoded.data = writerGroupMessage;
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        writerGroupConfig.rtLevel = UA_PUBSUB_RT_FIXED_SIZE;
+    }
     UA_Server_addWriterGroup(server, connectionIdent, &writerGroupConfig, &writerGroupIdent);
-    UA_Server_setWriterGroupOperational(server, writerGroupIdent);
     UA_UadpWriterGroupMessageDataType_delete(writerGroupMessage);
 }
 
+static void setWriterGroupOperational(UA_Server *server) {
+    /* A fixed size WriterGroup computes the offsets of its fields when its
+     * configuration is frozen, thus only once all its DataSetWriters exist. */
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        UA_Server_freezeWriterGroupConfiguration(server, writerGroupIdent);
+    }
+    UA_Server_setWriterGroupOperational(server, writerGroupIdent);
+}
+
 static void addDataSetWriter(UA_Server *server) {
     /* We need now a DataSetWriter within the WriterGroup. This means we must
      * create a new DataSetWriterConfig and add call the addWriterGroup function. */
@@ -74,15 +103,26 @@ static void addDataSetWriter(UA_Server *server) {
     dataSetWriterConfig.name = UA_STRING("Heartbeat DataSetWriter");
     dataSetWriterConfig.dataSetWriterId = DATASET_WRITER_ID;
     dataSetWriterConfig.keyFrameCount = 10;
+    UA_UadpDataSetWriterMessageDataType dataSetWriterMessage;
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        memset(&dataSetWriterMessage, 0, sizeof(UA_UadpDataSetWriterMessageDataType));
+        dataSetWriterMessage.dataSetMessageContentMask = HEART_BEAT_DATASET_MESSAGE_CONTENT_MASK;
+        dataSetWriterConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+        dataSetWriterConfig.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPDATASETWRITERMESSAGEDATATYPE];
+        dataSetWriterConfig.messageSettings.content.decoded.data = &dataSetWriterMessage;
+    }
     UA_Server_addDataSetWriter(server, writerGroupIdent, publishedDataSetIdent,
                                &dataSetWriterConfig, &dataSetWriterIdent);
 }
 
 typedef struct PublishedVariable {
     char *name;
+    UA_UInt32 numericNodeId;
+    node_id_t *nodeId;
     char *description;
     void * UA_RESTRICT pdefaultValue;
     int type;
+    UA_DataValue **ppdataValue;
 } PublishedVariable;
 
 static void addPubSubVariable(UA_Server *server, PublishedVariable varDetails) {
@@ -93,12 +133,28 @@ static void addPubSubVariable(UA_Server *server, PublishedVariable varDetails) {
     attr.dataType = UA_TYPES[varDetails.type].typeId;
     attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
 
-    UA_Server_addVariableNode(server, UA_NODEID_STRING(1, varDetails.name),
+    UA_Server_addVariableNode(server, varDetails.nodeId->node_id,
                                       UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
                                       UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
                                       UA_QUALIFIEDNAME(1, varDetails.description),
                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
                                       attr, NULL, NULL);
+
+    if (varDetails.ppdataValue != NULL) {
+        /* The node reads its value straight from the coupler's memory
+         * (external value backend) so a heart beat tic does not have to
+         * write (copy) a new value into the nodestore. */
+        UA_DataValue *dataValue = *varDetails.ppdataValue;
+        UA_ValueBackend valueBackend;
+        memset(&valueBackend, 0, sizeof(UA_ValueBackend));
+        UA_DataValue_init(dataValue);
+        UA_Variant_setScalar(&dataValue->value, varDetails.pdefaultValue, &UA_TYPES[varDetails.type]);
+        dataValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+        dataValue->hasValue = UA_TRUE;
+        valueBackend.backendType = UA_VALUEBACKENDTYPE_EXTERNAL;
+        valueBackend.backend.external.value = varDetails.ppdataValue;
+        UA_Server_setVariableNode_valueBackend(server, varDetails.nodeId->node_id, valueBackend);
+    }
 }
 
 static void addPubSubDataSetField(UA_Server *server, PublishedVariable varDetails) {
@@ -109,74 +165,135 @@ static void addPubSubDataSetField(UA_Server *server, PublishedVariable varDetail
     dataSetFieldConfig.field.variable.fieldNameAlias = UA_STRING(varDetails.description);
     dataSetFieldConfig.field.variable.promotedField = UA_FALSE;
     dataSetFieldConfig.field.variable.publishParameters.publishedVariable =
-    UA_NODEID_STRING(1, varDetails.name);
+    varDetails.nodeId->node_id;
     dataSetFieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    if (ENABLE_PUBSUB_FIXED_OFFSET && varDetails.ppdataValue != NULL) {
+        /* fixed size: the value is copied from the coupler's memory straight
+         * into the encoded message, not read through the nodestore */
+        dataSetFieldConfig.field.variable.rtValueSource.rtFieldSourceEnabled = UA_TRUE;
+        dataSetFieldConfig.field.variable.rtValueSource.staticValueSource = varDetails.ppdataValue;
+    }
     UA_Server_addDataSetField(server, publishedDataSetIdent,
                               &dataSetFieldConfig, &dataSetFieldIdent);
 }
 
 
+static UA_Float encodeLegacyHeartBeat(int coupler_id, UA_UInt32 heart_beats)
+{
+    /*
+     * Encode <ID_of_coupler>.<heart_beats> as a float (legacy format),
+     * i.e. coupler 3 at heart beat 125 is 3.125
+     */
+    double fraction = heart_beats;
+    while (fraction >= 1.0)
+        fraction /= 10.0;
+    return (UA_Float)(coupler_id + fraction);
+}
+
 void callbackTicHeartBeat()
 {
-    /* Increase periodically heart beats of the server */
+    /*
+     * Increase periodically heart beats of the server.
+     * Published variables reference these values directly (external
+     * value backend) so nothing is allocated nor written to a node here.
+     */
+    static uint64_t last_tic = 0;
+    uint64_t now = getTimeBaseNanoSeconds();
+    uint64_t interval = HEART_BEAT_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND;
+
+    // jitter of the publish period
+    if (last_tic != 0)
+    {
+        recordMetric(&METRIC_LIST[METRIC_HEART_BEAT_PUBLISH_JITTER],
+                     now - last_tic > interval ? now - last_tic - interval : interval - (now - last_tic));
+    }
+    last_tic = now;
     HEART_BEATS += 1;
+    traceEvent(TRACE_HEART_BEAT_TX, COUPLER_ID, HEART_BEATS, now);
     //UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "\theart_beat %d", HEART_BEATS);
 
-    // set OPC UA's heat_beat node value
-    UA_NodeId myFloatNodeId = UA_NODEID_STRING(1, "heart_beat");
-    
-    // heart_beat format is <ID_of_coupler>.<heart_beats>
-    int len = snprintf(NULL, 0, "%d", HEART_BEATS);
-    char *result1 = malloc(len + 1);
-    snprintf(result1, len + 1, "%d", HEART_BEATS);
-
-    int len1 = snprintf(NULL, 0, "%d", COUPLER_ID);
-    char *result2 = malloc(len1 + 1);
-    snprintf(result2, len1 + 1, "%d", COUPLER_ID);
-    
-    // concat
-    strcat(result2, ".");
-    strcat(result2, result1);
-   
-    char * end_ptr;
-    float final_result = strtof(result2, &end_ptr );
-
-    UA_Float myFloat = final_result;
-    UA_Variant myVar;
-    UA_Variant_init(&myVar);
-    UA_Variant_setScalar(&myVar, &myFloat, &UA_TYPES[UA_TYPES_FLOAT]);
-    UA_Server_writeValue(server, myFloatNodeId, myVar);
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        HEART_BEAT_LEGACY_VALUE = encodeLegacyHeartBeat(COUPLER_ID, HEART_BEATS);
+    }
+    else {
+        HEART_BEAT_TIMESTAMP = now;
+    }
 }
 
 
 static void enablePublishHeartBeat(UA_Server *server, UA_ServerConfig *config){
     int i;
+    size_t publishedVariableCount;
+    const PublishedVariable *publishedVariableArray;
     // add a callback which will increment heart beat tics
     UA_UInt64 callbackId = 1;
-    UA_Server_addRepeatedCallback(server, callbackTicHeartBeat, NULL, HEART_BEAT_INTERVAL, &callbackId);
+    addCyclicCallback(server, callbackTicHeartBeat, NULL, HEART_BEAT_INTERVAL, &callbackId);
 
-    UA_UInt32  defaultUInt32 = 0;
-    UA_UInt32  couplerID = COUPLER_ID;
-    UA_Float   defaultFloat = 0.0;
-    const PublishedVariable publishedVariableArray[] = {
-        // representing time in millis since start of process
+    HEART_BEAT_COUPLER_ID = COUPLER_ID;
+    const PublishedVariable heartBeatVariableArray[] = {
+        {
+            .name = "coupler_id",
+            .numericNodeId = HEART_BEAT_COUPLER_ID_NUMERIC_NODE_ID,
+            .nodeId = &HEART_BEAT_NODE_ID_LIST[HEART_BEAT_FIELD_COUPLER_ID],
+            .description = "Heartbeat coupler ID",
+            .pdefaultValue = &HEART_BEAT_COUPLER_ID,
+            .type = UA_TYPES_UINT16,
+            .ppdataValue = &HEART_BEAT_DATA_VALUE_REFERENCE_LIST[HEART_BEAT_FIELD_COUPLER_ID]
+        },
         {
             .name = "heart_beat",
+            .numericNodeId = HEART_BEAT_NUMERIC_NODE_ID,
+            .nodeId = &HEART_BEAT_NODE_ID_LIST[HEART_BEAT_FIELD_SEQUENCE],
             .description = "Heartbeat",
-            .pdefaultValue = &defaultFloat,
-            .type = UA_TYPES_FLOAT
+            .pdefaultValue = &HEART_BEATS,
+            .type = UA_TYPES_UINT32,
+            .ppdataValue = &HEART_BEAT_DATA_VALUE_REFERENCE_LIST[HEART_BEAT_FIELD_SEQUENCE]
+        },
+        // time base (monotonic) time of sending in ns
+        {
+            .name = "heart_beat_timestamp",
+            .numericNodeId = HEART_BEAT_TIMESTAMP_NUMERIC_NODE_ID,
+            .nodeId = &HEART_BEAT_NODE_ID_LIST[HEART_BEAT_FIELD_TIMESTAMP],
+            .description = "Heartbeat timestamp",
+            .pdefaultValue = &HEART_BEAT_TIMESTAMP,
+            .type = UA_TYPES_UINT64,
+            .ppdataValue = &HEART_BEAT_DATA_VALUE_REFERENCE_LIST[HEART_BEAT_FIELD_TIMESTAMP]
         }
     };
+    const PublishedVariable legacyHeartBeatVariableArray[] = {
+        // <ID_of_coupler>.<heart_beats>
+        {
+            .name = "heart_beat",
+            .numericNodeId = HEART_BEAT_NUMERIC_NODE_ID,
+            .nodeId = &HEART_BEAT_NODE_ID_LIST[0],
+            .description = "Heartbeat",
+            .pdefaultValue = &HEART_BEAT_LEGACY_VALUE,
+            .type = UA_TYPES_FLOAT,
+            .ppdataValue = &HEART_BEAT_DATA_VALUE_REFERENCE_LIST[0]
+        }
+    };
+
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        publishedVariableArray = legacyHeartBeatVariableArray;
+        publishedVariableCount = countof(legacyHeartBeatVariableArray);
+    }
+    else {
+        publishedVariableArray = heartBeatVariableArray;
+        publishedVariableCount = countof(heartBeatVariableArray);
+    }
 
     UA_String transportProfile = UA_STRING(DEFAULT_TRANSPORT_PROFILE);
     UA_NetworkAddressUrlDataType networkAddressUrl =
-        {UA_STRING_NULL , UA_STRING(NETWORK_ADDRESS_URL_DATA_TYPE)};
+        {UA_STRING_NULL , UA_STRING((char *)getPubSubNetworkAddressUrl())};
     addPubSubConnection(server, &transportProfile, &networkAddressUrl);
     addPublishedDataSet(server);
-    for(i = 0; i < countof(publishedVariableArray); i++) {
+    for(i = 0; i < publishedVariableCount; i++) {
+        resolveNodeId(publishedVariableArray[i].nodeId, publishedVariableArray[i].name,
+                      publishedVariableArray[i].numericNodeId);
         addPubSubVariable(server, publishedVariableArray[i]);
         addPubSubDataSetField(server, publishedVariableArray[i]);
     }
     addWriterGroup(server);
     addDataSetWriter(server);
+    setWriterGroupOperational(server);
 }
@@ -14,50 +14,184 @@
 
 UA_NodeId connectionIdentifier;
 UA_NodeId readerGroupIdentifier;
-UA_NodeId readerIdentifier;
 UA_DataSetReaderConfig readerConfig;
 
 static void fillTestDataSetMetaData(UA_DataSetMetaDataType *pMetaData);
 
-/* callback to handle change notifications */
-static void dataChangeNotificationCallback(UA_Server *server, UA_UInt32 monitoredItemId,
-                               void *monitoredItemContext, const UA_NodeId *nodeId,
-                               void *nodeContext, UA_UInt32 attributeId,
-                               const UA_DataValue *var) {
-    unsigned long int milli_seconds_now;
+// heart beat being received, the DataSetReader writes its fields in order
+static UA_UInt16 RECEIVED_HEART_BEAT_COUPLER_ID = 0;
+static UA_UInt32 RECEIVED_HEART_BEAT_SEQUENCE = 0;
+
+// numeric NodeIds of subscribed variables are base + coupler ID * HEART_BEAT_FIELD_COUNT + field
+#define SUBSCRIBED_NUMERIC_NODE_ID_BASE 50000
+#define MAX_SUBSCRIBED_NAME_LENGTH 32
+
+// one DataSetReader per watched coupler, filtering on the coupler's PublisherId
+// (legacy heart beats all share one PublisherId: a single reader for all of them)
+typedef struct {
     unsigned int coupler_id;
+    UA_UInt16 publisher_id;
+    char name[MAX_SUBSCRIBED_NAME_LENGTH];
+    // fixed size mode: every coupler has its own connection and ReaderGroup
+    UA_NodeId connection_identifier;
+    UA_NodeId reader_group_identifier;
+    UA_NodeId reader_identifier;
+    UA_NodeId folder_identifier;
+    // fixed size mode: the ReaderGroup decodes fields straight into these values
+    UA_UInt16 coupler_id_value;
+    UA_UInt32 sequence;
+    UA_UInt64 timestamp;
+    UA_Float legacy_value;
+    UA_DataValue data_value_list[HEART_BEAT_FIELD_COUNT];
+    UA_DataValue *data_value_reference_list[HEART_BEAT_FIELD_COUNT];
+} subscribed_heart_beat_t;
+
+// indexed by coupler ID (the legacy reader is entry 0), so peers can come and go at runtime
+static subscribed_heart_beat_t *SUBSCRIBED_HEART_BEAT_LIST[MAX_COUPLER_COUNT];
+static int SUBSCRIBED_HEART_BEAT_COUNT = 0;
+static bool HEART_BEAT_SUBSCRIBER_ENABLED = false;
+
+static void registerHeartBeat(unsigned int coupler_id, UA_UInt32 sequence, UA_UInt64 timestamp) {
+    /*
+     * Register a heart beat received from another coupler.
+     */
+    uint64_t now, last_seen;
+
+    if (coupler_id != COUPLER_ID) {
+        //UA_LOG_INFO(UA_Log_Stdout, \
+        //           UA_LOGCATEGORY_USERLAND, \
+        //           "HEART BEAT: %d (%d)", coupler_id, sequence);
+        now = getTimeBaseNanoSeconds();
+        last_seen = getLastSeen(&LIVENESS_TABLE, coupler_id);
+        if (last_seen != LIVENESS_NEVER_SEEN && now > last_seen) {
+            recordMetric(&METRIC_LIST[METRIC_HEART_BEAT_INTER_ARRIVAL], now - last_seen);
+        }
+        updateLiveness(&LIVENESS_TABLE, coupler_id, sequence, timestamp, now);
+        traceEvent(TRACE_HEART_BEAT_RX, coupler_id, sequence, timestamp);
+
+        // toggle GPIO so we can monitor using logical analyzer the work of
+        // keep-alive network system
+        toggleGPIO(GPIO_EVENT_HEART_BEAT_RX);
+    }
+}
+
+static void handleSubscribedHeartBeatField(size_t field, const UA_Variant *value) {
+    /*
+     * Handle a heart beat field received by the DataSetReader, fields come in order.
+     */
+    if (value->data == NULL) {
+        return;
+    }
 
-    // filter out heart_beat from Data Set
-    if(UA_Variant_hasScalarType(&var->value, &UA_TYPES[UA_TYPES_FLOAT])) {
-        float heart_beat = *(UA_Float*) var->value.data;
-        milli_seconds_now = getMilliSecondsSinceEpoch();
+    if (HEART_BEAT_LEGACY_FORMAT) {
         // split <ID>.<heart_beats>, just converting to int is enough
-        coupler_id = (int) heart_beat;
-        if (coupler_id!=COUPLER_ID) {
-          //UA_LOG_INFO(UA_Log_Stdout, \
-          //           UA_LOGCATEGORY_USERLAND, \
-          //           "HEART BEAT: %d (%ld)", coupler_id, milli_seconds_now);
+        if (value->type == &UA_TYPES[UA_TYPES_FLOAT]) {
+            registerHeartBeat((int) *(UA_Float*) value->data, 0, 0);
+        }
+        return;
+    }
 
-	  // convert coupler_id to str
-          char* coupler_id_str = convertInt2Str(coupler_id);
+    // the timestamp is the last field so coupler ID and sequence are already known
+    if (field == HEART_BEAT_FIELD_COUPLER_ID && value->type == &UA_TYPES[UA_TYPES_UINT16]) {
+        RECEIVED_HEART_BEAT_COUPLER_ID = *(UA_UInt16*) value->data;
+    }
+    else if (field == HEART_BEAT_FIELD_SEQUENCE && value->type == &UA_TYPES[UA_TYPES_UINT32]) {
+        RECEIVED_HEART_BEAT_SEQUENCE = *(UA_UInt32*) value->data;
+    }
+    else if (field == HEART_BEAT_FIELD_TIMESTAMP && value->type == &UA_TYPES[UA_TYPES_UINT64]) {
+        registerHeartBeat(RECEIVED_HEART_BEAT_COUPLER_ID, RECEIVED_HEART_BEAT_SEQUENCE,
+                          *(UA_UInt64*) value->data);
+    }
+}
 
-          // convert micro seconds to str
-          char* milli_seconds_now_str = convertLongInt2Str(milli_seconds_now);
+/* callback to handle every heart beat field written by the DataSetReader */
+static void afterWriteSubscribedHeartBeat(UA_Server *server,
+                                          const UA_NodeId *sessionId, void *sessionContext,
+                                          const UA_NodeId *nodeId, void *nodeContext,
+                                          const UA_NumericRange *range, const UA_DataValue *data) {
+    handleSubscribedHeartBeatField((size_t)(uintptr_t)nodeContext, &data->value);
+}
 
-          // Add to our local linked list
-          addItem(&SUBSCRIBER_DICT, coupler_id_str, milli_seconds_now_str);
+/* callback to handle every heart beat field decoded by a fixed size ReaderGroup */
+static void afterWriteFixedOffsetHeartBeat(UA_Server *server,
+                                           const UA_NodeId *readerIdentifier,
+                                           const UA_NodeId *readerGroupIdentifier,
+                                           const UA_NodeId *targetVariableIdentifier,
+                                           void *targetVariableContext,
+                                           UA_DataValue **externalDataValue) {
+    handleSubscribedHeartBeatField((size_t)(uintptr_t)targetVariableContext, &(*externalDataValue)->value);
+}
+
+static subscribed_heart_beat_t *newSubscribedHeartBeat(unsigned int coupler_id) {
+    /*
+     * Create the entry of a watched coupler (coupler ID 0 for all legacy heart beats).
+     * Return NULL if out of range, already existing or out of memory.
+     */
+    size_t field;
+    subscribed_heart_beat_t *subscribed;
+
+    if (coupler_id >= MAX_COUPLER_COUNT || SUBSCRIBED_HEART_BEAT_LIST[coupler_id] != NULL) {
+        return NULL;
+    }
+    subscribed = (subscribed_heart_beat_t *)UA_calloc(1, sizeof(subscribed_heart_beat_t));
+    if (subscribed == NULL) {
+        return NULL;
+    }
+    subscribed->coupler_id = coupler_id;
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        snprintf(subscribed->name, sizeof(subscribed->name), "DataSet 1 (subscribed)");
+    }
+    else {
+        snprintf(subscribed->name, sizeof(subscribed->name), "Heartbeat %d (subscribed)", coupler_id);
+    }
+    subscribed->publisher_id = getHeartBeatPublisherId(coupler_id);
+    for (field = 0; field < HEART_BEAT_FIELD_COUNT; field++) {
+        subscribed->data_value_reference_list[field] = &subscribed->data_value_list[field];
+    }
+    SUBSCRIBED_HEART_BEAT_LIST[coupler_id] = subscribed;
+    SUBSCRIBED_HEART_BEAT_COUNT++;
+    return subscribed;
+}
+
+static void deleteSubscribedHeartBeat(unsigned int coupler_id) {
+    /*
+     * Free the entry of a coupler no longer watched.
+     */
+    if (coupler_id >= MAX_COUPLER_COUNT || SUBSCRIBED_HEART_BEAT_LIST[coupler_id] == NULL) {
+        return;
+    }
+    UA_free(SUBSCRIBED_HEART_BEAT_LIST[coupler_id]);
+    SUBSCRIBED_HEART_BEAT_LIST[coupler_id] = NULL;
+    SUBSCRIBED_HEART_BEAT_COUNT--;
+}
 
-	  // set GPIO so we can monitor using logical analyzer the work of
-	  // keep-alive network system
-	  if (CURRENT_GPIO_MODE == 1) setGPIO();
+static void initSubscribedHeartBeatDataValue(subscribed_heart_beat_t *subscribed, size_t field) {
+    /*
+     * Point the value a fixed size ReaderGroup decodes a field into at its
+     * storage (the decoder needs it preallocated with the field's type).
+     */
+    UA_DataValue *dataValue = subscribed->data_value_reference_list[field];
 
-	}
+    UA_DataValue_init(dataValue);
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        UA_Variant_setScalar(&dataValue->value, &subscribed->legacy_value, &UA_TYPES[UA_TYPES_FLOAT]);
+    }
+    else if (field == HEART_BEAT_FIELD_COUPLER_ID) {
+        UA_Variant_setScalar(&dataValue->value, &subscribed->coupler_id_value, &UA_TYPES[UA_TYPES_UINT16]);
+    }
+    else if (field == HEART_BEAT_FIELD_SEQUENCE) {
+        UA_Variant_setScalar(&dataValue->value, &subscribed->sequence, &UA_TYPES[UA_TYPES_UINT32]);
     }
+    else {
+        UA_Variant_setScalar(&dataValue->value, &subscribed->timestamp, &UA_TYPES[UA_TYPES_UINT64]);
+    }
+    dataValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+    dataValue->hasValue = UA_TRUE;
 }
 
 /* Add new connection to the server */
 static UA_StatusCode addPubSubConnectionSubscriber(UA_Server *server, UA_String *transportProfile,
-                    UA_NetworkAddressUrlDataType *networkAddressUrl) {
+                    UA_NetworkAddressUrlDataType *networkAddressUrl, UA_NodeId *connectionId) {
     if((server == NULL) || (transportProfile == NULL) ||
         (networkAddressUrl == NULL)) {
         return UA_STATUSCODE_BADINTERNALERROR;
@@ -77,7 +211,7 @@ static UA_StatusCode addPubSubConnectionSubscriber(UA_Server *server, UA_String
     UA_Variant_setScalar(&connectionConfig.address, networkAddressUrl,
                          &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
     connectionConfig.publisherId.numeric = UA_UInt32_random ();
-    retval |= UA_Server_addPubSubConnection (server, &connectionConfig, &connectionIdentifier);
+    retval |= UA_Server_addPubSubConnection (server, &connectionConfig, connectionId);
     if (retval != UA_STATUSCODE_GOOD) {
         return retval;
     }
@@ -85,7 +219,7 @@ static UA_StatusCode addPubSubConnectionSubscriber(UA_Server *server, UA_String
     return retval;
 }
 
-static UA_StatusCode addReaderGroup(UA_Server *server) {
+static UA_StatusCode addReaderGroup(UA_Server *server, UA_NodeId connectionId, UA_NodeId *readerGroupId) {
     if(server == NULL) {
         return UA_STATUSCODE_BADINTERNALERROR;
     }
@@ -94,40 +228,68 @@ static UA_StatusCode addReaderGroup(UA_Server *server) {
     UA_ReaderGroupConfig readerGroupConfig;
     memset (&readerGroupConfig, 0, sizeof(UA_ReaderGroupConfig));
     readerGroupConfig.name = UA_STRING("ReaderGroup1");
-    retval |= UA_Server_addReaderGroup(server, connectionIdentifier, &readerGroupConfig,
-                                       &readerGroupIdentifier);
-    UA_Server_setReaderGroupOperational(server, readerGroupIdentifier);
+    // in real-time mode receive from the real-time thread
+    setPubSubCallbackLifecycle(&readerGroupConfig.pubsubManagerCallback);
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        readerGroupConfig.rtLevel = UA_PUBSUB_RT_FIXED_SIZE;
+    }
+    retval |= UA_Server_addReaderGroup(server, connectionId, &readerGroupConfig, readerGroupId);
     return retval;
 }
 
-static UA_StatusCode addDataSetReader(UA_Server *server) {
+static UA_StatusCode setReaderGroupOperational(UA_Server *server, UA_NodeId readerGroupId) {
+    /* A fixed size ReaderGroup computes the offsets of the fields of its
+     * DataSetReader when its configuration is frozen. */
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        UA_Server_freezeReaderGroupConfiguration(server, readerGroupId);
+    }
+    return UA_Server_setReaderGroupOperational(server, readerGroupId);
+}
+
+static UA_StatusCode addDataSetReader(UA_Server *server, subscribed_heart_beat_t *subscribed) {
     if(server == NULL) {
         return UA_STATUSCODE_BADINTERNALERROR;
     }
 
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
     memset (&readerConfig, 0, sizeof(UA_DataSetReaderConfig));
-    readerConfig.name = UA_STRING("DataSet Reader 1");
-    UA_UInt16 publisherIdentifier = PUBLISHER_ID;
+    readerConfig.name = UA_STRING(subscribed->name);
+    /* the decoder drops messages of other publishers before any callback */
     readerConfig.publisherId.type = &UA_TYPES[UA_TYPES_UINT16];
-    readerConfig.publisherId.data = &publisherIdentifier;
+    readerConfig.publisherId.data = &subscribed->publisher_id;
     readerConfig.writerGroupId    = WRITER_GROUP_ID;
     readerConfig.dataSetWriterId  = DATASET_WRITER_ID;
 
     /* Setting up Meta data configuration in DataSetReader */
     fillTestDataSetMetaData(&readerConfig.dataSetMetaData);
+    readerConfig.dataSetMetaData.name = UA_STRING(subscribed->name);
+
+    /* Fixed size: the expected message layout, as published by the other couplers */
+    UA_UadpDataSetReaderMessageDataType *dataSetReaderMessage = NULL;
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        dataSetReaderMessage = UA_UadpDataSetReaderMessageDataType_new();
+        dataSetReaderMessage->networkMessageContentMask = HEART_BEAT_NETWORK_MESSAGE_CONTENT_MASK;
+        dataSetReaderMessage->dataSetMessageContentMask = HEART_BEAT_DATASET_MESSAGE_CONTENT_MASK;
+        dataSetReaderMessage->publishingInterval = PUBLISHING_INTERVAL;
+        readerConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+        readerConfig.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPDATASETREADERMESSAGEDATATYPE];
+        readerConfig.messageSettings.content.decoded.data = dataSetReaderMessage;
+    }
 
-    retval |= UA_Server_addDataSetReader(server, readerGroupIdentifier, &readerConfig,
-                                         &readerIdentifier);
+    retval |= UA_Server_addDataSetReader(server, subscribed->reader_group_identifier, &readerConfig,
+                                         &subscribed->reader_identifier);
+    if (dataSetReaderMessage != NULL) {
+        UA_UadpDataSetReaderMessageDataType_delete(dataSetReaderMessage);
+        memset(&readerConfig.messageSettings, 0, sizeof(UA_ExtensionObject));
+    }
     return retval;
 }
 
-static UA_StatusCode addSubscribedVariables(UA_Server *server, UA_NodeId dataSetReaderId) {
+static UA_StatusCode addSubscribedVariables(UA_Server *server, subscribed_heart_beat_t *subscribed) {
     if(server == NULL)
         return UA_STATUSCODE_BADINTERNALERROR;
 
     UA_StatusCode retval = UA_STATUSCODE_GOOD;
-    UA_NodeId folderId;
     UA_String folderName = readerConfig.dataSetMetaData.name;
     UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
     UA_QualifiedName folderBrowseName;
@@ -146,7 +308,7 @@ static UA_StatusCode addSubscribedVariables(UA_Server *server, UA_NodeId dataSet
                              UA_NODEID_NUMERIC (0, UA_NS0ID_OBJECTSFOLDER),
                              UA_NODEID_NUMERIC (0, UA_NS0ID_ORGANIZES),
                              folderBrowseName, UA_NODEID_NUMERIC (0,
-                             UA_NS0ID_BASEOBJECTTYPE), oAttr, NULL, &folderId);
+                             UA_NS0ID_BASEOBJECTTYPE), oAttr, NULL, &subscribed->folder_identifier);
 
     /* Create the TargetVariables with respect to DataSetMetaData fields */
     UA_FieldTargetVariable *targetVars = (UA_FieldTargetVariable *)
@@ -161,26 +323,44 @@ static UA_StatusCode addSubscribedVariables(UA_Server *server, UA_NodeId dataSet
         vAttr.dataType = readerConfig.dataSetMetaData.fields[i].dataType;
 
         UA_NodeId newNode;
-        retval |= UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, (UA_UInt32)i + 50000),
-                                           folderId,
+        retval |= UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, SUBSCRIBED_NUMERIC_NODE_ID_BASE +
+                                           subscribed->coupler_id * HEART_BEAT_FIELD_COUNT + (UA_UInt32)i),
+                                           subscribed->folder_identifier,
                                            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
                                            UA_QUALIFIEDNAME(1, (char *)readerConfig.dataSetMetaData.fields[i].name.data),
                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
-                                           vAttr, NULL, &newNode);
-        /*monitor variable*/
-        if (ENABLE_HEART_BEAT_CHECK) {
-          UA_MonitoredItemCreateRequest monRequest = UA_MonitoredItemCreateRequest_default(newNode);
-          monRequest.requestedParameters.samplingInterval = PUBLISHING_INTERVAL;
-          UA_Server_createDataChangeMonitoredItem(server, UA_TIMESTAMPSTORETURN_NEITHER,
-                                                  monRequest, NULL, dataChangeNotificationCallback);
-        }
+                                           vAttr, (void *)(uintptr_t)i, &newNode);
         /* For creating Targetvariables */
         UA_FieldTargetDataType_init(&targetVars[i].targetVariable);
         targetVars[i].targetVariable.attributeId  = UA_ATTRIBUTEID_VALUE;
         targetVars[i].targetVariable.targetNodeId = newNode;
+
+        if (ENABLE_PUBSUB_FIXED_OFFSET) {
+          /* the field is decoded straight into the node's external value and
+           * handled right after, in the ReaderGroup's receive callback */
+          UA_ValueBackend valueBackend;
+          memset(&valueBackend, 0, sizeof(UA_ValueBackend));
+          initSubscribedHeartBeatDataValue(subscribed, i);
+          valueBackend.backendType = UA_VALUEBACKENDTYPE_EXTERNAL;
+          valueBackend.backend.external.value = &subscribed->data_value_reference_list[i];
+          UA_Server_setVariableNode_valueBackend(server, newNode, valueBackend);
+          targetVars[i].externalDataValue = &subscribed->data_value_reference_list[i];
+          targetVars[i].targetVariableContext = (void *)(uintptr_t)i;
+          if (ENABLE_HEART_BEAT_CHECK) {
+            targetVars[i].afterWrite = afterWriteFixedOffsetHeartBeat;
+          }
+        }
+        /* handle every received heart beat (a monitored item would only
+         * sample the variable and miss messages) */
+        else if (ENABLE_HEART_BEAT_CHECK) {
+          UA_ValueCallback callback;
+          callback.onRead = NULL;
+          callback.onWrite = afterWriteSubscribedHeartBeat;
+          UA_Server_setVariableNode_valueCallback(server, newNode, callback);
+        }
     }
 
-    retval = UA_Server_DataSetReader_createTargetVariables(server, dataSetReaderId,
+    retval = UA_Server_DataSetReader_createTargetVariables(server, subscribed->reader_identifier,
                                                            readerConfig.dataSetMetaData.fieldsSize, targetVars);
     for(size_t i = 0; i < readerConfig.dataSetMetaData.fieldsSize; i++)
         UA_FieldTargetDataType_clear(&targetVars[i].targetVariable);
@@ -197,98 +377,439 @@ static void fillTestDataSetMetaData(UA_DataSetMetaDataType *pMetaData) {
 
     UA_DataSetMetaDataType_init (pMetaData);
     pMetaData->name = UA_STRING ("DataSet 1 (subscribed)");
-    pMetaData->fieldsSize = 1;
+
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        pMetaData->fieldsSize = 1;
+        pMetaData->fields = (UA_FieldMetaData*)UA_Array_new (pMetaData->fieldsSize,
+                             &UA_TYPES[UA_TYPES_FIELDMETADATA]);
+
+        /* heartbeat as <ID_of_coupler>.<heart_beats> */
+        UA_FieldMetaData_init (&pMetaData->fields[0]);
+        UA_NodeId_copy (&UA_TYPES[UA_TYPES_FLOAT].typeId,
+                        &pMetaData->fields[0].dataType);
+        pMetaData->fields[0].builtInType = UA_NS0ID_FLOAT;
+        pMetaData->fields[0].name =  UA_STRING ("Heartbeat (subscribed)");
+        pMetaData->fields[0].valueRank = -1; /* scalar */
+        return;
+    }
+
+    pMetaData->fieldsSize = HEART_BEAT_FIELD_COUNT;
     pMetaData->fields = (UA_FieldMetaData*)UA_Array_new (pMetaData->fieldsSize,
                          &UA_TYPES[UA_TYPES_FIELDMETADATA]);
 
-    /* heartbeat */
-    UA_FieldMetaData_init (&pMetaData->fields[0]);
-    UA_NodeId_copy (&UA_TYPES[UA_TYPES_FLOAT].typeId,
-                    &pMetaData->fields[0].dataType);
-    pMetaData->fields[0].builtInType = UA_NS0ID_FLOAT;
-    pMetaData->fields[0].name =  UA_STRING ("Heartbeat (subscribed)");
-    pMetaData->fields[0].valueRank = -1; /* scalar */
-
+    /* coupler ID */
+    UA_FieldMetaData_init (&pMetaData->fields[HEART_BEAT_FIELD_COUPLER_ID]);
+    UA_NodeId_copy (&UA_TYPES[UA_TYPES_UINT16].typeId,
+                    &pMetaData->fields[HEART_BEAT_FIELD_COUPLER_ID].dataType);
+    pMetaData->fields[HEART_BEAT_FIELD_COUPLER_ID].builtInType = UA_NS0ID_UINT16;
+    pMetaData->fields[HEART_BEAT_FIELD_COUPLER_ID].name =  UA_STRING ("Heartbeat coupler ID (subscribed)");
+    pMetaData->fields[HEART_BEAT_FIELD_COUPLER_ID].valueRank = -1; /* scalar */
+
+    /* heartbeat sequence number */
+    UA_FieldMetaData_init (&pMetaData->fields[HEART_BEAT_FIELD_SEQUENCE]);
+    UA_NodeId_copy (&UA_TYPES[UA_TYPES_UINT32].typeId,
+                    &pMetaData->fields[HEART_BEAT_FIELD_SEQUENCE].dataType);
+    pMetaData->fields[HEART_BEAT_FIELD_SEQUENCE].builtInType = UA_NS0ID_UINT32;
+    pMetaData->fields[HEART_BEAT_FIELD_SEQUENCE].name =  UA_STRING ("Heartbeat (subscribed)");
+    pMetaData->fields[HEART_BEAT_FIELD_SEQUENCE].valueRank = -1; /* scalar */
+
+    /* heartbeat monotonic send timestamp */
+    UA_FieldMetaData_init (&pMetaData->fields[HEART_BEAT_FIELD_TIMESTAMP]);
+    UA_NodeId_copy (&UA_TYPES[UA_TYPES_UINT64].typeId,
+                    &pMetaData->fields[HEART_BEAT_FIELD_TIMESTAMP].dataType);
+    pMetaData->fields[HEART_BEAT_FIELD_TIMESTAMP].builtInType = UA_NS0ID_UINT64;
+    pMetaData->fields[HEART_BEAT_FIELD_TIMESTAMP].name =  UA_STRING ("Heartbeat timestamp (subscribed)");
+    pMetaData->fields[HEART_BEAT_FIELD_TIMESTAMP].valueRank = -1; /* scalar */
 }
 
 
+// printable peer states (indexed by PEER_STATE_*)
+static const char *PEER_STATE_NAME_LIST[] = {"DOWN", "UP", "NO INITIAL HEART BEAT", "SUSPECT"};
+
+static void logPeerStateChange(liveness_table_t *table, unsigned int coupler_id,
+                               uint8_t previous_state, uint8_t state, uint64_t now, void *context) {
+  /*
+   * Trace and log the state change of a watched peer.
+   */
+  liveness_t *peer = &table->peer_list[coupler_id];
+
+  traceEvent(TRACE_PEER_STATE, coupler_id, previous_state << 8 | state, 0);
+  UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+              "%s: %d (was %s, age=%ld ms, missed=%u, out of order=%u, jitter=%u us)",
+              PEER_STATE_NAME_LIST[state], coupler_id, PEER_STATE_NAME_LIST[previous_state],
+              (long int)((now - getLastSeen(table, coupler_id)) / NANO_SECONDS_PER_MILLI_SECOND),
+              peer->missed_count, peer->out_of_order_count,
+              (unsigned int)(peer->jitter_ewma / NANO_SECONDS_PER_MICRO_SECOND));
+}
+
 void callbackCheckHeartBeat() {
   /*
-   * Check if for liveness of related couplers. Called upon a certain interval.
-   * If a related coupler is down got to safe mode.
+   * Check for liveness of related couplers. Called upon a certain interval.
+   * Every peer has its own state. If any related coupler is DOWN go to safe mode.
    */
-  int i, coupler_id, last_seen_timestamp_int, timestamp_delta;
-  bool is_down;
-  unsigned long int milli_seconds = getMilliSecondsSinceEpoch();
-  size_t n = sizeof(HEART_BEAT_ID_LIST)/sizeof(HEART_BEAT_ID_LIST[0]);
-  for (int i = 0; i < n; i++) {
-    coupler_id = HEART_BEAT_ID_LIST[i];
-    if (coupler_id > 0) {
-      // convert to str as this is the hash key
-      char* coupler_id_str = convertInt2Str(coupler_id);
-      char *last_seen_timestamp = getItem(SUBSCRIBER_DICT, coupler_id_str);
-      //UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Check ID=%s, last_seen=%s", coupler_id_str, last_seen_timestamp);
-      if (last_seen_timestamp != NULL){
-        // we do have timestamp for this coupler ID
-        last_seen_timestamp_int = atoi(last_seen_timestamp);
-        timestamp_delta = milli_seconds - last_seen_timestamp_int;
-        is_down = (timestamp_delta > HEART_BEAT_TIMEOUT_INTERVAL);
-        if (is_down) {
-          // count for stats the switch to SAFE mode
-          if (CURRENT_STATE != STATE_DOWN) {
-            CURRENT_STATE = STATE_DOWN;
-            SAFE_MODE_STATE_COUNTER += 1;
-            UA_LOG_INFO(UA_Log_Stdout, \
-                        UA_LOGCATEGORY_USERLAND, \
-                        "DOWN: %s (delta=%d)", coupler_id_str, timestamp_delta);
-            // go to safe mode as a dependant coupler is DOWN.
-            gotoSafeMode();
-          }
-        }
-        else {
-          // all good, we received a keep alive in time
-          if (CURRENT_STATE == STATE_NO_INITIAL_HEART_BEAT) {
-            // initial keep alive received, printout
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "INITIAL HEART BEAT received: %s", coupler_id_str);
-          }
-          else if (CURRENT_STATE == STATE_DOWN) {
-            // initial keep alive received, printout
-            UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, 
-                        "UP (recovered %d times): %s", SAFE_MODE_STATE_COUNTER, coupler_id_str);
-	    // go to normal operational mode
-	    gotoNormalMode();
-          }
-          CURRENT_STATE = STATE_UP;
-        }
-      }
-      else {
-        // still no hear beat from this coupler ...
-        if (CURRENT_STATE != STATE_NO_INITIAL_HEART_BEAT){
-          CURRENT_STATE = STATE_NO_INITIAL_HEART_BEAT;
-          UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "NO INITIAL HEART BEAT: %s", coupler_id_str);
+  unsigned int worst_state;
+  uint64_t now = getTimeBaseNanoSeconds();
+  uint64_t interval = (uint64_t)HEART_BEAT_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND;
+  uint64_t down_timeout = (uint64_t)HEART_BEAT_TIMEOUT_INTERVAL * NANO_SECONDS_PER_MILLI_SECOND;
+
+  worst_state = checkHeartBeatTimeouts(&LIVENESS_TABLE, now, interval, down_timeout,
+                                       logPeerStateChange, NULL);
+
+  if (worst_state == STATE_DOWN && CURRENT_STATE != STATE_DOWN) {
+    // count for stats the switch to SAFE mode
+    SAFE_MODE_STATE_COUNTER += 1;
+    // go to safe mode as a dependant coupler is DOWN.
+    gotoSafeMode();
+  }
+  else if (worst_state != STATE_DOWN && CURRENT_STATE == STATE_DOWN) {
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                "UP (recovered %d times)", SAFE_MODE_STATE_COUNTER);
+    // go to normal operational mode
+    gotoNormalMode();
+  }
+  CURRENT_STATE = worst_state;
+  recordMetricSince(&METRIC_LIST[METRIC_HEART_BEAT_CHECK], now);
+}
+
+static void logLivenessStatistics() {
+  /*
+   * Print heart beat statistics of all watched peers.
+   */
+  int i, watched_count;
+  uint16_t watched_id_list[MAX_COUPLER_COUNT];
+  liveness_t *peer;
+
+  watched_count = copyWatchedPeerList(&LIVENESS_TABLE, watched_id_list);
+  for (i = 0; i < watched_count; i++) {
+    peer = &LIVENESS_TABLE.peer_list[watched_id_list[i]];
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                "Peer %d: %s, heart beats=%u, missed=%u, out of order=%u, duplicate=%u, "
+                "jitter=%u us (max %u us), down=%u",
+                watched_id_list[i], PEER_STATE_NAME_LIST[peer->state],
+                peer->heart_beat_count, peer->missed_count, peer->out_of_order_count,
+                peer->duplicate_count, (unsigned int)(peer->jitter_ewma / NANO_SECONDS_PER_MICRO_SECOND),
+                (unsigned int)(peer->jitter_max / NANO_SECONDS_PER_MICRO_SECOND),
+                peer->down_count);
+  }
+}
+
+// read only variables of every watched peer under Objects/KeepAlive/<peer>
+#define KEEP_ALIVE_VARIABLE_STATE 0
+#define KEEP_ALIVE_VARIABLE_HEART_BEAT_COUNT 1
+#define KEEP_ALIVE_VARIABLE_SEQUENCE 2
+#define KEEP_ALIVE_VARIABLE_MISSED_COUNT 3
+#define KEEP_ALIVE_VARIABLE_OUT_OF_ORDER_COUNT 4
+#define KEEP_ALIVE_VARIABLE_DUPLICATE_COUNT 5
+#define KEEP_ALIVE_VARIABLE_JITTER_EWMA 6
+#define KEEP_ALIVE_VARIABLE_JITTER_MAX 7
+#define KEEP_ALIVE_VARIABLE_LAST_SEEN_AGE 8
+#define KEEP_ALIVE_VARIABLE_DOWN_COUNT 9
+#define KEEP_ALIVE_VARIABLE_COUNT 10
+
+// numeric NodeIds of a peer are KEEP_ALIVE_NUMERIC_NODE_ID_BASE + peer * stride + variable (folder is last)
+#define KEEP_ALIVE_NODE_ID_STRIDE 16
+
+static const char *KEEP_ALIVE_VARIABLE_NAME_LIST[] = {
+    "State", "HeartBeats", "Sequence", "Missed", "OutOfOrder", "Duplicate",
+    "JitterEwmaNs", "JitterMaxNs", "LastSeenAgeMs", "DownCount"
+};
+
+static UA_StatusCode readKeepAliveVariable(UA_Server *server,
+                                           const UA_NodeId *sessionId, void *sessionContext,
+                                           const UA_NodeId *nodeId, void *nodeContext,
+                                           UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                                           UA_DataValue *dataValue) {
+    /*
+     * Read a peer's statistic straight from the liveness table.
+     */
+    uintptr_t context = (uintptr_t)nodeContext;
+    unsigned int coupler_id = context / KEEP_ALIVE_NODE_ID_STRIDE;
+    liveness_t *peer = &LIVENESS_TABLE.peer_list[coupler_id];
+    uint64_t last_seen;
+    UA_UInt32 value = 0;
+
+    switch (context % KEEP_ALIVE_NODE_ID_STRIDE) {
+    case KEEP_ALIVE_VARIABLE_STATE:
+        value = __atomic_load_n(&peer->state, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_HEART_BEAT_COUNT:
+        value = __atomic_load_n(&peer->heart_beat_count, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_SEQUENCE:
+        value = __atomic_load_n(&peer->sequence, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_MISSED_COUNT:
+        value = __atomic_load_n(&peer->missed_count, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_OUT_OF_ORDER_COUNT:
+        value = __atomic_load_n(&peer->out_of_order_count, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_DUPLICATE_COUNT:
+        value = __atomic_load_n(&peer->duplicate_count, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_JITTER_EWMA:
+        value = __atomic_load_n(&peer->jitter_ewma, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_JITTER_MAX:
+        value = __atomic_load_n(&peer->jitter_max, __ATOMIC_RELAXED);
+        break;
+    case KEEP_ALIVE_VARIABLE_LAST_SEEN_AGE:
+        last_seen = getLastSeen(&LIVENESS_TABLE, coupler_id);
+        if (last_seen == LIVENESS_NEVER_SEEN) {
+            dataValue->hasStatus = true;
+            dataValue->status = UA_STATUSCODE_BADWAITINGFORINITIALDATA;
+            return UA_STATUSCODE_GOOD;
         }
-      }
+        value = (UA_UInt32)((getTimeBaseNanoSeconds() - last_seen) / NANO_SECONDS_PER_MILLI_SECOND);
+        break;
+    case KEEP_ALIVE_VARIABLE_DOWN_COUNT:
+        value = __atomic_load_n(&peer->down_count, __ATOMIC_RELAXED);
+        break;
     }
-  }
+    UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_UINT32]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
 }
 
+static void getKeepAlivePeerNodeId(node_id_t *peer_node_id, unsigned int coupler_id) {
+    char name[MAX_NODE_ID_NAME_LENGTH];
 
-static int enableSubscribeToHeartBeat(UA_Server *server, UA_ServerConfig *config){
-    // enable subscribe to keep-alive messages
+    snprintf(name, sizeof(name), "keepalive.%d", coupler_id);
+    resolveNodeId(peer_node_id, name, KEEP_ALIVE_NUMERIC_NODE_ID_BASE +
+                  coupler_id * KEEP_ALIVE_NODE_ID_STRIDE + KEEP_ALIVE_NODE_ID_STRIDE - 1);
+}
+
+static void addKeepAlivePeerVariables(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Expose the liveness statistics of a watched peer (read only).
+     */
+    int j;
+    char name[MAX_NODE_ID_NAME_LENGTH];
+    char peer_name[16];
+    node_id_t folder_node_id, peer_node_id, variable_node_id;
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    UA_DataSource dataSource;
+
+    dataSource.read = readKeepAliveVariable;
+    dataSource.write = NULL;
+    resolveNodeId(&folder_node_id, "keepalive", KEEP_ALIVE_NUMERIC_NODE_ID);
+    snprintf(peer_name, sizeof(peer_name), "%d", coupler_id);
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", peer_name);
+    getKeepAlivePeerNodeId(&peer_node_id, coupler_id);
+    UA_Server_addObjectNode(server, peer_node_id.node_id, folder_node_id.node_id,
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                            UA_QUALIFIEDNAME(1, peer_name),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), oAttr, NULL, NULL);
+
+    for (j = 0; j < KEEP_ALIVE_VARIABLE_COUNT; j++) {
+        UA_VariableAttributes vAttr = UA_VariableAttributes_default;
+        vAttr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)KEEP_ALIVE_VARIABLE_NAME_LIST[j]);
+        vAttr.dataType = UA_TYPES[UA_TYPES_UINT32].typeId;
+        vAttr.accessLevel = UA_ACCESSLEVELMASK_READ;
+        snprintf(name, sizeof(name), "keepalive.%d.%s", coupler_id, KEEP_ALIVE_VARIABLE_NAME_LIST[j]);
+        resolveNodeId(&variable_node_id, name, KEEP_ALIVE_NUMERIC_NODE_ID_BASE +
+                      coupler_id * KEEP_ALIVE_NODE_ID_STRIDE + j);
+        UA_Server_addDataSourceVariableNode(server, variable_node_id.node_id, peer_node_id.node_id,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                            UA_QUALIFIEDNAME(1, (char *)KEEP_ALIVE_VARIABLE_NAME_LIST[j]),
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                            vAttr, dataSource,
+                                            (void *)(uintptr_t)(coupler_id * KEEP_ALIVE_NODE_ID_STRIDE + j),
+                                            NULL);
+    }
+}
+
+static void removeKeepAlivePeerVariables(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Remove the statistics of a peer no longer watched (its variables are
+     * deleted together with its object).
+     */
+    int j;
+    char name[MAX_NODE_ID_NAME_LENGTH];
+    node_id_t peer_node_id, variable_node_id;
+
+    for (j = 0; j < KEEP_ALIVE_VARIABLE_COUNT; j++) {
+        snprintf(name, sizeof(name), "keepalive.%d.%s", coupler_id, KEEP_ALIVE_VARIABLE_NAME_LIST[j]);
+        resolveNodeId(&variable_node_id, name, KEEP_ALIVE_NUMERIC_NODE_ID_BASE +
+                      coupler_id * KEEP_ALIVE_NODE_ID_STRIDE + j);
+        UA_Server_deleteNode(server, variable_node_id.node_id, true);
+    }
+    getKeepAlivePeerNodeId(&peer_node_id, coupler_id);
+    UA_Server_deleteNode(server, peer_node_id.node_id, true);
+}
+
+static void addKeepAliveVariables(UA_Server *server) {
+    /*
+     * Expose the liveness statistics of every watched peer (read only).
+     */
+    int i;
+    node_id_t folder_node_id;
+    UA_NodeId parentNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+
+    UA_ObjectAttributes oAttr = UA_ObjectAttributes_default;
+    oAttr.displayName = UA_LOCALIZEDTEXT("en-US", "KeepAlive");
+    resolveNodeId(&folder_node_id, "keepalive", KEEP_ALIVE_NUMERIC_NODE_ID);
+    UA_Server_addObjectNode(server, folder_node_id.node_id, parentNodeId,
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                            UA_QUALIFIEDNAME(1, "KeepAlive"),
+                            UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), oAttr, NULL, NULL);
+
+    for (i = 0; i < LIVENESS_TABLE.watched_count; i++) {
+        addKeepAlivePeerVariables(server, LIVENESS_TABLE.watched_id_list[i]);
+    }
+}
+
+static void addHeartBeatReaderGroup(UA_Server *server, UA_NodeId *connectionId, UA_NodeId *readerGroupId) {
+    /*
+     * Add a connection to the heart beat address and a ReaderGroup to it.
+     */
     UA_String transportProfile = UA_STRING(DEFAULT_TRANSPORT_PROFILE);
-    UA_NetworkAddressUrlDataType networkAddressUrl = {UA_STRING_NULL , UA_STRING(NETWORK_ADDRESS_URL_DATA_TYPE)};
-    addPubSubConnectionSubscriber(server, &transportProfile, &networkAddressUrl);
+    UA_NetworkAddressUrlDataType networkAddressUrl = {UA_STRING_NULL , UA_STRING((char *)getPubSubNetworkAddressUrl())};
+
+    addPubSubConnectionSubscriber(server, &transportProfile, &networkAddressUrl, connectionId);
+    addReaderGroup(server, *connectionId, readerGroupId);
+}
 
-    /* Add ReaderGroup to the created PubSubConnection */
-    addReaderGroup(server);
+static int addSubscribedHeartBeat(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Add the DataSetReader and the subscribed variables of a coupler.
+     * Return -1 if it can not be created.
+     */
+    subscribed_heart_beat_t *subscribed = newSubscribedHeartBeat(coupler_id);
+
+    if (subscribed == NULL) {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                     "Can not allocate heart beat DataSetReader of %d", coupler_id);
+        return -1;
+    }
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        /* a fixed size ReaderGroup has a single DataSetReader: every
+         * coupler gets its own connection and ReaderGroup */
+        addHeartBeatReaderGroup(server, &subscribed->connection_identifier,
+                                &subscribed->reader_group_identifier);
+    }
+    else {
+        subscribed->connection_identifier = connectionIdentifier;
+        subscribed->reader_group_identifier = readerGroupIdentifier;
+    }
 
-    /* Add DataSetReader to the created ReaderGroup */
-    addDataSetReader(server);
+    /* Add the coupler's DataSetReader to its ReaderGroup */
+    addDataSetReader(server, subscribed);
 
     /* Add SubscribedVariables to the created DataSetReader */
-    addSubscribedVariables(server, readerIdentifier);
+    addSubscribedVariables(server, subscribed);
+
+    /* Start receiving once the DataSetReader and its fields exist */
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        setReaderGroupOperational(server, subscribed->reader_group_identifier);
+    }
+    return 0;
+}
+
+static void removeSubscribedHeartBeat(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Remove the DataSetReader and the subscribed variables of a coupler.
+     */
+    size_t i;
+    subscribed_heart_beat_t *subscribed;
+
+    if (coupler_id >= MAX_COUPLER_COUNT || SUBSCRIBED_HEART_BEAT_LIST[coupler_id] == NULL) {
+        return;
+    }
+    subscribed = SUBSCRIBED_HEART_BEAT_LIST[coupler_id];
+    /* no ReaderGroup callback in flight in the real-time thread while open62541
+     * removes it holding its serviceMutex (see rt_executive.h) */
+    suspendRTTaskList();
+    if (ENABLE_PUBSUB_FIXED_OFFSET) {
+        /* the connection takes its ReaderGroup and DataSetReader along */
+        UA_Server_unfreezeReaderGroupConfiguration(server, subscribed->reader_group_identifier);
+        UA_Server_removePubSubConnection(server, subscribed->connection_identifier);
+    }
+    else {
+        UA_Server_removeDataSetReader(server, subscribed->reader_identifier);
+    }
+    resumeRTTaskList();
+    for (i = 0; i < HEART_BEAT_FIELD_COUNT; i++) {
+        UA_Server_deleteNode(server, UA_NODEID_NUMERIC(1, SUBSCRIBED_NUMERIC_NODE_ID_BASE +
+                             coupler_id * HEART_BEAT_FIELD_COUNT + (UA_UInt32)i), true);
+    }
+    UA_Server_deleteNode(server, subscribed->folder_identifier, true);
+    deleteSubscribedHeartBeat(coupler_id);
+}
+
+
+static int enableSubscribeToHeartBeat(UA_Server *server, UA_ServerConfig *config){
+    // enable subscribe to keep-alive messages
+    int i;
+
+    // no heart beat seen yet: the first check must not count as a recovery
+    CURRENT_STATE = STATE_NO_INITIAL_HEART_BEAT;
+
+    /* Add a ReaderGroup shared by the DataSetReaders of all couplers */
+    if (!ENABLE_PUBSUB_FIXED_OFFSET) {
+        addHeartBeatReaderGroup(server, &connectionIdentifier, &readerGroupIdentifier);
+    }
+
+    if (HEART_BEAT_LEGACY_FORMAT) {
+        if (addSubscribedHeartBeat(server, 0) < 0) {
+            return -1;
+        }
+    }
+    else {
+        for (i = 0; i < LIVENESS_TABLE.watched_count; i++) {
+            if (addSubscribedHeartBeat(server, LIVENESS_TABLE.watched_id_list[i]) < 0) {
+                return -1;
+            }
+        }
+    }
+
+    /* Start receiving once the DataSetReaders and their fields exist */
+    if (!ENABLE_PUBSUB_FIXED_OFFSET) {
+        setReaderGroupOperational(server, readerGroupIdentifier);
+    }
+
+    /* Expose liveness statistics of watched couplers */
+    addKeepAliveVariables(server);
 
    // add a callback which will check related coupler's heart beats
    UA_UInt64 callbackId = 2;
-   UA_Server_addRepeatedCallback(server, callbackCheckHeartBeat, NULL, HEART_BEAT_INTERVAL, &callbackId);
+   addCyclicCallback(server, callbackCheckHeartBeat, NULL, HEART_BEAT_INTERVAL, &callbackId);
+   HEART_BEAT_SUBSCRIBER_ENABLED = true;
+   return 0;
+}
+
+static int watchHeartBeatPeer(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Start checking the heart beats of a coupler while running (config reload).
+     * Return -1 if the ID is out of range or its reader can not be added.
+     */
+    if (watchPeer(&LIVENESS_TABLE, coupler_id, STATE_NO_INITIAL_HEART_BEAT) < 0) {
+        return -1;
+    }
+    if (!HEART_BEAT_SUBSCRIBER_ENABLED) {
+        // first watched peer: subscribe as if it was given on the command line
+        ENABLE_HEART_BEAT_CHECK = true;
+        return enableSubscribeToHeartBeat(server, UA_Server_getConfig(server));
+    }
+    // legacy heart beats of all couplers go through the single reader
+    if (!HEART_BEAT_LEGACY_FORMAT && addSubscribedHeartBeat(server, coupler_id) < 0) {
+        unwatchPeer(&LIVENESS_TABLE, coupler_id);
+        return -1;
+    }
+    addKeepAlivePeerVariables(server, coupler_id);
+    return 0;
+}
+
+static void unwatchHeartBeatPeer(UA_Server *server, unsigned int coupler_id) {
+    /*
+     * Stop checking the heart beats of a coupler while running (config reload).
+     */
+    unwatchPeer(&LIVENESS_TABLE, coupler_id);
+    if (!HEART_BEAT_SUBSCRIBER_ENABLED) {
+        return;
+    }
+    removeKeepAlivePeerVariables(server, coupler_id);
+    if (!HEART_BEAT_LEGACY_FORMAT) {
+        removeSubscribedHeartBeat(server, coupler_id);
+    }
 }
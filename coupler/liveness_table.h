@@ -0,0 +1,384 @@
+/*
+ * Liveness table of peer couplers.
+ *
+ * One cache line aligned slot per possible coupler ID so a received heart
+ * beat and a liveness check are a direct array access: no hashing, no
+ * strings, no allocation. Slots are written by the heart beat receiver and
+ * read by the checker with atomic loads / stores so both can run in
+ * different threads.
+ *
+ * Every peer runs its own state machine driven by the age of its last heart
+ * beat:
+ *
+ *   NO_INITIAL --beat--> UP --age > suspect--> SUSPECT --age > down--> DOWN
+ *                        ^                        |                     |
+ *                        +--------fresh beat------+---------------------+
+ *
+ * and keeps statistics of its heart beat stream (missed, out of order and
+ * duplicate frames from sequence numbers, inter-arrival jitter) which are
+ * the data to tune the timeout from.
+ *
+ * All functions take the table as argument so several tables can coexist
+ * (i.e. one per simulated coupler).
+ *
+ * The list of watched peers may change at runtime (configuration reload) in
+ * one thread while others walk it (checker in the real-time thread, metrics
+ * socket): it is guarded by a sequence number (seqlock), readers take a
+ * consistent copy with copyWatchedPeerList().
+ */
+#ifndef LIVENESS_TABLE_H
+#define LIVENESS_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// the maximal number of couplers (IDs 0 .. MAX_COUPLER_COUNT - 1)
+#define MAX_COUPLER_COUNT 1024
+
+#define CACHE_LINE_SIZE 64
+
+// no heart beat received yet
+#define LIVENESS_NEVER_SEEN 0
+
+// peer states
+#define PEER_STATE_DOWN 0
+#define PEER_STATE_UP 1
+#define PEER_STATE_NO_INITIAL 2
+#define PEER_STATE_SUSPECT 3
+
+// weight of a new jitter sample in the EWMA (1/16 as in RFC 3550)
+#define LIVENESS_JITTER_EWMA_SHIFT 4
+
+// heart beats at most that much older than the last one are reordered ones,
+// older ones come from a restarted peer whose sequence starts again
+#define LIVENESS_REORDER_WINDOW 16
+
+// heart beat protocol defaults, same for all couplers of a cell (keep_alive.h)
+#define LIVENESS_DEFAULT_HEART_BEAT_INTERVAL 250    // ms
+#define LIVENESS_DEFAULT_DOWN_HEART_BEAT_COUNT 4    // default down timeout, in heart beats
+#define LIVENESS_SUSPECT_HEART_BEAT_COUNT 2         // suspect timeout, in heart beats
+// heart beats are published with PublisherId LIVENESS_PUBLISHER_ID_BASE + coupler ID
+#define LIVENESS_PUBLISHER_ID_BASE 4096
+
+typedef struct {
+    uint64_t last_seen;         // local monotonic time (ns) of the last heart beat
+    uint64_t in_order_seen;     // local monotonic time (ns) of the last in order heart beat
+    uint64_t send_timestamp;    // peer's monotonic send timestamp (ns) of the last heart beat
+    uint32_t sequence;          // sequence number of the last heart beat
+    uint32_t heart_beat_count;  // number of received heart beats
+    uint32_t missed_count;      // heart beats never received (sequence gaps)
+    uint32_t out_of_order_count;// heart beats older than the last one
+    uint32_t duplicate_count;   // heart beats with the same sequence as the last one
+    uint32_t interval;          // last inter-arrival time (ns)
+    uint32_t jitter_ewma;       // inter-arrival jitter (ns), exponentially weighted
+    uint32_t jitter_max;        // maximal inter-arrival jitter (ns)
+    uint32_t down_count;        // number of transitions to DOWN
+    uint8_t state;              // PEER_STATE_*
+    uint8_t watched;            // the coupler depends on this peer
+} __attribute__((aligned(CACHE_LINE_SIZE))) liveness_t;
+
+typedef struct {
+    liveness_t peer_list[MAX_COUPLER_COUNT];
+    // IDs of watched peers, so checks do not walk the whole table
+    uint16_t watched_id_list[MAX_COUPLER_COUNT];
+    int watched_count;
+    uint32_t watched_sequence;  // odd while watched_id_list / watched_count change
+} liveness_table_t;
+
+static void initLivenessTable(liveness_table_t *table)
+{
+    /*
+     * Forget all peers.
+     */
+    memset(table, 0, sizeof(liveness_table_t));
+}
+
+static void beginWatchedPeerListChange(liveness_table_t *table)
+{
+    __atomic_store_n(&table->watched_sequence, table->watched_sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void endWatchedPeerListChange(liveness_table_t *table)
+{
+    __atomic_store_n(&table->watched_sequence, table->watched_sequence + 1, __ATOMIC_RELEASE);
+}
+
+static int copyWatchedPeerList(liveness_table_t *table, uint16_t *id_list)
+{
+    /*
+     * Copy the IDs of the watched peers (MAX_COUPLER_COUNT entries at most),
+     * consistent even while another thread changes the list. Return their count.
+     */
+    uint32_t sequence_before, sequence_after;
+    int count;
+
+    do
+    {
+        sequence_before = __atomic_load_n(&table->watched_sequence, __ATOMIC_ACQUIRE);
+        count = __atomic_load_n(&table->watched_count, __ATOMIC_RELAXED);
+        if (count < 0 || count > MAX_COUPLER_COUNT)
+            count = 0;
+        memcpy(id_list, table->watched_id_list, count * sizeof(uint16_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        sequence_after = __atomic_load_n(&table->watched_sequence, __ATOMIC_RELAXED);
+    } while ((sequence_before & 1) || sequence_before != sequence_after);
+    return count;
+}
+
+static int watchPeer(liveness_table_t *table, unsigned int coupler_id, uint8_t initial_state)
+{
+    /*
+     * Add a peer to the list of couplers whose heart beats are checked
+     * (one thread only changes the list). A peer watched again starts as
+     * never seen: its heart beats were not received while it was unwatched.
+     * Return -1 if the ID is out of range.
+     */
+    liveness_t *peer;
+
+    if (coupler_id >= MAX_COUPLER_COUNT)
+    {
+        return -1;
+    }
+
+    peer = &table->peer_list[coupler_id];
+    if (!peer->watched)
+    {
+        beginWatchedPeerListChange(table);
+        __atomic_store_n(&peer->last_seen, LIVENESS_NEVER_SEEN, __ATOMIC_RELAXED);
+        __atomic_store_n(&peer->in_order_seen, LIVENESS_NEVER_SEEN, __ATOMIC_RELAXED);
+        __atomic_store_n(&peer->sequence, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&peer->heart_beat_count, 0, __ATOMIC_RELAXED);
+        peer->watched = 1;
+        peer->state = initial_state;
+        table->watched_id_list[table->watched_count] = coupler_id;
+        __atomic_store_n(&table->watched_count, table->watched_count + 1, __ATOMIC_RELAXED);
+        endWatchedPeerListChange(table);
+    }
+    return 0;
+}
+
+static int unwatchPeer(liveness_table_t *table, unsigned int coupler_id)
+{
+    /*
+     * Stop checking the heart beats of a peer (its statistics are kept,
+     * one thread only changes the list). Return -1 if the ID is out of range.
+     */
+    int i;
+    liveness_t *peer;
+
+    if (coupler_id >= MAX_COUPLER_COUNT)
+    {
+        return -1;
+    }
+
+    peer = &table->peer_list[coupler_id];
+    if (!peer->watched)
+    {
+        return 0;
+    }
+    beginWatchedPeerListChange(table);
+    peer->watched = 0;
+    for (i = 0; i < table->watched_count; i++)
+    {
+        if (table->watched_id_list[i] == coupler_id)
+        {
+            // keep the order of the remaining peers
+            memmove(&table->watched_id_list[i], &table->watched_id_list[i + 1],
+                    (table->watched_count - i - 1) * sizeof(uint16_t));
+            __atomic_store_n(&table->watched_count, table->watched_count - 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    endWatchedPeerListChange(table);
+    return 0;
+}
+
+static int updateLiveness(liveness_table_t *table, unsigned int coupler_id, uint32_t sequence,
+                          uint64_t send_timestamp, uint64_t now)
+{
+    /*
+     * Register a heart beat of a peer received at (monotonic) time now.
+     * Every heart beat keeps the peer alive, the sequence numbers only feed
+     * the statistics: duplicate and out of order heart beats are counted but
+     * not used for them. A watched peer that is DOWN or one whose sequence goes back by
+     * more than LIVENESS_REORDER_WINDOW restarted: its sequence is taken over.
+     * A send_timestamp of 0 (legacy heart beats) measures jitter between
+     * consecutive inter-arrival times instead of against the send times.
+     * Only one thread may update a table. Return -1 if the ID is out of range.
+     */
+    liveness_t *peer;
+    int32_t sequence_delta;
+    bool restarted;
+    int64_t transit_delta;
+    uint64_t jitter;
+    uint32_t interval;
+
+    if (coupler_id >= MAX_COUPLER_COUNT)
+    {
+        return -1;
+    }
+
+    peer = &table->peer_list[coupler_id];
+    if (peer->heart_beat_count > 0)
+    {
+        // wrap around safe
+        sequence_delta = (int32_t)(sequence - peer->sequence);
+        restarted = sequence_delta <= 0 &&
+                    ((peer->watched && peer->state == PEER_STATE_DOWN) ||
+                     sequence_delta < -LIVENESS_REORDER_WINDOW);
+        if (!restarted && send_timestamp != 0 && sequence_delta <= 0)
+        {
+            if (sequence_delta == 0)
+                __atomic_store_n(&peer->duplicate_count, peer->duplicate_count + 1, __ATOMIC_RELAXED);
+            else
+                __atomic_store_n(&peer->out_of_order_count, peer->out_of_order_count + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&peer->last_seen, now, __ATOMIC_RELEASE);
+            return 0;
+        }
+        if (sequence_delta > 1)
+        {
+            __atomic_store_n(&peer->missed_count, peer->missed_count + sequence_delta - 1, __ATOMIC_RELAXED);
+        }
+
+        // D = (R_i - R_i-1) - (S_i - S_i-1)
+        interval = now - peer->in_order_seen > UINT32_MAX ? UINT32_MAX : (uint32_t)(now - peer->in_order_seen);
+        if (restarted)
+            // the send times of a restarted peer start again too
+            transit_delta = 0;
+        else if (send_timestamp != 0)
+            transit_delta = (int64_t)(now - peer->in_order_seen) - (int64_t)(send_timestamp - peer->send_timestamp);
+        else
+            transit_delta = (int64_t)interval - (int64_t)peer->interval;
+        jitter = transit_delta < 0 ? -transit_delta : transit_delta;
+        if (jitter > UINT32_MAX)
+            jitter = UINT32_MAX;
+        // the first interval has no previous one to compare to
+        if (!restarted && (send_timestamp != 0 || peer->heart_beat_count > 1))
+        {
+            __atomic_store_n(&peer->jitter_ewma,
+                             (uint32_t)(peer->jitter_ewma + (((int64_t)jitter - peer->jitter_ewma) >> LIVENESS_JITTER_EWMA_SHIFT)),
+                             __ATOMIC_RELAXED);
+            if (jitter > peer->jitter_max)
+                __atomic_store_n(&peer->jitter_max, (uint32_t)jitter, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&peer->interval, interval, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&peer->sequence, sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&peer->send_timestamp, send_timestamp, __ATOMIC_RELAXED);
+    __atomic_store_n(&peer->heart_beat_count, peer->heart_beat_count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&peer->in_order_seen, now, __ATOMIC_RELAXED);
+    // publish last: a reader seeing the new time also sees the new sequence
+    __atomic_store_n(&peer->last_seen, now, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static uint64_t getLastSeen(liveness_table_t *table, unsigned int coupler_id)
+{
+    /*
+     * Return the local monotonic time (ns) of the last heart beat of a peer
+     * or LIVENESS_NEVER_SEEN.
+     */
+    if (coupler_id >= MAX_COUPLER_COUNT)
+    {
+        return LIVENESS_NEVER_SEEN;
+    }
+    return __atomic_load_n(&table->peer_list[coupler_id].last_seen, __ATOMIC_ACQUIRE);
+}
+
+static uint8_t checkPeerState(liveness_table_t *table, unsigned int coupler_id, uint64_t now,
+                              uint64_t suspect_timeout, uint64_t down_timeout)
+{
+    /*
+     * Advance the state machine of a peer at (monotonic) time now. A peer
+     * whose last heart beat is older than suspect_timeout (ns) is SUSPECT,
+     * older than down_timeout (ns) is DOWN. Return the new state.
+     */
+    liveness_t *peer = &table->peer_list[coupler_id];
+    uint64_t last_seen = getLastSeen(table, coupler_id);
+    uint64_t age;
+    uint8_t state;
+
+    if (last_seen == LIVENESS_NEVER_SEEN)
+    {
+        state = PEER_STATE_NO_INITIAL;
+    }
+    else
+    {
+        age = now > last_seen ? now - last_seen : 0;
+        if (age > down_timeout)
+            state = PEER_STATE_DOWN;
+        else if (age > suspect_timeout)
+            state = PEER_STATE_SUSPECT;
+        else
+            state = PEER_STATE_UP;
+    }
+
+    if (state == PEER_STATE_DOWN && peer->state != PEER_STATE_DOWN)
+    {
+        __atomic_store_n(&peer->down_count, peer->down_count + 1, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&peer->state, state, __ATOMIC_RELAXED);
+    return state;
+}
+
+// called for every watched peer whose state changed during a check
+typedef void (*peer_state_change_callback_t)(liveness_table_t *table, unsigned int coupler_id,
+                                             uint8_t previous_state, uint8_t state,
+                                             uint64_t now, void *context);
+
+static uint8_t checkWatchedPeerList(liveness_table_t *table, uint64_t now,
+                                    uint64_t suspect_timeout, uint64_t down_timeout,
+                                    peer_state_change_callback_t callback, void *context)
+{
+    /*
+     * Advance the state machine of every watched peer at (monotonic) time
+     * now and return the worst state the coupler depends on: DOWN if any
+     * peer is DOWN, else NO_INITIAL if any peer never sent a heart beat,
+     * else UP (a SUSPECT peer still counts as UP). callback (may be NULL)
+     * is called for every peer whose state changed.
+     */
+    uint16_t id_list[MAX_COUPLER_COUNT];
+    int i, count;
+    unsigned int coupler_id;
+    uint8_t state, previous_state;
+    uint8_t worst_state = PEER_STATE_UP;
+
+    count = copyWatchedPeerList(table, id_list);
+    for (i = 0; i < count; i++)
+    {
+        coupler_id = id_list[i];
+        previous_state = table->peer_list[coupler_id].state;
+        state = checkPeerState(table, coupler_id, now, suspect_timeout, down_timeout);
+        if (state != previous_state && callback != NULL)
+        {
+            callback(table, coupler_id, previous_state, state, now, context);
+        }
+        if (state == PEER_STATE_DOWN)
+            worst_state = PEER_STATE_DOWN;
+        else if (state == PEER_STATE_NO_INITIAL && worst_state != PEER_STATE_DOWN)
+            worst_state = PEER_STATE_NO_INITIAL;
+    }
+    return worst_state;
+}
+
+static uint8_t checkHeartBeatTimeouts(liveness_table_t *table, uint64_t now,
+                                      uint64_t interval, uint64_t down_timeout,
+                                      peer_state_change_callback_t callback, void *context)
+{
+    /*
+     * Check the watched peers of a coupler publishing heart beats every
+     * interval (ns): a peer is SUSPECT after LIVENESS_SUSPECT_HEART_BEAT_COUNT
+     * missing heart beats (at most down_timeout), DOWN after down_timeout (ns).
+     * Return the worst state as checkWatchedPeerList().
+     */
+    uint64_t suspect_timeout = LIVENESS_SUSPECT_HEART_BEAT_COUNT * interval;
+
+    if (suspect_timeout > down_timeout)
+        suspect_timeout = down_timeout;
+    return checkWatchedPeerList(table, now, suspect_timeout, down_timeout, callback, context);
+}
+
+#endif
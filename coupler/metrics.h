@@ -0,0 +1,158 @@
+/*
+ * Runtime metrics: fixed bucket, HDR style latency histograms.
+ *
+ * A histogram has 8 linear sub-buckets per power of two (at most 12.5%
+ * relative error) from 1 ns up to ~9 minutes, so recording a value is a
+ * count leading zeros, a shift and three plain (non locked) increments on a
+ * cache line of its own: a few ns, always on. Histograms are never reset,
+ * readers (OPC UA Diagnostics object, Prometheus dump) take relaxed snapshots.
+ *
+ * A histogram has a single writer: it is recorded by one thread (I/O
+ * scanner, server or real-time thread) or under the lock serializing the
+ * recorded operation (I2C_RELAY_LOCK for relay writes).
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <string.h>
+#include "time_base.h"
+
+// finer histograms (rt_analyzer) define more sub-bucket bits before including
+#ifndef METRIC_SUB_BUCKET_BITS
+#define METRIC_SUB_BUCKET_BITS 3
+#endif
+#define METRIC_SUB_BUCKET_COUNT (1U << METRIC_SUB_BUCKET_BITS)
+// values up to 2^40 ns, larger ones go to the last bucket
+#define METRIC_MAX_EXPONENT 40
+#define METRIC_BUCKET_COUNT ((METRIC_MAX_EXPONENT - METRIC_SUB_BUCKET_BITS + 1) * METRIC_SUB_BUCKET_COUNT)
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;                               // ns
+    uint64_t max;                               // ns
+    uint32_t bucket_list[METRIC_BUCKET_COUNT];
+} __attribute__((aligned(CACHE_LINE_SIZE))) metric_histogram_t;
+
+// I2C transactions per slave
+#define METRIC_I2C_WRITE 0                      // relays
+#define METRIC_I2C_READ 1                       // all inputs
+#define METRIC_I2C_OP_COUNT 2
+
+// all histograms of the coupler
+#define METRIC_IO_SCAN_CYCLE 0                  // duration of an I/O scan cycle
+#define METRIC_INPUT_CHANGE_WRITE 1             // duration of writing the changed inputs of a slave into variables
+#define METRIC_OPC_UA_WRITE 2                   // duration of MOD-IO variable write callback
+#define METRIC_HEART_BEAT_PUBLISH_JITTER 3      // |publish period - heart beat interval|
+#define METRIC_HEART_BEAT_INTER_ARRIVAL 4       // time between two heart beats of a peer
+#define METRIC_HEART_BEAT_CHECK 5               // duration of a heart beat check
+#define METRIC_COUNT 6
+
+// not every includer records or names metrics
+static metric_histogram_t METRIC_LIST[METRIC_COUNT] __attribute__((unused));
+
+static const char *METRIC_NAME_LIST[] __attribute__((unused)) = {
+    "io_scan_cycle", "input_change_write", "opc_ua_write",
+    "heart_beat_publish_jitter", "heart_beat_inter_arrival", "heart_beat_check"
+};
+static const char *METRIC_I2C_OP_NAME_LIST[] __attribute__((unused)) = {"write", "read"};
+
+static inline unsigned int getMetricBucket(uint64_t value)
+{
+    /*
+     * Return the bucket of a value.
+     */
+    unsigned int exponent, shift, bucket;
+
+    if (value < METRIC_SUB_BUCKET_COUNT)
+        return (unsigned int)value;
+    exponent = 63 - __builtin_clzll(value);
+    shift = exponent - METRIC_SUB_BUCKET_BITS;
+    bucket = (shift + 1) * METRIC_SUB_BUCKET_COUNT + ((value >> shift) & (METRIC_SUB_BUCKET_COUNT - 1));
+    return bucket < METRIC_BUCKET_COUNT ? bucket : METRIC_BUCKET_COUNT - 1;
+}
+
+static uint64_t getMetricBucketUpperBound(unsigned int bucket)
+{
+    /*
+     * Return the largest value of a bucket.
+     */
+    unsigned int shift;
+
+    if (bucket < METRIC_SUB_BUCKET_COUNT)
+        return bucket;
+    if (bucket == METRIC_BUCKET_COUNT - 1)
+        return UINT64_MAX;
+    shift = bucket / METRIC_SUB_BUCKET_COUNT - 1;
+    return (((uint64_t)(METRIC_SUB_BUCKET_COUNT + bucket % METRIC_SUB_BUCKET_COUNT + 1)) << shift) - 1;
+}
+
+static inline void incrementMetricCounter(uint64_t *counter, uint64_t value)
+{
+    // single writer: no locked read-modify-write, readers never see a torn value
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+static inline void recordMetric(metric_histogram_t *histogram, uint64_t value)
+{
+    /*
+     * Record a value (ns), from the histogram's writer only.
+     */
+    uint32_t *bucket = &histogram->bucket_list[getMetricBucket(value)];
+
+    __atomic_store_n(bucket, __atomic_load_n(bucket, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    incrementMetricCounter(&histogram->sum, value);
+    incrementMetricCounter(&histogram->count, 1);
+    if (value > __atomic_load_n(&histogram->max, __ATOMIC_RELAXED))
+        __atomic_store_n(&histogram->max, value, __ATOMIC_RELAXED);
+}
+
+static inline void recordMetricSince(metric_histogram_t *histogram, uint64_t start)
+{
+    /*
+     * Record the time elapsed since start (a time base timestamp).
+     */
+    recordMetric(histogram, getTimeBaseNanoSeconds() - start);
+}
+
+static uint64_t getMetricPercentile(const metric_histogram_t *histogram, double percentile)
+{
+    /*
+     * Return the upper bound of the bucket holding a percentile (0..100),
+     * never more than the maximum recorded. 0 if nothing recorded.
+     */
+    unsigned int i;
+    uint64_t rank, seen = 0;
+    uint64_t count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    uint64_t bound;
+
+    if (count == 0)
+        return 0;
+    rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (rank == 0)
+        rank = 1;
+    for (i = 0; i < METRIC_BUCKET_COUNT; i++)
+    {
+        seen += __atomic_load_n(&histogram->bucket_list[i], __ATOMIC_RELAXED);
+        if (seen >= rank)
+            break;
+    }
+    if (i == METRIC_BUCKET_COUNT)
+        return max;     // buckets read while being recorded
+    bound = getMetricBucketUpperBound(i);
+    return bound < max ? bound : max;
+}
+
+static uint64_t getMetricMean(const metric_histogram_t *histogram)
+{
+    uint64_t count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+
+    return count > 0 ? __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED) / count : 0;
+}
+
+#endif
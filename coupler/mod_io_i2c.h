@@ -1,20 +1,50 @@
-// global relay state
-uint8_t I2C_0_RELAYS_STATE = 0; // state of 4 relays at I2C slave 0
-uint8_t I2C_1_RELAYS_STATE = 0; // state of 4 relays at I2C slave 1
+#include <pthread.h>
+#include "i2c_bus.h"
+#include "metrics.h"
+#include "trace.h"
+
+// MOD-IO registers
+#define MOD_IO_RELAY_REGISTER 0x10
+#define MOD_IO_DIGITAL_INPUT_REGISTER 0x20
+#define MOD_IO_ANALOG_INPUT_REGISTER 0x30 // AIN0..3 are 0x30..0x33
+#define MOD_IO_ANALOG_INPUT_COUNT 4
+
+// all inputs of a MOD-IO
+typedef struct {
+    uint8_t digital_input;                                 // IN0..3 as bits 0..3
+    uint16_t analog_input[MOD_IO_ANALOG_INPUT_COUNT];      // AIN0..3 (10 bit ADC)
+} mod_io_input_t;
+
+#include "i2c_bus_simulation.h"
+
+// serializes relay writes issued from different threads (i.e. flush vs safe mode)
+pthread_mutex_t I2C_RELAY_LOCK = PTHREAD_MUTEX_INITIALIZER;
 
 // the default addresses of MOD-IOs
-static char *DEFAULT_I2C_0_ADDR = "0x58";
+#define DEFAULT_I2C_0_ADDR "0x58"
 
 // the list of attached I2C slaves
 const int DEFAULT_I2C_SLAVE_ADDR = 0x58;
 
-// XXX:code assumes only 2 I2C slaves but it can be more
-int I2C_SLAVE_ADDR_LIST[] = {0, 0};
+// the maximal number of attached I2C slaves (over all buses)
+#define MAX_I2C_SLAVE_COUNT 32
+int I2C_SLAVE_ADDR_LIST[MAX_I2C_SLAVE_COUNT] = {0};
+
+// I2C transaction latency of each attached slave (METRIC_I2C_*)
+static metric_histogram_t I2C_METRIC_LIST[MAX_I2C_SLAVE_COUNT][METRIC_I2C_OP_COUNT];
 
 // the block device at host machine
-static char *DEFAULT_I2C_BLOCK_DEVICE_NAME = "/dev/i2c-1";
+#define DEFAULT_I2C_BLOCK_DEVICE_NAME "/dev/i2c-1"
 char *I2C_BLOCK_DEVICE_NAME;
 
+// the block device of each attached I2C slave (NULL means I2C_BLOCK_DEVICE_NAME)
+char *I2C_SLAVE_DEVICE_LIST[MAX_I2C_SLAVE_COUNT] = {NULL};
+
+// coupler modes (CLI "-m")
+#define OPERATIONAL_MODE_NORMAL 0
+#define OPERATIONAL_MODE_VIRTUAL 1
+#define OPERATIONAL_MODE_SIMULATED 2
+
 // global coupler mode
 // 0 - normal operational mode
 // 1 - virtual operational mode (no real I2C to MOD-IO command issued)
@@ -23,6 +53,29 @@ bool OPERATIONAL_MODE = 0;
 // global virtual mode needed for testing on x86 platform
 bool I2C_VIRTUAL_MODE = 0;
 
+// normal operation on simulated I2C buses (mode 2)
+bool I2C_SIMULATION_MODE = 0;
+
+static void setOperationalMode(int mode)
+{
+    /*
+     * Apply a coupler mode. The simulated mode is the normal mode with the
+     * buses opened from now on simulated.
+     */
+    OPERATIONAL_MODE = mode == OPERATIONAL_MODE_VIRTUAL;
+    I2C_VIRTUAL_MODE = OPERATIONAL_MODE;
+    I2C_SIMULATION_MODE = mode == OPERATIONAL_MODE_SIMULATED;
+    if (I2C_SIMULATION_MODE)
+    {
+        enableI2CSimulation();
+    }
+}
+
+static int getOperationalMode()
+{
+    return I2C_SIMULATION_MODE ? OPERATIONAL_MODE_SIMULATED : OPERATIONAL_MODE;
+}
+
 static int getI2CSlaveListLength()
 {
     /*
@@ -44,48 +97,132 @@ static int getI2CSlaveListLength()
     return counter;
 }
 
-static int setRelayState(int command, int i2c_addr)
+static char *getI2CSlaveDevice(int slave_index)
 {
     /*
-     *  Set relays' state over I2C
+     * Return the block device of an attached I2C slave.
      */
-    int file;
-    char filename[20];
-    if (I2C_VIRTUAL_MODE)
-    {
-        // we're in a virtual mode, likely on x86 platform or without I2C support
-        // simply do nothing
-        return 0;
-    }
+    char *device = I2C_SLAVE_DEVICE_LIST[slave_index];
+    return device != NULL ? device : I2C_BLOCK_DEVICE_NAME;
+}
 
-    // step 1: open device
-    file = open(I2C_BLOCK_DEVICE_NAME, O_RDWR);
-    if (file < 0)
+static i2c_bus_t *getI2CDeviceBus(char *device, int i2c_addr)
+{
+    /*
+     * Return the (persistently opened) bus of a slave.
+     */
+    i2c_bus_t *bus = getI2CBus(device);
+    if (bus == NULL)
     {
         /* ERROR HANDLING; you can check errno to see what went wrong */
         printf("Error opening i2c device (0x%x).\n", i2c_addr);
         exit(1);
     }
+    return bus;
+}
+
+static i2c_bus_t *getI2CSlaveBus(char *device, int i2c_addr)
+{
+    /*
+     * Return the (persistently opened) bus of a slave with the slave addressed.
+     */
+    i2c_bus_t *bus = getI2CDeviceBus(device, i2c_addr);
 
-    // step 2: address the slave by its address
-    if (ioctl(file, I2C_SLAVE, i2c_addr) < 0)
+    if (selectI2CSlave(bus, i2c_addr) < 0)
     {
         /* ERROR HANDLING; you can check errno to see what went wrong */
         printf("Error addressing i2c slave (0x%x).\n", i2c_addr);
         exit(1);
     }
+    return bus;
+}
+
+void openI2CSlaveBusList()
+{
+    /*
+     * Open once the buses of all known I2C slaves.
+     */
+    int i;
+
+    if (I2C_VIRTUAL_MODE)
+    {
+        // no I2C support at all, nothing to open
+        return;
+    }
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
+        {
+            getI2CSlaveBus(getI2CSlaveDevice(i), I2C_SLAVE_ADDR_LIST[i]);
+        }
+    }
+}
+
+static int convertAnalogInput(const uint8_t *read_buf)
+{
+    /*
+     * Convert the 2 bytes read from an AIN register to its value.
+     */
+    int analog_data = 0;
+    // based on https://github.com/OLIMEX/OLINUXINO/blob/master/SOFTWARE/A13/MOD-IO/main.c
+    // since ADC is 10 bit we need to read and convert accordingly 2 bytes
+    analog_data = read_buf[1];
+    analog_data <<= 8;
+    analog_data |= read_buf[0];
+    return analog_data;
+}
+
+static int setI2CRelayState(char *device, int i2c_addr, int command)
+{
+    /*
+     *  Set relays' state over I2C
+     */
+    i2c_bus_t *bus;
+    if (I2C_VIRTUAL_MODE)
+    {
+        // we're in a virtual mode, likely on x86 platform or without I2C support
+        // simply do nothing
+        return 0;
+    }
+
+    // step 1 & 2: get the already opened bus with the slave addressed
+    bus = getI2CSlaveBus(device, i2c_addr);
 
     // step 3: write command over I2c
-    __u8 reg = 0x10; /* Device register to access */
-    char buf[10];
+    __u8 reg = MOD_IO_RELAY_REGISTER; /* Device register to access */
+    uint8_t buf[10] = {0};
     buf[0] = reg;
     buf[1] = command; //0x00 -all off, 0x0F - all 4 on
-    if (write(file, buf, 3) != 3)
+    if (writeI2CSlave(bus, buf, 3) != 3)
     {
         /* ERROR HANDLING: i2c transaction failed */
         printf("Error writing to i2c slave (0x%x).\n", i2c_addr);
+        return -1;
     }
-    close(file);
+    return 0;
+}
+
+static int setRelayState(int command, int i2c_addr)
+{
+    /*
+     *  Set relays' state of a slave at the default block device
+     */
+    return setI2CRelayState(I2C_BLOCK_DEVICE_NAME, i2c_addr, command);
+}
+
+static int setI2CSlaveRelayState(int slave_index, int command)
+{
+    /*
+     *  Set relays' state of an attached I2C slave
+     */
+    int result;
+    uint64_t start = getTimeBaseNanoSeconds();
+
+    result = setI2CRelayState(getI2CSlaveDevice(slave_index), I2C_SLAVE_ADDR_LIST[slave_index], command);
+    recordMetricSince(&I2C_METRIC_LIST[slave_index][METRIC_I2C_WRITE], start);
+    traceSpan(TRACE_I2C_WRITE, slave_index, command, start);
+    return result;
 }
 
 static int getDigitalInputState(int i2c_addr, char **digital_input)
@@ -93,8 +230,9 @@ static int getDigitalInputState(int i2c_addr, char **digital_input)
     /*
      *  get digital input state over I2C
      */
-    int file;
-    char filename[20];
+    // returned pointer must outlive this call
+    static char digital_data = 0;
+    uint8_t read_buf[1];
     if (I2C_VIRTUAL_MODE)
     {
         // we're in a virtual mode, likely on x86 platform or without I2C support
@@ -102,52 +240,27 @@ static int getDigitalInputState(int i2c_addr, char **digital_input)
         return 0;
     }
 
-    // step 1: open device
-    file = open(I2C_BLOCK_DEVICE_NAME, O_RDWR);
-    if (file < 0)
-    {
-        /* ERROR HANDLING; you can check errno to see what went wrong */
-        printf("Error opening i2c device (0x%x).\n", i2c_addr);
-        exit(1);
-    }
-
-    // step 2: address the slave by its address
-    if (ioctl(file, I2C_SLAVE, i2c_addr) < 0)
-    {
-        /* ERROR HANDLING; you can check errno to see what went wrong */
-        printf("Error addressing i2c slave (0x%x).\n", i2c_addr);
-        exit(1);
-    }
-
-    // step 3: write command over I2c
-    __u8 read_reg = 0x20; /* Device register to access */
-    char read_buf[2];
-    read_buf[0] = read_reg;
-    if (write(file, read_buf, 1) != 1)
-    {
-        /* ERROR HANDLING: i2c transaction failed */
-        printf("Error writing to i2c slave (0x%x).\n", i2c_addr);
-    }
-    if (read(file, read_buf, 1) != 1)
+    // write register and read it back in one combined transaction
+    if (readI2CRegister(getI2CDeviceBus(I2C_BLOCK_DEVICE_NAME, i2c_addr), i2c_addr,
+                        MOD_IO_DIGITAL_INPUT_REGISTER, read_buf, 1) < 0)
     {
         /* ERROR HANDLING: i2c transaction failed */
         printf("Error reading digital input from i2c slave (0x%x).\n", i2c_addr);
+        return -1;
     }
-    else
-    {
-        /* read_buf[0] contains the read byte */
-        *digital_input = &read_buf[0];
-    }
-    close(file);
+    digital_data = read_buf[0];
+    *digital_input = &digital_data;
+    return 0;
 }
 
 static int getAnalogInputStateAIN(int i2c_addr, int **analog_input, uint8_t read_reg)
 {
     /*
-     *  get digital input state over I2C
+     *  get analog input state over I2C
      */
-    int file;
-    char filename[20];
+    // returned pointer must outlive this call
+    static int analog_data = 0;
+    uint8_t read_buf[2];
     if (I2C_VIRTUAL_MODE)
     {
         // we're in a virtual mode, likely on x86 platform or without I2C support
@@ -155,48 +268,80 @@ static int getAnalogInputStateAIN(int i2c_addr, int **analog_input, uint8_t read
         return 0;
     }
 
-    // step 1: open device
-    file = open(I2C_BLOCK_DEVICE_NAME, O_RDWR);
-    if (file < 0)
+    // write register and read it back in one combined transaction
+    if (readI2CRegister(getI2CDeviceBus(I2C_BLOCK_DEVICE_NAME, i2c_addr), i2c_addr,
+                        read_reg, read_buf, 2) < 0)
     {
-        /* ERROR HANDLING; you can check errno to see what went wrong */
-        printf("Error opening i2c device (0x%x).\n", i2c_addr);
-        exit(1);
+        /* ERROR HANDLING: i2c transaction failed */
+        printf("Error reading analog input from i2c slave (0x%x).\n", i2c_addr);
+        return -1;
     }
+    analog_data = convertAnalogInput(read_buf);
+    *analog_input = &analog_data;
+    return 0;
+}
 
-    // step 2: address the slave by its address
-    if (ioctl(file, I2C_SLAVE, i2c_addr) < 0)
+static int getI2CModIOInputState(char *device, int i2c_addr, mod_io_input_t *input)
+{
+    /*
+     *  get digital input and all analog inputs over I2C in one
+     *  combined transaction (one syscall instead of five write + read pairs)
+     */
+    int i;
+    uint8_t reg_list[1 + MOD_IO_ANALOG_INPUT_COUNT];
+    uint16_t length_list[1 + MOD_IO_ANALOG_INPUT_COUNT];
+    uint8_t read_buf[1 + 2 * MOD_IO_ANALOG_INPUT_COUNT];
+    if (I2C_VIRTUAL_MODE)
     {
-        /* ERROR HANDLING; you can check errno to see what went wrong */
-        printf("Error addressing i2c slave (0x%x).\n", i2c_addr);
-        exit(1);
+        // we're in a virtual mode, likely on x86 platform or without I2C support
+        // simply do nothing
+        return 0;
     }
 
-    // step 3: write command over I2c
-    //__u8 read_reg = 0x30; /* Device register to access */
-    char read_buf[10];
-    read_buf[0] = read_reg;
-    if (write(file, read_buf, 1) != 1)
+    reg_list[0] = MOD_IO_DIGITAL_INPUT_REGISTER;
+    length_list[0] = 1;
+    for (i = 0; i < MOD_IO_ANALOG_INPUT_COUNT; i++)
     {
-        /* ERROR HANDLING: i2c transaction failed */
-        printf("Error writing to i2c slave (0x%x).\n", i2c_addr);
+        reg_list[1 + i] = MOD_IO_ANALOG_INPUT_REGISTER + i;
+        length_list[1 + i] = 2;
     }
-    if (read(file, read_buf, 2) != 2)
+
+    if (readI2CRegisterList(getI2CDeviceBus(device, i2c_addr), i2c_addr, reg_list, length_list,
+                            1 + MOD_IO_ANALOG_INPUT_COUNT, read_buf) < 0)
     {
         /* ERROR HANDLING: i2c transaction failed */
-        printf("Error reading analog input from i2c slave (0x%x).\n", i2c_addr);
+        printf("Error reading inputs from i2c slave (0x%x).\n", i2c_addr);
+        return -1;
     }
-    else
+
+    input->digital_input = read_buf[0];
+    for (i = 0; i < MOD_IO_ANALOG_INPUT_COUNT; i++)
     {
-        int analog_data = 0;
-	// based on https://github.com/OLIMEX/OLINUXINO/blob/master/SOFTWARE/A13/MOD-IO/main.c
-	// since ADC is 10 bit we need to read and convert accordingly 2 bytes
-	analog_data = read_buf[1];
-	analog_data <<= 8;
-	analog_data |= read_buf[0];
-	*analog_input = &analog_data;
+        input->analog_input[i] = convertAnalogInput(&read_buf[1 + 2 * i]);
     }
-    close(file);
+    return 0;
+}
+
+static int getModIOInputState(int i2c_addr, mod_io_input_t *input)
+{
+    /*
+     *  get all inputs of a slave at the default block device
+     */
+    return getI2CModIOInputState(I2C_BLOCK_DEVICE_NAME, i2c_addr, input);
+}
+
+static int getI2CSlaveInputState(int slave_index, mod_io_input_t *input)
+{
+    /*
+     *  get all inputs of an attached I2C slave
+     */
+    int result;
+    uint64_t start = getTimeBaseNanoSeconds();
+
+    result = getI2CModIOInputState(getI2CSlaveDevice(slave_index), I2C_SLAVE_ADDR_LIST[slave_index], input);
+    recordMetricSince(&I2C_METRIC_LIST[slave_index][METRIC_I2C_READ], start);
+    traceSpan(TRACE_I2C_READ, slave_index, result, start);
+    return result;
 }
 
 void safeShutdownI2CSlaveList()
@@ -205,17 +350,13 @@ void safeShutdownI2CSlaveList()
      * Perform a safe shutdown of all known I2C slaves
      */
     int i;
-    int length;
-    int addr;
-    length = sizeof(I2C_SLAVE_ADDR_LIST) / sizeof(int);
 
-    for (i = 0; i < length; i++)
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
     {
-        addr = I2C_SLAVE_ADDR_LIST[i];
-        if (addr != 0)
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
         {
             // properly initialized from CLI
-            setRelayState(0x00, addr);
+            setI2CSlaveRelayState(i, 0x00);
         }
     }
 }
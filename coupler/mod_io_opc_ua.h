@@ -1,10 +1,21 @@
 /*
  * OPC-UA code representation of MOD-IOs connected to a Lime2
+ *
+ * Every I/O point of every attached MOD-IO is described by one entry of
+ * MOD_IO_CHANNEL_LIST (slave, kind, register, bit). The table drives the
+ * creation of the OPC UA variables and is handed to one generic read and
+ * one generic write callback through the node context.
+ *
+ * Each slave owns a fixed block of MOD_IO_CHANNEL_COUNT entries so the
+ * variables of one slave can be added / removed at runtime (configuration
+ * reload) without touching the ones of the other slaves.
  */
 
 #include <open62541/server.h>
+#include "node_id.h"
 
-void addIntegerVariableNode(UA_Server *server, char *node_id, char *node_description)
+void addIntegerVariableNode(UA_Server *server, const UA_NodeId node_id, char *node_description,
+                            void *node_context)
 {
     UA_Int32 myInteger = 0;
     UA_NodeId parentNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
@@ -16,14 +27,14 @@ void addIntegerVariableNode(UA_Server *server, char *node_id, char *node_descrip
     attr0.displayName = UA_LOCALIZEDTEXT("en-US", node_description);
     attr0.dataType = UA_TYPES[UA_TYPES_INT32].typeId;
     attr0.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
-    UA_NodeId myIntegerNodeId0 = UA_NODEID_STRING(1, node_id);
     UA_QualifiedName myIntegerName0 = UA_QUALIFIEDNAME(1, node_description);
-    UA_Server_addVariableNode(server, myIntegerNodeId0, parentNodeId,
+    UA_Server_addVariableNode(server, node_id, parentNodeId,
                               parentReferenceNodeId, myIntegerName0,
-                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, NULL, NULL);
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, node_context, NULL);
 }
 
-void addUIntegerVariableReadNode(UA_Server *server, char *node_id, char *node_description)
+void addUIntegerVariableReadNode(UA_Server *server, const UA_NodeId node_id, char *node_description,
+                                 void *node_context)
 {
     UA_UInt32 myInteger = 0;
     UA_NodeId parentNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
@@ -35,14 +46,14 @@ void addUIntegerVariableReadNode(UA_Server *server, char *node_id, char *node_de
     attr0.displayName = UA_LOCALIZEDTEXT("en-US", node_description);
     attr0.dataType = UA_TYPES[UA_TYPES_UINT32].typeId;
     attr0.accessLevel = UA_ACCESSLEVELMASK_READ;
-    UA_NodeId myIntegerNodeId0 = UA_NODEID_STRING(1, node_id);
     UA_QualifiedName myIntegerName0 = UA_QUALIFIEDNAME(1, node_description);
-    UA_Server_addVariableNode(server, myIntegerNodeId0, parentNodeId,
+    UA_Server_addVariableNode(server, node_id, parentNodeId,
                               parentReferenceNodeId, myIntegerName0,
-                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, NULL, NULL);
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, node_context, NULL);
 }
 
-void addBooleanVariableReadNode(UA_Server *server, char *node_id, char *node_description)
+void addBooleanVariableReadNode(UA_Server *server, const UA_NodeId node_id, char *node_description,
+                                void *node_context)
 {
     UA_Boolean myBoolean = false;
     UA_NodeId parentNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
@@ -54,767 +65,374 @@ void addBooleanVariableReadNode(UA_Server *server, char *node_id, char *node_des
     attr0.displayName = UA_LOCALIZEDTEXT("en-US", node_description);
     attr0.dataType = UA_TYPES[UA_TYPES_BOOLEAN].typeId;
     attr0.accessLevel = UA_ACCESSLEVELMASK_READ;
-    UA_NodeId myIntegerNodeId0 = UA_NODEID_STRING(1, node_id);
     UA_QualifiedName myIntegerName0 = UA_QUALIFIEDNAME(1, node_description);
-    UA_Server_addVariableNode(server, myIntegerNodeId0, parentNodeId,
+    UA_Server_addVariableNode(server, node_id, parentNodeId,
                               parentReferenceNodeId, myIntegerName0,
-                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, NULL, NULL);
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr0, node_context, NULL);
 }
 
-static void addVariable(UA_Server *server)
+typedef enum {
+    MOD_IO_CHANNEL_RELAY = 0,
+    MOD_IO_CHANNEL_DIGITAL_INPUT = 1,
+    MOD_IO_CHANNEL_ANALOG_INPUT = 2
+} mod_io_channel_kind_t;
+
+// every MOD-IO has 4 relays, 4 digital inputs and 4 analog inputs
+#define MOD_IO_RELAY_COUNT 4
+#define MOD_IO_DIGITAL_INPUT_COUNT 4
+#define MOD_IO_CHANNEL_COUNT (MOD_IO_RELAY_COUNT + MOD_IO_DIGITAL_INPUT_COUNT + MOD_IO_ANALOG_INPUT_COUNT)
+
+typedef struct {
+    uint8_t slave_index;    // index in I2C_SLAVE_ADDR_LIST
+    uint8_t slave_addr;     // I2C address of the slave
+    uint8_t kind;           // mod_io_channel_kind_t
+    uint8_t reg;            // MOD-IO register holding the channel
+    uint8_t bit;            // bit in register (relay, digital input) or AIN number
+} mod_io_channel_t;
+
+// all channels of all attached MOD-IOs, MOD_IO_CHANNEL_COUNT per slave (indexed as
+// I2C_SLAVE_ADDR_LIST), unused entries (no slave, channel not mapped) have slave_addr 0
+static mod_io_channel_t MOD_IO_CHANNEL_LIST[MAX_I2C_SLAVE_COUNT * MOD_IO_CHANNEL_COUNT];
+static int MOD_IO_CHANNEL_LIST_LENGTH = 0;
+
+// channels of a slave exposed over OPC UA: bit i is channel i of the slave
+// (relays, then digital inputs, then analog inputs), 0 - all channels
+#define MOD_IO_CHANNEL_MASK_ALL ((1U << MOD_IO_CHANNEL_COUNT) - 1)
+static uint16_t MOD_IO_CHANNEL_MASK_LIST[MAX_I2C_SLAVE_COUNT] = {0};
+
+// NodeIds of all channels resolved at startup (same index as MOD_IO_CHANNEL_LIST)
+static node_id_t MOD_IO_NODE_ID_LIST[MAX_I2C_SLAVE_COUNT * MOD_IO_CHANNEL_COUNT];
+
+static void getModIOChannelName(const mod_io_channel_t *channel, char *node_id, size_t node_id_size,
+                                char *description, size_t description_size)
 {
-    /* 
-     * Create all variables representing MOD-IO's relays
+    /*
+     * Return the node id (i.e. i2c0.relay0) and description of a channel.
      */
-    int length = getI2CSlaveListLength();
-    if (length >= 1)
-    {
-        // IC2-0
-        addIntegerVariableNode(server, "i2c0.relay0", "I2C0 / Relay 0");
-        addIntegerVariableNode(server, "i2c0.relay1", "I2C0 / Relay 1");
-        addIntegerVariableNode(server, "i2c0.relay2", "I2C0 / Relay 2");
-        addIntegerVariableNode(server, "i2c0.relay3", "I2C0 / Relay 3");
-        addBooleanVariableReadNode(server, "i2c0.in0", "I2C0 / Digital Input 0");
-        addBooleanVariableReadNode(server, "i2c0.in1", "I2C0 / Digital Input 1");
-        addBooleanVariableReadNode(server, "i2c0.in2", "I2C0 / Digital Input 2");
-        addBooleanVariableReadNode(server, "i2c0.in3", "I2C0 / Digital Input 3");
-        addUIntegerVariableReadNode(server, "i2c0.ain0", "I2C0 / Analog Input 0");
-        addUIntegerVariableReadNode(server, "i2c0.ain1", "I2C0 / Analog Input 1");
-        addUIntegerVariableReadNode(server, "i2c0.ain2", "I2C0 / Analog Input 2");
-        addUIntegerVariableReadNode(server, "i2c0.ain3", "I2C0 / Analog Input 3");
-    }
-    if (length >= 2)
+    switch (channel->kind)
     {
-        // IC2-1
-        addIntegerVariableNode(server, "i2c1.relay0", "I2C1 / Relay 0");
-        addIntegerVariableNode(server, "i2c1.relay1", "I2C1 / Relay 1");
-        addIntegerVariableNode(server, "i2c1.relay2", "I2C1 / Relay 2");
-        addIntegerVariableNode(server, "i2c1.relay3", "I2C1 / Relay 3");
-        addBooleanVariableReadNode(server, "i2c1.in0", "I2C1 / Digital Input 0");
-        addBooleanVariableReadNode(server, "i2c1.in1", "I2C1 / Digital Input 1");
-        addBooleanVariableReadNode(server, "i2c1.in2", "I2C1 / Digital Input 2");
-        addBooleanVariableReadNode(server, "i2c1.in3", "I2C1 / Digital Input 3");
-        addUIntegerVariableReadNode(server, "i2c1.ain0", "I2C1 / Analog Input 0");
-        addUIntegerVariableReadNode(server, "i2c1.ain1", "I2C1 / Analog Input 1");
-        addUIntegerVariableReadNode(server, "i2c1.ain2", "I2C1 / Analog Input 2");
-        addUIntegerVariableReadNode(server, "i2c1.ain3", "I2C1 / Analog Input 3");
-    }
-}
-
-/* Connect to variables to physical relays
- *
- */
-static void beforeReadTime(UA_Server *server,
-                           const UA_NodeId *sessionId, void *sessionContext,
-                           const UA_NodeId *nodeid, void *nodeContext,
-                           const UA_NumericRange *range, const UA_DataValue *data)
-{
-}
-static void beforeReadTimeI2C0Ain0(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    int *data_input = 0;
-    uint8_t read_addr =0x30;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
-
-static void beforeReadTimeI2C0Ain1(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    int *data_input = 0;
-    uint8_t read_addr =0x31;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
-
-static void beforeReadTimeI2C0Ain2(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    int *data_input = 0;
-    uint8_t read_addr =0x32;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
-
-static void beforeReadTimeI2C0Ain3(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    int *data_input = 0;
-    uint8_t read_addr =0x33;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
-static void beforeReadTimeI2C1Ain0(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    int *data_input = 0;
-    uint8_t read_addr =0x30;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
+    case MOD_IO_CHANNEL_RELAY:
+        snprintf(node_id, node_id_size, "i2c%d.relay%d", channel->slave_index, channel->bit);
+        snprintf(description, description_size, "I2C%d / Relay %d", channel->slave_index, channel->bit);
+        break;
+    case MOD_IO_CHANNEL_DIGITAL_INPUT:
+        snprintf(node_id, node_id_size, "i2c%d.in%d", channel->slave_index, channel->bit);
+        snprintf(description, description_size, "I2C%d / Digital Input %d", channel->slave_index, channel->bit);
+        break;
+    case MOD_IO_CHANNEL_ANALOG_INPUT:
+        snprintf(node_id, node_id_size, "i2c%d.ain%d", channel->slave_index, channel->bit);
+        snprintf(description, description_size, "I2C%d / Analog Input %d", channel->slave_index, channel->bit);
+        break;
     }
 }
 
-static void beforeReadTimeI2C1Ain1(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
+static uint16_t getModIOChannelMask(int slave_index)
 {
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    int *data_input = 0;    
-    uint8_t read_addr =0x31;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
+    uint16_t mask = MOD_IO_CHANNEL_MASK_LIST[slave_index];
+    return mask != 0 ? mask : MOD_IO_CHANNEL_MASK_ALL;
 }
 
-static void beforeReadTimeI2C1Ain2(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
+static void initModIOSlaveChannelList(int slave_index)
 {
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    int *data_input = 0;
-    uint8_t read_addr =0x32;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
-
-static void beforeReadTimeI2C1Ain3(UA_Server *server,
-                                   const UA_NodeId *sessionId, void *sessionContext,
-                                   const UA_NodeId *nodeid, void *nodeContext,
-                                   const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    int *data_input = 0;
-    uint8_t read_addr =0x33;
-    if (!I2C_VIRTUAL_MODE) {
-      getAnalogInputStateAIN(addr, &data_input, read_addr);
-      if (data->value.type == &UA_TYPES[UA_TYPES_UINT32])
-      {
-        *(UA_UInt32 *)data->value.data = *data_input;
-      }
-    }
-}
+    /*
+     * Fill the channel table block of a slave and resolve the NodeIds
+     * of its mapped channels.
+     */
+    int j;
+    int index = slave_index * MOD_IO_CHANNEL_COUNT;
+    uint16_t mask = getModIOChannelMask(slave_index);
+    char node_id[MAX_NODE_ID_NAME_LENGTH];
+    char description[64];
+    mod_io_channel_t *channel;
+
+    for (j = 0; j < MOD_IO_CHANNEL_COUNT; j++)
+    {
+        channel = &MOD_IO_CHANNEL_LIST[index + j];
+        memset(channel, 0, sizeof(mod_io_channel_t));
+        if (I2C_SLAVE_ADDR_LIST[slave_index] == 0 || !(mask & (1U << j)))
+            continue;
 
-static void beforeReadTimeI2C0In0(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 0))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
+        channel->slave_index = slave_index;
+        channel->slave_addr = I2C_SLAVE_ADDR_LIST[slave_index];
+        if (j < MOD_IO_RELAY_COUNT)
         {
-            *(UA_Boolean *)data->value.data = false;
+            channel->kind = MOD_IO_CHANNEL_RELAY;
+            channel->reg = MOD_IO_RELAY_REGISTER;
+            channel->bit = j;
         }
-      }
-    }
-}
-
-static void beforeReadTimeI2C0In1(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 1))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
+        else if (j < MOD_IO_RELAY_COUNT + MOD_IO_DIGITAL_INPUT_COUNT)
         {
-            *(UA_Boolean *)data->value.data = true;
+            channel->kind = MOD_IO_CHANNEL_DIGITAL_INPUT;
+            channel->reg = MOD_IO_DIGITAL_INPUT_REGISTER;
+            channel->bit = j - MOD_IO_RELAY_COUNT;
         }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
+        else
         {
-            *(UA_Boolean *)data->value.data = false;
+            channel->kind = MOD_IO_CHANNEL_ANALOG_INPUT;
+            channel->bit = j - MOD_IO_RELAY_COUNT - MOD_IO_DIGITAL_INPUT_COUNT;
+            channel->reg = MOD_IO_ANALOG_INPUT_REGISTER + channel->bit;
         }
-      }
+        getModIOChannelName(channel, node_id, sizeof(node_id), description, sizeof(description));
+        resolveNodeId(&MOD_IO_NODE_ID_LIST[index + j], node_id, MOD_IO_NUMERIC_NODE_ID_BASE + index + j);
     }
 }
 
-static void beforeReadTimeI2C0In2(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
+static void updateModIOChannelListLength()
 {
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 2))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
-    }
-}
+    /*
+     * The table ends with the block of the last attached slave.
+     */
+    int i;
 
-static void beforeReadTimeI2C0In3(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[0];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {     
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 3))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
-    }
-}
-static void beforeReadTimeI2C1In0(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
-{
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {   
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 0))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
+    MOD_IO_CHANNEL_LIST_LENGTH = 0;
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
+            MOD_IO_CHANNEL_LIST_LENGTH = (i + 1) * MOD_IO_CHANNEL_COUNT;
     }
 }
 
-static void beforeReadTimeI2C1In1(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
+static void initModIOChannelList()
 {
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 1))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
+    /*
+     * Build the channel table of all registered I2C slaves
+     * and resolve the NodeIds of all channels.
+     */
+    int i;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        initModIOSlaveChannelList(i);
     }
+    updateModIOChannelListLength();
 }
 
-static void beforeReadTimeI2C1In2(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
+static void addModIOChannelVariable(UA_Server *server, int index)
 {
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 2))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
+    /*
+     * Create the variable of a channel.
+     */
+    char node_id[MAX_NODE_ID_NAME_LENGTH];
+    char description[64];
+    mod_io_channel_t *channel = &MOD_IO_CHANNEL_LIST[index];
+    UA_NodeId *channel_node_id = &MOD_IO_NODE_ID_LIST[index].node_id;
+
+    getModIOChannelName(channel, node_id, sizeof(node_id), description, sizeof(description));
+    switch (channel->kind)
+    {
+    case MOD_IO_CHANNEL_RELAY:
+        addIntegerVariableNode(server, *channel_node_id, description, channel);
+        break;
+    case MOD_IO_CHANNEL_DIGITAL_INPUT:
+        addBooleanVariableReadNode(server, *channel_node_id, description, channel);
+        break;
+    case MOD_IO_CHANNEL_ANALOG_INPUT:
+        addUIntegerVariableReadNode(server, *channel_node_id, description, channel);
+        break;
     }
 }
 
-static void beforeReadTimeI2C1In3(UA_Server *server,
-                                  const UA_NodeId *sessionId, void *sessionContext,
-                                  const UA_NodeId *nodeid, void *nodeContext,
-                                  const UA_NumericRange *range, const UA_DataValue *data)
+static void addVariable(UA_Server *server)
 {
-    int addr = I2C_SLAVE_ADDR_LIST[1];
-    char *data_input = 0;
-    if (!I2C_VIRTUAL_MODE) {
-      getDigitalInputState(addr, &data_input);
-      if ((*data_input) & (1UL << 3))
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = true;
-        }
-      }
-      else
-      {
-        if (data->value.type == &UA_TYPES[UA_TYPES_BOOLEAN])
-        {
-            *(UA_Boolean *)data->value.data = false;
-        }
-      }
+    /* 
+     * Create all variables representing MOD-IO's relays and inputs
+     */
+    int i;
+
+    initModIOChannelList();
+    for (i = 0; i < MOD_IO_CHANNEL_LIST_LENGTH; i++)
+    {
+        if (MOD_IO_CHANNEL_LIST[i].slave_addr != 0)
+            addModIOChannelVariable(server, i);
     }
 }
 
-static void afterWriteTime(UA_Server *server,
-                           const UA_NodeId *sessionId, void *sessionContext,
-                           const UA_NodeId *nodeId, void *nodeContext,
-                           const UA_NumericRange *range, const UA_DataValue *data)
+/* Connect to variables to physical relays
+ * Relays are written by the (coalescing) relay output flush. Inputs have no
+ * callback: their variables are written on change by callbackWriteInputChangeList
+ * (so monitored items fire without polling) and read as any other variable.
+ */
+static void afterWriteModIOChannel(UA_Server *server,
+                                   const UA_NodeId *sessionId, void *sessionContext,
+                                   const UA_NodeId *nodeId, void *nodeContext,
+                                   const UA_NumericRange *range, const UA_DataValue *data)
 {
-    // nothing to do as not yet needed.
-}
+    const mod_io_channel_t *channel = (const mod_io_channel_t *)nodeContext;
+    uint64_t start = getTimeBaseNanoSeconds();
 
-// XXX: having afterWriteTime{0..3} is not needed and maybe with introspection of context we can
-// write only one callback function
-static void afterWriteTimeI2C0_0(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
-{
+    // inputs are only written by the server itself (input change notification)
+    if (channel->kind != MOD_IO_CHANNEL_RELAY)
+    {
+        return;
+    }
     if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
     {
         UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        // used only for debuging with logical analyzer
-        if (CURRENT_GPIO_MODE == 2) setGPIO();
+        // used only for debuging with logical analyzer (first i2c0.relay0)
+        if (channel->slave_index == 0 && channel->bit == 0) toggleGPIO(GPIO_EVENT_RELAY_WRITE);
 
-        int addr = I2C_SLAVE_ADDR_LIST[0];
-        if (hrValue > 0)
-        {
-            I2C_0_RELAYS_STATE |= 1UL << 0;
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_0_RELAYS_STATE &= ~(1UL << 0);
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
+        // written to the slave by the next flush (coalesced with other relays)
+        setRelayOutput(channel->slave_index, channel->bit, hrValue > 0);
+        scheduleRelayOutputFlush(server);
     }
+    recordMetricSince(&METRIC_LIST[METRIC_OPC_UA_WRITE], start);
+    traceSpan(TRACE_OPC_UA_WRITE, channel->slave_index, channel->kind << 8 | channel->bit, start);
 }
 
-static void afterWriteTimeI2C0_1(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static void setModIOChannelValueCallback(UA_Server *server, int index)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
-    {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[0];
-        if (hrValue > 0)
-        {
-            I2C_0_RELAYS_STATE |= 1UL << 1;
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_0_RELAYS_STATE &= ~(1UL << 1);
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
-    }
+    UA_ValueCallback callback;
+
+    callback.onRead = NULL;
+    callback.onWrite = afterWriteModIOChannel;
+    UA_Server_setVariableNode_valueCallback(server, MOD_IO_NODE_ID_LIST[index].node_id, callback);
 }
 
-static void afterWriteTimeI2C0_2(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static void addValueCallbackToCurrentTimeVariable(UA_Server *server)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
+    int i;
+
+    for (i = 0; i < MOD_IO_CHANNEL_LIST_LENGTH; i++)
     {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[0];
-        if (hrValue > 0)
-        {
-            I2C_0_RELAYS_STATE |= 1UL << 2;
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_0_RELAYS_STATE &= ~(1UL << 2);
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
+        if (MOD_IO_CHANNEL_LIST[i].slave_addr != 0)
+            setModIOChannelValueCallback(server, i);
+    }
+    // new variables start at 0, write the notified inputs once
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0)
+            flagInputChange(i, INPUT_CHANGE_ALL, UA_DateTime_now());
     }
 }
 
-static void afterWriteTimeI2C0_3(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+// the repeated callback writing changed inputs into the address space
+static UA_UInt64 INPUT_CHANGE_CALLBACK_ID = 0;
+
+static void writeModIOInputChannel(UA_Server *server, int index, const mod_io_input_t *input,
+                                   UA_DateTime source_timestamp)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
+    /*
+     * Write the notified value of an input channel with its change time
+     * as source timestamp.
+     */
+    const mod_io_channel_t *channel = &MOD_IO_CHANNEL_LIST[index];
+    UA_Boolean boolean_value;
+    UA_UInt32 uint32_value;
+    UA_DataValue value;
+
+    UA_DataValue_init(&value);
+    if (channel->kind == MOD_IO_CHANNEL_DIGITAL_INPUT)
     {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[0];
-        if (hrValue > 0)
-        {
-            I2C_0_RELAYS_STATE |= 1UL << 3;
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_0_RELAYS_STATE &= ~(1UL << 3);
-            setRelayState(I2C_0_RELAYS_STATE, addr);
-        }
+        boolean_value = (input->digital_input >> channel->bit) & 1;
+        UA_Variant_setScalar(&value.value, &boolean_value, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    }
+    else
+    {
+        uint32_value = input->analog_input[channel->bit];
+        UA_Variant_setScalar(&value.value, &uint32_value, &UA_TYPES[UA_TYPES_UINT32]);
     }
+    value.hasValue = true;
+    value.sourceTimestamp = source_timestamp;
+    value.hasSourceTimestamp = true;
+    UA_Server_writeDataValue(server, MOD_IO_NODE_ID_LIST[index].node_id, value);
 }
 
-// I2C1
-static void afterWriteTimeI2C1_0(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static void callbackWriteInputChangeList(UA_Server *server, void *data)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
+    /*
+     * Write the inputs flagged as changed by the I/O scanner into their
+     * variables (server thread: the address space is not thread safe).
+     * Unchanged inputs are not written, so data change notifications are
+     * only sent on change.
+     */
+    int i, j, index;
+    unsigned int bit;
+    uint16_t change;
+    uint64_t start;
+    mod_io_input_t input;
+    const mod_io_channel_t *channel;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
     {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[1];
-        if (hrValue > 0)
-        {
-            I2C_1_RELAYS_STATE |= 1UL << 0;
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_1_RELAYS_STATE &= ~(1UL << 0);
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
+        if (I2C_SLAVE_ADDR_LIST[i] == 0)
+            continue;
+        change = takeInputChange(i, &input);
+        if (change == 0)
+            continue;
+        start = getTimeBaseNanoSeconds();
+        for (j = MOD_IO_RELAY_COUNT; j < MOD_IO_CHANNEL_COUNT; j++)
+        {
+            index = i * MOD_IO_CHANNEL_COUNT + j;
+            channel = &MOD_IO_CHANNEL_LIST[index];
+            if (channel->slave_addr == 0)
+                continue;
+            bit = channel->kind == MOD_IO_CHANNEL_DIGITAL_INPUT ?
+                  channel->bit : INPUT_CHANGE_ANALOG_SHIFT + channel->bit;
+            if (change & (1U << bit))
+                writeModIOInputChannel(server, index, &input, getInputChangeTime(i, bit));
+        }
+        recordMetricSince(&METRIC_LIST[METRIC_INPUT_CHANGE_WRITE], start);
+        traceSpan(TRACE_INPUT_CHANGE_WRITE, i, change, start);
     }
 }
 
-static void afterWriteTimeI2C1_1(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static int enableInputChangeNotification(UA_Server *server)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
+    /*
+     * Write changed inputs into the address space every I/O scan interval.
+     */
+    if (UA_Server_addRepeatedCallback(server, callbackWriteInputChangeList, NULL,
+                                      IO_SCAN_INTERVAL, &INPUT_CHANGE_CALLBACK_ID) != UA_STATUSCODE_GOOD)
     {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[1];
-        if (hrValue > 0)
-        {
-            I2C_1_RELAYS_STATE |= 1UL << 1;
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_1_RELAYS_STATE &= ~(1UL << 1);
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Error adding input change notification");
+        return -1;
     }
+    return 0;
 }
 
-static void afterWriteTimeI2C1_2(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static void setInputChangeNotificationInterval(UA_Server *server)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
-    {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[1];
-        if (hrValue > 0)
-        {
-            I2C_1_RELAYS_STATE |= 1UL << 2;
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
-        else
-        {
-            I2C_1_RELAYS_STATE &= ~(1UL << 2);
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
-    }
+    /*
+     * Follow a changed I/O scan interval.
+     */
+    UA_Server_changeRepeatedCallbackInterval(server, INPUT_CHANGE_CALLBACK_ID, IO_SCAN_INTERVAL);
 }
 
-static void afterWriteTimeI2C1_3(UA_Server *server,
-                                 const UA_NodeId *sessionId, void *sessionContext,
-                                 const UA_NodeId *nodeId, void *nodeContext,
-                                 const UA_NumericRange *range, const UA_DataValue *data)
+static void addModIOSlaveVariables(UA_Server *server, int slave_index)
 {
-    if (data->value.type == &UA_TYPES[UA_TYPES_INT32])
+    /*
+     * Create the variables of a slave attached at runtime.
+     */
+    int j;
+    int index = slave_index * MOD_IO_CHANNEL_COUNT;
+
+    initModIOSlaveChannelList(slave_index);
+    updateModIOChannelListLength();
+    for (j = index; j < index + MOD_IO_CHANNEL_COUNT; j++)
     {
-        UA_Int32 hrValue = *(UA_Int32 *)data->value.data;
-        int addr = I2C_SLAVE_ADDR_LIST[1];
-        if (hrValue > 0)
-        {
-            I2C_1_RELAYS_STATE |= 1UL << 3;
-            setRelayState(I2C_1_RELAYS_STATE, addr);
-        }
-        else
+        if (MOD_IO_CHANNEL_LIST[j].slave_addr != 0)
         {
-            I2C_1_RELAYS_STATE &= ~(1UL << 3);
-            setRelayState(I2C_1_RELAYS_STATE, addr);
+            addModIOChannelVariable(server, j);
+            setModIOChannelValueCallback(server, j);
         }
     }
+    flagInputChange(slave_index, INPUT_CHANGE_ALL, UA_DateTime_now());
 }
 
-static void addValueCallbackToCurrentTimeVariable(UA_Server *server)
+static void removeModIOSlaveVariables(UA_Server *server, int slave_index)
 {
-    int length = getI2CSlaveListLength();
-    // I2C0
-    // relay 0
-    UA_NodeId currentNodeId0 = UA_NODEID_STRING(1, "i2c0.relay0");
-    UA_ValueCallback callback0;
-    callback0.onRead = beforeReadTime;
-    callback0.onWrite = afterWriteTimeI2C0_0;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId0, callback0);
-
-    // relay 1
-    UA_NodeId currentNodeId1 = UA_NODEID_STRING(1, "i2c0.relay1");
-    UA_ValueCallback callback1;
-    callback1.onRead = beforeReadTime;
-    callback1.onWrite = afterWriteTimeI2C0_1;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId1, callback1);
-
-    // relay 2
-    UA_NodeId currentNodeId2 = UA_NODEID_STRING(1, "i2c0.relay2");
-    UA_ValueCallback callback2;
-    callback2.onRead = beforeReadTime;
-    callback2.onWrite = afterWriteTimeI2C0_2;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId2, callback2);
-
-    // relay 3
-    UA_NodeId currentNodeId3 = UA_NODEID_STRING(1, "i2c0.relay3");
-    UA_ValueCallback callback3;
-    callback3.onRead = beforeReadTime;
-    callback3.onWrite = afterWriteTimeI2C0_3;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId3, callback3);
-
-    // Digital input 0
-    UA_NodeId currentNodeId4 = UA_NODEID_STRING(1, "i2c0.in0");
-    UA_ValueCallback callback4;
-    callback4.onRead = beforeReadTimeI2C0In0;
-    callback4.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId4, callback4);
-
-    // Digital input 1
-    UA_NodeId currentNodeId5 = UA_NODEID_STRING(1, "i2c0.in1");
-    UA_ValueCallback callback5;
-    callback5.onRead = beforeReadTimeI2C0In1;
-    callback5.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId5, callback5);
-
-    // Digital input 2
-    UA_NodeId currentNodeId6 = UA_NODEID_STRING(1, "i2c0.in2");
-    UA_ValueCallback callback6;
-    callback6.onRead = beforeReadTimeI2C0In2;
-    callback6.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId6, callback6);
-
-    // Digital input 3
-    UA_NodeId currentNodeId7 = UA_NODEID_STRING(1, "i2c0.in3");
-    UA_ValueCallback callback7;
-    callback7.onRead = beforeReadTimeI2C0In3;
-    callback7.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId7, callback7);
-
-    // Analog input 0
-    UA_NodeId currentNodeId8 = UA_NODEID_STRING(1, "i2c0.ain0");
-    UA_ValueCallback callback8;
-    callback8.onRead = beforeReadTimeI2C0Ain0;
-    callback8.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId8, callback8);
-
-    // Analog input 1
-    UA_NodeId currentNodeId9 = UA_NODEID_STRING(1, "i2c0.ain1");
-    UA_ValueCallback callback9;
-    callback9.onRead = beforeReadTimeI2C0Ain1;
-    callback9.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId9, callback9);
-
-    // Analog input 2
-    UA_NodeId currentNodeId10 = UA_NODEID_STRING(1, "i2c0.ain2");
-    UA_ValueCallback callback10;
-    callback10.onRead = beforeReadTimeI2C0Ain2;
-    callback10.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId10, callback10);
-
-    // Analog input 3
-    UA_NodeId currentNodeId11 = UA_NODEID_STRING(1, "i2c0.ain3");
-    UA_ValueCallback callback11;
-    callback11.onRead = beforeReadTimeI2C0Ain3;
-    callback11.onWrite = afterWriteTime;
-    UA_Server_setVariableNode_valueCallback(server, currentNodeId11, callback11);
-
-    if (length > 1)
+    /*
+     * Delete the variables of a slave (before it is detached at runtime).
+     */
+    int j;
+    int index = slave_index * MOD_IO_CHANNEL_COUNT;
+
+    for (j = index; j < index + MOD_IO_CHANNEL_COUNT; j++)
     {
-        // I2C1
-        // relay 0
-        UA_NodeId currentNodeId12 = UA_NODEID_STRING(1, "i2c1.relay0");
-        UA_ValueCallback callback12;
-        callback12.onRead = beforeReadTime;
-        callback12.onWrite = afterWriteTimeI2C1_0;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId12, callback12);
-
-        // relay 1
-        UA_NodeId currentNodeId13 = UA_NODEID_STRING(1, "i2c1.relay1");
-        UA_ValueCallback callback13;
-        callback13.onRead = beforeReadTime;
-        callback13.onWrite = afterWriteTimeI2C1_1;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId13, callback13);
-
-        // relay 2
-        UA_NodeId currentNodeId14 = UA_NODEID_STRING(1, "i2c1.relay2");
-        UA_ValueCallback callback14;
-        callback14.onRead = beforeReadTime;
-        callback14.onWrite = afterWriteTimeI2C1_2;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId14, callback14);
-
-        // relay 2
-        UA_NodeId currentNodeId15 = UA_NODEID_STRING(1, "i2c1.relay3");
-        UA_ValueCallback callback15;
-        callback15.onRead = beforeReadTime;
-        callback15.onWrite = afterWriteTimeI2C1_3;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId15, callback15);
-
-        // Digital input 0
-        UA_NodeId currentNodeId16 = UA_NODEID_STRING(1, "i2c1.in0");
-        UA_ValueCallback callback16;
-        callback16.onRead = beforeReadTimeI2C1In0;
-        callback16.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId16, callback16);
-
-        // Digital input 1
-        UA_NodeId currentNodeId17 = UA_NODEID_STRING(1, "i2c1.in1");
-        UA_ValueCallback callback17;
-        callback17.onRead = beforeReadTimeI2C1In1;
-        callback17.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId17, callback17);
-
-        // Digital input 2
-        UA_NodeId currentNodeId18 = UA_NODEID_STRING(1, "i2c1.in2");
-        UA_ValueCallback callback18;
-        callback18.onRead = beforeReadTimeI2C1In2;
-        callback18.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId18, callback18);
-
-        // Digital input 3
-        UA_NodeId currentNodeId19 = UA_NODEID_STRING(1, "i2c1.in3");
-        UA_ValueCallback callback19;
-        callback19.onRead = beforeReadTimeI2C1In3;
-        callback19.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId19, callback19);
-
-        // Analog input 0
-        UA_NodeId currentNodeId20 = UA_NODEID_STRING(1, "i2c1.ain0");
-        UA_ValueCallback callback20;
-        callback20.onRead = beforeReadTimeI2C1Ain0;
-        callback20.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId20, callback20);
-
-        // Analog input 1
-        UA_NodeId currentNodeId21 = UA_NODEID_STRING(1, "i2c1.ain1");
-        UA_ValueCallback callback21;
-        callback21.onRead = beforeReadTimeI2C1Ain1;
-        callback21.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId21, callback21);
-
-        // Analog input 2
-        UA_NodeId currentNodeId22 = UA_NODEID_STRING(1, "i2c1.ain2");
-        UA_ValueCallback callback22;
-        callback22.onRead = beforeReadTimeI2C1Ain2;
-        callback22.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId22, callback22);
-
-        // Analog input 3
-        UA_NodeId currentNodeId23 = UA_NODEID_STRING(1, "i2c1.ain3");
-        UA_ValueCallback callback23;
-        callback23.onRead = beforeReadTimeI2C1Ain3;
-        callback23.onWrite = afterWriteTime;
-        UA_Server_setVariableNode_valueCallback(server, currentNodeId23, callback23);
+        if (MOD_IO_CHANNEL_LIST[j].slave_addr != 0)
+        {
+            UA_Server_deleteNode(server, MOD_IO_NODE_ID_LIST[j].node_id, true);
+            memset(&MOD_IO_CHANNEL_LIST[j], 0, sizeof(mod_io_channel_t));
+        }
     }
 }
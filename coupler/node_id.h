@@ -0,0 +1,62 @@
+/*
+ * NodeIds of the coupler's own OPC UA variables.
+ *
+ * By default variables are addressed by string NodeIds (ns=1;s=i2c0.relay0)
+ * which the nodestore has to hash and compare on every Read / Write. In
+ * numeric mode (CLI "-e 1") the very same variables get numeric NodeIds
+ * (ns=1;i=1000..) while their BrowseNames stay unchanged.
+ *
+ * NodeIds are resolved only once at startup into static tables so hot paths
+ * (value callbacks, heart beat tics) never build a NodeId again.
+ */
+#ifndef NODE_ID_H
+#define NODE_ID_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <open62541/server.h>
+
+// the namespace of all coupler's variables
+#define COUPLER_NAMESPACE_INDEX 1
+
+// numeric NodeIds layout (numeric mode only)
+#define HEART_BEAT_NUMERIC_NODE_ID 100
+#define HEART_BEAT_COUPLER_ID_NUMERIC_NODE_ID 101
+#define HEART_BEAT_TIMESTAMP_NUMERIC_NODE_ID 102
+#define MOD_IO_NUMERIC_NODE_ID_BASE 1000
+#define KEEP_ALIVE_NUMERIC_NODE_ID 200
+#define KEEP_ALIVE_NUMERIC_NODE_ID_BASE 100000
+#define DIAGNOSTICS_NUMERIC_NODE_ID 300
+#define DIAGNOSTICS_NUMERIC_NODE_ID_BASE 200000
+
+// longest string NodeId (i.e. diagnostics.heart_beat_inter_arrival.Count)
+#define MAX_NODE_ID_NAME_LENGTH 64
+
+// use numeric NodeIds instead of string ones
+static bool ENABLE_NUMERIC_NODE_ID = false;
+
+typedef struct {
+    char name[MAX_NODE_ID_NAME_LENGTH];     // string NodeId (also used in string mode)
+    UA_NodeId node_id;                      // resolved NodeId
+} node_id_t;
+
+static const UA_NodeId *resolveNodeId(node_id_t *entry, const char *name, UA_UInt32 numeric_id)
+{
+    /*
+     * Resolve once the NodeId of a variable either to its string
+     * or to its numeric form. The string is kept in the entry so the
+     * resulting NodeId stays valid for the whole lifetime of the coupler.
+     */
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    if (ENABLE_NUMERIC_NODE_ID)
+    {
+        entry->node_id = UA_NODEID_NUMERIC(COUPLER_NAMESPACE_INDEX, numeric_id);
+    }
+    else
+    {
+        entry->node_id = UA_NODEID_STRING(COUPLER_NAMESPACE_INDEX, entry->name);
+    }
+    return &entry->node_id;
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * Transport of keep-alive Pub/Sub messages (CLI "-T").
+ *
+ *   - udp (default): UADP over UDP multicast (NETWORK_ADDRESS_URL_DATA_TYPE)
+ *   - eth: UADP directly in Ethernet frames (EtherType 0xB62C) sent to a
+ *     destination MAC, optionally VLAN tagged with a priority code point so
+ *     switches queue heart beats ahead of best effort traffic. This bypasses
+ *     the IP / UDP stack and needs a network interface ("-j").
+ *
+ * Over Ethernet, SO_TXTIME can be enabled ("-X <offset in us>"): every heart
+ * beat frame gets a launch time of now + offset on CLOCK_TAI and the ETF
+ * qdisc of the interface (or the NIC) sends it exactly then, i.e.
+ *
+ *   tc qdisc replace dev eth0 parent root handle 100 mqprio num_tc 3 \
+ *      map 2 2 1 0 2 2 2 2 2 2 2 2 2 2 2 2 queues 1@0 1@1 2@2 hw 0
+ *   tc qdisc add dev eth0 parent 100:1 etf clockid CLOCK_TAI delta 200000 offload
+ *
+ * with the socket priority ("-Q") mapped to the ETF queue. The offset must
+ * be larger than the ETF delta plus the publish time.
+ */
+#ifndef PUBSUB_TRANSPORT_H
+#define PUBSUB_TRANSPORT_H
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+#include "ua_pubsub.h"
+#include "time_base.h"
+#include "rt_executive.h"
+
+#define PUBSUB_TRANSPORT_UDP 0
+#define PUBSUB_TRANSPORT_ETH 1
+
+// OPC UA's Pub/Sub profiles
+#define UDP_TRANSPORT_PROFILE "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp"
+#define ETH_TRANSPORT_PROFILE "http://opcfoundation.org/UA-Profile/Transport/pubsub-eth-uadp"
+
+// the default destination MAC (multicast MAC of 224.0.0.22)
+#define DEFAULT_ETH_DESTINATION_MAC "01-00-5E-00-00-16"
+
+// VLAN IDs 1..4094, 0 - untagged frames
+#define MAX_ETH_VLAN_ID 4094
+#define MAX_ETH_PCP 7
+
+// the default socket priority of SO_TXTIME frames
+#define DEFAULT_ETH_SOCKET_PRIORITY 3
+
+// opc.eth://01-00-5E-00-00-16:4094.7
+#define MAX_ETH_ADDRESS_URL_LENGTH 64
+
+static int PUBSUB_TRANSPORT = PUBSUB_TRANSPORT_UDP;
+static char *ETH_DESTINATION_MAC = DEFAULT_ETH_DESTINATION_MAC;
+static int ETH_VLAN_ID = 0;
+static int ETH_PCP = 0;
+static int ETH_SOCKET_PRIORITY = DEFAULT_ETH_SOCKET_PRIORITY;
+
+// launch time offset (in ns) of SO_TXTIME frames (0 - SO_TXTIME disabled)
+static uint64_t ETH_TXTIME_OFFSET = 0;
+
+static char PUBSUB_ETH_ADDRESS_URL[MAX_ETH_ADDRESS_URL_LENGTH];
+
+// connection properties of the publisher's connection (SO_TXTIME only)
+static UA_UInt32 ETH_SOCKET_PRIORITY_PROPERTY;
+static UA_Boolean ETH_ENABLE_SO_TXTIME_PROPERTY = UA_TRUE;
+static UA_KeyValuePair ETH_CONNECTION_PROPERTY_LIST[2];
+
+// launch time of the next heart beat frame, read by the Ethernet plugin
+static UA_EthernetWriterGroupTransportDataType ETH_WRITER_GROUP_TRANSPORT;
+
+// a WriterGroup's publish callback, wrapped to set its launch time
+typedef struct txtime_publish {
+    UA_ServerCallback callback;     // the WriterGroup's publish callback
+    void *data;                     // its WriterGroup
+    UA_UInt64 callback_id;
+    struct txtime_publish *next;
+} txtime_publish_t;
+
+// all wrapped publish callbacks (server thread only)
+static txtime_publish_t *TXTIME_PUBLISH_LIST = NULL;
+
+static int selectPubSubTransport(const char *name)
+{
+    /*
+     * Select the Pub/Sub transport by name (udp, eth).
+     * Return -1 if unknown.
+     */
+    if (strcmp(name, "udp") == 0)
+    {
+        PUBSUB_TRANSPORT = PUBSUB_TRANSPORT_UDP;
+        DEFAULT_TRANSPORT_PROFILE = UDP_TRANSPORT_PROFILE;
+    }
+    else if (strcmp(name, "eth") == 0)
+    {
+        PUBSUB_TRANSPORT = PUBSUB_TRANSPORT_ETH;
+        DEFAULT_TRANSPORT_PROFILE = ETH_TRANSPORT_PROFILE;
+    }
+    else
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int formatEthernetAddressUrl(char *buffer, size_t size, const char *mac, int vlan_id, int pcp)
+{
+    /*
+     * Format the ETH UADP address opc.eth://<MAC>[:<VLAN ID>[.<PCP>]].
+     * The MAC can be given with '-' or ':' separators. Return -1 if the MAC,
+     * the VLAN ID or the PCP is invalid.
+     */
+    char normalized_mac[18];
+    int i;
+
+    if (strlen(mac) != 17 || vlan_id < 0 || vlan_id > MAX_ETH_VLAN_ID || pcp < 0 || pcp > MAX_ETH_PCP)
+    {
+        return -1;
+    }
+    for (i = 0; i < 17; i++)
+    {
+        if (i % 3 == 2)
+        {
+            if (mac[i] != '-' && mac[i] != ':')
+                return -1;
+            // ':' separates the VLAN ID in the URL
+            normalized_mac[i] = '-';
+        }
+        else
+        {
+            if (!isxdigit((unsigned char)mac[i]))
+                return -1;
+            normalized_mac[i] = toupper((unsigned char)mac[i]);
+        }
+    }
+    normalized_mac[17] = '\0';
+
+    if (vlan_id == 0)
+        snprintf(buffer, size, "opc.eth://%s", normalized_mac);
+    else
+        snprintf(buffer, size, "opc.eth://%s:%d.%d", normalized_mac, vlan_id, pcp);
+    return 0;
+}
+
+static const char *getPubSubNetworkAddressUrl()
+{
+    /*
+     * Return the address heart beats are published to / subscribed from.
+     */
+    if (PUBSUB_TRANSPORT != PUBSUB_TRANSPORT_ETH)
+    {
+        return NETWORK_ADDRESS_URL_DATA_TYPE;
+    }
+    if (formatEthernetAddressUrl(PUBSUB_ETH_ADDRESS_URL, sizeof(PUBSUB_ETH_ADDRESS_URL),
+                                 ETH_DESTINATION_MAC, ETH_VLAN_ID, ETH_PCP) < 0)
+    {
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                     "Invalid Ethernet destination (MAC=%s, VLAN=%d, PCP=%d), using %s",
+                     ETH_DESTINATION_MAC, ETH_VLAN_ID, ETH_PCP, DEFAULT_ETH_DESTINATION_MAC);
+        formatEthernetAddressUrl(PUBSUB_ETH_ADDRESS_URL, sizeof(PUBSUB_ETH_ADDRESS_URL),
+                                 DEFAULT_ETH_DESTINATION_MAC, 0, 0);
+    }
+    return PUBSUB_ETH_ADDRESS_URL;
+}
+
+static bool isSOTxTimeEnabled()
+{
+    return PUBSUB_TRANSPORT == PUBSUB_TRANSPORT_ETH && ETH_TXTIME_OFFSET > 0;
+}
+
+static void setPubSubConnectionProperties(UA_PubSubConnectionConfig *connectionConfig)
+{
+    /*
+     * Ask the Ethernet plugin for a SO_TXTIME socket of the ETF queue's priority.
+     */
+    if (!isSOTxTimeEnabled())
+    {
+        return;
+    }
+    ETH_SOCKET_PRIORITY_PROPERTY = ETH_SOCKET_PRIORITY;
+    ETH_CONNECTION_PROPERTY_LIST[0].key = UA_QUALIFIEDNAME(0, "sockpriority");
+    UA_Variant_setScalar(&ETH_CONNECTION_PROPERTY_LIST[0].value, &ETH_SOCKET_PRIORITY_PROPERTY,
+                         &UA_TYPES[UA_TYPES_UINT32]);
+    ETH_CONNECTION_PROPERTY_LIST[1].key = UA_QUALIFIEDNAME(0, "enablesotxtime");
+    UA_Variant_setScalar(&ETH_CONNECTION_PROPERTY_LIST[1].value, &ETH_ENABLE_SO_TXTIME_PROPERTY,
+                         &UA_TYPES[UA_TYPES_BOOLEAN]);
+    connectionConfig->connectionProperties = ETH_CONNECTION_PROPERTY_LIST;
+    connectionConfig->connectionPropertiesSize = 2;
+}
+
+static uint64_t getSOTxTimeLaunchTime()
+{
+    /*
+     * Launch time (CLOCK_TAI, the ETF qdisc's clock) of a frame sent now.
+     */
+    struct timespec ts;
+    clock_gettime(CLOCK_TAI, &ts);
+    return convertTimespec2NanoSeconds(&ts) + ETH_TXTIME_OFFSET;
+}
+
+static void callbackPublishWithTxTime(UA_Server *server, void *data)
+{
+    /*
+     * Set the launch time of the frame right before the WriterGroup publishes it.
+     */
+    txtime_publish_t *publish = (txtime_publish_t *)data;
+    UA_WriterGroup *writerGroup = (UA_WriterGroup *)publish->data;
+    UA_EthernetWriterGroupTransportDataType *transport =
+        (UA_EthernetWriterGroupTransportDataType *)writerGroup->config.transportSettings.content.decoded.data;
+
+    if (transport != NULL)
+    {
+        transport->transmission_time = getSOTxTimeLaunchTime();
+    }
+    publish->callback(server, publish->data);
+}
+
+static UA_StatusCode addTxTimePublishCallback(UA_Server *server, UA_NodeId identifier,
+                                              UA_ServerCallback callback, void *data,
+                                              UA_Double interval_ms, UA_DateTime *baseTime,
+                                              UA_TimerPolicy timerPolicy, UA_UInt64 *callbackId)
+{
+    /*
+     * Run the publish callback of a WriterGroup through its own wrapper context.
+     */
+    UA_StatusCode result;
+    txtime_publish_t *publish = (txtime_publish_t *)calloc(1, sizeof(txtime_publish_t));
+
+    if (publish == NULL)
+    {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    publish->callback = callback;
+    publish->data = data;
+    result = addCyclicCallback(server, callbackPublishWithTxTime, publish, interval_ms, &publish->callback_id);
+    if (result != UA_STATUSCODE_GOOD)
+    {
+        free(publish);
+        return result;
+    }
+    publish->next = TXTIME_PUBLISH_LIST;
+    TXTIME_PUBLISH_LIST = publish;
+    *callbackId = publish->callback_id;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode changeTxTimePublishCallback(UA_Server *server, UA_NodeId identifier,
+                                                 UA_UInt64 callbackId, UA_Double interval_ms,
+                                                 UA_DateTime *baseTime, UA_TimerPolicy timerPolicy)
+{
+    return changeCyclicCallback(server, callbackId, interval_ms);
+}
+
+static void removeTxTimePublishCallback(UA_Server *server, UA_NodeId identifier, UA_UInt64 callbackId)
+{
+    /*
+     * Remove the callback, then free its wrapper context (not in flight anymore).
+     */
+    txtime_publish_t **link;
+    txtime_publish_t *publish;
+
+    removeCyclicCallback(server, callbackId);
+    for (link = &TXTIME_PUBLISH_LIST; *link != NULL; link = &(*link)->next)
+    {
+        if ((*link)->callback_id == callbackId)
+        {
+            publish = *link;
+            *link = publish->next;
+            free(publish);
+            return;
+        }
+    }
+}
+
+static void setWriterGroupTransportSettings(UA_WriterGroupConfig *writerGroupConfig)
+{
+    /*
+     * With SO_TXTIME every published frame carries its launch time:
+     * the Ethernet plugin reads it from the WriterGroup's transport settings
+     * which are set by a wrapper of the publish callback.
+     */
+    if (!isSOTxTimeEnabled())
+    {
+        return;
+    }
+    memset(&ETH_WRITER_GROUP_TRANSPORT, 0, sizeof(ETH_WRITER_GROUP_TRANSPORT));
+    ETH_WRITER_GROUP_TRANSPORT.txtime_enabled = UA_TRUE;
+    writerGroupConfig->transportSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+    writerGroupConfig->transportSettings.content.decoded.type =
+        &UA_TYPES[UA_TYPES_ETHERNETWRITERGROUPTRANSPORTDATATYPE];
+    writerGroupConfig->transportSettings.content.decoded.data = &ETH_WRITER_GROUP_TRANSPORT;
+    writerGroupConfig->pubsubManagerCallback.addCustomCallback = addTxTimePublishCallback;
+    writerGroupConfig->pubsubManagerCallback.changeCustomCallback = changeTxTimePublishCallback;
+    writerGroupConfig->pubsubManagerCallback.removeCustomCallback = removeTxTimePublishCallback;
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Coalesced, write-behind relay outputs.
+ *
+ * OPC UA writes to i2c*.relay* only update the requested relay state of the
+ * slave and mark it dirty. A flush stage then issues at most one I2C write
+ * per dirty slave: once the current OPC UA service request is processed and
+ * at each I/O scanner cycle. A PLC writing all four relays of a MOD-IO in one
+ * Write request thus causes a single I2C transaction and all four relays
+ * change together.
+ */
+
+typedef struct {
+    uint8_t state;          // requested state of the 4 relays (bits 0..3)
+    uint8_t dirty;          // requested state not yet written to the slave
+} relay_output_t;
+
+static relay_output_t RELAY_OUTPUT_LIST[MAX_I2C_SLAVE_COUNT];
+
+// statistics
+static unsigned int RELAY_OUTPUT_WRITE_COUNTER = 0;       // relay writes requested
+static unsigned int RELAY_OUTPUT_FLUSH_COUNTER = 0;       // I2C writes issued
+static unsigned int RELAY_OUTPUT_COALESCED_COUNTER = 0;   // relay writes merged into another I2C write
+
+// a flush is already scheduled on the server's event loop
+static bool RELAY_OUTPUT_FLUSH_SCHEDULED = false;
+
+static void setRelayOutput(int slave_index, int relay, bool value)
+{
+    /*
+     * Request a relay state, it will be written by the next flush.
+     */
+    relay_output_t *output = &RELAY_OUTPUT_LIST[slave_index];
+
+    if (value)
+    {
+        __atomic_fetch_or(&output->state, 1U << relay, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_fetch_and(&output->state, ~(1U << relay), __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&RELAY_OUTPUT_WRITE_COUNTER, 1, __ATOMIC_RELAXED);
+    if (__atomic_exchange_n(&output->dirty, 1, __ATOMIC_RELEASE))
+    {
+        // an I2C write for this slave is already pending
+        __atomic_fetch_add(&RELAY_OUTPUT_COALESCED_COUNTER, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static uint8_t getRelayOutput(int slave_index)
+{
+    /*
+     * Return the requested relays' state of a slave.
+     */
+    return __atomic_load_n(&RELAY_OUTPUT_LIST[slave_index].state, __ATOMIC_RELAXED);
+}
+
+void flushRelayOutputList()
+{
+    /*
+     * Write the relays' state of all dirty slaves (one I2C write per slave).
+     */
+    int i;
+
+    pthread_mutex_lock(&I2C_RELAY_LOCK);
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+    {
+        if (I2C_SLAVE_ADDR_LIST[i] != 0 &&
+            __atomic_exchange_n(&RELAY_OUTPUT_LIST[i].dirty, 0, __ATOMIC_ACQUIRE))
+        {
+            setI2CSlaveRelayState(i, getRelayOutput(i));
+            __atomic_fetch_add(&RELAY_OUTPUT_FLUSH_COUNTER, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&I2C_RELAY_LOCK);
+}
+
+static void flushRelayOutputCallback(UA_Server *server, void *data)
+{
+    RELAY_OUTPUT_FLUSH_SCHEDULED = false;
+    flushRelayOutputList();
+}
+
+static void scheduleRelayOutputFlush(UA_Server *server)
+{
+    /*
+     * Flush once the current service request is processed (server thread only).
+     */
+    if (RELAY_OUTPUT_FLUSH_SCHEDULED)
+    {
+        return;
+    }
+    // a timed callback "now" runs at the next iteration of the server's event loop
+    if (UA_Server_addTimedCallback(server, flushRelayOutputCallback, NULL,
+                                   UA_DateTime_nowMonotonic(), NULL) == UA_STATUSCODE_GOOD)
+    {
+        RELAY_OUTPUT_FLUSH_SCHEDULED = true;
+    }
+    else
+    {
+        flushRelayOutputList();
+    }
+}
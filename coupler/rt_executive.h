@@ -0,0 +1,509 @@
+/*
+ * Real-time cyclic executive (opt-in, CLI "-y <priority>").
+ *
+ * By default the I/O scanner runs in its own normal thread and heart beat
+ * tics / checks and Pub/Sub publish / receive run as repeated callbacks of
+ * the OPC UA server's main loop, thus their jitter depends on the load of
+ * the server (client sessions, browsing, ...).
+ *
+ * In real-time mode a single SCHED_FIFO thread (optionally pinned to a CPU
+ * with "-z <cpu>") owns all cyclic work:
+ *   - I/O scan (flush relays, read inputs, flag changed inputs)
+ *   - heart beat tic and check
+ *   - Pub/Sub WriterGroup publish and ReaderGroup receive (through the
+ *     groups' pubsubManagerCallback)
+ * It wakes up every RT_CYCLE_INTERVAL us on absolute deadlines
+ * (clock_nanosleep(TIMER_ABSTIME)) and runs the tasks which are due. Memory
+ * is locked (mlockall) and the thread's stack is prefaulted so no page fault
+ * happens in the cycle. The OPC UA server keeps running in the main thread
+ * at normal priority.
+ *
+ * Running Pub/Sub callbacks outside of the server's main loop requires
+ * open62541 to be built with UA_MULTITHREADING=100.
+ *
+ * Each cycle records its wakeup latency (actual - planned wakeup) and
+ * counts overruns (cycle work did not finish before the next deadline).
+ *
+ * RT_TASK_LOCK only guards the task list, callbacks run without it: Pub/Sub
+ * callbacks take the server's serviceMutex, which open62541 holds while it
+ * changes / removes them through the callback lifecycle. A task is marked
+ * running while its callback is in flight and removeRTTask() waits for it.
+ * Pub/Sub groups removed at runtime must be removed between
+ * suspendRTTaskList() and resumeRTTaskList() (called without serviceMutex),
+ * so the removal never waits for a callback blocked on serviceMutex.
+ */
+#ifndef RT_EXECUTIVE_H
+#define RT_EXECUTIVE_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+#include "time_base.h"
+
+// the default base cycle of the real-time thread (in us)
+#define DEFAULT_RT_CYCLE_INTERVAL 1000
+
+// the maximal number of cyclic tasks of the real-time thread
+#define MAX_RT_TASK_COUNT 16
+
+// stack of the real-time thread, prefaulted at start
+#define RT_STACK_SIZE (512 * 1024)
+#define RT_STACK_PREFAULT_SIZE (256 * 1024)
+
+// SCHED_FIFO priority of the real-time thread (0 - real-time mode disabled)
+static int RT_PRIORITY = 0;
+
+// CPU the real-time thread is pinned to (-1 - no affinity)
+static int RT_CPU = -1;
+
+// base cycle of the real-time thread (in us)
+static int RT_CYCLE_INTERVAL = DEFAULT_RT_CYCLE_INTERVAL;
+
+typedef struct {
+    UA_ServerCallback callback;
+    UA_Server *server;
+    void *data;
+    uint64_t interval;          // ns
+    uint64_t next;              // monotonic deadline (ns) of the next run
+    uint64_t id;
+    bool used;
+    bool running;               // callback in flight (real-time thread)
+} rt_task_t;
+
+static rt_task_t RT_TASK_LIST[MAX_RT_TASK_COUNT];
+static uint64_t RT_TASK_LAST_ID = 0;
+static pthread_mutex_t RT_TASK_LOCK;
+static bool RT_TASK_LOCK_INITIALIZED = false;
+// signaled when callbacks in flight finished
+static pthread_cond_t RT_TASK_DONE = PTHREAD_COND_INITIALIZER;
+// no task is started while > 0
+static int RT_TASK_SUSPEND_COUNT = 0;
+
+static pthread_t RT_EXECUTIVE_THREAD;
+static volatile bool RT_EXECUTIVE_RUNNING = false;
+
+// statistics of the real-time thread
+static uint64_t RT_CYCLE_COUNTER = 0;
+static uint64_t RT_OVERRUN_COUNTER = 0;
+static uint64_t RT_WAKEUP_LATENCY_SUM = 0;     // ns
+static uint64_t RT_WAKEUP_LATENCY_MAX = 0;     // ns
+static uint64_t RT_CYCLE_TIME_MAX = 0;         // ns
+
+static bool isRTModeEnabled()
+{
+    return RT_PRIORITY > 0;
+}
+
+static bool isRTExecutiveThread()
+{
+    return RT_EXECUTIVE_RUNNING && pthread_equal(pthread_self(), RT_EXECUTIVE_THREAD);
+}
+
+static void initRTTaskLock()
+{
+    /*
+     * Tasks are changed by the server thread while the real-time thread runs
+     * them: protect them by a priority inheritance mutex.
+     */
+    pthread_mutexattr_t attr;
+
+    if (RT_TASK_LOCK_INITIALIZED)
+    {
+        return;
+    }
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&RT_TASK_LOCK, &attr);
+    pthread_mutexattr_destroy(&attr);
+    RT_TASK_LOCK_INITIALIZED = true;
+}
+
+static int addRTTask(UA_ServerCallback callback, UA_Server *server, void *data,
+                     uint64_t interval, uint64_t *id)
+{
+    /*
+     * Add a task run every interval (ns) by the real-time thread.
+     * Return -1 if the task list is full.
+     */
+    int i;
+
+    initRTTaskLock();
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        // a removed task still in flight keeps its slot
+        if (!RT_TASK_LIST[i].used && !RT_TASK_LIST[i].running)
+        {
+            RT_TASK_LIST[i].callback = callback;
+            RT_TASK_LIST[i].server = server;
+            RT_TASK_LIST[i].data = data;
+            RT_TASK_LIST[i].interval = interval;
+            RT_TASK_LIST[i].next = getMonotonicNanoSeconds() + interval;
+            RT_TASK_LIST[i].id = ++RT_TASK_LAST_ID;
+            RT_TASK_LIST[i].used = true;
+            if (id != NULL)
+                *id = RT_TASK_LIST[i].id;
+            pthread_mutex_unlock(&RT_TASK_LOCK);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+    return -1;
+}
+
+static int changeRTTask(uint64_t id, uint64_t interval)
+{
+    /*
+     * Change the interval (ns) of a task. Return -1 if unknown.
+     */
+    int i;
+
+    initRTTaskLock();
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        if (RT_TASK_LIST[i].used && RT_TASK_LIST[i].id == id)
+        {
+            RT_TASK_LIST[i].interval = interval;
+            RT_TASK_LIST[i].next = getMonotonicNanoSeconds() + interval;
+            pthread_mutex_unlock(&RT_TASK_LOCK);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+    return -1;
+}
+
+static void removeRTTask(uint64_t id)
+{
+    /*
+     * Remove a task (it is not run anymore once this returns). Waits for
+     * its callback if in flight, unless called by the real-time thread.
+     */
+    int i;
+
+    initRTTaskLock();
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        if (RT_TASK_LIST[i].used && RT_TASK_LIST[i].id == id)
+        {
+            __atomic_store_n(&RT_TASK_LIST[i].used, false, __ATOMIC_RELAXED);
+            while (RT_TASK_LIST[i].running && !isRTExecutiveThread())
+            {
+                pthread_cond_wait(&RT_TASK_DONE, &RT_TASK_LOCK);
+            }
+        }
+    }
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+}
+
+static void suspendRTTaskList()
+{
+    /*
+     * Do not start tasks anymore and wait for the callbacks in flight
+     * (not from the real-time thread, not holding the server's serviceMutex).
+     */
+    int i;
+
+    initRTTaskLock();
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    RT_TASK_SUSPEND_COUNT++;
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        while (RT_TASK_LIST[i].running)
+        {
+            pthread_cond_wait(&RT_TASK_DONE, &RT_TASK_LOCK);
+        }
+    }
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+}
+
+static void resumeRTTaskList()
+{
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    RT_TASK_SUSPEND_COUNT--;
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+}
+
+static int runRTTaskList(uint64_t now)
+{
+    /*
+     * Run all tasks due at (monotonic) time now. A task which missed
+     * several of its periods runs only once and is realigned to now.
+     * The due tasks are taken under the lock, their callbacks run without it.
+     * Return the number of tasks run.
+     */
+    int i, count = 0;
+    int due_list[MAX_RT_TASK_COUNT];
+    rt_task_t due_task_list[MAX_RT_TASK_COUNT];
+    rt_task_t *task;
+
+    pthread_mutex_lock(&RT_TASK_LOCK);
+    for (i = 0; i < MAX_RT_TASK_COUNT && RT_TASK_SUSPEND_COUNT == 0; i++)
+    {
+        task = &RT_TASK_LIST[i];
+        if (!task->used || task->next > now)
+        {
+            continue;
+        }
+        task->running = true;
+        due_list[count] = i;
+        due_task_list[count++] = *task;
+        task->next += task->interval;
+        if (task->next <= now)
+        {
+            task->next = now + task->interval;
+        }
+    }
+    pthread_mutex_unlock(&RT_TASK_LOCK);
+
+    for (i = 0; i < count; i++)
+    {
+        // removed by an earlier callback of this cycle
+        if (!__atomic_load_n(&RT_TASK_LIST[due_list[i]].used, __ATOMIC_RELAXED))
+            continue;
+        due_task_list[i].callback(due_task_list[i].server, due_task_list[i].data);
+    }
+
+    if (count > 0)
+    {
+        pthread_mutex_lock(&RT_TASK_LOCK);
+        for (i = 0; i < count; i++)
+        {
+            RT_TASK_LIST[due_list[i]].running = false;
+        }
+        pthread_cond_broadcast(&RT_TASK_DONE);
+        pthread_mutex_unlock(&RT_TASK_LOCK);
+    }
+    return count;
+}
+
+static UA_StatusCode addCyclicCallback(UA_Server *server, UA_ServerCallback callback, void *data,
+                                       UA_Double interval_ms, UA_UInt64 *callbackId)
+{
+    /*
+     * Run a callback every interval_ms either in the real-time thread
+     * (real-time mode) or in the server's main loop.
+     */
+    if (!isRTModeEnabled())
+    {
+        return UA_Server_addRepeatedCallback(server, callback, data, interval_ms, callbackId);
+    }
+    if (addRTTask(callback, server, data,
+                  (uint64_t)(interval_ms * NANO_SECONDS_PER_MILLI_SECOND), callbackId) < 0)
+    {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode changeCyclicCallback(UA_Server *server, UA_UInt64 callbackId, UA_Double interval_ms)
+{
+    if (!isRTModeEnabled())
+    {
+        return UA_Server_changeRepeatedCallbackInterval(server, callbackId, interval_ms);
+    }
+    if (changeRTTask(callbackId, (uint64_t)(interval_ms * NANO_SECONDS_PER_MILLI_SECOND)) < 0)
+    {
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void removeCyclicCallback(UA_Server *server, UA_UInt64 callbackId)
+{
+    if (!isRTModeEnabled())
+    {
+        UA_Server_removeCallback(server, callbackId);
+        return;
+    }
+    removeRTTask(callbackId);
+}
+
+/* Pub/Sub group callbacks run by the real-time thread */
+
+static UA_StatusCode addRTPubSubCallback(UA_Server *server, UA_NodeId identifier,
+                                         UA_ServerCallback callback, void *data,
+                                         UA_Double interval_ms, UA_DateTime *baseTime,
+                                         UA_TimerPolicy timerPolicy, UA_UInt64 *callbackId)
+{
+    if (addRTTask(callback, server, data,
+                  (uint64_t)(interval_ms * NANO_SECONDS_PER_MILLI_SECOND), callbackId) < 0)
+    {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode changeRTPubSubCallback(UA_Server *server, UA_NodeId identifier,
+                                            UA_UInt64 callbackId, UA_Double interval_ms,
+                                            UA_DateTime *baseTime, UA_TimerPolicy timerPolicy)
+{
+    if (changeRTTask(callbackId, (uint64_t)(interval_ms * NANO_SECONDS_PER_MILLI_SECOND)) < 0)
+    {
+        return UA_STATUSCODE_BADNOTFOUND;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static void removeRTPubSubCallback(UA_Server *server, UA_NodeId identifier, UA_UInt64 callbackId)
+{
+    removeRTTask(callbackId);
+}
+
+static void setPubSubCallbackLifecycle(UA_PubSub_CallbackLifecycle *lifecycle)
+{
+    /*
+     * Let the real-time thread run a Writer- / ReaderGroup's cyclic
+     * callback (real-time mode only, otherwise the server's main loop does).
+     */
+    if (!isRTModeEnabled())
+    {
+        return;
+    }
+    lifecycle->addCustomCallback = addRTPubSubCallback;
+    lifecycle->changeCustomCallback = changeRTPubSubCallback;
+    lifecycle->removeCustomCallback = removeRTPubSubCallback;
+}
+
+static void prefaultRTStack()
+{
+    /*
+     * Touch the stack the cycle will use so it is mapped (and locked)
+     * before the first deadline.
+     */
+    volatile unsigned char stack[RT_STACK_PREFAULT_SIZE];
+    memset((unsigned char *)stack, 0, sizeof(stack));
+}
+
+static void *runRTExecutive(void *arg)
+{
+    /*
+     * Real-time cycle: sleep until the absolute deadline, run due tasks,
+     * measure wakeup latency and overruns.
+     */
+    uint64_t deadline, now, latency, cycle_time, cycle_interval;
+
+    prefaultRTStack();
+    cycle_interval = RT_CYCLE_INTERVAL * NANO_SECONDS_PER_MICRO_SECOND;
+    deadline = getMonotonicNanoSeconds() + cycle_interval;
+    while (RT_EXECUTIVE_RUNNING)
+    {
+        sleepUntilMonotonicNanoSeconds(deadline);
+        now = getMonotonicNanoSeconds();
+        latency = now > deadline ? now - deadline : 0;
+        __atomic_store_n(&RT_WAKEUP_LATENCY_SUM, RT_WAKEUP_LATENCY_SUM + latency, __ATOMIC_RELAXED);
+        if (latency > RT_WAKEUP_LATENCY_MAX)
+            __atomic_store_n(&RT_WAKEUP_LATENCY_MAX, latency, __ATOMIC_RELAXED);
+
+        runRTTaskList(now);
+
+        cycle_time = getMonotonicNanoSeconds() - deadline;
+        if (cycle_time > RT_CYCLE_TIME_MAX)
+            __atomic_store_n(&RT_CYCLE_TIME_MAX, cycle_time, __ATOMIC_RELAXED);
+        __atomic_store_n(&RT_CYCLE_COUNTER, RT_CYCLE_COUNTER + 1, __ATOMIC_RELAXED);
+
+        deadline += cycle_interval;
+        if (cycle_time >= cycle_interval)
+        {
+            // missed the next deadline(s): count it and skip them
+            __atomic_store_n(&RT_OVERRUN_COUNTER, RT_OVERRUN_COUNTER + 1, __ATOMIC_RELAXED);
+            deadline += (cycle_time / cycle_interval) * cycle_interval;
+        }
+    }
+    return NULL;
+}
+
+int startRTExecutive()
+{
+    /*
+     * Lock memory and start the real-time thread. Without the privilege
+     * to use SCHED_FIFO the thread still runs, at normal priority.
+     */
+    pthread_attr_t attr;
+    struct sched_param param;
+    int result;
+
+    if (!isRTModeEnabled())
+    {
+        return 0;
+    }
+    initRTTaskLock();
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                       "Real-time: mlockall failed (%s)", strerror(errno));
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, RT_STACK_SIZE);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = RT_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+#ifdef CPU_SET
+    if (RT_CPU >= 0)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(RT_CPU, &cpu_set);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+    }
+#endif
+
+    RT_EXECUTIVE_RUNNING = true;
+    result = pthread_create(&RT_EXECUTIVE_THREAD, &attr, runRTExecutive, NULL);
+    if (result == EPERM)
+    {
+        UA_LOG_WARNING(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                       "Real-time: no permission for SCHED_FIFO, running at normal priority");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        result = pthread_create(&RT_EXECUTIVE_THREAD, &attr, runRTExecutive, NULL);
+    }
+    pthread_attr_destroy(&attr);
+    if (result != 0)
+    {
+        RT_EXECUTIVE_RUNNING = false;
+        UA_LOG_ERROR(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND, "Error starting real-time thread");
+        return -1;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                "Real-time thread started (priority=%d, cpu=%d, cycle=%d us)",
+                RT_PRIORITY, RT_CPU, RT_CYCLE_INTERVAL);
+    return 0;
+}
+
+void stopRTExecutive()
+{
+    /*
+     * Stop the real-time thread and wait for its last cycle.
+     */
+    if (!RT_EXECUTIVE_RUNNING)
+    {
+        return;
+    }
+    RT_EXECUTIVE_RUNNING = false;
+    pthread_join(RT_EXECUTIVE_THREAD, NULL);
+}
+
+static void logRTExecutiveStatistics()
+{
+    if (!isRTModeEnabled())
+    {
+        return;
+    }
+    UA_LOG_INFO(UA_Log_Stdout, UA_LOGCATEGORY_USERLAND,
+                "Real-time cycles=%lu, overruns=%lu, wakeup latency avg=%lu ns max=%lu ns, cycle time max=%lu ns",
+                (unsigned long)RT_CYCLE_COUNTER, (unsigned long)RT_OVERRUN_COUNTER,
+                (unsigned long)(RT_CYCLE_COUNTER > 0 ? RT_WAKEUP_LATENCY_SUM / RT_CYCLE_COUNTER : 0),
+                (unsigned long)RT_WAKEUP_LATENCY_MAX, (unsigned long)RT_CYCLE_TIME_MAX);
+}
+
+#endif
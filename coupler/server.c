@@ -8,6 +8,8 @@
  *   - i2c0.ain0..3
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -34,9 +36,6 @@ static int COUPLER_ID = 0;
 // global server
 UA_Server *server;
 
-// global dictionary of subscribers
-dict_t *SUBSCRIBER_DICT;
-
 // The default port of OPC-UA server
 const int DEFAULT_OPC_UA_PORT = 4840;
 
@@ -61,13 +60,22 @@ char *USERNAME;
 char *PASSWORD;
 char *X509_KEY_FILENAME;
 char *X509_CERTIFICATE_FILENAME;
+char *CONFIG_FILENAME = "";
+char *METRICS_SOCKET_PATH = "";
+char *TRACE_FILENAME = "";
 
 #include "gpio.h"
+#include "node_id.h"
+#include "relay_output.h"
+#include "io_scanner.h"
 #include "keep_alive.h"
+#include "pubsub_transport.h"
 #include "keep_alive_publisher.h"
 #include "keep_alive_subscriber.h"
 #include "cli.h"
 #include "mod_io_opc_ua.h"
+#include "diagnostics.h"
+#include "config_file.h"
 
 static volatile UA_Boolean running = true;
 
@@ -80,17 +88,27 @@ static void stopHandler(int sign)
 #ifndef DOING_UNIT_TESTS
 int main(int argc, char **argv)
 {
-  // init dictionary only once$
-  if (SUBSCRIBER_DICT==NULL){
-    SUBSCRIBER_DICT = *dictAlloc();
-  }
-
   // parse CLI
   handleCLI(argc, argv);
 
+  // overlay the configuration file, if any
+  if (loadCouplerConfig() < 0)
+  {
+    exit(1);
+  }
+
+  // open I2C buses only once and keep them open
+  openI2CSlaveBusList();
+
   // always start attached slaves from a know safe shutdown state
   safeShutdownI2CSlaveList();
 
+  // request GPIO measurement lines only once (if any)
+  openGPIO();
+
+  // scan inputs cyclically, changed inputs are written into the address space
+  startIOScanner();
+
   signal(SIGINT, stopHandler);
   signal(SIGTERM, stopHandler);
   UA_String serverUrls[1];
@@ -135,6 +153,12 @@ int main(int argc, char **argv)
   // add variables representing physical relays / inputs, etc
   addVariable(server);
   addValueCallbackToCurrentTimeVariable(server);
+  enableInputChangeNotification(server);
+
+  // expose metrics as Objects/Diagnostics and on the Prometheus socket
+  addDiagnosticsVariables(server);
+  startMetricsSocket();
+  enableTraceDump(server);
 
   /* Disable anonymous logins, enable two user/password logins */
   if (ENABLE_USERNAME_PASSWORD_AUTHENTICATION){
@@ -177,7 +201,12 @@ int main(int argc, char **argv)
   #endif
 
   // enable protocol for Pub/Sub
-  UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerUDPMP());
+  if (PUBSUB_TRANSPORT == PUBSUB_TRANSPORT_ETH) {
+    UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerEthernet());
+  }
+  else {
+    UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerUDPMP());
+  }
 
   // set for Pub / Sub the minimal and maximal sampling and publishing intervals
   UA_DurationRange rangePublishing = {PUBLISHING_INTERVAL, 3600.0 * 1000.0};
@@ -195,17 +224,36 @@ int main(int argc, char **argv)
     enableSubscribeToHeartBeat(server, config);
   }
 
+  // reload the configuration file on SIGHUP
+  enableCouplerConfigReload(server);
+
+  // in real-time mode cyclic work runs in its own thread, the server stays at normal priority
+  startRTExecutive();
+
   // run server
   UA_StatusCode retval = UA_Server_run(server, &running);
+  stopRTExecutive();
+  stopMetricsSocket();
   UA_Server_delete(server);
+  stopIOScanner();
 
   // always leave attached slaves to a known safe shutdown state
   safeShutdownI2CSlaveList();
+  closeI2CBusList();
+  closeGPIO();
+  dumpTraceToFile();
 
   // print statistics
   UA_LOG_INFO(UA_Log_Stdout, \
               UA_LOGCATEGORY_USERLAND, \
               "SAFE mode counter=%d", SAFE_MODE_STATE_COUNTER);
+  logLivenessStatistics();
+  logRTExecutiveStatistics();
+  UA_LOG_INFO(UA_Log_Stdout, \
+              UA_LOGCATEGORY_USERLAND, \
+              "Relay writes=%d, I2C relay writes=%d, coalesced=%d",
+              RELAY_OUTPUT_WRITE_COUNTER, RELAY_OUTPUT_FLUSH_COUNTER,
+              RELAY_OUTPUT_COALESCED_COUNTER);
  
   return retval == UA_STATUSCODE_GOOD ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,110 @@
+/*
+ * Time base of the coupler.
+ *
+ * All keep-alive and timing code works with integer nanosecond timestamps
+ * of a clock which is not stepped by NTP:
+ *   - CLOCK_MONOTONIC (default)
+ *   - CLOCK_MONOTONIC_RAW, not slewed by NTP either (pure oscillator)
+ *   - CLOCK_TAI, comparable between couplers synchronized with PTP so send
+ *     timestamps of Pub/Sub heart beats give one-way latencies
+ * The clock is selected once at startup (CLI "-g"). Reading it is an inline
+ * clock_gettime() served by the vDSO, no system call.
+ *
+ * Fixed rate loops always sleep on CLOCK_MONOTONIC (CLOCK_MONOTONIC_RAW can
+ * not be used with clock_nanosleep).
+ */
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define NANO_SECONDS_PER_SECOND 1000000000ULL
+#define NANO_SECONDS_PER_MILLI_SECOND 1000000ULL
+#define NANO_SECONDS_PER_MICRO_SECOND 1000ULL
+
+#ifndef CLOCK_TAI
+#define CLOCK_TAI 11
+#endif
+
+// the clock of all timestamps
+static clockid_t TIME_BASE_CLOCK = CLOCK_MONOTONIC;
+
+static inline uint64_t convertTimespec2NanoSeconds(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * NANO_SECONDS_PER_SECOND + ts->tv_nsec;
+}
+
+static inline void convertNanoSeconds2Timespec(uint64_t nano_seconds, struct timespec *ts)
+{
+    ts->tv_sec = nano_seconds / NANO_SECONDS_PER_SECOND;
+    ts->tv_nsec = nano_seconds % NANO_SECONDS_PER_SECOND;
+}
+
+static inline uint64_t getTimeBaseNanoSeconds(void)
+{
+    /*
+     * Return nano seconds of the time base clock.
+     */
+    struct timespec ts;
+    clock_gettime(TIME_BASE_CLOCK, &ts);
+    return convertTimespec2NanoSeconds(&ts);
+}
+
+static inline uint64_t getMonotonicNanoSeconds(void)
+{
+    /*
+     * Return nano seconds of the monotonic clock (deadlines of fixed rate loops).
+     */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return convertTimespec2NanoSeconds(&ts);
+}
+
+static inline int sleepUntilMonotonicNanoSeconds(uint64_t deadline)
+{
+    /*
+     * Sleep until an absolute deadline of the monotonic clock.
+     */
+    struct timespec ts;
+    convertNanoSeconds2Timespec(deadline, &ts);
+    return clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int setTimeBaseClock(const char *name)
+{
+    /*
+     * Select the time base clock by name (monotonic, monotonic_raw, tai).
+     * Return -1 if unknown or not available on this system.
+     */
+    struct timespec ts;
+    clockid_t clock;
+
+    if (strcmp(name, "monotonic") == 0)
+        clock = CLOCK_MONOTONIC;
+    else if (strcmp(name, "monotonic_raw") == 0)
+        clock = CLOCK_MONOTONIC_RAW;
+    else if (strcmp(name, "tai") == 0)
+        clock = CLOCK_TAI;
+    else
+        return -1;
+
+    if (clock_gettime(clock, &ts) != 0)
+        return -1;
+    TIME_BASE_CLOCK = clock;
+    return 0;
+}
+
+static uint64_t getTimeBaseResolution(void)
+{
+    /*
+     * Return the resolution (ns) of the time base clock.
+     */
+    struct timespec ts;
+    if (clock_getres(TIME_BASE_CLOCK, &ts) != 0)
+        return 0;
+    return convertTimespec2NanoSeconds(&ts);
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * Event trace: per thread lock free rings of fixed size binary records.
+ *
+ * Every thread tracing an event gets a ring of its own on its first event,
+ * so recording is a release fence, a store of 24 bytes and one release
+ * store of the ring's head: no lock, no system call, no shared cache line. A ring keeps the
+ * last TRACE_RING_RECORD_COUNT records of its thread (older ones are
+ * overwritten).
+ *
+ * Traced: heart beats sent / received, peer state changes, safe / normal
+ * mode, I2C transactions, I/O scan cycles and MOD-IO OPC UA callbacks.
+ * Operations having a duration are traced once, when done, with their
+ * start timestamp and duration.
+ *
+ * Tracing is enabled with a trace file (CLI "-E"). All rings are dumped to
+ * it on SIGUSR1 and at exit, rt_analyzer/trace_convert converts a dump to
+ * Chrome trace (chrome://tracing, Perfetto), CSV or a logic analyzer like
+ * CSV. Disabled, an event costs one predictable branch.
+ *
+ * Dump file: trace_file_header_t, then for every ring a trace_ring_header_t
+ * followed by its records, oldest first. Timestamps are time base ns.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "time_base.h"
+
+// records per ring (a power of two)
+#ifndef TRACE_RING_RECORD_COUNT
+#define TRACE_RING_RECORD_COUNT 16384
+#endif
+#define TRACE_RING_MASK (TRACE_RING_RECORD_COUNT - 1)
+
+// maximal number of tracing threads
+#define TRACE_MAX_RING_COUNT 16
+
+#define TRACE_FILE_MAGIC "OSIETRC"
+#define TRACE_FILE_VERSION 2
+
+// events (id, arg and value of their record)
+#define TRACE_HEART_BEAT_TX 0               // coupler, sequence, send timestamp
+#define TRACE_HEART_BEAT_RX 1               // peer, sequence, send timestamp
+#define TRACE_PEER_STATE 2                  // peer, previous state << 8 | state, -
+#define TRACE_SAFE_MODE 3                   // -, 1 entered / 0 left, -
+#define TRACE_I2C_WRITE 4                   // slave, relay command, duration
+#define TRACE_I2C_READ 5                    // slave, result, duration
+#define TRACE_IO_SCAN_CYCLE 6               // -, -, duration
+#define TRACE_INPUT_CHANGE_WRITE 7          // slave, changed inputs (INPUT_CHANGE_* bits), duration
+#define TRACE_OPC_UA_WRITE 8                // slave, channel kind << 8 | bit, duration
+#define TRACE_EVENT_COUNT 9
+
+// only used by the converter / dumps
+static const char *TRACE_EVENT_NAME_LIST[] __attribute__((unused)) = {
+    "heart_beat_tx", "heart_beat_rx", "peer_state", "safe_mode", "i2c_write", "i2c_read",
+    "io_scan_cycle", "input_change_write", "opc_ua_write"
+};
+
+// events whose value is a duration (ns)
+#define TRACE_IS_SPAN(event) ((event) >= TRACE_I2C_WRITE && (event) < TRACE_EVENT_COUNT)
+
+typedef struct {
+    uint64_t timestamp;                     // ns (start of a span)
+    uint64_t value;
+    uint32_t arg;
+    uint16_t event;
+    uint16_t id;
+} trace_record_t;
+
+typedef struct {
+    uint64_t head;                          // records ever written (single writer)
+    uint32_t thread_id;
+    trace_record_t record_list[TRACE_RING_RECORD_COUNT];
+} trace_ring_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t clock;                         // clockid_t of the time base
+    uint32_t ring_count;
+    uint32_t coupler_id;
+    uint32_t event_count;
+} trace_file_header_t;
+
+typedef struct {
+    uint32_t thread_id;
+    uint32_t record_count;
+    uint64_t lost_count;                    // overwritten before the dump
+} trace_ring_header_t;
+
+static bool TRACE_ENABLED = false;
+
+static trace_ring_t *TRACE_RING_LIST[TRACE_MAX_RING_COUNT];
+static uint32_t TRACE_RING_COUNT = 0;
+static __thread trace_ring_t *TRACE_THREAD_RING = NULL;
+// a thread which got no ring does not try again
+static __thread bool TRACE_THREAD_RING_FAILED = false;
+
+static trace_ring_t *newTraceRing()
+{
+    /*
+     * Give the calling thread a ring. Return NULL if out of rings or memory.
+     */
+    uint32_t index;
+    trace_ring_t *ring;
+
+    TRACE_THREAD_RING_FAILED = true;
+    index = __atomic_fetch_add(&TRACE_RING_COUNT, 1, __ATOMIC_RELAXED);
+    if (index >= TRACE_MAX_RING_COUNT)
+        return NULL;
+    ring = (trace_ring_t *)calloc(1, sizeof(trace_ring_t));
+    if (ring == NULL)
+        return NULL;
+    ring->thread_id = (uint32_t)syscall(SYS_gettid);
+    __atomic_store_n(&TRACE_RING_LIST[index], ring, __ATOMIC_RELEASE);
+    TRACE_THREAD_RING_FAILED = false;
+    TRACE_THREAD_RING = ring;
+    return ring;
+}
+
+static inline void writeTraceRecord(uint16_t event, uint16_t id, uint32_t arg, uint64_t value,
+                                    uint64_t timestamp)
+{
+    trace_ring_t *ring = TRACE_THREAD_RING;
+    trace_record_t *record;
+
+    if (ring == NULL)
+    {
+        if (TRACE_THREAD_RING_FAILED || (ring = newTraceRing()) == NULL)
+            return;
+    }
+    record = &ring->record_list[ring->head & TRACE_RING_MASK];
+    // the previous head store is visible before this slot is overwritten: a dump
+    // seeing any part of the new record also sees the new head and drops the slot
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->timestamp = timestamp;
+    record->value = value;
+    record->arg = arg;
+    record->event = event;
+    record->id = id;
+    // the record is complete before a dump can see it
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+static inline void traceEvent(uint16_t event, uint16_t id, uint32_t arg, uint64_t value)
+{
+    /*
+     * Trace an event now.
+     */
+    if (__builtin_expect(TRACE_ENABLED, 0))
+        writeTraceRecord(event, id, arg, value, getTimeBaseNanoSeconds());
+}
+
+static inline void traceSpan(uint16_t event, uint16_t id, uint32_t arg, uint64_t start)
+{
+    /*
+     * Trace an operation which started at start (time base ns) and is done now.
+     */
+    if (__builtin_expect(TRACE_ENABLED, 0))
+        writeTraceRecord(event, id, arg, getTimeBaseNanoSeconds() - start, start);
+}
+
+static size_t copyTraceRing(trace_ring_t *ring, trace_record_t *record_list, uint64_t *lost_count)
+{
+    /*
+     * Copy the records of a ring, oldest first, while its thread keeps
+     * tracing. Records overwritten during the copy are dropped.
+     * Return the number of records copied.
+     */
+    uint64_t i, first, head, valid;
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    first = head > TRACE_RING_RECORD_COUNT ? head - TRACE_RING_RECORD_COUNT : 0;
+    for (i = first; i < head; i++)
+        record_list[i - first] = ring->record_list[i & TRACE_RING_MASK];
+    // pairs with the writer's fence before it overwrites a slot
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    // slots overwritten during the copy belong to records older than the head
+    // read now, the writer may be filling the slot of record head - TRACE_RING_RECORD_COUNT + 1
+    valid = __atomic_load_n(&ring->head, __ATOMIC_RELAXED) + 1;
+    valid = valid > TRACE_RING_RECORD_COUNT ? valid - TRACE_RING_RECORD_COUNT : 0;
+    if (valid > first)
+    {
+        if (valid > head)
+            valid = head;
+        memmove(record_list, record_list + (valid - first), (head - valid) * sizeof(trace_record_t));
+        first = valid;
+    }
+    *lost_count = first;
+    return head - first;
+}
+
+static int dumpTrace(FILE *file, uint32_t coupler_id)
+{
+    /*
+     * Write all rings to a file. Return -1 on write error.
+     */
+    static trace_record_t record_list[TRACE_RING_RECORD_COUNT];
+    uint32_t i;
+    uint32_t ring_count = __atomic_load_n(&TRACE_RING_COUNT, __ATOMIC_RELAXED);
+    trace_file_header_t header;
+    trace_ring_header_t ring_header;
+    trace_ring_t *ring_list[TRACE_MAX_RING_COUNT];
+    uint32_t ring_list_length = 0;
+
+    if (ring_count > TRACE_MAX_RING_COUNT)
+        ring_count = TRACE_MAX_RING_COUNT;
+    for (i = 0; i < ring_count; i++)
+    {
+        // a ring being created by its thread is skipped
+        ring_list[ring_list_length] = __atomic_load_n(&TRACE_RING_LIST[i], __ATOMIC_ACQUIRE);
+        if (ring_list[ring_list_length] != NULL)
+            ring_list_length++;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+    header.version = TRACE_FILE_VERSION;
+    header.record_size = sizeof(trace_record_t);
+    header.clock = (uint32_t)TIME_BASE_CLOCK;
+    header.ring_count = ring_list_length;
+    header.coupler_id = coupler_id;
+    header.event_count = TRACE_EVENT_COUNT;
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        return -1;
+
+    for (i = 0; i < ring_list_length; i++)
+    {
+        memset(&ring_header, 0, sizeof(ring_header));
+        ring_header.thread_id = ring_list[i]->thread_id;
+        ring_header.record_count = copyTraceRing(ring_list[i], record_list, &ring_header.lost_count);
+        if (fwrite(&ring_header, sizeof(ring_header), 1, file) != 1 ||
+            fwrite(record_list, sizeof(trace_record_t), ring_header.record_count, file) != ring_header.record_count)
+            return -1;
+    }
+    return 0;
+}
+
+static int dumpTraceFile(const char *path, uint32_t coupler_id)
+{
+    /*
+     * Dump all rings to a file (replaced). Return -1 on error.
+     */
+    int result;
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL)
+        return -1;
+    result = dumpTrace(file, coupler_id);
+    if (fclose(file) != 0)
+        result = -1;
+    return result;
+}
+
+#endif
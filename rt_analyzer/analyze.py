@@ -1,6 +1,7 @@
 """
     Parse logical analyzer logs. Used together with test_latency.c as generator.
     Usage: python3 analyze.py digital.csv
+    For large captures use the streaming analyzer (analyzer.c) instead.
 """
 import sys
 import statistics
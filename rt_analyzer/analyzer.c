@@ -0,0 +1,816 @@
+/*
+ * Analyze logic analyzer captures (digital.csv) of GPIO measurement lines
+ * (coupler "-L", test_latency.c) in one streaming pass, whatever their size.
+ *
+ * For every channel the time between two consecutive edges (0 -> 1 or
+ * 1 -> 0) is measured, like analyze.py does, and summarized with exact
+ * count, min, max, mean and standard deviation (integer sums, 128 bit for
+ * the squares) plus p99 and p99.9
+ * from a log-linear histogram (coupler/metrics.h with 128 sub-buckets per
+ * power of two, below 1% error). Memory use is constant.
+ *
+ * The durations (ms) are also written to coupler<channel>_duration.txt for
+ * the notebooks, unless "-n" is given. Then the durations are also kept in
+ * memory (8 bytes per edge) for the exact median (quickselect), so median and
+ * relative standard deviation are the ones of analyze.py. With "-n" the
+ * median is the histogram's p50 and printed as approximate. Without duration files the capture
+ * can be split into parts analyzed by threads ("-j", default one per CPU),
+ * joined at the part boundaries afterwards.
+ *
+ * Correlation mode ("-c <source>:<target>", repeatable) measures end to
+ * end latency between channels instead, e.g. heart beat sent by coupler0
+ * (channel 0) to received by coupler1 (channel 1), or OPC UA relay write
+ * to relay line. Every source edge is paired with the nearest following
+ * target edge within a window ("-w", us). A source edge followed by
+ * another source edge (or the window's end) before a target edge is
+ * dropped, a target edge without a pending source edge is unmatched. A
+ * channel may be suffixed with "r" or "f" to only take rising or falling
+ * edges ("-c 2r:2f" is the pulse width of channel 2). Latencies are also
+ * written as a cyclictest like histogram of 1 us buckets ("-b" buckets,
+ * one column per correlation) to latency_histogram.txt for
+ * cyclictest_latency_plot.sh. Correlation runs in a single thread.
+ *
+ * Usage: analyzer [-n] [-j <threads>] [-d <directory>]
+ *                 [-c <source>[r|f]:<target>[r|f] [-w <us>] [-b <buckets>]] <digital.csv>
+ *   ./analyzer notebooks/beremiz_runtime_measurements/digital.csv
+ *   ./analyzer -n -c 0:1 -w 10000 notebooks/keep_alive_measurements/digital.csv
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "capture.h"
+// below 1% histogram error (16 KB per histogram)
+#define METRIC_SUB_BUCKET_BITS 7
+#include "../coupler/metrics.h"
+
+// rows handled at once
+#define ROW_BATCH_SIZE 4096
+
+#define MAX_PATH_LENGTH 1024
+
+#define MAX_THREAD_COUNT 64
+
+#define MAX_CORRELATION_COUNT 8
+
+#define DEFAULT_CORRELATION_WINDOW 1000000          // us
+#define DEFAULT_HISTOGRAM_BUCKET_COUNT 400          // us, as cyclictest -h400
+#define MAX_HISTOGRAM_BUCKET_COUNT 1000000
+
+// edges taken on a correlated channel
+#define EDGE_ANY 0
+#define EDGE_RISING 1
+#define EDGE_FALLING 2
+
+typedef struct {
+    metric_histogram_t histogram;
+    int64_t first_edge;                     // ns
+    int64_t last_edge;                      // ns
+    uint64_t edge_count;
+    uint64_t min;
+    unsigned __int128 square_sum;           // ns^2
+    FILE *duration_file;
+    uint64_t *duration_list;                // ns, only with duration files (exact median)
+    uint64_t duration_capacity;
+} channel_statistics_t;
+
+typedef struct {
+    capture_t capture;
+    channel_statistics_t *statistics_list;  // per channel
+    bool empty;
+    uint64_t first_mask;
+    uint64_t last_mask;
+    int64_t first_timestamp;                // ns
+    int64_t last_timestamp;                 // ns
+    pthread_t thread;
+} capture_part_t;
+
+typedef struct {
+    int source_channel;
+    int source_edge;
+    int target_channel;
+    int target_edge;
+    bool pending;                           // a source edge waits for its target edge
+    int64_t pending_source;                 // ns
+    uint64_t source_count;
+    uint64_t target_count;
+    uint64_t dropped_count;                 // source edges without target edge
+    uint64_t unmatched_count;               // target edges without source edge
+    uint64_t overflow_count;                // beyond the histogram
+    channel_statistics_t latency;
+    uint64_t *bucket_list;                  // per us
+} correlation_t;
+
+static bool WRITE_DURATION_FILES = true;
+static char *OUTPUT_DIRECTORY = ".";
+static long THREAD_COUNT = 0;
+
+static correlation_t CORRELATION_LIST[MAX_CORRELATION_COUNT];
+static int CORRELATION_COUNT = 0;
+// all correlated channels
+static uint64_t CORRELATION_CHANNEL_MASK = 0;
+static int64_t CORRELATION_WINDOW = DEFAULT_CORRELATION_WINDOW * 1000LL;   // ns
+static long HISTOGRAM_BUCKET_COUNT = DEFAULT_HISTOGRAM_BUCKET_COUNT;
+
+static inline void writeDuration(FILE *file, uint64_t duration, bool first)
+{
+    /*
+     * Write a duration (ns) in ms with 6 decimals, i.e. exactly.
+     */
+    char text[32];
+    char *p = text + sizeof(text);
+    int i;
+
+    for (i = 0; i < 6; i++)
+    {
+        *--p = '0' + duration % 10;
+        duration /= 10;
+    }
+    *--p = '.';
+    do
+    {
+        *--p = '0' + duration % 10;
+        duration /= 10;
+    } while (duration != 0);
+    if (!first)
+        *--p = '\n';
+    fwrite(p, 1, text + sizeof(text) - p, file);
+}
+
+static void keepDuration(channel_statistics_t *statistics, uint64_t duration, uint64_t count)
+{
+    /*
+     * Append the count-th duration to the list of all durations. On
+     * allocation failure the list is dropped (median from the histogram).
+     */
+    uint64_t *duration_list;
+
+    if (count > statistics->duration_capacity)
+    {
+        if (count > 1 && statistics->duration_list == NULL)
+            return;
+        statistics->duration_capacity = statistics->duration_capacity ? statistics->duration_capacity * 2 : 65536;
+        duration_list = (uint64_t *)realloc(statistics->duration_list,
+                                            statistics->duration_capacity * sizeof(uint64_t));
+        if (duration_list == NULL)
+        {
+            fprintf(stderr, "Out of memory for the exact median, using the histogram\n");
+            free(statistics->duration_list);
+            statistics->duration_list = NULL;
+            return;
+        }
+        statistics->duration_list = duration_list;
+    }
+    statistics->duration_list[count - 1] = duration;
+}
+
+static uint64_t selectDuration(uint64_t *duration_list, uint64_t count, uint64_t k)
+{
+    /*
+     * Return the k-th smallest duration (quickselect, Hoare partition).
+     * Reorders the list: afterwards no duration before k is larger.
+     */
+    uint64_t left = 0, right = count - 1;
+    uint64_t i, j, pivot, swap;
+
+    while (left < right)
+    {
+        pivot = duration_list[left + (right - left) / 2];
+        i = left;
+        j = right;
+        while (i <= j)
+        {
+            while (duration_list[i] < pivot)
+                i++;
+            while (duration_list[j] > pivot)
+                j--;
+            if (i <= j)
+            {
+                swap = duration_list[i];
+                duration_list[i] = duration_list[j];
+                duration_list[j] = swap;
+                i++;
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+        if (k <= j)
+            right = j;
+        else if (k >= i)
+            left = i;
+        else
+            break;
+    }
+    return duration_list[k];
+}
+
+static double getExactMedian(channel_statistics_t *statistics)
+{
+    /*
+     * Median (ns) as statistics.median: the mean of the two middle
+     * durations for an even count.
+     */
+    uint64_t count = statistics->histogram.count;
+    uint64_t upper, lower, i;
+
+    upper = selectDuration(statistics->duration_list, count, count / 2);
+    if (count % 2)
+        return upper;
+    // the lower middle is the largest of the lower half
+    lower = statistics->duration_list[0];
+    for (i = 1; i < count / 2; i++)
+    {
+        if (statistics->duration_list[i] > lower)
+            lower = statistics->duration_list[i];
+    }
+    return (lower + (double)upper) / 2;
+}
+
+static inline void recordDuration(channel_statistics_t *statistics, uint64_t duration)
+{
+    /*
+     * Add the time between two edges (ns).
+     */
+    uint64_t count = statistics->histogram.count + 1;
+
+    // the histogram keeps count, sum and max
+    recordMetric(&statistics->histogram, duration);
+    if (count == 1 || duration < statistics->min)
+        statistics->min = duration;
+    statistics->square_sum += (unsigned __int128)duration * duration;
+    if (statistics->duration_file != NULL)
+    {
+        writeDuration(statistics->duration_file, duration, count == 1);
+        keepDuration(statistics, duration, count);
+    }
+}
+
+static inline void recordEdge(channel_statistics_t *statistics, int64_t timestamp)
+{
+    // the first edge only starts the measurement, equal timestamps are no duration
+    if (statistics->edge_count == 0)
+        statistics->first_edge = timestamp;
+    else if (timestamp > statistics->last_edge)
+        recordDuration(statistics, timestamp - statistics->last_edge);
+    statistics->last_edge = timestamp;
+    statistics->edge_count++;
+}
+
+static void analyzeEdgeRowList(capture_part_t *part, const capture_row_t *row_list, size_t length)
+{
+    size_t i;
+    uint64_t changed;
+    uint64_t previous_mask = part->last_mask;
+    channel_statistics_t *statistics_list = part->statistics_list;
+
+    if (length == 0)
+        return;
+    i = 0;
+    if (part->empty)
+    {
+        // the first row gives the initial state
+        part->empty = false;
+        part->first_mask = row_list[0].value_mask;
+        part->first_timestamp = row_list[0].timestamp;
+        previous_mask = row_list[0].value_mask;
+        i = 1;
+    }
+    for (; i < length; i++)
+    {
+        changed = row_list[i].value_mask ^ previous_mask;
+        previous_mask = row_list[i].value_mask;
+        while (changed != 0)
+        {
+            recordEdge(&statistics_list[__builtin_ctzll(changed)], row_list[i].timestamp);
+            changed &= changed - 1;
+        }
+    }
+    part->last_mask = previous_mask;
+    part->last_timestamp = row_list[length - 1].timestamp;
+}
+
+static int parseCorrelationChannel(const char *text, char **end, int *channel, int *edge)
+{
+    /*
+     * Parse <channel>[r|f]. Return -1 if not a channel.
+     */
+    long number = strtol(text, end, 10);
+
+    if (*end == text || number < 0 || number >= CAPTURE_MAX_CHANNEL_COUNT)
+        return -1;
+    *channel = (int)number;
+    *edge = EDGE_ANY;
+    if (**end == 'r' || **end == 'f')
+        *edge = *(*end)++ == 'r' ? EDGE_RISING : EDGE_FALLING;
+    return 0;
+}
+
+static int addCorrelation(const char *text)
+{
+    /*
+     * Add a correlation <source>[r|f]:<target>[r|f].
+     * Return -1 if invalid or too many.
+     */
+    char *end;
+    correlation_t *correlation = &CORRELATION_LIST[CORRELATION_COUNT];
+
+    if (CORRELATION_COUNT == MAX_CORRELATION_COUNT)
+        return -1;
+    if (parseCorrelationChannel(text, &end, &correlation->source_channel, &correlation->source_edge) < 0 ||
+        *end != ':' ||
+        parseCorrelationChannel(end + 1, &end, &correlation->target_channel, &correlation->target_edge) < 0 ||
+        *end != '\0')
+        return -1;
+    // an edge can not be its own target
+    if (correlation->source_channel == correlation->target_channel &&
+        (correlation->source_edge == EDGE_ANY || correlation->source_edge == correlation->target_edge))
+        return -1;
+    CORRELATION_CHANNEL_MASK |= 1ULL << correlation->source_channel | 1ULL << correlation->target_channel;
+    CORRELATION_COUNT++;
+    return 0;
+}
+
+static inline bool isCorrelationEdge(uint64_t changed, uint64_t rising, int channel, int edge)
+{
+    uint64_t mask = 1ULL << channel;
+
+    if (!(changed & mask))
+        return false;
+    return edge == EDGE_ANY || (edge == EDGE_RISING) == ((rising & mask) != 0);
+}
+
+static void correlateSourceEdge(correlation_t *correlation, int64_t timestamp)
+{
+    correlation->source_count++;
+    // the previous one got no target edge
+    if (correlation->pending)
+        correlation->dropped_count++;
+    correlation->pending = true;
+    correlation->pending_source = timestamp;
+}
+
+static void correlateTargetEdge(correlation_t *correlation, int64_t timestamp)
+{
+    uint64_t latency;
+
+    correlation->target_count++;
+    if (!correlation->pending)
+    {
+        correlation->unmatched_count++;
+        return;
+    }
+    correlation->pending = false;
+    latency = timestamp - correlation->pending_source;
+    if ((int64_t)latency > CORRELATION_WINDOW)
+    {
+        correlation->dropped_count++;
+        correlation->unmatched_count++;
+        return;
+    }
+    if (correlation->latency.histogram.count == 0 || latency < correlation->latency.min)
+        correlation->latency.min = latency;
+    recordMetric(&correlation->latency.histogram, latency);
+    correlation->latency.square_sum += (unsigned __int128)latency * latency;
+    if (latency / 1000 < (uint64_t)HISTOGRAM_BUCKET_COUNT)
+        correlation->bucket_list[latency / 1000]++;
+    else
+        correlation->overflow_count++;
+}
+
+static void correlateEdgeRowList(const capture_part_t *part, const capture_row_t *row_list, size_t length)
+{
+    /*
+     * Pair the edges of the correlated channels, before the rows are
+     * analyzed (part still holds the state before them).
+     */
+    size_t i;
+    int j;
+    uint64_t changed;
+    uint64_t rising;
+    uint64_t previous_mask = part->last_mask;
+    correlation_t *correlation;
+
+    if (length == 0)
+        return;
+    i = 0;
+    if (part->empty)
+    {
+        previous_mask = row_list[0].value_mask;
+        i = 1;
+    }
+    for (; i < length; i++)
+    {
+        changed = (row_list[i].value_mask ^ previous_mask) & CORRELATION_CHANNEL_MASK;
+        previous_mask = row_list[i].value_mask;
+        if (changed == 0)
+            continue;
+        rising = changed & row_list[i].value_mask;
+        for (j = 0; j < CORRELATION_COUNT; j++)
+        {
+            // a source and a target edge at once is a latency of 0
+            correlation = &CORRELATION_LIST[j];
+            if (isCorrelationEdge(changed, rising, correlation->source_channel, correlation->source_edge))
+                correlateSourceEdge(correlation, row_list[i].timestamp);
+            if (isCorrelationEdge(changed, rising, correlation->target_channel, correlation->target_edge))
+                correlateTargetEdge(correlation, row_list[i].timestamp);
+        }
+    }
+}
+
+static void *analyzeCapturePart(void *argument)
+{
+    /*
+     * Analyze all rows of a part (thread).
+     */
+    capture_part_t *part = (capture_part_t *)argument;
+    static __thread capture_row_t row_list[ROW_BATCH_SIZE];
+    size_t length;
+
+    while ((length = readCaptureRowList(&part->capture, row_list, ROW_BATCH_SIZE)) > 0)
+    {
+        if (CORRELATION_COUNT > 0)
+            correlateEdgeRowList(part, row_list, length);
+        analyzeEdgeRowList(part, row_list, length);
+    }
+    return NULL;
+}
+
+static void mergeCapturePart(capture_part_t *result, const capture_part_t *part, int channel_count)
+{
+    /*
+     * Append the statistics of the part following result: the first row of
+     * part is an edge of all channels changed since the last row of result,
+     * the first edge of a channel in part ends the last one in result.
+     */
+    int channel;
+    unsigned int bucket;
+    uint64_t changed;
+    channel_statistics_t *statistics;
+    const channel_statistics_t *part_statistics;
+
+    result->capture.row_count += part->capture.row_count;
+    result->capture.invalid_row_count += part->capture.invalid_row_count;
+    if (part->empty)
+        return;
+    if (result->empty)
+    {
+        result->empty = false;
+        result->first_mask = part->first_mask;
+        result->first_timestamp = part->first_timestamp;
+        changed = 0;
+    }
+    else
+        changed = part->first_mask ^ result->last_mask;
+
+    for (channel = 0; channel < channel_count; channel++)
+    {
+        statistics = &result->statistics_list[channel];
+        part_statistics = &part->statistics_list[channel];
+        if (changed & (1ULL << channel))
+            recordEdge(statistics, part->first_timestamp);
+        if (part_statistics->edge_count == 0)
+            continue;
+        recordEdge(statistics, part_statistics->first_edge);
+        statistics->edge_count += part_statistics->edge_count - 1;
+        statistics->last_edge = part_statistics->last_edge;
+        if (part_statistics->histogram.count == 0)
+            continue;
+        if (statistics->histogram.count == 0 || part_statistics->min < statistics->min)
+            statistics->min = part_statistics->min;
+        statistics->square_sum += part_statistics->square_sum;
+        statistics->histogram.count += part_statistics->histogram.count;
+        statistics->histogram.sum += part_statistics->histogram.sum;
+        if (part_statistics->histogram.max > statistics->histogram.max)
+            statistics->histogram.max = part_statistics->histogram.max;
+        for (bucket = 0; bucket < METRIC_BUCKET_COUNT; bucket++)
+            statistics->histogram.bucket_list[bucket] += part_statistics->histogram.bucket_list[bucket];
+    }
+    result->last_mask = part->last_mask;
+    result->last_timestamp = part->last_timestamp;
+}
+
+static int analyzeCapture(capture_t *capture, capture_part_t *result, int part_count)
+{
+    /*
+     * Analyze a capture in part_count parts, one thread each, into result.
+     * Return -1 if a thread can not be started.
+     */
+    int i;
+    int error = 0;
+    capture_t capture_list[MAX_THREAD_COUNT];
+    capture_part_t *part_list = (capture_part_t *)calloc(part_count, sizeof(capture_part_t));
+
+    if (part_list == NULL)
+        return -1;
+    splitCapture(capture, capture_list, part_count);
+    for (i = 0; i < part_count; i++)
+    {
+        part_list[i].capture = capture_list[i];
+        part_list[i].empty = true;
+        part_list[i].statistics_list = i == 0 ? result->statistics_list :
+            (channel_statistics_t *)calloc(capture->channel_count, sizeof(channel_statistics_t));
+        if (part_list[i].statistics_list == NULL)
+        {
+            part_count = i;
+            error = -1;
+            break;
+        }
+    }
+    if (error == 0 && part_count == 1)
+        analyzeCapturePart(&part_list[0]);
+    else if (error == 0)
+    {
+        for (i = 0; i < part_count; i++)
+        {
+            if (pthread_create(&part_list[i].thread, NULL, analyzeCapturePart, &part_list[i]) != 0)
+            {
+                perror("pthread_create");
+                error = -1;
+                break;
+            }
+        }
+        while (i-- > 0)
+            pthread_join(part_list[i].thread, NULL);
+    }
+
+    if (error == 0)
+    {
+        *result = part_list[0];
+        for (i = 1; i < part_count; i++)
+            mergeCapturePart(result, &part_list[i], capture->channel_count);
+    }
+    for (i = 1; i < part_count; i++)
+        free(part_list[i].statistics_list);
+    free(part_list);
+    return error;
+}
+
+static int openDurationFileList(channel_statistics_t *statistics_list, int channel_count)
+{
+    int channel;
+    char path[MAX_PATH_LENGTH];
+
+    for (channel = 0; channel < channel_count; channel++)
+    {
+        snprintf(path, sizeof(path), "%s/coupler%d_duration.txt", OUTPUT_DIRECTORY, channel);
+        statistics_list[channel].duration_file = fopen(path, "w");
+        if (statistics_list[channel].duration_file == NULL)
+        {
+            perror(path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void closeDurationFileList(channel_statistics_t *statistics_list, int channel_count)
+{
+    int channel;
+
+    for (channel = 0; channel < channel_count; channel++)
+    {
+        if (statistics_list[channel].duration_file != NULL)
+            fclose(statistics_list[channel].duration_file);
+        statistics_list[channel].duration_file = NULL;
+    }
+}
+
+static double getStandardDeviation(const channel_statistics_t *statistics)
+{
+    /*
+     * Sample standard deviation (ns).
+     */
+    long double count = statistics->histogram.count;
+    long double sum = statistics->histogram.sum;
+
+    if (statistics->histogram.count < 2)
+        return 0.0;
+    return sqrtl(((long double)statistics->square_sum - sum * sum / count) / (count - 1));
+}
+
+static void printDurationStatistics(channel_statistics_t *statistics)
+{
+    const metric_histogram_t *histogram = &statistics->histogram;
+    double stdev;
+    double median;
+    bool exact;
+
+    if (histogram->count == 0)
+        return;
+    stdev = getStandardDeviation(statistics);
+    exact = statistics->duration_list != NULL;
+    median = (exact ? getExactMedian(statistics) : getMetricPercentile(histogram, 50.0)) / 1e6;
+    printf("\tMean =   %.5f\n", (double)histogram->sum / histogram->count / 1e6);
+    printf("\tMedian = %.5f%s\n", median, exact ? "" : " (approximate, histogram)");
+    printf("\tMin =    %.5f\n", statistics->min / 1e6);
+    printf("\tMax =    %.5f\n", histogram->max / 1e6);
+    printf("\tStandart deviation = %.5f\n", stdev / 1e6);
+    printf("\tStandart deviation (%%) = %.5f\n", median > 0 ? stdev / 1e6 * 100 / median : 0.0);
+    printf("\tP99 =    %.5f\n", getMetricPercentile(histogram, 99.0) / 1e6);
+    printf("\tP99.9 =  %.5f\n", getMetricPercentile(histogram, 99.9) / 1e6);
+}
+
+static void printChannelStatistics(const capture_t *capture, channel_statistics_t *statistics, int channel)
+{
+    printf("\n%s (in milli seconds):\n", capture->channel_name_list[channel]);
+    printf("\tEdges =  %llu\n", (unsigned long long)statistics->edge_count);
+    printDurationStatistics(statistics);
+}
+
+static const char *getEdgeName(int edge)
+{
+    return edge == EDGE_RISING ? " rising" : edge == EDGE_FALLING ? " falling" : "";
+}
+
+static void printCorrelation(const capture_t *capture, correlation_t *correlation)
+{
+    printf("\n%s%s -> %s%s latency (in milli seconds):\n",
+           capture->channel_name_list[correlation->source_channel], getEdgeName(correlation->source_edge),
+           capture->channel_name_list[correlation->target_channel], getEdgeName(correlation->target_edge));
+    printf("\tSource edges = %llu\n", (unsigned long long)correlation->source_count);
+    printf("\tTarget edges = %llu\n", (unsigned long long)correlation->target_count);
+    printf("\tMatched = %llu\n", (unsigned long long)correlation->latency.histogram.count);
+    printf("\tDropped (source without target) = %llu\n", (unsigned long long)correlation->dropped_count);
+    printf("\tUnmatched (target without source) = %llu\n", (unsigned long long)correlation->unmatched_count);
+    printDurationStatistics(&correlation->latency);
+}
+
+static int writeLatencyHistogram(const char *path)
+{
+    /*
+     * Write the latencies of all correlations like cyclictest -h does (one
+     * line per us, one column per correlation, summary as comments).
+     */
+    long i;
+    int j;
+    const correlation_t *correlation;
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    fprintf(file, "# Histogram\n");
+    for (i = 0; i < HISTOGRAM_BUCKET_COUNT; i++)
+    {
+        fprintf(file, "%06ld", i);
+        for (j = 0; j < CORRELATION_COUNT; j++)
+            fprintf(file, " %06llu", (unsigned long long)CORRELATION_LIST[j].bucket_list[i]);
+        fprintf(file, "\n");
+    }
+    fprintf(file, "# Total:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %09llu", (unsigned long long)CORRELATION_LIST[j].latency.histogram.count);
+    fprintf(file, "\n# Min Latencies:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+    {
+        correlation = &CORRELATION_LIST[j];
+        fprintf(file, " %05llu", (unsigned long long)(correlation->latency.histogram.count > 0 ?
+                                                      correlation->latency.min / 1000 : 0));
+    }
+    fprintf(file, "\n# Avg Latencies:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %05llu", (unsigned long long)(getMetricMean(&CORRELATION_LIST[j].latency.histogram) / 1000));
+    fprintf(file, "\n# Max Latencies:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %05llu", (unsigned long long)(CORRELATION_LIST[j].latency.histogram.max / 1000));
+    fprintf(file, "\n# Histogram Overflows:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %05llu", (unsigned long long)CORRELATION_LIST[j].overflow_count);
+    fprintf(file, "\n# Dropped:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %05llu", (unsigned long long)CORRELATION_LIST[j].dropped_count);
+    fprintf(file, "\n# Unmatched:");
+    for (j = 0; j < CORRELATION_COUNT; j++)
+        fprintf(file, " %05llu", (unsigned long long)CORRELATION_LIST[j].unmatched_count);
+    fprintf(file, "\n");
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int option;
+    int channel;
+    int i;
+    int part_count;
+    capture_t capture;
+    capture_part_t result;
+    static channel_statistics_t statistics_list[CAPTURE_MAX_CHANNEL_COUNT];
+    uint64_t start, elapsed;
+    char path[MAX_PATH_LENGTH];
+    const char *usage = "Usage: %s [-n] [-j <threads>] [-d <directory>]\n"
+                        "\t[-c <source>[r|f]:<target>[r|f] [-w <us>] [-b <buckets>]] <digital.csv>\n";
+
+    while ((option = getopt(argc, argv, "nj:d:c:w:b:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            WRITE_DURATION_FILES = false;
+            break;
+        case 'j':
+            THREAD_COUNT = atol(optarg);
+            break;
+        case 'd':
+            OUTPUT_DIRECTORY = optarg;
+            break;
+        case 'c':
+            if (addCorrelation(optarg) < 0)
+            {
+                fprintf(stderr, "Invalid correlation: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            CORRELATION_WINDOW = atoll(optarg) * 1000LL;
+            break;
+        case 'b':
+            HISTOGRAM_BUCKET_COUNT = atol(optarg);
+            if (HISTOGRAM_BUCKET_COUNT < 1 || HISTOGRAM_BUCKET_COUNT > MAX_HISTOGRAM_BUCKET_COUNT)
+            {
+                fprintf(stderr, "Invalid histogram bucket count: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            fprintf(stderr, usage, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (openCapture(&capture, argv[optind]) < 0)
+        return EXIT_FAILURE;
+    for (i = 0; i < CORRELATION_COUNT; i++)
+    {
+        if (CORRELATION_LIST[i].source_channel >= capture.channel_count ||
+            CORRELATION_LIST[i].target_channel >= capture.channel_count)
+        {
+            fprintf(stderr, "Correlation %d: no such channel\n", i);
+            closeCapture(&capture);
+            return EXIT_FAILURE;
+        }
+        CORRELATION_LIST[i].bucket_list = (uint64_t *)calloc(HISTOGRAM_BUCKET_COUNT, sizeof(uint64_t));
+        if (CORRELATION_LIST[i].bucket_list == NULL)
+        {
+            closeCapture(&capture);
+            return EXIT_FAILURE;
+        }
+    }
+    if (WRITE_DURATION_FILES && openDurationFileList(statistics_list, capture.channel_count) < 0)
+    {
+        closeDurationFileList(statistics_list, capture.channel_count);
+        closeCapture(&capture);
+        return EXIT_FAILURE;
+    }
+
+    // duration files are written and edges correlated in capture order, by one thread
+    if (THREAD_COUNT <= 0)
+        THREAD_COUNT = sysconf(_SC_NPROCESSORS_ONLN);
+    part_count = WRITE_DURATION_FILES || CORRELATION_COUNT > 0 || THREAD_COUNT < 1 ? 1 :
+                 THREAD_COUNT > MAX_THREAD_COUNT ? MAX_THREAD_COUNT : (int)THREAD_COUNT;
+    result.statistics_list = statistics_list;
+    start = getMonotonicNanoSeconds();
+    if (analyzeCapture(&capture, &result, part_count) < 0)
+    {
+        closeDurationFileList(statistics_list, capture.channel_count);
+        closeCapture(&capture);
+        return EXIT_FAILURE;
+    }
+    elapsed = getMonotonicNanoSeconds() - start;
+    closeDurationFileList(statistics_list, capture.channel_count);
+
+    printf("Timestamp records = %llu\n", (unsigned long long)result.capture.row_count);
+    printf("Duration (seconds) = %.9f\n",
+           result.empty ? 0.0 : (result.last_timestamp - result.first_timestamp) / 1e9);
+    if (result.capture.invalid_row_count > 0)
+        printf("Invalid records = %llu\n", (unsigned long long)result.capture.invalid_row_count);
+    for (channel = 0; channel < capture.channel_count; channel++)
+    {
+        printChannelStatistics(&capture, &statistics_list[channel], channel);
+        free(statistics_list[channel].duration_list);
+    }
+    for (i = 0; i < CORRELATION_COUNT; i++)
+        printCorrelation(&capture, &CORRELATION_LIST[i]);
+    if (CORRELATION_COUNT > 0)
+    {
+        snprintf(path, sizeof(path), "%s/latency_histogram.txt", OUTPUT_DIRECTORY);
+        writeLatencyHistogram(path);
+    }
+    fprintf(stderr, "\nParsed %.1f MB in %.3f s (%.1f MB/s, %d thread(s))\n", capture.size / 1e6,
+            elapsed / 1e9, elapsed > 0 ? capture.size * 1e3 / elapsed : 0.0, part_count);
+    for (i = 0; i < CORRELATION_COUNT; i++)
+        free(CORRELATION_LIST[i].bucket_list);
+    closeCapture(&capture);
+    return EXIT_SUCCESS;
+}
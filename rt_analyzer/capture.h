@@ -0,0 +1,412 @@
+/*
+ * Streaming reader of logic analyzer captures (CSV exported by Saleae Logic):
+ *
+ *   Time [s],Channel 0,Channel 1
+ *   0.000000000,0,1
+ *   0.008751760,0,0
+ *
+ * The file is mmap()ed and scanned once. Separators (',' and '\n') of 64
+ * bytes are found at once, with SSE2 where available and 8 bytes per word
+ * (SWAR) otherwise, then fields are visited separator to separator.
+ * Timestamps are converted to integer ns without strtod() (exact, 8
+ * fractional digits at a time), channel values to one bit per channel.
+ *
+ * Rows are returned in batches so memory use does not depend on the
+ * capture's size. A capture can be split at line boundaries into parts
+ * read independently (one per thread).
+ */
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CAPTURE_BLOCK_SIZE 64
+// one bit per channel
+#define CAPTURE_MAX_CHANNEL_COUNT 64
+#define CAPTURE_MAX_CHANNEL_NAME_LENGTH 32
+
+typedef struct {
+    int64_t timestamp;                      // ns
+    uint64_t value_mask;                    // bit per channel
+} capture_row_t;
+
+typedef struct {
+    const char *data;
+    size_t size;
+    int channel_count;
+    char channel_name_list[CAPTURE_MAX_CHANNEL_COUNT][CAPTURE_MAX_CHANNEL_NAME_LENGTH];
+    // scan state
+    size_t position;                        // first byte of the current block
+    uint64_t mask;                          // separators of the block not yet visited
+    const char *field;                      // first byte of the current field
+    unsigned int field_index;
+    int64_t timestamp;
+    uint64_t value_mask;
+    bool done;
+    // statistics
+    uint64_t row_count;
+    uint64_t invalid_row_count;             // too few fields or invalid timestamp
+} capture_t;
+
+static inline uint64_t getByteEqualMask(uint64_t word, uint64_t pattern)
+{
+    /*
+     * 0x80 in every byte of word equal to the byte of pattern (exact).
+     */
+    uint64_t t = word ^ pattern;
+    return ~(((t & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | t | 0x7F7F7F7F7F7F7F7FULL);
+}
+
+static inline uint64_t getSeparatorMask(const char *block)
+{
+    /*
+     * Bit i set if block[i] is ',' or '\n' (64 bytes readable).
+     */
+    uint64_t mask = 0;
+    int i;
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    __m128i bytes;
+
+    for (i = 0; i < CAPTURE_BLOCK_SIZE / 16; i++)
+    {
+        bytes = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+        bytes = _mm_or_si128(_mm_cmpeq_epi8(bytes, comma), _mm_cmpeq_epi8(bytes, newline));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(bytes) << (16 * i);
+    }
+#else
+    uint64_t word, found;
+
+    for (i = 0; i < CAPTURE_BLOCK_SIZE / 8; i++)
+    {
+        memcpy(&word, block + 8 * i, 8);
+        found = getByteEqualMask(word, 0x2C2C2C2C2C2C2C2CULL) | getByteEqualMask(word, 0x0A0A0A0A0A0A0A0AULL);
+        // gather the top bit of each byte (little endian)
+        mask |= (((found >> 7) * 0x0102040810204080ULL) >> 56) << (8 * i);
+    }
+#endif
+    return mask;
+}
+
+static uint64_t getTailSeparatorMask(const char *block, size_t length)
+{
+    uint64_t mask = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (block[i] == ',' || block[i] == '\n')
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+static inline bool parseEightDigits(const char *p, uint32_t *number)
+{
+    /*
+     * Convert 8 ASCII digits to a number (little endian SWAR).
+     * Return false if they are not all digits.
+     */
+    uint64_t word;
+
+    memcpy(&word, p, 8);
+    if ((((word + 0x4646464646464646ULL) | (word - 0x3030303030303030ULL)) & 0x8080808080808080ULL) != 0)
+        return false;
+    word -= 0x3030303030303030ULL;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+            (((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    *number = (uint32_t)word;
+    return true;
+}
+
+static int parseSlowTimestamp(const char *begin, const char *end, int64_t *timestamp)
+{
+    /*
+     * Exponent notation and the like, through strtod().
+     */
+    char buffer[64];
+    char *eptr;
+    double seconds;
+    size_t length = end - begin;
+
+    if (length >= sizeof(buffer))
+        return -1;
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    seconds = strtod(buffer, &eptr);
+    if (eptr == buffer)
+        return -1;
+    *timestamp = (int64_t)(seconds * 1e9 + (seconds < 0 ? -0.5 : 0.5));
+    return 0;
+}
+
+static inline int parseTimestamp(const char *begin, const char *end, int64_t *timestamp)
+{
+    /*
+     * Convert seconds (i.e. 12.008751760) to ns. Digits beyond ns are
+     * truncated. Return -1 if not a number.
+     */
+    const char *p = begin;
+    bool negative = false;
+    uint64_t seconds = 0;
+    uint64_t fraction = 0;
+    uint64_t scale = 100000000;             // ns of the first fractional digit
+    unsigned int digit;
+    uint32_t digits;
+
+    if (p < end && *p == '-')
+    {
+        negative = true;
+        p++;
+    }
+    if (p == end || (unsigned int)(*p - '0') > 9)
+        return parseSlowTimestamp(begin, end, timestamp);
+    while (p < end && (digit = (unsigned int)(*p - '0')) <= 9)
+    {
+        seconds = seconds * 10 + digit;
+        p++;
+    }
+    if (p < end && *p == '.')
+    {
+        p++;
+        if (end - p >= 8 && parseEightDigits(p, &digits))
+        {
+            // 10 ns units, the next digit is ns
+            fraction = digits * 10ULL;
+            scale = 1;
+            p += 8;
+        }
+        while (p < end && (digit = (unsigned int)(*p - '0')) <= 9)
+        {
+            fraction += digit * scale;
+            scale /= 10;
+            p++;
+        }
+    }
+    // trailing '\r' or spaces are fine, anything else is not a plain number
+    if (p < end && *p != '\r' && *p != ' ')
+        return parseSlowTimestamp(begin, end, timestamp);
+    *timestamp = (int64_t)(seconds * 1000000000ULL + fraction);
+    if (negative)
+        *timestamp = -*timestamp;
+    return 0;
+}
+
+static void seekCapture(capture_t *capture, size_t begin, size_t end)
+{
+    /*
+     * Read rows from begin (a line) up to end.
+     */
+    capture->size = end;
+    capture->position = begin;
+    capture->field = capture->data + begin;
+    capture->field_index = 0;
+    capture->row_count = 0;
+    capture->invalid_row_count = 0;
+    capture->mask = 0;
+    capture->done = begin >= end;
+    if (!capture->done)
+    {
+        capture->mask = begin + CAPTURE_BLOCK_SIZE <= end ?
+                        getSeparatorMask(capture->field) :
+                        getTailSeparatorMask(capture->field, end - begin);
+    }
+}
+
+static int openCapture(capture_t *capture, const char *path)
+{
+    /*
+     * Map a capture and parse its header. Return -1 on error.
+     */
+    int fd;
+    struct stat st;
+    const char *header_end;
+    const char *p;
+    const char *name;
+    size_t length;
+
+    memset(capture, 0, sizeof(*capture));
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    capture->size = st.st_size;
+    if (capture->size == 0)
+    {
+        fprintf(stderr, "%s: empty\n", path);
+        close(fd);
+        return -1;
+    }
+    capture->data = (const char *)mmap(NULL, capture->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (capture->data == MAP_FAILED)
+    {
+        perror(path);
+        return -1;
+    }
+    madvise((void *)capture->data, capture->size, MADV_SEQUENTIAL);
+
+    // header: Time [s],<channel name>,..
+    header_end = (const char *)memchr(capture->data, '\n', capture->size);
+    if (header_end == NULL)
+        header_end = capture->data + capture->size;
+    p = (const char *)memchr(capture->data, ',', header_end - capture->data);
+    while (p != NULL && capture->channel_count < CAPTURE_MAX_CHANNEL_COUNT)
+    {
+        name = p + 1;
+        p = (const char *)memchr(name, ',', header_end - name);
+        length = (p != NULL ? p : header_end) - name;
+        while (length > 0 && (name[length - 1] == '\r' || name[length - 1] == ' '))
+            length--;
+        if (length >= CAPTURE_MAX_CHANNEL_NAME_LENGTH)
+            length = CAPTURE_MAX_CHANNEL_NAME_LENGTH - 1;
+        memcpy(capture->channel_name_list[capture->channel_count], name, length);
+        capture->channel_count++;
+    }
+    if (capture->channel_count == 0)
+    {
+        fprintf(stderr, "%s: no channel in header\n", path);
+        munmap((void *)capture->data, capture->size);
+        return -1;
+    }
+
+    seekCapture(capture, header_end - capture->data + 1, capture->size);
+    return 0;
+}
+
+static void splitCapture(const capture_t *capture, capture_t *part_list, int part_count)
+{
+    /*
+     * Split the rows of a capture (not yet read) into parts of about the
+     * same size, each beginning at a line.
+     */
+    int i;
+    size_t begin = capture->position;
+    size_t end;
+    const char *newline;
+
+    for (i = 0; i < part_count; i++)
+    {
+        end = capture->position + (capture->size - capture->position) * (i + 1) / part_count;
+        if (end < begin)
+            end = begin;
+        if (i == part_count - 1)
+            end = capture->size;
+        else if (end > 0 && end < capture->size)
+        {
+            newline = (const char *)memchr(capture->data + end - 1, '\n', capture->size - end + 1);
+            end = newline != NULL ? newline - capture->data + 1 : capture->size;
+        }
+        part_list[i] = *capture;
+        seekCapture(&part_list[i], begin, end);
+        begin = end;
+    }
+}
+
+static void closeCapture(capture_t *capture)
+{
+    if (capture->data != NULL)
+        munmap((void *)capture->data, capture->size);
+    capture->data = NULL;
+}
+
+static inline bool endCaptureField(capture_t *capture, const char *end)
+{
+    /*
+     * Handle the field ending at end. Return true if it ends a valid row.
+     */
+    bool row = false;
+    unsigned int index = capture->field_index;
+
+    if (index == 0)
+    {
+        if (parseTimestamp(capture->field, end, &capture->timestamp) < 0)
+            capture->field_index = CAPTURE_MAX_CHANNEL_COUNT + 1;   // invalid row
+        else
+            capture->field_index = 1;
+        capture->value_mask = 0;
+    }
+    else if (index <= (unsigned int)capture->channel_count)
+    {
+        capture->value_mask |= (uint64_t)(capture->field < end && *capture->field == '1') << (index - 1);
+        capture->field_index++;
+    }
+
+    if (end == capture->data + capture->size || *end == '\n')
+    {
+        if (capture->field_index == (unsigned int)capture->channel_count + 1)
+        {
+            capture->row_count++;
+            row = true;
+        }
+        else if (index > 0 || end > capture->field)
+        {
+            // not an empty line
+            capture->invalid_row_count++;
+        }
+        capture->field_index = 0;
+    }
+    capture->field = end + 1;
+    return row;
+}
+
+static size_t readCaptureRowList(capture_t *capture, capture_row_t *row_list, size_t size)
+{
+    /*
+     * Read up to size rows. Return the number of rows read, 0 at the end.
+     */
+    size_t length = 0;
+    const char *end;
+
+    while (length < size && !capture->done)
+    {
+        if (capture->mask == 0)
+        {
+            capture->position += CAPTURE_BLOCK_SIZE;
+            if (capture->position >= capture->size)
+            {
+                // last line without a newline
+                capture->done = true;
+                if (capture->field < capture->data + capture->size &&
+                    endCaptureField(capture, capture->data + capture->size))
+                {
+                    row_list[length].timestamp = capture->timestamp;
+                    row_list[length++].value_mask = capture->value_mask;
+                }
+                break;
+            }
+            capture->mask = capture->position + CAPTURE_BLOCK_SIZE <= capture->size ?
+                            getSeparatorMask(capture->data + capture->position) :
+                            getTailSeparatorMask(capture->data + capture->position,
+                                                 capture->size - capture->position);
+            continue;
+        }
+        end = capture->data + capture->position + __builtin_ctzll(capture->mask);
+        capture->mask &= capture->mask - 1;
+        if (endCaptureField(capture, end))
+        {
+            row_list[length].timestamp = capture->timestamp;
+            row_list[length++].value_mask = capture->value_mask;
+        }
+    }
+    return length;
+}
+
+#endif
@@ -2,14 +2,22 @@
 
 # based on https://www.osadl.org/Create-a-latency-plot-from-cyclictest-hi.bash-script-for-latency-plot.0.html
 # generate latency plot for Lime2
-
-cyclictest -l100000000 -m -Sp90 -i200 -h400 -q >output
+# or of an existing histogram, e.g. of correlated channels (analyzer -c ..):
+#   ./cyclictest_latency_plot.sh latency_histogram.txt <columns>
+
+if test -n "$1"
+then
+  cp "$1" output
+  cores=${2:-1}
+else
+  cyclictest -l100000000 -m -Sp90 -i200 -h400 -q >output
+  cores=2
+fi
 
 max=`grep "Max Latencies" output | tr " " "\n" | sort -n | tail -1 | sed s/^0*//`
 
 grep -v -e "^#" -e "^$" output | tr " " "\t" >histogram
-
-cores=2
+range=`wc -l <histogram`
 
 for i in `seq 1 $cores`
 do
@@ -21,7 +29,7 @@ echo -n -e "set title \"Latency plot\"\n\
 set terminal png\n\
 set xlabel \"Latency (us), max $max us\"\n\
 set logscale y\n\
-set xrange [0:400]\n\
+set xrange [0:$range]\n\
 set yrange [0.8:*]\n\
 set ylabel \"Number of latency samples\"\n\
 set output \"plot.png\"\n\
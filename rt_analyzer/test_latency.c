@@ -3,7 +3,13 @@
 #include <string.h>
 /*
  * Simple C program which tests system latency by writing every cycle 1 or 0
- * to respective GPIO (configured to STMP157-OLinuXino-LIME2 with STMP15X-SHIELD)
+ * to respective GPIOs (configured to STMP157-OLinuXino-LIME2 with STMP15X-SHIELD)
+ *
+ * All lines are requested once (GPIO v2 character device API) and toggled
+ * together with one ioctl per cycle.
+ *
+ * Usage: ./test_latency [chip] [comma separated line offsets] [cycles]
+ *   ./test_latency /dev/gpiochip1 7 100000000
  */
 #include <stdint.h>
 #include <unistd.h>
@@ -11,49 +17,55 @@
 #include <sys/ioctl.h>
 #include <linux/gpio.h>
 
-int main() {
+int main(int argc, char **argv) {
 	int fd;
-	struct gpiohandle_request led;
-	struct gpiohandle_data data;
+	long i;
+	char *token;
+	struct gpio_v2_line_request request;
+	struct gpio_v2_line_values data;
+	char *chip = argc > 1 ? argv[1] : "/dev/gpiochip1";
+	char offsets[128] = "7";
+	long cycles = argc > 3 ? atol(argv[3]) : 100000000;
 
 	 /* Schema
 	 * GND: pin 2
-	 *    : pin 9
+	 * line 7: pin 9
 	 * */
 
-	fd = open("/dev/gpiochip1", O_RDWR);
+	if (argc > 2) {
+		strncpy(offsets, argv[2], sizeof(offsets) - 1);
+	}
+
+	fd = open(chip, O_RDWR);
 	if(fd < 0) {
 		perror("Error opening gpiochip");
 		return -1;
 	}
 
-	/* Setup LED to output */
-	led.flags = GPIOHANDLE_REQUEST_OUTPUT;
-	strcpy(led.consumer_label, "LED");
-	memset(led.default_values, 0, sizeof(led.default_values));
-	led.lines = 1;
-	led.lineoffsets[0] = 7;
+	/* Setup lines to output */
+	memset(&request, 0, sizeof(request));
+	strcpy(request.consumer, "test_latency");
+	request.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	for (token = strtok(offsets, ","); token != NULL && request.num_lines < GPIO_V2_LINES_MAX;
+	     token = strtok(NULL, ",")) {
+		request.offsets[request.num_lines++] = atoi(token);
+	}
 
-	if(ioctl(fd, GPIO_GET_LINEHANDLE_IOCTL, &led) < 0) {
+	if(ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &request) < 0) {
 		perror("Error setting GPIO to output");
 		close(fd);
 		return -1;
 	}
+	close(fd);
 
-	/* Let's set the LED */
-	int i;
-	int b = 1;
-	for (i=1; i<100000000; ++i) {
-	  data.values[0] = b;
-	  if (b) b = 0;
-	  else b = 1;
-	  if(ioctl(led.fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0) 
-		perror("Error setting GPIO to 1");
-          //printf("b=%d\n", b);
-	  //sleep(2);
+	/* Toggle all lines at once */
+	data.mask = request.num_lines < 64 ? (1ULL << request.num_lines) - 1 : ~0ULL;
+	data.bits = 0;
+	for (i = 1; i < cycles; ++i) {
+	  data.bits ^= data.mask;
+	  if(ioctl(request.fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &data) < 0)
+		perror("Error setting GPIO");
         }
-	// close fds
-	close(fd);
-	close(led.fd);
+	close(request.fd);
 	return 0;
 }
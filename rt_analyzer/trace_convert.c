@@ -0,0 +1,251 @@
+/*
+ * Convert an event trace dump of the coupler (coupler/trace.h, CLI "-E")
+ * to a text format, records of all threads merged in time order:
+ *   - chrome:  Chrome trace JSON (chrome://tracing, https://ui.perfetto.dev),
+ *              spans (I2C, I/O scan, OPC UA callbacks) as complete events
+ *   - csv:     thread,timestamp_ns,event,id,arg,value
+ *   - digital: logic analyzer like CSV (Time [s],Channel 0,..) with one
+ *              channel per given event toggling at each of its records,
+ *              i.e. what GPIO measurement mode would have captured, for
+ *              analyze.py
+ *
+ * Usage: trace_convert <dump> chrome|csv|digital [<event>[:<id>] ..]
+ *   ./trace_convert coupler.trace chrome > coupler.json
+ *   ./trace_convert coupler.trace digital heart_beat_rx:0 heart_beat_rx:1 > digital.csv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../coupler/trace.h"
+
+#define MAX_DIGITAL_CHANNEL_COUNT 16
+
+typedef struct {
+    uint32_t thread_id;
+    trace_record_t record;
+} thread_record_t;
+
+typedef struct {
+    int event;
+    int id;                     // -1 for any
+    int value;
+} digital_channel_t;
+
+static int compareThreadRecord(const void *a, const void *b)
+{
+    uint64_t ta = ((const thread_record_t *)a)->record.timestamp;
+    uint64_t tb = ((const thread_record_t *)b)->record.timestamp;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+static thread_record_t *loadTrace(const char *path, trace_file_header_t *header, size_t *length)
+{
+    /*
+     * Load all records of a dump. Return NULL on error.
+     */
+    uint32_t i, j;
+    size_t size = 0;
+    thread_record_t *record_list = NULL;
+    trace_ring_header_t ring_header;
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        memcmp(header->magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0 ||
+        header->version != TRACE_FILE_VERSION || header->record_size != sizeof(trace_record_t))
+    {
+        fprintf(stderr, "%s: not a trace dump of this version\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    *length = 0;
+    for (i = 0; i < header->ring_count; i++)
+    {
+        if (fread(&ring_header, sizeof(ring_header), 1, file) != 1)
+            goto truncated;
+        if (ring_header.lost_count > 0)
+            fprintf(stderr, "thread %u: %llu older records overwritten\n", ring_header.thread_id,
+                    (unsigned long long)ring_header.lost_count);
+        if (*length + ring_header.record_count > size)
+        {
+            size = (*length + ring_header.record_count) * 2;
+            record_list = (thread_record_t *)realloc(record_list, size * sizeof(thread_record_t));
+            if (record_list == NULL)
+            {
+                fclose(file);
+                return NULL;
+            }
+        }
+        for (j = 0; j < ring_header.record_count; j++)
+        {
+            if (fread(&record_list[*length].record, sizeof(trace_record_t), 1, file) != 1)
+                goto truncated;
+            record_list[(*length)++].thread_id = ring_header.thread_id;
+        }
+    }
+    fclose(file);
+    qsort(record_list, *length, sizeof(thread_record_t), compareThreadRecord);
+    return record_list;
+
+truncated:
+    fprintf(stderr, "%s: truncated\n", path);
+    fclose(file);
+    free(record_list);
+    return NULL;
+}
+
+static const char *getEventName(uint16_t event)
+{
+    return event < TRACE_EVENT_COUNT ? TRACE_EVENT_NAME_LIST[event] : "unknown";
+}
+
+static void writeChromeTrace(const thread_record_t *record_list, size_t length, uint32_t coupler_id)
+{
+    size_t i;
+    const trace_record_t *record;
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (i = 0; i < length; i++)
+    {
+        record = &record_list[i].record;
+        // timestamps in us
+        printf("{\"name\":\"%s\",\"cat\":\"coupler\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,",
+               getEventName(record->event), coupler_id, record_list[i].thread_id, record->timestamp / 1000.0);
+        if (TRACE_IS_SPAN(record->event))
+            printf("\"ph\":\"X\",\"dur\":%.3f,\"args\":{\"id\":%u,\"arg\":%u}}",
+                   record->value / 1000.0, record->id, record->arg);
+        else
+            printf("\"ph\":\"i\",\"s\":\"t\",\"args\":{\"id\":%u,\"arg\":%u,\"value\":%llu}}",
+                   record->id, record->arg, (unsigned long long)record->value);
+        printf(i + 1 < length ? ",\n" : "\n");
+    }
+    printf("]}\n");
+}
+
+static void writeCSV(const thread_record_t *record_list, size_t length)
+{
+    size_t i;
+    const trace_record_t *record;
+
+    printf("thread,timestamp_ns,event,id,arg,value\n");
+    for (i = 0; i < length; i++)
+    {
+        record = &record_list[i].record;
+        printf("%u,%llu,%s,%u,%u,%llu\n", record_list[i].thread_id, (unsigned long long)record->timestamp,
+               getEventName(record->event), record->id, record->arg, (unsigned long long)record->value);
+    }
+}
+
+static int parseDigitalChannel(const char *text, digital_channel_t *channel)
+{
+    /*
+     * Parse <event>[:<id>]. Return -1 on unknown event.
+     */
+    int event;
+    const char *separator = strchr(text, ':');
+    size_t name_length = separator != NULL ? (size_t)(separator - text) : strlen(text);
+
+    for (event = 0; event < TRACE_EVENT_COUNT; event++)
+    {
+        if (strlen(TRACE_EVENT_NAME_LIST[event]) == name_length &&
+            strncmp(TRACE_EVENT_NAME_LIST[event], text, name_length) == 0)
+            break;
+    }
+    if (event == TRACE_EVENT_COUNT)
+        return -1;
+    channel->event = event;
+    channel->id = separator != NULL ? atoi(separator + 1) : -1;
+    channel->value = 0;
+    return 0;
+}
+
+static void writeDigital(const thread_record_t *record_list, size_t length,
+                         digital_channel_t *channel_list, int channel_count)
+{
+    size_t i;
+    int j;
+    bool changed;
+    const trace_record_t *record;
+    uint64_t origin = length > 0 ? record_list[0].record.timestamp : 0;
+
+    printf("Time [s]");
+    for (j = 0; j < channel_count; j++)
+        printf(",Channel %d", j);
+    printf("\n0.000000000");
+    for (j = 0; j < channel_count; j++)
+        printf(",0");
+    printf("\n");
+
+    for (i = 0; i < length; i++)
+    {
+        record = &record_list[i].record;
+        changed = false;
+        for (j = 0; j < channel_count; j++)
+        {
+            if (channel_list[j].event == record->event &&
+                (channel_list[j].id < 0 || channel_list[j].id == record->id))
+            {
+                channel_list[j].value ^= 1;
+                changed = true;
+            }
+        }
+        if (!changed)
+            continue;
+        printf("%llu.%09llu", (unsigned long long)((record->timestamp - origin) / NANO_SECONDS_PER_SECOND),
+               (unsigned long long)((record->timestamp - origin) % NANO_SECONDS_PER_SECOND));
+        for (j = 0; j < channel_count; j++)
+            printf(",%d", channel_list[j].value);
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+    size_t length;
+    trace_file_header_t header;
+    thread_record_t *record_list;
+    digital_channel_t channel_list[MAX_DIGITAL_CHANNEL_COUNT];
+    int channel_count = 0;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <dump> chrome|csv|digital [<event>[:<id>] ..]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    for (i = 3; i < argc && channel_count < MAX_DIGITAL_CHANNEL_COUNT; i++)
+    {
+        if (parseDigitalChannel(argv[i], &channel_list[channel_count++]) < 0)
+        {
+            fprintf(stderr, "Unknown event: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    record_list = loadTrace(argv[1], &header, &length);
+    if (record_list == NULL)
+        return EXIT_FAILURE;
+
+    if (strcmp(argv[2], "chrome") == 0)
+        writeChromeTrace(record_list, length, header.coupler_id);
+    else if (strcmp(argv[2], "csv") == 0)
+        writeCSV(record_list, length);
+    else if (strcmp(argv[2], "digital") == 0 && channel_count > 0)
+        writeDigital(record_list, length, channel_list, channel_count);
+    else
+    {
+        fprintf(stderr, "Unknown format or no digital channel: %s\n", argv[2]);
+        free(record_list);
+        return EXIT_FAILURE;
+    }
+    free(record_list);
+    return EXIT_SUCCESS;
+}
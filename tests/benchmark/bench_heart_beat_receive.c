@@ -0,0 +1,338 @@
+/*
+ * Receive CPU load of Pub/Sub heart beats versus the number of peers.
+ *
+ * The publisher simulates N couplers: one connection per coupler with the
+ * coupler's PublisherId (base + coupler ID, as in keep_alive.h) and a
+ * WriterGroup publishing the heart beat DataSet <coupler ID, sequence,
+ * timestamp> every interval. The subscriber watches the same N couplers
+ * like the coupler does: one ReaderGroup with one DataSetReader per peer,
+ * so messages are matched on their PublisherId while decoding. It runs the
+ * server loop for the given duration and reports the CPU time it used
+ * (user + system) per second and per received heart beat.
+ *
+ * Usage: ./bench_heart_beat_receive <pub|sub> <peers> [interval ms] [duration s] [interface]
+ *   ./bench_heart_beat_receive pub 64 10 12 &
+ *   ./bench_heart_beat_receive sub 64 10 10
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/plugin/pubsub_udp.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include "../../coupler/time_base.h"
+
+// a port of its own so a running coupler does not receive the benchmark's heart beats
+#define BENCHMARK_NETWORK_ADDRESS_URL "opc.udp://224.0.0.22:4842/"
+#define BENCHMARK_TRANSPORT_PROFILE "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp"
+
+// same IDs as the coupler's heart beats (keep_alive.h)
+#define BENCHMARK_PUBLISHER_ID_BASE 4096
+#define BENCHMARK_WRITER_GROUP_ID 100
+#define BENCHMARK_DATASET_WRITER_ID 62541
+#define BENCHMARK_FIELD_COUNT 3
+
+#define MAX_BENCHMARK_PEER_COUNT 1024
+
+/* ================ Helpers ====================== */
+
+static const char *INTERFACE = "";
+
+// heart beat values of every simulated coupler (published from these variables)
+static UA_UInt16 COUPLER_ID_LIST[MAX_BENCHMARK_PEER_COUNT];
+static UA_UInt32 SEQUENCE_LIST[MAX_BENCHMARK_PEER_COUNT];
+static UA_UInt64 TIMESTAMP_LIST[MAX_BENCHMARK_PEER_COUNT];
+
+static long RECEIVED_COUNT = 0;
+
+static UA_NodeId addConnection(UA_Server *server, UA_UInt32 publisherId)
+{
+    UA_NodeId connectionId;
+    UA_PubSubConnectionConfig connectionConfig;
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING((char *)INTERFACE), UA_STRING(BENCHMARK_NETWORK_ADDRESS_URL)};
+
+    memset(&connectionConfig, 0, sizeof(connectionConfig));
+    connectionConfig.name = UA_STRING("Benchmark Connection");
+    connectionConfig.transportProfileUri = UA_STRING(BENCHMARK_TRANSPORT_PROFILE);
+    connectionConfig.enabled = UA_TRUE;
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.publisherId.numeric = publisherId;
+    if (UA_Server_addPubSubConnection(server, &connectionConfig, &connectionId) != UA_STATUSCODE_GOOD)
+    {
+        printf("error: can not open a connection to %s\n", BENCHMARK_NETWORK_ADDRESS_URL);
+        exit(EXIT_FAILURE);
+    }
+    return connectionId;
+}
+
+static UA_NodeId addVariable(UA_Server *server, UA_UInt32 numericId, char *name,
+                             void *value, const UA_DataType *type)
+{
+    UA_NodeId variableId;
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+
+    if (value != NULL)
+        UA_Variant_setScalar(&attr.value, value, type);
+    attr.dataType = type->typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, numericId),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, name),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              attr, NULL, &variableId);
+    return variableId;
+}
+
+static void addPublishedField(UA_Server *server, UA_NodeId publishedDataSetId, UA_NodeId variableId)
+{
+    UA_NodeId dataSetFieldId;
+    UA_DataSetFieldConfig dataSetFieldConfig;
+
+    memset(&dataSetFieldConfig, 0, sizeof(dataSetFieldConfig));
+    dataSetFieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    dataSetFieldConfig.field.variable.fieldNameAlias = UA_STRING("heart beat");
+    dataSetFieldConfig.field.variable.publishParameters.publishedVariable = variableId;
+    dataSetFieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_Server_addDataSetField(server, publishedDataSetId, &dataSetFieldConfig, &dataSetFieldId);
+}
+
+static void addPublisher(UA_Server *server, int peer, double interval_ms)
+{
+    /*
+     * Publish the heart beats of one simulated coupler on a connection of its own.
+     */
+    UA_NodeId connectionId, publishedDataSetId, writerGroupId, dataSetWriterId;
+    UA_PublishedDataSetConfig publishedDataSetConfig;
+    UA_WriterGroupConfig writerGroupConfig;
+    UA_DataSetWriterConfig dataSetWriterConfig;
+    UA_UadpWriterGroupMessageDataType *writerGroupMessage;
+    UA_UInt32 numericId = 1000 + peer * BENCHMARK_FIELD_COUNT;
+
+    COUPLER_ID_LIST[peer] = peer;
+    connectionId = addConnection(server, BENCHMARK_PUBLISHER_ID_BASE + peer);
+
+    memset(&publishedDataSetConfig, 0, sizeof(publishedDataSetConfig));
+    publishedDataSetConfig.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    publishedDataSetConfig.name = UA_STRING("Benchmark PDS");
+    UA_Server_addPublishedDataSet(server, &publishedDataSetConfig, &publishedDataSetId);
+    addPublishedField(server, publishedDataSetId,
+                      addVariable(server, numericId, "coupler_id", &COUPLER_ID_LIST[peer], &UA_TYPES[UA_TYPES_UINT16]));
+    addPublishedField(server, publishedDataSetId,
+                      addVariable(server, numericId + 1, "sequence", &SEQUENCE_LIST[peer], &UA_TYPES[UA_TYPES_UINT32]));
+    addPublishedField(server, publishedDataSetId,
+                      addVariable(server, numericId + 2, "timestamp", &TIMESTAMP_LIST[peer], &UA_TYPES[UA_TYPES_UINT64]));
+
+    memset(&writerGroupConfig, 0, sizeof(writerGroupConfig));
+    writerGroupConfig.name = UA_STRING("Benchmark WriterGroup");
+    writerGroupConfig.publishingInterval = interval_ms;
+    writerGroupConfig.enabled = UA_FALSE;
+    writerGroupConfig.writerGroupId = BENCHMARK_WRITER_GROUP_ID;
+    writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    writerGroupMessage = UA_UadpWriterGroupMessageDataType_new();
+    writerGroupMessage->networkMessageContentMask =
+        (UA_UadpNetworkMessageContentMask)(UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER);
+    writerGroupConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+    writerGroupConfig.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPWRITERGROUPMESSAGEDATATYPE];
+    writerGroupConfig.messageSettings.content.decoded.data = writerGroupMessage;
+    UA_Server_addWriterGroup(server, connectionId, &writerGroupConfig, &writerGroupId);
+    UA_UadpWriterGroupMessageDataType_delete(writerGroupMessage);
+
+    memset(&dataSetWriterConfig, 0, sizeof(dataSetWriterConfig));
+    dataSetWriterConfig.name = UA_STRING("Benchmark DataSetWriter");
+    dataSetWriterConfig.dataSetWriterId = BENCHMARK_DATASET_WRITER_ID;
+    dataSetWriterConfig.keyFrameCount = 10;
+    UA_Server_addDataSetWriter(server, writerGroupId, publishedDataSetId,
+                               &dataSetWriterConfig, &dataSetWriterId);
+    UA_Server_setWriterGroupOperational(server, writerGroupId);
+}
+
+static void callbackUpdateHeartBeats(UA_Server *server, void *data)
+{
+    int i;
+    long peers = (long)(uintptr_t)data;
+    uint64_t now = getMonotonicNanoSeconds();
+    UA_Variant value;
+
+    for (i = 0; i < peers; i++)
+    {
+        SEQUENCE_LIST[i]++;
+        TIMESTAMP_LIST[i] = now;
+        UA_Variant_setScalar(&value, &SEQUENCE_LIST[i], &UA_TYPES[UA_TYPES_UINT32]);
+        UA_Server_writeValue(server, UA_NODEID_NUMERIC(1, 1000 + i * BENCHMARK_FIELD_COUNT + 1), value);
+        UA_Variant_setScalar(&value, &TIMESTAMP_LIST[i], &UA_TYPES[UA_TYPES_UINT64]);
+        UA_Server_writeValue(server, UA_NODEID_NUMERIC(1, 1000 + i * BENCHMARK_FIELD_COUNT + 2), value);
+    }
+}
+
+static void afterWriteTimestamp(UA_Server *server,
+                                const UA_NodeId *sessionId, void *sessionContext,
+                                const UA_NodeId *nodeId, void *nodeContext,
+                                const UA_NumericRange *range, const UA_DataValue *data)
+{
+    // the timestamp is the last field of a heart beat
+    RECEIVED_COUNT++;
+}
+
+static void fillHeartBeatMetaData(UA_DataSetMetaDataType *metaData)
+{
+    const UA_DataType *typeList[BENCHMARK_FIELD_COUNT] =
+        {&UA_TYPES[UA_TYPES_UINT16], &UA_TYPES[UA_TYPES_UINT32], &UA_TYPES[UA_TYPES_UINT64]};
+    const UA_UInt32 builtInTypeList[BENCHMARK_FIELD_COUNT] = {UA_NS0ID_UINT16, UA_NS0ID_UINT32, UA_NS0ID_UINT64};
+    int i;
+
+    UA_DataSetMetaDataType_init(metaData);
+    metaData->name = UA_STRING("Benchmark DataSet");
+    metaData->fieldsSize = BENCHMARK_FIELD_COUNT;
+    metaData->fields = (UA_FieldMetaData *)UA_Array_new(BENCHMARK_FIELD_COUNT, &UA_TYPES[UA_TYPES_FIELDMETADATA]);
+    for (i = 0; i < BENCHMARK_FIELD_COUNT; i++)
+    {
+        UA_FieldMetaData_init(&metaData->fields[i]);
+        UA_NodeId_copy(&typeList[i]->typeId, &metaData->fields[i].dataType);
+        metaData->fields[i].builtInType = builtInTypeList[i];
+        metaData->fields[i].name = UA_STRING("heart beat");
+        metaData->fields[i].valueRank = -1;
+    }
+}
+
+static void addSubscriber(UA_Server *server, int peers)
+{
+    /*
+     * One ReaderGroup with one DataSetReader per watched coupler (as the coupler).
+     */
+    UA_NodeId readerGroupId, dataSetReaderId, variableId;
+    UA_ReaderGroupConfig readerGroupConfig;
+    UA_DataSetReaderConfig readerConfig;
+    UA_FieldTargetVariable targetVariableList[BENCHMARK_FIELD_COUNT];
+    UA_ValueCallback callback;
+    UA_UInt16 publisherId;
+    const UA_DataType *typeList[BENCHMARK_FIELD_COUNT] =
+        {&UA_TYPES[UA_TYPES_UINT16], &UA_TYPES[UA_TYPES_UINT32], &UA_TYPES[UA_TYPES_UINT64]};
+    int peer, i;
+
+    memset(&readerGroupConfig, 0, sizeof(readerGroupConfig));
+    readerGroupConfig.name = UA_STRING("Benchmark ReaderGroup");
+    UA_Server_addReaderGroup(server, addConnection(server, UA_UInt32_random()),
+                             &readerGroupConfig, &readerGroupId);
+
+    callback.onRead = NULL;
+    callback.onWrite = afterWriteTimestamp;
+    for (peer = 0; peer < peers; peer++)
+    {
+        memset(&readerConfig, 0, sizeof(readerConfig));
+        readerConfig.name = UA_STRING("Benchmark DataSetReader");
+        publisherId = BENCHMARK_PUBLISHER_ID_BASE + peer;
+        readerConfig.publisherId.type = &UA_TYPES[UA_TYPES_UINT16];
+        readerConfig.publisherId.data = &publisherId;
+        readerConfig.writerGroupId = BENCHMARK_WRITER_GROUP_ID;
+        readerConfig.dataSetWriterId = BENCHMARK_DATASET_WRITER_ID;
+        fillHeartBeatMetaData(&readerConfig.dataSetMetaData);
+        UA_Server_addDataSetReader(server, readerGroupId, &readerConfig, &dataSetReaderId);
+
+        for (i = 0; i < BENCHMARK_FIELD_COUNT; i++)
+        {
+            variableId = addVariable(server, 100000 + peer * BENCHMARK_FIELD_COUNT + i,
+                                     "received", NULL, typeList[i]);
+            if (i == BENCHMARK_FIELD_COUNT - 1)
+                UA_Server_setVariableNode_valueCallback(server, variableId, callback);
+            memset(&targetVariableList[i], 0, sizeof(UA_FieldTargetVariable));
+            UA_FieldTargetDataType_init(&targetVariableList[i].targetVariable);
+            targetVariableList[i].targetVariable.attributeId = UA_ATTRIBUTEID_VALUE;
+            targetVariableList[i].targetVariable.targetNodeId = variableId;
+        }
+        UA_Server_DataSetReader_createTargetVariables(server, dataSetReaderId,
+                                                      BENCHMARK_FIELD_COUNT, targetVariableList);
+        UA_Array_delete(readerConfig.dataSetMetaData.fields, BENCHMARK_FIELD_COUNT,
+                        &UA_TYPES[UA_TYPES_FIELDMETADATA]);
+    }
+    UA_Server_setReaderGroupOperational(server, readerGroupId);
+}
+
+static uint64_t getCPUNanoSeconds()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * NANO_SECONDS_PER_SECOND +
+           (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * NANO_SECONDS_PER_MICRO_SECOND;
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    bool is_publisher;
+    int peers, peer;
+    double interval_ms, duration_s;
+    uint64_t start, deadline, cpu_start, cpu_time, wall_time;
+    UA_UInt64 callbackId;
+    UA_Server *server;
+    UA_ServerConfig *config;
+
+    if (argc < 3 || (strcmp(argv[1], "pub") != 0 && strcmp(argv[1], "sub") != 0) ||
+        atoi(argv[2]) < 1 || atoi(argv[2]) > MAX_BENCHMARK_PEER_COUNT)
+    {
+        printf("Usage: %s <pub|sub> <peers (1..%d)> [interval ms] [duration s] [interface]\n",
+               argv[0], MAX_BENCHMARK_PEER_COUNT);
+        return EXIT_FAILURE;
+    }
+    is_publisher = strcmp(argv[1], "pub") == 0;
+    peers = atoi(argv[2]);
+    interval_ms = argc > 3 ? atof(argv[3]) : 10.0;
+    duration_s = argc > 4 ? atof(argv[4]) : 10.0;
+    INTERFACE = argc > 5 ? argv[5] : "";
+
+    server = UA_Server_new();
+    config = UA_Server_getConfig(server);
+    UA_ServerConfig_setMinimal(config, is_publisher ? 4853 : 4854, NULL);
+    UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerUDPMP());
+
+    if (is_publisher)
+    {
+        for (peer = 0; peer < peers; peer++)
+            addPublisher(server, peer, interval_ms);
+        UA_Server_addRepeatedCallback(server, callbackUpdateHeartBeats, (void *)(uintptr_t)peers,
+                                      interval_ms, &callbackId);
+    }
+    else
+    {
+        addSubscriber(server, peers);
+    }
+    UA_Server_run_startup(server);
+
+    start = getMonotonicNanoSeconds();
+    deadline = start + (uint64_t)(duration_s * NANO_SECONDS_PER_SECOND);
+    cpu_start = getCPUNanoSeconds();
+    while (getMonotonicNanoSeconds() < deadline)
+    {
+        UA_Server_run_iterate(server, true);
+    }
+    cpu_time = getCPUNanoSeconds() - cpu_start;
+    wall_time = getMonotonicNanoSeconds() - start;
+
+    if (is_publisher)
+    {
+        printf("published heart beats of %d peers every %.1f ms for %.1f s\n", peers, interval_ms, duration_s);
+    }
+    else
+    {
+        printf("peers %4d: received %ld/%ld heart beats, CPU %.2f%%, %lu ns per heart beat\n",
+               peers, RECEIVED_COUNT, (long)(peers * duration_s * 1000 / interval_ms),
+               100.0 * cpu_time / wall_time,
+               RECEIVED_COUNT > 0 ? (unsigned long)(cpu_time / RECEIVED_COUNT) : 0UL);
+    }
+
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * Micro benchmark of a single MOD-IO relay write transaction:
+ *   - legacy: open() + ioctl(I2C_SLAVE) + write() + close() per transaction
+ *   - pooled: bus opened once, slave address cached, write() only
+ * and of a full MOD-IO input scan (IN0..3 and AIN0..3):
+ *   - split:    write() of the register + read() for each of the 5 registers
+ *   - combined: one ioctl(I2C_RDWR) with a write + read message pair per register
+ *
+ * Usage: ./bench_i2c_bus [device] [slave address] [iterations]
+ *   ./bench_i2c_bus /dev/i2c-1 0x58 10000
+ *
+ * On a host without I2C (x86) pass /dev/null as device to measure the pure
+ * syscall overhead. Transactions then fail but are still timed. Or pass
+ * "sim[:<settings>]" to run on a simulated MOD-IO (coupler -B settings,
+ * i.e. sim:clock=400), legacy is not measured then.
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../../coupler/mod_io_i2c.h"
+
+/* ================ Helpers ====================== */
+
+static uint64_t nowNanoSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int legacyRelayWrite(char *device, int i2c_addr, uint8_t command)
+{
+    /*
+     * Same sequence as setRelayState did before bus handles were introduced.
+     */
+    int file;
+    char buf[2];
+    int retval = 0;
+
+    file = open(device, O_RDWR);
+    if (file < 0)
+        return -1;
+    if (ioctl(file, I2C_SLAVE, i2c_addr) < 0)
+        retval = -1;
+    buf[0] = 0x10;
+    buf[1] = command;
+    if (write(file, buf, 2) != 2)
+        retval = -1;
+    close(file);
+    return retval;
+}
+
+static int pooledRelayWrite(i2c_bus_t *bus, int i2c_addr, uint8_t command)
+{
+    uint8_t buf[2];
+    int retval = 0;
+
+    if (selectI2CSlave(bus, i2c_addr) < 0)
+        retval = -1;
+    buf[0] = 0x10;
+    buf[1] = command;
+    if (writeI2CSlave(bus, buf, 2) != 2)
+        retval = -1;
+    return retval;
+}
+
+static int splitInputScan(i2c_bus_t *bus, int i2c_addr, uint8_t *buf)
+{
+    int i;
+    uint8_t reg;
+    int retval = 0;
+
+    if (selectI2CSlave(bus, i2c_addr) < 0)
+        retval = -1;
+    for (i = 0; i < 5; i++)
+    {
+        reg = i == 0 ? 0x20 : 0x30 + i - 1;
+        if (writeI2CSlave(bus, &reg, 1) != 1)
+            retval = -1;
+        if (readI2CSlave(bus, buf, i == 0 ? 1 : 2) < 0)
+            retval = -1;
+    }
+    return retval;
+}
+
+static int combinedInputScan(i2c_bus_t *bus, int i2c_addr, uint8_t *buf)
+{
+    const uint8_t reg_list[] = {0x20, 0x30, 0x31, 0x32, 0x33};
+    const uint16_t length_list[] = {1, 2, 2, 2, 2};
+
+    return readI2CRegisterList(bus, i2c_addr, reg_list, length_list, 5, buf);
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    char *device = argc > 1 ? argv[1] : "/dev/i2c-1";
+    int i2c_addr = argc > 2 ? (int)strtol(argv[2], NULL, 16) : 0x58;
+    long iterations = argc > 3 ? atol(argv[3]) : 10000;
+    long i;
+    long legacy_errors = 0;
+    long pooled_errors = 0;
+    long split_errors = 0;
+    long combined_errors = 0;
+    uint8_t buf[9];
+    uint64_t start, legacy_ns = 0, pooled_ns, split_ns, combined_ns;
+    bool simulated = strncmp(device, "sim", 3) == 0;
+    i2c_bus_t *bus;
+
+    if (simulated)
+    {
+        if (device[3] == ':' && parseI2CSimulationConfig(strdup(device + 4), &I2C_SIMULATION_CONFIG) < 0)
+        {
+            printf("Invalid I2C simulation (%s).\n", device + 4);
+            return EXIT_FAILURE;
+        }
+        enableI2CSimulation();
+    }
+
+    // legacy: everything per transaction
+    start = nowNanoSeconds();
+    for (i = 0; i < iterations && !simulated; i++)
+    {
+        if (legacyRelayWrite(device, i2c_addr, i & 0x0F) < 0)
+            legacy_errors++;
+    }
+    legacy_ns = nowNanoSeconds() - start;
+
+    // pooled: bus opened once
+    bus = getI2CBus(device);
+    if (bus == NULL)
+        return EXIT_FAILURE;
+    start = nowNanoSeconds();
+    for (i = 0; i < iterations; i++)
+    {
+        if (pooledRelayWrite(bus, i2c_addr, i & 0x0F) < 0)
+            pooled_errors++;
+    }
+    pooled_ns = nowNanoSeconds() - start;
+
+    // full input scan: 10 syscalls vs 1 syscall
+    start = nowNanoSeconds();
+    for (i = 0; i < iterations; i++)
+    {
+        if (splitInputScan(bus, i2c_addr, buf) < 0)
+            split_errors++;
+    }
+    split_ns = nowNanoSeconds() - start;
+
+    start = nowNanoSeconds();
+    for (i = 0; i < iterations; i++)
+    {
+        if (combinedInputScan(bus, i2c_addr, buf) < 0)
+            combined_errors++;
+    }
+    combined_ns = nowNanoSeconds() - start;
+
+    // always leave relays off
+    if (simulated)
+        pooledRelayWrite(bus, i2c_addr, 0x00);
+    closeI2CBusList();
+    if (!simulated)
+        legacyRelayWrite(device, i2c_addr, 0x00);
+
+    printf("device=%s slave=0x%x iterations=%ld\n", device, i2c_addr, iterations);
+    if (!simulated)
+        printf("legacy: %10.1f ns/transaction (errors=%ld)\n",
+               (double)legacy_ns / iterations, legacy_errors);
+    printf("pooled: %10.1f ns/transaction (errors=%ld)\n",
+           (double)pooled_ns / iterations, pooled_errors);
+    if (!simulated)
+        printf("speedup: %.2fx\n", (double)legacy_ns / pooled_ns);
+    printf("input scan split:    %10.1f ns/scan (errors=%ld)\n",
+           (double)split_ns / iterations, split_errors);
+    printf("input scan combined: %10.1f ns/scan (errors=%ld)\n",
+           (double)combined_ns / iterations, combined_errors);
+    printf("speedup: %.2fx\n", (double)split_ns / combined_ns);
+    return EXIT_SUCCESS;
+}
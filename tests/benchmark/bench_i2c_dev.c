@@ -0,0 +1,157 @@
+/*
+ * End to end benchmark of the normal mode I2C path (open / ioctl / read /
+ * write of /dev/i2c-N through mod_io_i2c.h), on the board or on a host with
+ * the i2c-dev fake preloaded (tests/i2c_dev_fake):
+ *   - latency and transactions per second of every operation type: slave
+ *     (re)addressing, relay write, IN0..3 read, AIN read, input scan
+ *   - full scan of 1..16 slaves, every slave's relays written and all its
+ *     inputs read, as an I/O scan cycle with all relays dirty
+ *
+ * Results are CSV (one row per operation and slave count), written to a
+ * file or stdout ("-") so runs can be compared, i.e. by compare_benchmark.py.
+ * Failed transactions are counted, the coupler reports them on stdout.
+ *
+ * Usage: ./bench_i2c_dev [device] [iterations] [slaves] [csv file]
+ *   ./bench_i2c_dev /dev/i2c-1 1000 2 i2c_dev.csv
+ *   LD_PRELOAD=../i2c_dev_fake/build/libi2c_dev_fake.so I2C_DEV_FAKE_SETTINGS=clock=400 \
+ *       ./bench_i2c_dev /dev/i2c-1 1000
+ *
+ * The fake answers in process: the kernel's share (system calls, adapter
+ * driver) is only measured on the board.
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../../coupler/mod_io_i2c.h"
+
+#define MAX_BENCH_SLAVE_COUNT 16
+
+// operation types
+#define BENCH_SELECT 0
+#define BENCH_RELAY_WRITE 1
+#define BENCH_DIGITAL_READ 2
+#define BENCH_ANALOG_READ 3
+#define BENCH_INPUT_SCAN 4
+#define BENCH_FULL_SCAN 5
+
+static const char *BENCH_OP_NAME_LIST[] = {
+    "select", "relay_write", "digital_read", "analog_read", "input_scan", "full_scan"
+};
+
+static metric_histogram_t LATENCY;
+static FILE *CSV_FILE;
+
+/* ================ Helpers ====================== */
+
+static int runOperation(int op, long i, int slave_count)
+{
+    /*
+     * Run one operation. Return -1 if it failed.
+     */
+    int slave;
+    int retval = 0;
+    char *digital_input;
+    int *analog_input;
+    mod_io_input_t input;
+
+    switch (op)
+    {
+    case BENCH_SELECT:
+        // alternate between two slaves so every call is an ioctl(I2C_SLAVE)
+        return selectI2CSlave(getI2CBus(I2C_BLOCK_DEVICE_NAME), I2C_SLAVE_ADDR_LIST[i & 1]);
+    case BENCH_RELAY_WRITE:
+        return setI2CSlaveRelayState(0, i & 0x0F);
+    case BENCH_DIGITAL_READ:
+        return getDigitalInputState(I2C_SLAVE_ADDR_LIST[0], &digital_input);
+    case BENCH_ANALOG_READ:
+        return getAnalogInputStateAIN(I2C_SLAVE_ADDR_LIST[0], &analog_input,
+                                      MOD_IO_ANALOG_INPUT_REGISTER + (i & 3));
+    case BENCH_INPUT_SCAN:
+        return getI2CSlaveInputState(0, &input);
+    default:
+        for (slave = 0; slave < slave_count; slave++)
+        {
+            if (setI2CSlaveRelayState(slave, i & 0x0F) < 0)
+                retval = -1;
+            if (getI2CSlaveInputState(slave, &input) < 0)
+                retval = -1;
+        }
+        return retval;
+    }
+}
+
+static void runBenchmark(int op, int slave_count, long iterations)
+{
+    /*
+     * Time every iteration of an operation, print its CSV row.
+     */
+    long i;
+    long errors = 0;
+    uint64_t start, elapsed = 0, latency;
+
+    memset(&LATENCY, 0, sizeof(LATENCY));
+    for (i = 0; i < iterations; i++)
+    {
+        start = getMonotonicNanoSeconds();
+        if (runOperation(op, i, slave_count) < 0)
+            errors++;
+        latency = getMonotonicNanoSeconds() - start;
+        recordMetric(&LATENCY, latency);
+        elapsed += latency;
+    }
+
+    fprintf(CSV_FILE, "%s,%d,%ld,%ld,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f\n", BENCH_OP_NAME_LIST[op], slave_count,
+            iterations, errors, elapsed > 0 ? iterations * 1e9 / elapsed : 0.0,
+            getMetricMean(&LATENCY) / 1e3, getMetricPercentile(&LATENCY, 50.0) / 1e3,
+            getMetricPercentile(&LATENCY, 99.0) / 1e3, getMetricPercentile(&LATENCY, 99.9) / 1e3,
+            LATENCY.max / 1e3);
+    fflush(CSV_FILE);
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 2 ? atol(argv[2]) : 1000;
+    int max_slave_count = argc > 3 ? atoi(argv[3]) : MAX_BENCH_SLAVE_COUNT;
+    char *csv_path = argc > 4 ? argv[4] : "-";
+    int op, slave_count;
+
+    I2C_BLOCK_DEVICE_NAME = argc > 1 ? argv[1] : "/dev/i2c-1";
+    if (iterations <= 0 || max_slave_count < 1 || max_slave_count > MAX_BENCH_SLAVE_COUNT)
+    {
+        printf("Usage: %s [device] [iterations] [slaves (1..%d)] [csv file]\n", argv[0], MAX_BENCH_SLAVE_COUNT);
+        return EXIT_FAILURE;
+    }
+    CSV_FILE = strcmp(csv_path, "-") == 0 ? stdout : fopen(csv_path, "w");
+    if (CSV_FILE == NULL)
+    {
+        perror(csv_path);
+        return EXIT_FAILURE;
+    }
+    for (slave_count = 0; slave_count < max_slave_count; slave_count++)
+    {
+        I2C_SLAVE_ADDR_LIST[slave_count] = DEFAULT_I2C_SLAVE_ADDR + slave_count;
+    }
+    openI2CSlaveBusList();
+
+    fprintf(stderr, "device=%s iterations=%ld slaves=%d\n", I2C_BLOCK_DEVICE_NAME, iterations, max_slave_count);
+    fprintf(CSV_FILE, "op,slaves,iterations,errors,ops_per_second,mean_us,p50_us,p99_us,p999_us,max_us\n");
+    for (op = 0; op < BENCH_FULL_SCAN; op++)
+    {
+        runBenchmark(op, 1, iterations);
+    }
+    for (slave_count = 1; slave_count <= max_slave_count; slave_count++)
+    {
+        runBenchmark(BENCH_FULL_SCAN, slave_count, iterations);
+    }
+
+    // always leave relays off
+    safeShutdownI2CSlaveList();
+    closeI2CBusList();
+    fclose(CSV_FILE);
+    return EXIT_SUCCESS;
+}
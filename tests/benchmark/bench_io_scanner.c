@@ -0,0 +1,129 @@
+/*
+ * Benchmark of the I/O scan cycle on simulated MOD-IOs (coupler -m 2), so
+ * it runs on any host, i.e. in CI:
+ *   - scan cycle time (relay flush + input scan of all slaves) for 1..16
+ *     slaves at 100 and 400 kHz
+ *   - 4 relay writes per slave and cycle, coalesced (one I2C write per dirty
+ *     slave and cycle) vs written through (one I2C write per relay write)
+ *
+ * Usage: ./bench_io_scanner [cycles] [simulation settings]
+ *   ./bench_io_scanner 50
+ *   ./bench_io_scanner 50 overhead=60,nak=0.001
+ */
+
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include "../../coupler/mod_io_i2c.h"
+#include "../../coupler/relay_output.h"
+#include "../../coupler/io_scanner.h"
+
+#define RELAY_COUNT 4
+
+// relay writes of a cycle
+#define NO_RELAY_WRITE 0
+#define COALESCED_RELAY_WRITE 1
+#define WRITE_THROUGH_RELAY_WRITE 2
+
+static const unsigned int CLOCK_LIST[] = {100000, 400000};
+static const int SLAVE_COUNT_LIST[] = {1, 2, 4, 8, 16};
+
+/* ================ Helpers ====================== */
+
+static void attachSlaveList(int slave_count)
+{
+    int i;
+
+    memset(I2C_SLAVE_ADDR_LIST, 0, sizeof(I2C_SLAVE_ADDR_LIST));
+    for (i = 0; i < slave_count; i++)
+        I2C_SLAVE_ADDR_LIST[i] = DEFAULT_I2C_SLAVE_ADDR + i;
+}
+
+static void writeRelayList(int slave_count, long cycle, int relay_write)
+{
+    /*
+     * Write every relay of every slave, as a PLC would.
+     */
+    int i, relay;
+
+    for (i = 0; i < slave_count; i++)
+    {
+        for (relay = 0; relay < RELAY_COUNT; relay++)
+        {
+            setRelayOutput(i, relay, (cycle + relay) & 1);
+            if (relay_write == WRITE_THROUGH_RELAY_WRITE)
+                flushRelayOutputList();
+        }
+    }
+}
+
+static uint64_t runScanCycleList(int slave_count, long cycles, int relay_write)
+{
+    /*
+     * Return the mean time (ns) of a cycle of relay writes and an I/O scan.
+     */
+    long cycle;
+    uint64_t start = getMonotonicNanoSeconds();
+
+    for (cycle = 0; cycle < cycles; cycle++)
+    {
+        if (relay_write != NO_RELAY_WRITE)
+            writeRelayList(slave_count, cycle, relay_write);
+        runIOScanCycle();
+    }
+    return (getMonotonicNanoSeconds() - start) / cycles;
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    long cycles = argc > 1 ? atol(argv[1]) : 50;
+    unsigned int i, j;
+    int slave_count;
+    uint64_t coalesced_ns, through_ns;
+    unsigned int flush_count;
+
+    if (argc > 2 && parseI2CSimulationConfig(argv[2], &I2C_SIMULATION_CONFIG) < 0)
+    {
+        printf("Invalid I2C simulation (%s).\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    I2C_BLOCK_DEVICE_NAME = "/dev/i2c-1";
+    setOperationalMode(OPERATIONAL_MODE_SIMULATED);
+
+    printf("cycles=%ld overhead=%llu ns\n", cycles, (unsigned long long)I2C_SIMULATION_CONFIG.overhead);
+    printf("%9s %6s %12s %12s %12s %12s %14s %14s\n", "clock_khz", "slaves", "scan_us", "scan_p99_us",
+           "coalesced_us", "through_us", "coalesced_i2c", "through_i2c");
+    for (i = 0; i < sizeof(CLOCK_LIST) / sizeof(CLOCK_LIST[0]); i++)
+    {
+        I2C_SIMULATION_CONFIG.clock = CLOCK_LIST[i];
+        for (j = 0; j < sizeof(SLAVE_COUNT_LIST) / sizeof(SLAVE_COUNT_LIST[0]); j++)
+        {
+            slave_count = SLAVE_COUNT_LIST[j];
+            attachSlaveList(slave_count);
+
+            memset(&METRIC_LIST[METRIC_IO_SCAN_CYCLE], 0, sizeof(metric_histogram_t));
+            runScanCycleList(slave_count, cycles, NO_RELAY_WRITE);
+            printf("%9u %6d %12.1f %12.1f", CLOCK_LIST[i] / 1000, slave_count,
+                   getMetricMean(&METRIC_LIST[METRIC_IO_SCAN_CYCLE]) / 1e3,
+                   getMetricPercentile(&METRIC_LIST[METRIC_IO_SCAN_CYCLE], 99.0) / 1e3);
+
+            flush_count = RELAY_OUTPUT_FLUSH_COUNTER;
+            coalesced_ns = runScanCycleList(slave_count, cycles, COALESCED_RELAY_WRITE);
+            flush_count = RELAY_OUTPUT_FLUSH_COUNTER - flush_count;
+
+            through_ns = runScanCycleList(slave_count, cycles, WRITE_THROUGH_RELAY_WRITE);
+            printf(" %12.1f %12.1f %14u %14ld\n", coalesced_ns / 1e3, through_ns / 1e3, flush_count,
+                   (long)slave_count * RELAY_COUNT * cycles);
+        }
+    }
+    safeShutdownI2CSlaveList();
+    closeI2CBusList();
+    return EXIT_SUCCESS;
+}
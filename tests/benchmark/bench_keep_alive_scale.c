@@ -0,0 +1,895 @@
+/*
+ * Keep-alive scale simulator: N virtual couplers in one process.
+ *
+ * Every virtual coupler runs the keep-alive logic of the coupler on a
+ * liveness table of its own (liveness_table.h, as keep_alive_publisher.h /
+ * keep_alive_subscriber.h do):
+ *   - it publishes a heart beat <coupler ID, sequence, send timestamp> every
+ *     heart beat interval (callbackTicHeartBeat)
+ *   - it registers the heart beats of the peers it watches (registerHeartBeat)
+ *   - every heart beat interval it checks its watched peers with the same
+ *     suspect / down timeouts and goes to safe mode if one is DOWN
+ *     (callbackCheckHeartBeat, checkHeartBeatTimeouts of liveness_table.h)
+ * Couplers start at a random phase. Heart beats travel over:
+ *   - mem: an in-memory network, simulated time (or wall clock with -R)
+ *   - udp: loopback multicast, one socket per coupler receiving all heart
+ *     beats and filtering on the PublisherId, wall clock
+ * and are lost (independently or in bursts, per link), delayed and jittered
+ * as configured. Peers are stopped at random times for an outage (they
+ * neither publish nor receive, their sequence resumes afterwards).
+ *
+ * Reported per run (one row per coupler count, also as CSV with -o):
+ *   - detection latency: from a peer stopping to it being DOWN at a watcher,
+ *     i.e. the watcher's gotoSafeMode() (mean, p50, p99, max), and watchers
+ *     that did not detect an outage
+ *   - false positives: live peers seen SUSPECT / DOWN, safe mode entries
+ *     caused by live peers only, and false DOWNs per watched pair and hour
+ *   - CPU per coupler: time spent in its keep-alive handlers (receive,
+ *     check, and the send system call with udp) per second of (simulated)
+ *     time, mean and max over all couplers. Pub/Sub encoding / decoding is
+ *     not included, see bench_heart_beat_receive for it.
+ *
+ * Usage: ./bench_keep_alive_scale [-n <couplers>[,<couplers>...]] [-T <mesh|ring[:k]|star>]
+ *                                 [-i <interval ms>] [-t <timeout ms>] [-l <loss 0..1>] [-b <burst length>]
+ *                                 [-d <delay ms>] [-j <jitter ms>] [-D <duration s>] [-f <outages>]
+ *                                 [-O <outage ms>] [-x <mem|udp>] [-R] [-S <seed>] [-o <csv file>]
+ *   ./bench_keep_alive_scale -n 16,64,256 -T mesh -i 250 -t 1000 -l 0.01 -b 3 -d 1 -j 5 -D 600
+ *   ./bench_keep_alive_scale -n 64 -x udp -i 50 -t 200 -D 30
+ */
+
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "../../coupler/liveness_table.h"
+#include "../../coupler/time_base.h"
+// detection latencies are close to each other: 64 sub-buckets (1.6%)
+#define METRIC_SUB_BUCKET_BITS 6
+#include "../../coupler/metrics.h"
+
+// a port of its own so running couplers do not receive the simulated heart beats
+#define SIMULATION_MULTICAST_ADDRESS "224.0.0.22"
+#define SIMULATION_MULTICAST_PORT 4843
+
+// watch topologies
+#define TOPOLOGY_MESH 0
+#define TOPOLOGY_RING 1
+#define TOPOLOGY_STAR 2
+
+static const char *TOPOLOGY_NAME_LIST[] = {"mesh", "ring", "star"};
+
+// transports
+#define TRANSPORT_MEM 0
+#define TRANSPORT_UDP 1
+
+// events
+#define EVENT_PUBLISH 0
+#define EVENT_CHECK 1
+#define EVENT_DELIVER 2
+#define EVENT_STOP 3
+#define EVENT_START 4
+
+#define MAX_SIMULATION_RUN_COUNT 16
+
+typedef struct {
+    uint64_t time;              // simulated time (ns)
+    uint64_t send_timestamp;    // heart beat's send timestamp (ns)
+    uint32_t sequence;          // heart beat's sequence
+    uint16_t coupler_id;        // coupler handling the event (receiver of a heart beat)
+    uint16_t peer_id;           // sender of a heart beat
+    uint8_t type;               // EVENT_*
+} simulation_event_t;
+
+// heart beat frame of the udp transport
+typedef struct {
+    uint16_t publisher_id;      // LIVENESS_PUBLISHER_ID_BASE + coupler ID
+    uint16_t coupler_id;
+    uint32_t sequence;
+    uint64_t timestamp;
+} __attribute__((packed)) simulation_heart_beat_t;
+
+typedef struct {
+    liveness_table_t table;
+    uint32_t heart_beats;       // sequence of the last published heart beat
+    uint8_t current_state;      // worst state of the watched peers (CURRENT_STATE)
+    bool stopped;               // in an outage: neither publishes nor receives
+    bool down_detected;         // a check saw a peer become DOWN while it was stopped
+    bool false_down;            // a check saw a live peer become DOWN
+    uint64_t stop_time;         // start of the last outage
+    uint64_t start_time;        // end of the last outage
+    uint64_t cpu_time;          // ns spent in the keep-alive handlers
+    int watcher_count;          // couplers watching this one
+    uint16_t *watcher_list;
+    int socket;                 // udp transport
+} virtual_coupler_t;
+
+// settings
+static int COUPLER_COUNT_LIST[MAX_SIMULATION_RUN_COUNT] = {16};
+static int RUN_COUNT = 1;
+static int TOPOLOGY = TOPOLOGY_MESH;
+static int RING_WATCH_COUNT = 1;
+static int TRANSPORT = TRANSPORT_MEM;
+static bool REAL_TIME = false;
+static double INTERVAL = LIVENESS_DEFAULT_HEART_BEAT_INTERVAL; // ms
+static double TIMEOUT = 0;                                 // ms, 0 = default (keep_alive.h)
+static double LOSS = 0;
+static double BURST_LENGTH = 1;
+static double DELAY = 0;                                   // ms
+static double JITTER = 0;                                  // ms
+static double DURATION = 300;                              // s
+static int OUTAGE_COUNT = 10;
+static double OUTAGE = 0;                                  // ms, 0 = 3 timeouts
+static uint64_t SEED = 1;
+static char *CSV_PATH = NULL;
+
+// state of a run
+static int COUPLER_COUNT;
+static virtual_coupler_t *COUPLER_LIST;
+static uint8_t *LINK_STATE_LIST;    // per sender and receiver: 1 in a loss burst
+static uint64_t INTERVAL_NS, DOWN_TIMEOUT_NS, DELAY_NS, JITTER_NS, OUTAGE_NS, END_TIME;
+static uint64_t EPOCH;              // monotonic time of simulated time 0 (real time)
+static uint64_t RANDOM_STATE;
+static int EPOLL_FD = -1;
+
+static simulation_event_t *EVENT_HEAP;
+static size_t EVENT_COUNT, EVENT_CAPACITY;
+
+// results of a run
+static metric_histogram_t DETECTION_LATENCY;
+static uint64_t HEART_BEAT_COUNT, DROPPED_COUNT, DETECTION_COUNT, MISSED_DETECTION_COUNT;
+static uint64_t FALSE_SUSPECT_COUNT, FALSE_DOWN_COUNT, SAFE_MODE_COUNT, FALSE_SAFE_MODE_COUNT;
+
+/* ================ Helpers ====================== */
+
+static double getRandomUniform(void)
+{
+    /*
+     * Return a uniformly distributed number in [0, 1) (xorshift64*).
+     */
+    RANDOM_STATE ^= RANDOM_STATE >> 12;
+    RANDOM_STATE ^= RANDOM_STATE << 25;
+    RANDOM_STATE ^= RANDOM_STATE >> 27;
+    return ((RANDOM_STATE * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void pushEvent(simulation_event_t *event)
+{
+    /*
+     * Add an event to the queue (binary min-heap on time).
+     */
+    size_t i, parent;
+
+    if (EVENT_COUNT == EVENT_CAPACITY)
+    {
+        EVENT_CAPACITY = EVENT_CAPACITY == 0 ? 4096 : 2 * EVENT_CAPACITY;
+        EVENT_HEAP = (simulation_event_t *)realloc(EVENT_HEAP, EVENT_CAPACITY * sizeof(simulation_event_t));
+        if (EVENT_HEAP == NULL)
+        {
+            perror("event queue");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (i = EVENT_COUNT++; i > 0; i = parent)
+    {
+        parent = (i - 1) / 2;
+        if (EVENT_HEAP[parent].time <= event->time)
+            break;
+        EVENT_HEAP[i] = EVENT_HEAP[parent];
+    }
+    EVENT_HEAP[i] = *event;
+}
+
+static void popEvent(simulation_event_t *event)
+{
+    /*
+     * Remove the earliest event from the queue.
+     */
+    size_t i = 0, child;
+    simulation_event_t last = EVENT_HEAP[--EVENT_COUNT];
+
+    *event = EVENT_HEAP[0];
+    while ((child = 2 * i + 1) < EVENT_COUNT)
+    {
+        if (child + 1 < EVENT_COUNT && EVENT_HEAP[child + 1].time < EVENT_HEAP[child].time)
+            child++;
+        if (last.time <= EVENT_HEAP[child].time)
+            break;
+        EVENT_HEAP[i] = EVENT_HEAP[child];
+        i = child;
+    }
+    EVENT_HEAP[i] = last;
+}
+
+static void scheduleEvent(uint8_t type, uint64_t time, int coupler_id)
+{
+    simulation_event_t event = {0};
+
+    event.type = type;
+    event.time = time;
+    event.coupler_id = coupler_id;
+    pushEvent(&event);
+}
+
+static uint64_t getSimulationNanoSeconds(void)
+{
+    /*
+     * Return the simulated time of the wall clock (real time runs).
+     */
+    return getMonotonicNanoSeconds() - EPOCH;
+}
+
+static bool isHeartBeatLost(int sender, int receiver)
+{
+    /*
+     * Draw the loss of a heart beat on the link sender -> receiver. With a
+     * burst length > 1 links follow a Gilbert model whose bad state loses
+     * every heart beat, bursts have the given mean length and the overall
+     * loss rate stays LOSS.
+     */
+    uint8_t *in_burst = &LINK_STATE_LIST[sender * COUPLER_COUNT + receiver];
+
+    if (LOSS <= 0)
+        return false;
+    if (BURST_LENGTH <= 1)
+        return getRandomUniform() < LOSS;
+    if (*in_burst)
+    {
+        if (getRandomUniform() < 1.0 / BURST_LENGTH)
+            *in_burst = 0;
+    }
+    else if (getRandomUniform() < LOSS / (BURST_LENGTH * (1.0 - LOSS)))
+    {
+        *in_burst = 1;
+    }
+    return *in_burst;
+}
+
+static bool isSilent(virtual_coupler_t *coupler, uint64_t now)
+{
+    /*
+     * A coupler in an outage, or whose heart beats may not have reached its
+     * peers since, is rightly seen DOWN (and rightly sees its peers DOWN).
+     */
+    return coupler->stopped ||
+           (coupler->start_time != 0 && now < coupler->start_time + DOWN_TIMEOUT_NS + INTERVAL_NS + DELAY_NS + JITTER_NS);
+}
+
+/* ================ Virtual coupler ============== */
+
+static void receiveHeartBeat(virtual_coupler_t *coupler, unsigned int peer_id, uint32_t sequence,
+                             uint64_t send_timestamp, uint64_t now)
+{
+    /*
+     * Register a heart beat of a watched peer (registerHeartBeat).
+     */
+    uint64_t start = getMonotonicNanoSeconds();
+
+    updateLiveness(&coupler->table, peer_id, sequence, send_timestamp, now);
+    coupler->cpu_time += getMonotonicNanoSeconds() - start;
+}
+
+static void deliverHeartBeat(int sender, int receiver, uint32_t sequence, uint64_t send_timestamp, uint64_t now)
+{
+    /*
+     * Pass a heart beat through the simulated network: lost, or delivered
+     * after the delay and a uniformly distributed jitter.
+     */
+    simulation_event_t event;
+    uint64_t delay;
+
+    if (isHeartBeatLost(sender, receiver))
+    {
+        DROPPED_COUNT++;
+        return;
+    }
+    delay = DELAY_NS + (uint64_t)(getRandomUniform() * JITTER_NS);
+    if (delay == 0)
+    {
+        if (!COUPLER_LIST[receiver].stopped)
+            receiveHeartBeat(&COUPLER_LIST[receiver], sender, sequence, send_timestamp, now);
+        return;
+    }
+    event.type = EVENT_DELIVER;
+    event.time = now + delay;
+    event.coupler_id = receiver;
+    event.peer_id = sender;
+    event.sequence = sequence;
+    event.send_timestamp = send_timestamp;
+    pushEvent(&event);
+}
+
+static void publishHeartBeat(int coupler_id, uint64_t now)
+{
+    /*
+     * Publish the next heart beat of a coupler (callbackTicHeartBeat and its
+     * WriterGroup): to every watcher (mem) or to the multicast group (udp).
+     */
+    virtual_coupler_t *coupler = &COUPLER_LIST[coupler_id];
+    simulation_heart_beat_t frame;
+    struct sockaddr_in address;
+    uint64_t start;
+    int i;
+
+    coupler->heart_beats++;
+    HEART_BEAT_COUNT++;
+    if (TRANSPORT == TRANSPORT_MEM)
+    {
+        for (i = 0; i < coupler->watcher_count; i++)
+        {
+            deliverHeartBeat(coupler_id, coupler->watcher_list[i], coupler->heart_beats, now, now);
+        }
+        return;
+    }
+
+    frame.publisher_id = LIVENESS_PUBLISHER_ID_BASE + coupler_id;
+    frame.coupler_id = coupler_id;
+    frame.sequence = coupler->heart_beats;
+    frame.timestamp = now;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(SIMULATION_MULTICAST_PORT);
+    address.sin_addr.s_addr = inet_addr(SIMULATION_MULTICAST_ADDRESS);
+    start = getMonotonicNanoSeconds();
+    if (sendto(coupler->socket, &frame, sizeof(frame), 0, (struct sockaddr *)&address, sizeof(address)) < 0)
+        DROPPED_COUNT++;
+    coupler->cpu_time += getMonotonicNanoSeconds() - start;
+}
+
+static void handlePeerStateChange(liveness_table_t *table, unsigned int peer_id,
+                                  uint8_t previous_state, uint8_t state, uint64_t now, void *context)
+{
+    /*
+     * Classify a watcher's verdict on a peer: a stopped peer becoming DOWN is
+     * a detection, a live one becoming SUSPECT or DOWN is a false positive.
+     */
+    virtual_coupler_t *coupler = (virtual_coupler_t *)context;
+    virtual_coupler_t *peer = &COUPLER_LIST[peer_id];
+
+    if ((state != PEER_STATE_DOWN && state != PEER_STATE_SUSPECT) || isSilent(coupler, now))
+        return;
+    if (peer->stopped)
+    {
+        if (state == PEER_STATE_DOWN)
+        {
+            recordMetric(&DETECTION_LATENCY, now - peer->stop_time);
+            DETECTION_COUNT++;
+            coupler->down_detected = true;
+        }
+        return;
+    }
+    // heart beats of a restarted peer may still be on their way
+    if (isSilent(peer, now))
+        return;
+    if (state == PEER_STATE_DOWN)
+    {
+        FALSE_DOWN_COUNT++;
+        coupler->false_down = true;
+    }
+    else
+    {
+        FALSE_SUSPECT_COUNT++;
+    }
+}
+
+static void checkHeartBeat(virtual_coupler_t *coupler, uint64_t now)
+{
+    /*
+     * Check the liveness of the watched peers (callbackCheckHeartBeat).
+     */
+    uint64_t start = getMonotonicNanoSeconds();
+    uint8_t worst_state;
+
+    coupler->down_detected = false;
+    coupler->false_down = false;
+    worst_state = checkHeartBeatTimeouts(&coupler->table, now, INTERVAL_NS, DOWN_TIMEOUT_NS,
+                                         handlePeerStateChange, coupler);
+    if (worst_state == PEER_STATE_DOWN && coupler->current_state != PEER_STATE_DOWN)
+    {
+        // gotoSafeMode()
+        SAFE_MODE_COUNT++;
+        if (coupler->false_down && !coupler->down_detected)
+            FALSE_SAFE_MODE_COUNT++;
+    }
+    coupler->current_state = worst_state;
+    coupler->cpu_time += getMonotonicNanoSeconds() - start;
+}
+
+static void stopCoupler(int coupler_id, uint64_t now)
+{
+    /*
+     * Start an outage of a random coupler (the next one if it is already stopped).
+     */
+    int i;
+    virtual_coupler_t *coupler;
+
+    for (i = 0; i < COUPLER_COUNT; i++)
+    {
+        coupler = &COUPLER_LIST[(coupler_id + i) % COUPLER_COUNT];
+        if (!coupler->stopped)
+        {
+            coupler->stopped = true;
+            coupler->stop_time = now;
+            scheduleEvent(EVENT_START, now + OUTAGE_NS, (coupler_id + i) % COUPLER_COUNT);
+            return;
+        }
+    }
+}
+
+static void startCoupler(int coupler_id, uint64_t now)
+{
+    /*
+     * End the outage of a coupler, count its watchers that do not see it
+     * DOWN (i.e. the outage was shorter than their timeout).
+     */
+    int i;
+    virtual_coupler_t *coupler = &COUPLER_LIST[coupler_id];
+
+    coupler->stopped = false;
+    coupler->start_time = now;
+    for (i = 0; i < coupler->watcher_count; i++)
+    {
+        if (COUPLER_LIST[coupler->watcher_list[i]].table.peer_list[coupler_id].state != PEER_STATE_DOWN)
+            MISSED_DETECTION_COUNT++;
+    }
+}
+
+/* ================ UDP transport ================ */
+
+static int openCouplerSocket(virtual_coupler_t *coupler, int coupler_id)
+{
+    /*
+     * Open the multicast socket of a coupler on the loopback interface.
+     * Return -1 on error.
+     */
+    int one = 1;
+    unsigned char ttl = 0;
+    struct sockaddr_in address;
+    struct ip_mreq membership;
+    struct in_addr interface;
+    struct epoll_event event;
+
+    coupler->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (coupler->socket < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(SIMULATION_MULTICAST_PORT);
+    address.sin_addr.s_addr = inet_addr(SIMULATION_MULTICAST_ADDRESS);
+    membership.imr_multiaddr.s_addr = inet_addr(SIMULATION_MULTICAST_ADDRESS);
+    membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    interface.s_addr = htonl(INADDR_LOOPBACK);
+    event.events = EPOLLIN;
+    event.data.u32 = coupler_id;
+    if (setsockopt(coupler->socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        bind(coupler->socket, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        setsockopt(coupler->socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        setsockopt(coupler->socket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0 ||
+        setsockopt(coupler->socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        epoll_ctl(EPOLL_FD, EPOLL_CTL_ADD, coupler->socket, &event) < 0)
+    {
+        perror("multicast socket");
+        return -1;
+    }
+    return 0;
+}
+
+static void receiveFrameList(int coupler_id)
+{
+    /*
+     * Read all pending heart beats of a coupler's socket. Heart beats of
+     * peers it does not watch are dropped as a DataSetReader would.
+     */
+    virtual_coupler_t *coupler = &COUPLER_LIST[coupler_id];
+    simulation_heart_beat_t frame;
+    unsigned int peer_id;
+    ssize_t received;
+    uint64_t start, now;
+
+    for (;;)
+    {
+        start = getMonotonicNanoSeconds();
+        received = recv(coupler->socket, &frame, sizeof(frame), 0);
+        coupler->cpu_time += getMonotonicNanoSeconds() - start;
+        if (received != sizeof(frame))
+            break;
+        peer_id = frame.publisher_id - LIVENESS_PUBLISHER_ID_BASE;
+        if (peer_id >= (unsigned int)COUPLER_COUNT || !coupler->table.peer_list[peer_id].watched ||
+            coupler->stopped)
+            continue;
+        now = getSimulationNanoSeconds();
+        if (DELAY_NS == 0 && JITTER_NS == 0 && LOSS <= 0)
+            receiveHeartBeat(coupler, peer_id, frame.sequence, frame.timestamp, now);
+        else
+            deliverHeartBeat(peer_id, coupler_id, frame.sequence, frame.timestamp, now);
+    }
+}
+
+static void pollSocketList(uint64_t deadline)
+{
+    /*
+     * Receive heart beats until the (simulated) deadline.
+     */
+    struct epoll_event event_list[64];
+    uint64_t now;
+    int i, count, timeout;
+
+    while ((now = getSimulationNanoSeconds()) < deadline)
+    {
+        timeout = (int)((deadline - now) / NANO_SECONDS_PER_MILLI_SECOND);
+        count = epoll_wait(EPOLL_FD, event_list, 64, timeout);
+        for (i = 0; i < count; i++)
+        {
+            receiveFrameList(event_list[i].data.u32);
+        }
+    }
+}
+
+/* ================ Simulation =================== */
+
+static int parseTopology(const char *name)
+{
+    /*
+     * Parse "mesh", "ring[:k]" or "star". Return -1 if unknown.
+     */
+    if (strcmp(name, "mesh") == 0)
+        return TOPOLOGY_MESH;
+    if (strcmp(name, "star") == 0)
+        return TOPOLOGY_STAR;
+    if (strncmp(name, "ring", 4) == 0)
+    {
+        RING_WATCH_COUNT = name[4] == ':' ? atoi(name + 5) : 1;
+        return RING_WATCH_COUNT > 0 ? TOPOLOGY_RING : -1;
+    }
+    return -1;
+}
+
+static void watchCoupler(int watcher, int peer)
+{
+    virtual_coupler_t *coupler = &COUPLER_LIST[peer];
+
+    if (watcher == peer || COUPLER_LIST[watcher].table.peer_list[peer].watched)
+        return;
+    watchPeer(&COUPLER_LIST[watcher].table, peer, PEER_STATE_NO_INITIAL);
+    coupler->watcher_list[coupler->watcher_count++] = watcher;
+}
+
+static int setupSimulation(int coupler_count)
+{
+    /*
+     * Create the couplers, their watch topology, start events and outages.
+     * Return -1 on error.
+     */
+    int i, k;
+    uint64_t warmup, last_outage;
+
+    COUPLER_COUNT = coupler_count;
+    if (posix_memalign((void **)&COUPLER_LIST, CACHE_LINE_SIZE, coupler_count * sizeof(virtual_coupler_t)) != 0)
+    {
+        perror("couplers");
+        exit(EXIT_FAILURE);
+    }
+    memset(COUPLER_LIST, 0, coupler_count * sizeof(virtual_coupler_t));
+    for (i = 0; i < coupler_count; i++)
+        COUPLER_LIST[i].socket = -1;
+    LINK_STATE_LIST = (uint8_t *)calloc(coupler_count * coupler_count, 1);
+    if (LINK_STATE_LIST == NULL)
+    {
+        perror("links");
+        return -1;
+    }
+    for (i = 0; i < coupler_count; i++)
+    {
+        initLivenessTable(&COUPLER_LIST[i].table);
+        COUPLER_LIST[i].current_state = PEER_STATE_NO_INITIAL;
+        COUPLER_LIST[i].watcher_list = (uint16_t *)calloc(coupler_count, sizeof(uint16_t));
+        if (COUPLER_LIST[i].watcher_list == NULL)
+        {
+            perror("couplers");
+            return -1;
+        }
+    }
+    for (i = 0; i < coupler_count; i++)
+    {
+        switch (TOPOLOGY)
+        {
+        case TOPOLOGY_MESH:
+            for (k = 0; k < coupler_count; k++)
+                watchCoupler(i, k);
+            break;
+        case TOPOLOGY_RING:
+            for (k = 1; k <= RING_WATCH_COUNT; k++)
+                watchCoupler(i, (i + k) % coupler_count);
+            break;
+        case TOPOLOGY_STAR:
+            watchCoupler(i, 0);
+            watchCoupler(0, i);
+            break;
+        }
+    }
+
+    RANDOM_STATE = SEED * 0x9E3779B97F4A7C15ULL + 1;
+    EVENT_COUNT = 0;
+    memset(&DETECTION_LATENCY, 0, sizeof(DETECTION_LATENCY));
+    HEART_BEAT_COUNT = DROPPED_COUNT = DETECTION_COUNT = MISSED_DETECTION_COUNT = 0;
+    FALSE_SUSPECT_COUNT = FALSE_DOWN_COUNT = SAFE_MODE_COUNT = FALSE_SAFE_MODE_COUNT = 0;
+
+    // simulated time starts at 1 s (a heart beat at 0 would be LIVENESS_NEVER_SEEN)
+    for (i = 0; i < coupler_count; i++)
+    {
+        scheduleEvent(EVENT_PUBLISH, NANO_SECONDS_PER_SECOND + (uint64_t)(getRandomUniform() * INTERVAL_NS), i);
+        scheduleEvent(EVENT_CHECK, NANO_SECONDS_PER_SECOND + (uint64_t)(getRandomUniform() * INTERVAL_NS), i);
+    }
+    // outages once every coupler saw its peers, ending before the run does
+    warmup = NANO_SECONDS_PER_SECOND + DOWN_TIMEOUT_NS + 2 * INTERVAL_NS + DELAY_NS + JITTER_NS;
+    last_outage = END_TIME - OUTAGE_NS - INTERVAL_NS;
+    for (i = 0; i < OUTAGE_COUNT && last_outage > warmup; i++)
+    {
+        scheduleEvent(EVENT_STOP, warmup + (uint64_t)(getRandomUniform() * (last_outage - warmup)),
+                      (int)(getRandomUniform() * coupler_count));
+    }
+
+    if (TRANSPORT == TRANSPORT_UDP)
+    {
+        EPOLL_FD = epoll_create1(0);
+        for (i = 0; i < coupler_count; i++)
+        {
+            if (openCouplerSocket(&COUPLER_LIST[i], i) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static void cleanupSimulation(void)
+{
+    int i;
+
+    for (i = 0; i < COUPLER_COUNT; i++)
+    {
+        if (COUPLER_LIST[i].socket >= 0)
+            close(COUPLER_LIST[i].socket);
+        free(COUPLER_LIST[i].watcher_list);
+    }
+    if (EPOLL_FD >= 0)
+        close(EPOLL_FD);
+    EPOLL_FD = -1;
+    free(COUPLER_LIST);
+    free(LINK_STATE_LIST);
+}
+
+static void runSimulation(void)
+{
+    /*
+     * Process events in time order until the end of the run.
+     */
+    simulation_event_t event;
+
+    EPOCH = getMonotonicNanoSeconds();
+    while (EVENT_COUNT > 0)
+    {
+        popEvent(&event);
+        if (event.time > END_TIME)
+            break;
+        if (TRANSPORT == TRANSPORT_UDP)
+            pollSocketList(event.time);
+        else if (REAL_TIME)
+            sleepUntilMonotonicNanoSeconds(EPOCH + event.time);
+
+        switch (event.type)
+        {
+        case EVENT_PUBLISH:
+            scheduleEvent(EVENT_PUBLISH, event.time + INTERVAL_NS, event.coupler_id);
+            if (!COUPLER_LIST[event.coupler_id].stopped)
+                publishHeartBeat(event.coupler_id, event.time);
+            break;
+        case EVENT_CHECK:
+            scheduleEvent(EVENT_CHECK, event.time + INTERVAL_NS, event.coupler_id);
+            checkHeartBeat(&COUPLER_LIST[event.coupler_id], event.time);
+            break;
+        case EVENT_DELIVER:
+            // a stopped coupler's link is down
+            if (!COUPLER_LIST[event.coupler_id].stopped)
+                receiveHeartBeat(&COUPLER_LIST[event.coupler_id], event.peer_id, event.sequence,
+                                 event.send_timestamp, event.time);
+            break;
+        case EVENT_STOP:
+            stopCoupler(event.coupler_id, event.time);
+            break;
+        case EVENT_START:
+            startCoupler(event.coupler_id, event.time);
+            break;
+        }
+    }
+}
+
+/* ================ Report ======================= */
+
+static void printResult(FILE *csv_file)
+{
+    /*
+     * Print the row of a run, also as CSV.
+     */
+    int i, j;
+    uint64_t missed = 0, pair_count = 0, cpu_max = 0, cpu_sum = 0;
+    double seconds = (double)(END_TIME - NANO_SECONDS_PER_SECOND) / NANO_SECONDS_PER_SECOND;
+    double false_rate, cpu_mean;
+    liveness_table_t *table;
+
+    for (i = 0; i < COUPLER_COUNT; i++)
+    {
+        table = &COUPLER_LIST[i].table;
+        pair_count += table->watched_count;
+        for (j = 0; j < table->watched_count; j++)
+            missed += table->peer_list[table->watched_id_list[j]].missed_count;
+        cpu_sum += COUPLER_LIST[i].cpu_time;
+        if (COUPLER_LIST[i].cpu_time > cpu_max)
+            cpu_max = COUPLER_LIST[i].cpu_time;
+    }
+    false_rate = pair_count > 0 ? FALSE_DOWN_COUNT / (pair_count * seconds / 3600.0) : 0.0;
+    // us of handler time per second of run
+    cpu_mean = cpu_sum / (COUPLER_COUNT * seconds) / 1e3;
+
+    printf("%-6s %8d %10llu %8llu %8llu %8llu %8llu %8llu %8llu %12.4f %11.1f %11.1f %11.1f %11.1f %8.2f %8.2f\n",
+           TOPOLOGY_NAME_LIST[TOPOLOGY], COUPLER_COUNT, (unsigned long long)HEART_BEAT_COUNT,
+           (unsigned long long)missed, (unsigned long long)DETECTION_COUNT,
+           (unsigned long long)MISSED_DETECTION_COUNT, (unsigned long long)FALSE_SUSPECT_COUNT,
+           (unsigned long long)FALSE_DOWN_COUNT, (unsigned long long)FALSE_SAFE_MODE_COUNT, false_rate,
+           getMetricMean(&DETECTION_LATENCY) / 1e6, getMetricPercentile(&DETECTION_LATENCY, 50.0) / 1e6,
+           getMetricPercentile(&DETECTION_LATENCY, 99.0) / 1e6, DETECTION_LATENCY.max / 1e6,
+           cpu_mean, cpu_max / seconds / 1e3);
+    if (csv_file != NULL)
+    {
+        fprintf(csv_file, "%s,%d,%.1f,%.1f,%.4f,%.1f,%.1f,%.1f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,"
+                          "%.4f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f\n",
+                TOPOLOGY_NAME_LIST[TOPOLOGY], COUPLER_COUNT, INTERVAL, TIMEOUT, LOSS, BURST_LENGTH, DELAY, JITTER,
+                (unsigned long long)HEART_BEAT_COUNT, (unsigned long long)DROPPED_COUNT,
+                (unsigned long long)missed, (unsigned long long)DETECTION_COUNT,
+                (unsigned long long)MISSED_DETECTION_COUNT, (unsigned long long)FALSE_SUSPECT_COUNT,
+                (unsigned long long)FALSE_DOWN_COUNT, (unsigned long long)SAFE_MODE_COUNT,
+                (unsigned long long)FALSE_SAFE_MODE_COUNT, false_rate,
+                getMetricMean(&DETECTION_LATENCY) / 1e3, getMetricPercentile(&DETECTION_LATENCY, 50.0) / 1e3,
+                getMetricPercentile(&DETECTION_LATENCY, 99.0) / 1e3, DETECTION_LATENCY.max / 1e3,
+                cpu_mean, cpu_max / seconds / 1e3);
+        fflush(csv_file);
+    }
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    int option, run;
+    char *count;
+    FILE *csv_file = NULL;
+    const char *usage = "Usage: %s [-n <couplers>[,<couplers>...]] [-T <mesh|ring[:k]|star>]\n"
+                        "\t[-i <interval ms>] [-t <timeout ms>] [-l <loss 0..1>] [-b <burst length>]\n"
+                        "\t[-d <delay ms>] [-j <jitter ms>] [-D <duration s>] [-f <outages>]\n"
+                        "\t[-O <outage ms>] [-x <mem|udp>] [-R] [-S <seed>] [-o <csv file>]\n";
+
+    while ((option = getopt(argc, argv, "n:T:i:t:l:b:d:j:D:f:O:x:RS:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'n':
+            for (RUN_COUNT = 0, count = strtok(optarg, ","); count != NULL && RUN_COUNT < MAX_SIMULATION_RUN_COUNT;
+                 count = strtok(NULL, ","))
+                COUPLER_COUNT_LIST[RUN_COUNT++] = atoi(count);
+            break;
+        case 'T':
+            TOPOLOGY = parseTopology(optarg);
+            break;
+        case 'i':
+            INTERVAL = atof(optarg);
+            break;
+        case 't':
+            TIMEOUT = atof(optarg);
+            break;
+        case 'l':
+            LOSS = atof(optarg);
+            break;
+        case 'b':
+            BURST_LENGTH = atof(optarg);
+            break;
+        case 'd':
+            DELAY = atof(optarg);
+            break;
+        case 'j':
+            JITTER = atof(optarg);
+            break;
+        case 'D':
+            DURATION = atof(optarg);
+            break;
+        case 'f':
+            OUTAGE_COUNT = atoi(optarg);
+            break;
+        case 'O':
+            OUTAGE = atof(optarg);
+            break;
+        case 'x':
+            TRANSPORT = strcmp(optarg, "udp") == 0 ? TRANSPORT_UDP : strcmp(optarg, "mem") == 0 ? TRANSPORT_MEM : -1;
+            break;
+        case 'R':
+            REAL_TIME = true;
+            break;
+        case 'S':
+            SEED = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            CSV_PATH = optarg;
+            break;
+        default:
+            fprintf(stderr, usage, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (TIMEOUT == 0)
+        TIMEOUT = LIVENESS_DEFAULT_DOWN_HEART_BEAT_COUNT * INTERVAL;
+    if (OUTAGE == 0)
+        OUTAGE = 3 * TIMEOUT;
+    for (run = 0; run < RUN_COUNT; run++)
+    {
+        if (COUPLER_COUNT_LIST[run] < 2 || COUPLER_COUNT_LIST[run] > MAX_COUPLER_COUNT)
+            TOPOLOGY = -1;
+    }
+    if (RUN_COUNT == 0 || TOPOLOGY < 0 || TRANSPORT < 0 || INTERVAL <= 0 || TIMEOUT <= 0 || LOSS < 0 ||
+        LOSS >= 1 || BURST_LENGTH < 1 || DELAY < 0 || JITTER < 0 || DURATION <= 0 || OUTAGE_COUNT < 0)
+    {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    INTERVAL_NS = (uint64_t)(INTERVAL * NANO_SECONDS_PER_MILLI_SECOND);
+    DOWN_TIMEOUT_NS = (uint64_t)(TIMEOUT * NANO_SECONDS_PER_MILLI_SECOND);
+    DELAY_NS = (uint64_t)(DELAY * NANO_SECONDS_PER_MILLI_SECOND);
+    JITTER_NS = (uint64_t)(JITTER * NANO_SECONDS_PER_MILLI_SECOND);
+    OUTAGE_NS = (uint64_t)(OUTAGE * NANO_SECONDS_PER_MILLI_SECOND);
+    END_TIME = NANO_SECONDS_PER_SECOND + (uint64_t)(DURATION * NANO_SECONDS_PER_SECOND);
+
+    if (CSV_PATH != NULL && (csv_file = fopen(CSV_PATH, "w")) == NULL)
+        perror(CSV_PATH);
+    if (csv_file != NULL)
+        fprintf(csv_file, "topology,couplers,interval_ms,timeout_ms,loss,burst_length,delay_ms,jitter_ms,"
+                          "heart_beats,dropped,missed,detections,missed_detections,false_suspects,false_downs,"
+                          "safe_modes,false_safe_modes,false_downs_per_pair_hour,"
+                          "detect_mean_us,detect_p50_us,detect_p99_us,detect_max_us,cpu_mean_us,cpu_max_us\n");
+
+    printf("transport=%s%s interval=%.1f ms timeout=%.1f ms loss=%.4f burst=%.1f delay=%.1f ms jitter=%.1f ms "
+           "duration=%.0f s outages=%d of %.0f ms watch=%s",
+           TRANSPORT == TRANSPORT_UDP ? "udp" : "mem", TRANSPORT == TRANSPORT_MEM && !REAL_TIME ? " (simulated time)" : "",
+           INTERVAL, TIMEOUT, LOSS, BURST_LENGTH, DELAY, JITTER, DURATION, OUTAGE_COUNT, OUTAGE,
+           TOPOLOGY_NAME_LIST[TOPOLOGY]);
+    if (TOPOLOGY == TOPOLOGY_RING)
+        printf(":%d", RING_WATCH_COUNT);
+    printf("\n%-6s %8s %10s %8s %8s %8s %8s %8s %8s %12s %11s %11s %11s %11s %8s %8s\n", "watch", "couplers",
+           "beats", "missed", "detect", "undetect", "f_susp", "f_down", "f_safe", "f_down/p/h", "det_mean_ms",
+           "det_p50_ms", "det_p99_ms", "det_max_ms", "cpu_us/s", "cpu_max");
+
+    for (run = 0; run < RUN_COUNT; run++)
+    {
+        if (setupSimulation(COUPLER_COUNT_LIST[run]) < 0)
+        {
+            cleanupSimulation();
+            return EXIT_FAILURE;
+        }
+        runSimulation();
+        printResult(csv_file);
+        cleanupSimulation();
+    }
+    if (csv_file != NULL)
+        fclose(csv_file);
+    return EXIT_SUCCESS;
+}
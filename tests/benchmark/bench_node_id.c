@@ -0,0 +1,139 @@
+/*
+ * Micro benchmark of Read / Write service latency of the open62541 nodestore
+ * for string NodeIds (ns=1;s=i2c0.relay0) vs numeric NodeIds (ns=1;i=1000).
+ *
+ * The same number of Int32 variables is created once with string and once
+ * with numeric NodeIds (same BrowseNames), then every variable is read and
+ * written in a scattered order through UA_Server_read / UA_Server_write
+ * which run the same per-node operation as the Read / Write services.
+ * NodeIds are resolved once before timing, like the coupler does at startup.
+ *
+ * Usage: ./bench_node_id [node count] [iterations]
+ *   ./bench_node_id 1024 100
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+
+#include "../../coupler/node_id.h"
+
+/* ================ Helpers ====================== */
+
+static uint64_t nowNanoSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void addBenchmarkVariable(UA_Server *server, const UA_NodeId node_id, char *browse_name)
+{
+    UA_Int32 value = 0;
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    UA_Variant_setScalar(&attr.value, &value, &UA_TYPES[UA_TYPES_INT32]);
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", browse_name);
+    attr.dataType = UA_TYPES[UA_TYPES_INT32].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Server_addVariableNode(server, node_id,
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, browse_name),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              attr, NULL, NULL);
+}
+
+static void benchmarkNodeIdList(UA_Server *server, node_id_t *node_id_list, int count,
+                                long iterations, double *read_ns, double *write_ns)
+{
+    /*
+     * Read and write all nodes in a scattered (but fixed) order.
+     */
+    int i, j;
+    long k;
+    uint64_t start;
+    UA_Int32 value;
+    UA_Variant variant;
+    UA_StatusCode status = UA_STATUSCODE_GOOD;
+
+    start = nowNanoSeconds();
+    for (k = 0; k < iterations; k++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            // 7919 is a prime so every node is visited once per round
+            j = (int)(((long)i * 7919) % count);
+            status |= UA_Server_readValue(server, node_id_list[j].node_id, &variant);
+            UA_Variant_clear(&variant);
+        }
+    }
+    *read_ns = (double)(nowNanoSeconds() - start) / (iterations * count);
+
+    start = nowNanoSeconds();
+    for (k = 0; k < iterations; k++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            j = (int)(((long)i * 7919) % count);
+            value = (UA_Int32)k;
+            UA_Variant_setScalar(&variant, &value, &UA_TYPES[UA_TYPES_INT32]);
+            status |= UA_Server_writeValue(server, node_id_list[j].node_id, variant);
+        }
+    }
+    *write_ns = (double)(nowNanoSeconds() - start) / (iterations * count);
+
+    if (status != UA_STATUSCODE_GOOD)
+        printf("warning: some Read / Write operations failed\n");
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1024;
+    long iterations = argc > 2 ? atol(argv[2]) : 100;
+    int i;
+    char name[MAX_NODE_ID_NAME_LENGTH];
+    double string_read_ns, string_write_ns, numeric_read_ns, numeric_write_ns;
+    node_id_t *string_node_id_list = calloc(count, sizeof(node_id_t));
+    node_id_t *numeric_node_id_list = calloc(count, sizeof(node_id_t));
+    UA_Server *server = UA_Server_new();
+
+    if (string_node_id_list == NULL || numeric_node_id_list == NULL || server == NULL)
+        return EXIT_FAILURE;
+    UA_ServerConfig_setDefault(UA_Server_getConfig(server));
+
+    // same BrowseNames, only the NodeId differs
+    for (i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "i2c%d.relay%d", i / 4, i % 4);
+        ENABLE_NUMERIC_NODE_ID = false;
+        resolveNodeId(&string_node_id_list[i], name, 0);
+        addBenchmarkVariable(server, string_node_id_list[i].node_id, name);
+
+        ENABLE_NUMERIC_NODE_ID = true;
+        resolveNodeId(&numeric_node_id_list[i], name, MOD_IO_NUMERIC_NODE_ID_BASE + i);
+        addBenchmarkVariable(server, numeric_node_id_list[i].node_id, name);
+    }
+
+    benchmarkNodeIdList(server, string_node_id_list, count, iterations,
+                        &string_read_ns, &string_write_ns);
+    benchmarkNodeIdList(server, numeric_node_id_list, count, iterations,
+                        &numeric_read_ns, &numeric_write_ns);
+
+    printf("nodes=%d iterations=%ld\n", count, iterations);
+    printf("string  NodeId: read %8.1f ns/op, write %8.1f ns/op\n", string_read_ns, string_write_ns);
+    printf("numeric NodeId: read %8.1f ns/op, write %8.1f ns/op\n", numeric_read_ns, numeric_write_ns);
+    printf("speedup: read %.2fx, write %.2fx\n",
+           string_read_ns / numeric_read_ns, string_write_ns / numeric_write_ns);
+
+    UA_Server_delete(server);
+    free(string_node_id_list);
+    free(numeric_node_id_list);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,521 @@
+/*
+ * OPC UA client load generator: how many PLCs / HMIs one coupler serves.
+ *
+ * Opens N sessions to a coupler (one thread and one open62541 client per
+ * session), each of them driving a mix of:
+ *   - Read of i2c*.relay* / in* / ain* (a batch of nodes per request)
+ *   - Write toggling i2c*.relay*
+ *   - Browse of the Objects folder holding all MOD-IO variables
+ *   - monitored items (data change) on the same variables
+ * at target rates per session. Requests are sent on a fixed schedule (open
+ * loop) and their latency is measured from the time they were due, so a
+ * server falling behind shows up in the latency instead of just lowering
+ * the request rate.
+ *
+ * Throughput and latency (mean, p50, p99, p999, max) of every service are
+ * printed as a table and written as CSV (-o) for compare_benchmark.py. The
+ * latency of a data change notification is its delivery time minus its
+ * server timestamp (same host clock on localhost).
+ *
+ * Run against a coupler on simulated I2C buses:
+ *   ./server -m 2 -s 0x58,0x59
+ *   ./bench_opc_ua_load -s 8 -n 2 -r 50 -w 10 -b 1 -M 12 -d 30
+ *
+ * Usage: ./bench_opc_ua_load [-u <url>] [-s <sessions>] [-d <seconds>] [-n <slaves>] [-e]
+ *                            [-r <reads/s>] [-k <nodes per read>] [-w <writes/s>] [-b <browses/s>]
+ *                            [-M <monitored items>] [-i <publishing interval ms>] [-o <csv file>]
+ */
+
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <open62541/client.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+
+#include "../../coupler/time_base.h"
+#include "../../coupler/metrics.h"
+#include "../../coupler/node_id.h"
+
+#define MAX_LOAD_SESSION_COUNT 256
+#define MAX_LOAD_SLAVE_COUNT 32
+#define MAX_LOAD_READ_NODE_COUNT 64
+#define MAX_LOAD_MONITORED_ITEM_COUNT 1024
+
+// as mod_io_opc_ua.h: 4 relays, 4 digital inputs, 4 analog inputs per slave
+#define LOAD_RELAY_COUNT 4
+#define LOAD_CHANNEL_COUNT 12
+
+// services
+#define LOAD_READ 0
+#define LOAD_WRITE 1
+#define LOAD_BROWSE 2
+#define LOAD_NOTIFICATION 3
+#define LOAD_OP_COUNT 4
+
+static const char *LOAD_OP_NAME_LIST[] = {"read", "write", "browse", "notification"};
+
+typedef struct {
+    int index;
+    UA_Client *client;
+    pthread_t thread;
+    UA_UInt32 subscription_id;
+    unsigned int read_cursor;
+    unsigned int write_cursor;
+    uint64_t error_list[LOAD_OP_COUNT];
+    metric_histogram_t latency_list[LOAD_OP_COUNT];
+} load_session_t;
+
+// settings
+static char *SERVER_URL = "opc.tcp://localhost:4840";
+static int SESSION_COUNT = 4;
+static int DURATION = 10;                          // s
+static int SLAVE_COUNT = 1;
+static double RATE_LIST[LOAD_OP_COUNT] = {100, 10, 1, 0};  // per session and second
+static int READ_NODE_COUNT = 1;
+static int MONITORED_ITEM_COUNT = 0;               // per session
+static double PUBLISHING_INTERVAL = 100;           // ms
+static char *CSV_PATH = NULL;
+
+// MOD-IO variables: all channels, relays only
+static node_id_t CHANNEL_NODE_ID_LIST[MAX_LOAD_SLAVE_COUNT * LOAD_CHANNEL_COUNT];
+static node_id_t RELAY_NODE_ID_LIST[MAX_LOAD_SLAVE_COUNT * LOAD_RELAY_COUNT];
+static int CHANNEL_COUNT = 0;
+static int RELAY_COUNT = 0;
+
+static load_session_t SESSION_LIST[MAX_LOAD_SESSION_COUNT];
+static uint64_t START_TIME;                        // monotonic ns
+static uint64_t STOP_TIME;
+
+/* ================ Helpers ====================== */
+
+static void resolveChannelNodeIdList()
+{
+    /*
+     * Resolve the NodeIds of all channels as the coupler names them
+     * (string or, with -e, numeric).
+     */
+    int slave, j;
+    char name[MAX_NODE_ID_NAME_LENGTH];
+    const char *kind;
+
+    for (slave = 0; slave < SLAVE_COUNT; slave++)
+    {
+        for (j = 0; j < LOAD_CHANNEL_COUNT; j++)
+        {
+            kind = j < LOAD_RELAY_COUNT ? "relay" : j < 2 * LOAD_RELAY_COUNT ? "in" : "ain";
+            snprintf(name, sizeof(name), "i2c%d.%s%d", slave, kind, j % LOAD_RELAY_COUNT);
+            resolveNodeId(&CHANNEL_NODE_ID_LIST[CHANNEL_COUNT++], name,
+                          MOD_IO_NUMERIC_NODE_ID_BASE + slave * LOAD_CHANNEL_COUNT + j);
+            if (j < LOAD_RELAY_COUNT)
+                resolveNodeId(&RELAY_NODE_ID_LIST[RELAY_COUNT++], name,
+                              MOD_IO_NUMERIC_NODE_ID_BASE + slave * LOAD_CHANNEL_COUNT + j);
+        }
+    }
+}
+
+static void mergeMetricHistogram(metric_histogram_t *histogram, const metric_histogram_t *other)
+{
+    unsigned int i;
+
+    histogram->count += other->count;
+    histogram->sum += other->sum;
+    if (other->max > histogram->max)
+        histogram->max = other->max;
+    for (i = 0; i < METRIC_BUCKET_COUNT; i++)
+        histogram->bucket_list[i] += other->bucket_list[i];
+}
+
+/* ================ Services ===================== */
+
+static int readChannelList(load_session_t *session)
+{
+    /*
+     * Read the value of the next batch of channels in one request.
+     */
+    int i;
+    int retval = 0;
+    UA_ReadValueId item_list[MAX_LOAD_READ_NODE_COUNT];
+    UA_ReadRequest request;
+    UA_ReadResponse response;
+
+    UA_ReadRequest_init(&request);
+    for (i = 0; i < READ_NODE_COUNT; i++)
+    {
+        UA_ReadValueId_init(&item_list[i]);
+        item_list[i].nodeId = CHANNEL_NODE_ID_LIST[session->read_cursor++ % CHANNEL_COUNT].node_id;
+        item_list[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    request.nodesToRead = item_list;
+    request.nodesToReadSize = READ_NODE_COUNT;
+
+    response = UA_Client_Service_read(session->client, request);
+    if (response.responseHeader.serviceResult != UA_STATUSCODE_GOOD ||
+        response.resultsSize != (size_t)READ_NODE_COUNT)
+        retval = -1;
+    for (i = 0; retval == 0 && i < READ_NODE_COUNT; i++)
+    {
+        if (response.results[i].hasStatus && response.results[i].status != UA_STATUSCODE_GOOD)
+            retval = -1;
+    }
+    UA_ReadResponse_clear(&response);
+    return retval;
+}
+
+static int toggleRelay(load_session_t *session)
+{
+    /*
+     * Write the next relay, on and off in turns.
+     */
+    UA_Int32 value = (session->write_cursor / RELAY_COUNT) & 1;
+    UA_Variant variant;
+    const UA_NodeId *node_id = &RELAY_NODE_ID_LIST[session->write_cursor++ % RELAY_COUNT].node_id;
+
+    UA_Variant_setScalar(&variant, &value, &UA_TYPES[UA_TYPES_INT32]);
+    return UA_Client_writeValueAttribute(session->client, *node_id, &variant) == UA_STATUSCODE_GOOD ? 0 : -1;
+}
+
+static int browseObjectsFolder(load_session_t *session)
+{
+    /*
+     * Browse all references of the Objects folder, as an HMI listing the
+     * coupler's variables.
+     */
+    int retval = 0;
+    UA_BrowseRequest request;
+    UA_BrowseResponse response;
+
+    UA_BrowseRequest_init(&request);
+    request.requestedMaxReferencesPerNode = 0;
+    request.nodesToBrowse = UA_BrowseDescription_new();
+    request.nodesToBrowseSize = 1;
+    request.nodesToBrowse[0].nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    request.nodesToBrowse[0].browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    request.nodesToBrowse[0].includeSubtypes = true;
+    request.nodesToBrowse[0].resultMask = UA_BROWSERESULTMASK_ALL;
+
+    response = UA_Client_Service_browse(session->client, request);
+    if (response.responseHeader.serviceResult != UA_STATUSCODE_GOOD || response.resultsSize != 1 ||
+        response.results[0].statusCode != UA_STATUSCODE_GOOD)
+        retval = -1;
+    UA_BrowseResponse_clear(&response);
+    UA_BrowseRequest_clear(&request);
+    return retval;
+}
+
+static void handleDataChange(UA_Client *client, UA_UInt32 subscription_id, void *subscription_context,
+                             UA_UInt32 monitored_item_id, void *monitored_item_context, UA_DataValue *value)
+{
+    /*
+     * Record the delivery latency of a notification (only while measuring).
+     */
+    load_session_t *session = (load_session_t *)subscription_context;
+    UA_DateTime now = UA_DateTime_now();
+    uint64_t monotonic_now = getMonotonicNanoSeconds();
+
+    if (monotonic_now < START_TIME || monotonic_now >= STOP_TIME)
+        return;
+    if (!value->hasServerTimestamp || (value->hasStatus && value->status != UA_STATUSCODE_GOOD))
+    {
+        session->error_list[LOAD_NOTIFICATION]++;
+        recordMetric(&session->latency_list[LOAD_NOTIFICATION], 0);
+        return;
+    }
+    recordMetric(&session->latency_list[LOAD_NOTIFICATION],
+                 now > value->serverTimestamp ? (uint64_t)(now - value->serverTimestamp) * 100 : 0);
+}
+
+static int subscribeChannelList(load_session_t *session)
+{
+    /*
+     * Create one subscription monitoring MONITORED_ITEM_COUNT channels.
+     */
+    int i;
+    UA_CreateSubscriptionRequest request = UA_CreateSubscriptionRequest_default();
+    UA_CreateSubscriptionResponse response;
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateResult result;
+
+    request.requestedPublishingInterval = PUBLISHING_INTERVAL;
+    response = UA_Client_Subscriptions_create(session->client, request, session, NULL, NULL);
+    if (response.responseHeader.serviceResult != UA_STATUSCODE_GOOD)
+        return -1;
+    session->subscription_id = response.subscriptionId;
+
+    for (i = 0; i < MONITORED_ITEM_COUNT; i++)
+    {
+        item = UA_MonitoredItemCreateRequest_default(CHANNEL_NODE_ID_LIST[i % CHANNEL_COUNT].node_id);
+        item.requestedParameters.samplingInterval = PUBLISHING_INTERVAL;
+        result = UA_Client_MonitoredItems_createDataChange(session->client, session->subscription_id,
+                                                           UA_TIMESTAMPSTORETURN_BOTH, item, NULL,
+                                                           handleDataChange, NULL);
+        if (result.statusCode != UA_STATUSCODE_GOOD)
+            return -1;
+    }
+    return 0;
+}
+
+/* ================ Sessions ===================== */
+
+static int runService(load_session_t *session, int op)
+{
+    switch (op)
+    {
+    case LOAD_READ:
+        return readChannelList(session);
+    case LOAD_WRITE:
+        return toggleRelay(session);
+    default:
+        return browseObjectsFolder(session);
+    }
+}
+
+static void waitUntil(load_session_t *session, uint64_t deadline)
+{
+    /*
+     * Wait for the next request, meanwhile receive notifications.
+     */
+    uint64_t now = getMonotonicNanoSeconds();
+
+    if (MONITORED_ITEM_COUNT > 0)
+    {
+        // at least once: also sends the publish requests when behind schedule
+        do
+        {
+            UA_Client_run_iterate(session->client,
+                                  now < deadline ? (deadline - now) / NANO_SECONDS_PER_MILLI_SECOND : 0);
+            now = getMonotonicNanoSeconds();
+        } while (now + NANO_SECONDS_PER_MILLI_SECOND <= deadline);
+    }
+    if (now < deadline)
+    {
+        while (sleepUntilMonotonicNanoSeconds(deadline) == EINTR)
+            ;
+    }
+}
+
+static void *runSession(void *argument)
+{
+    /*
+     * Send every service at its rate until the end of the run. Requests
+     * of a service are staggered over the sessions.
+     */
+    load_session_t *session = (load_session_t *)argument;
+    uint64_t period_list[LOAD_OP_COUNT];
+    uint64_t due_list[LOAD_OP_COUNT];
+    uint64_t due;
+    int op, next;
+
+    for (op = 0; op < LOAD_NOTIFICATION; op++)
+    {
+        period_list[op] = RATE_LIST[op] > 0 ? (uint64_t)(NANO_SECONDS_PER_SECOND / RATE_LIST[op]) : 0;
+        due_list[op] = START_TIME + period_list[op] * session->index / SESSION_COUNT;
+    }
+
+    for (;;)
+    {
+        next = -1;
+        for (op = 0; op < LOAD_NOTIFICATION; op++)
+        {
+            if (period_list[op] > 0 && (next < 0 || due_list[op] < due_list[next]))
+                next = op;
+        }
+        due = next < 0 ? STOP_TIME : due_list[next];
+        // requests still due when behind schedule are dropped at the end
+        if (due >= STOP_TIME || getMonotonicNanoSeconds() >= STOP_TIME)
+        {
+            waitUntil(session, STOP_TIME);
+            break;
+        }
+        waitUntil(session, due);
+
+        if (runService(session, next) < 0)
+            session->error_list[next]++;
+        recordMetric(&session->latency_list[next], getMonotonicNanoSeconds() - due);
+        due_list[next] += period_list[next];
+    }
+    return NULL;
+}
+
+static int connectSession(load_session_t *session)
+{
+    session->client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(session->client));
+    if (UA_Client_connect(session->client, SERVER_URL) != UA_STATUSCODE_GOOD)
+    {
+        printf("Error connecting session %d to %s.\n", session->index, SERVER_URL);
+        return -1;
+    }
+    if (MONITORED_ITEM_COUNT > 0 && subscribeChannelList(session) < 0)
+    {
+        printf("Error subscribing session %d.\n", session->index);
+        return -1;
+    }
+    return 0;
+}
+
+static void disconnectSessionList()
+{
+    int i;
+
+    for (i = 0; i < SESSION_COUNT; i++)
+    {
+        if (SESSION_LIST[i].client == NULL)
+            continue;
+        UA_Client_disconnect(SESSION_LIST[i].client);
+        UA_Client_delete(SESSION_LIST[i].client);
+        SESSION_LIST[i].client = NULL;
+    }
+}
+
+/* ================ Report ======================= */
+
+static void printResultList()
+{
+    /*
+     * Print a row per service over all sessions, also as CSV.
+     */
+    static metric_histogram_t latency;
+    FILE *csv_file = NULL;
+    uint64_t errors;
+    double target, achieved;
+    int op, i;
+
+    if (CSV_PATH != NULL && (csv_file = fopen(CSV_PATH, "w")) == NULL)
+        perror(CSV_PATH);
+    if (csv_file != NULL)
+        fprintf(csv_file, "op,sessions,target_per_second,ops_per_second,count,errors,"
+                          "mean_us,p50_us,p99_us,p999_us,max_us\n");
+
+    printf("url=%s sessions=%d slaves=%d duration=%d s nodes/read=%d monitored items/session=%d\n",
+           SERVER_URL, SESSION_COUNT, SLAVE_COUNT, DURATION, READ_NODE_COUNT, MONITORED_ITEM_COUNT);
+    printf("%-12s %10s %10s %10s %8s %10s %10s %10s %10s %10s\n", "op", "target/s", "ops/s", "count",
+           "errors", "mean_us", "p50_us", "p99_us", "p999_us", "max_us");
+    for (op = 0; op < LOAD_OP_COUNT; op++)
+    {
+        memset(&latency, 0, sizeof(latency));
+        errors = 0;
+        for (i = 0; i < SESSION_COUNT; i++)
+        {
+            mergeMetricHistogram(&latency, &SESSION_LIST[i].latency_list[op]);
+            errors += SESSION_LIST[i].error_list[op];
+        }
+        if (latency.count == 0)
+            continue;
+        target = op == LOAD_NOTIFICATION ? 0 : RATE_LIST[op] * SESSION_COUNT;
+        achieved = (double)latency.count / DURATION;
+
+        printf("%-12s %10.1f %10.1f %10llu %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", LOAD_OP_NAME_LIST[op],
+               target, achieved, (unsigned long long)latency.count, (unsigned long long)errors,
+               getMetricMean(&latency) / 1e3, getMetricPercentile(&latency, 50.0) / 1e3,
+               getMetricPercentile(&latency, 99.0) / 1e3, getMetricPercentile(&latency, 99.9) / 1e3,
+               latency.max / 1e3);
+        if (csv_file != NULL)
+            fprintf(csv_file, "%s,%d,%.1f,%.1f,%llu,%llu,%.2f,%.2f,%.2f,%.2f,%.2f\n", LOAD_OP_NAME_LIST[op],
+                    SESSION_COUNT, target, achieved, (unsigned long long)latency.count,
+                    (unsigned long long)errors, getMetricMean(&latency) / 1e3,
+                    getMetricPercentile(&latency, 50.0) / 1e3, getMetricPercentile(&latency, 99.0) / 1e3,
+                    getMetricPercentile(&latency, 99.9) / 1e3, latency.max / 1e3);
+    }
+    if (csv_file != NULL)
+        fclose(csv_file);
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    int option;
+    int i;
+    const char *usage = "Usage: %s [-u <url>] [-s <sessions>] [-d <seconds>] [-n <slaves>] [-e]\n"
+                        "\t[-r <reads/s>] [-k <nodes per read>] [-w <writes/s>] [-b <browses/s>]\n"
+                        "\t[-M <monitored items>] [-i <publishing interval ms>] [-o <csv file>]\n";
+
+    while ((option = getopt(argc, argv, "u:s:d:n:er:k:w:b:M:i:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'u':
+            SERVER_URL = optarg;
+            break;
+        case 's':
+            SESSION_COUNT = atoi(optarg);
+            break;
+        case 'd':
+            DURATION = atoi(optarg);
+            break;
+        case 'n':
+            SLAVE_COUNT = atoi(optarg);
+            break;
+        case 'e':
+            ENABLE_NUMERIC_NODE_ID = true;
+            break;
+        case 'r':
+            RATE_LIST[LOAD_READ] = atof(optarg);
+            break;
+        case 'k':
+            READ_NODE_COUNT = atoi(optarg);
+            break;
+        case 'w':
+            RATE_LIST[LOAD_WRITE] = atof(optarg);
+            break;
+        case 'b':
+            RATE_LIST[LOAD_BROWSE] = atof(optarg);
+            break;
+        case 'M':
+            MONITORED_ITEM_COUNT = atoi(optarg);
+            break;
+        case 'i':
+            PUBLISHING_INTERVAL = atof(optarg);
+            break;
+        case 'o':
+            CSV_PATH = optarg;
+            break;
+        default:
+            fprintf(stderr, usage, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (SESSION_COUNT < 1 || SESSION_COUNT > MAX_LOAD_SESSION_COUNT || DURATION < 1 ||
+        SLAVE_COUNT < 1 || SLAVE_COUNT > MAX_LOAD_SLAVE_COUNT ||
+        READ_NODE_COUNT < 1 || READ_NODE_COUNT > MAX_LOAD_READ_NODE_COUNT ||
+        MONITORED_ITEM_COUNT < 0 || MONITORED_ITEM_COUNT > MAX_LOAD_MONITORED_ITEM_COUNT ||
+        PUBLISHING_INTERVAL <= 0)
+    {
+        fprintf(stderr, usage, argv[0]);
+        return EXIT_FAILURE;
+    }
+    resolveChannelNodeIdList();
+
+    for (i = 0; i < SESSION_COUNT; i++)
+    {
+        SESSION_LIST[i].index = i;
+        if (connectSession(&SESSION_LIST[i]) < 0)
+        {
+            disconnectSessionList();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // all sessions start together once all threads are up
+    START_TIME = getMonotonicNanoSeconds() + 100 * NANO_SECONDS_PER_MILLI_SECOND;
+    STOP_TIME = START_TIME + (uint64_t)DURATION * NANO_SECONDS_PER_SECOND;
+    for (i = 0; i < SESSION_COUNT; i++)
+    {
+        pthread_create(&SESSION_LIST[i].thread, NULL, runSession, &SESSION_LIST[i]);
+    }
+    for (i = 0; i < SESSION_COUNT; i++)
+    {
+        pthread_join(SESSION_LIST[i].thread, NULL);
+    }
+
+    printResultList();
+    disconnectSessionList();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+/*
+ * One-way latency of Pub/Sub heart beats over UDP multicast vs raw Ethernet
+ * (ETH UADP), the coupler's "-T udp" and "-T eth" transports.
+ *
+ * The publisher sends a DataSet with a single UInt64 field: its
+ * CLOCK_MONOTONIC send time, taken right before each publish. The
+ * subscriber runs on another interface (or network namespace) of the same
+ * host and takes the difference to its CLOCK_MONOTONIC receive time, so no
+ * clock synchronization is needed. Both sides run their Writer- /
+ * ReaderGroup callbacks themselves (pubsubManagerCallback): the publisher
+ * at a fixed rate, the subscriber in a busy loop so its subscribing
+ * interval does not add up to the latency.
+ *
+ * Usage: ./bench_pubsub_latency <pub|sub> <udp|eth> <interface> [count] [interval ms]
+ *   ./bench_pubsub_latency sub eth veth1 1000 &
+ *   ./bench_pubsub_latency pub eth veth0 1000
+ *
+ * run_pubsub_latency.sh sets up a veth pair and runs both transports.
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <open62541/plugin/log_stdout.h>
+#include <open62541/plugin/pubsub_ethernet.h>
+#include <open62541/plugin/pubsub_udp.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+
+// normally defined by keep_alive.h
+char *DEFAULT_TRANSPORT_PROFILE = "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp";
+char *NETWORK_ADDRESS_URL_DATA_TYPE = "opc.udp://224.0.0.22:4841/";
+
+#include "../../coupler/pubsub_transport.h"
+
+#define BENCHMARK_PUBLISHER_ID 2235
+#define BENCHMARK_WRITER_GROUP_ID 101
+#define BENCHMARK_DATASET_WRITER_ID 62542
+
+// the subscriber gives up this long after the last expected message (ns)
+#define BENCHMARK_RECEIVE_GRACE (2 * NANO_SECONDS_PER_SECOND)
+
+/* ================ Helpers ====================== */
+
+static bool IS_PUBLISHER = false;
+
+// Writer- / ReaderGroup callback, run by the benchmark loop
+static UA_ServerCallback GROUP_CALLBACK = NULL;
+static void *GROUP_DATA = NULL;
+
+static UA_UInt64 SEND_TIMESTAMP = 0;
+static UA_DataValue SEND_DATA_VALUE;
+static UA_DataValue *SEND_DATA_VALUE_REFERENCE = &SEND_DATA_VALUE;
+
+static uint64_t *LATENCY_LIST = NULL;
+static long LATENCY_CAPACITY = 0;
+static long LATENCY_COUNT = 0;
+
+static UA_StatusCode addGroupCallback(UA_Server *server, UA_NodeId identifier,
+                                      UA_ServerCallback callback, void *data,
+                                      UA_Double interval_ms, UA_DateTime *baseTime,
+                                      UA_TimerPolicy timerPolicy, UA_UInt64 *callbackId)
+{
+    GROUP_CALLBACK = callback;
+    GROUP_DATA = data;
+    *callbackId = 1;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode changeGroupCallback(UA_Server *server, UA_NodeId identifier,
+                                         UA_UInt64 callbackId, UA_Double interval_ms,
+                                         UA_DateTime *baseTime, UA_TimerPolicy timerPolicy)
+{
+    return UA_STATUSCODE_GOOD;
+}
+
+static void removeGroupCallback(UA_Server *server, UA_NodeId identifier, UA_UInt64 callbackId)
+{
+    GROUP_CALLBACK = NULL;
+}
+
+static void setGroupCallbackLifecycle(UA_PubSub_CallbackLifecycle *lifecycle)
+{
+    lifecycle->addCustomCallback = addGroupCallback;
+    lifecycle->changeCustomCallback = changeGroupCallback;
+    lifecycle->removeCustomCallback = removeGroupCallback;
+}
+
+static UA_NodeId addConnection(UA_Server *server, const char *interface)
+{
+    UA_NodeId connectionId;
+    UA_PubSubConnectionConfig connectionConfig;
+    UA_NetworkAddressUrlDataType networkAddressUrl =
+        {UA_STRING((char *)interface), UA_STRING((char *)getPubSubNetworkAddressUrl())};
+
+    memset(&connectionConfig, 0, sizeof(connectionConfig));
+    connectionConfig.name = UA_STRING("Benchmark Connection");
+    connectionConfig.transportProfileUri = UA_STRING(DEFAULT_TRANSPORT_PROFILE);
+    connectionConfig.enabled = UA_TRUE;
+    UA_Variant_setScalar(&connectionConfig.address, &networkAddressUrl,
+                         &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+    connectionConfig.publisherId.numeric = IS_PUBLISHER ? BENCHMARK_PUBLISHER_ID : UA_UInt32_random();
+    if (UA_Server_addPubSubConnection(server, &connectionConfig, &connectionId) != UA_STATUSCODE_GOOD)
+    {
+        printf("error: can not open a %s connection on %s\n", DEFAULT_TRANSPORT_PROFILE, interface);
+        exit(EXIT_FAILURE);
+    }
+    return connectionId;
+}
+
+static void addPublisher(UA_Server *server, UA_NodeId connectionId, double interval_ms)
+{
+    UA_NodeId publishedDataSetId, variableId, dataSetFieldId, writerGroupId, dataSetWriterId;
+    UA_PublishedDataSetConfig publishedDataSetConfig;
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    UA_ValueBackend valueBackend;
+    UA_DataSetFieldConfig dataSetFieldConfig;
+    UA_WriterGroupConfig writerGroupConfig;
+    UA_DataSetWriterConfig dataSetWriterConfig;
+    UA_UadpWriterGroupMessageDataType *writerGroupMessage;
+
+    memset(&publishedDataSetConfig, 0, sizeof(publishedDataSetConfig));
+    publishedDataSetConfig.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+    publishedDataSetConfig.name = UA_STRING("Benchmark PDS");
+    UA_Server_addPublishedDataSet(server, &publishedDataSetConfig, &publishedDataSetId);
+
+    // the send time is read straight from SEND_TIMESTAMP (external value backend)
+    UA_Variant_setScalar(&attr.value, &SEND_TIMESTAMP, &UA_TYPES[UA_TYPES_UINT64]);
+    attr.dataType = UA_TYPES[UA_TYPES_UINT64].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, 1000),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "send_timestamp"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              attr, NULL, &variableId);
+    UA_DataValue_init(&SEND_DATA_VALUE);
+    UA_Variant_setScalar(&SEND_DATA_VALUE.value, &SEND_TIMESTAMP, &UA_TYPES[UA_TYPES_UINT64]);
+    SEND_DATA_VALUE.value.storageType = UA_VARIANT_DATA_NODELETE;
+    SEND_DATA_VALUE.hasValue = UA_TRUE;
+    memset(&valueBackend, 0, sizeof(valueBackend));
+    valueBackend.backendType = UA_VALUEBACKENDTYPE_EXTERNAL;
+    valueBackend.backend.external.value = &SEND_DATA_VALUE_REFERENCE;
+    UA_Server_setVariableNode_valueBackend(server, variableId, valueBackend);
+
+    memset(&dataSetFieldConfig, 0, sizeof(dataSetFieldConfig));
+    dataSetFieldConfig.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+    dataSetFieldConfig.field.variable.fieldNameAlias = UA_STRING("send_timestamp");
+    dataSetFieldConfig.field.variable.publishParameters.publishedVariable = variableId;
+    dataSetFieldConfig.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_Server_addDataSetField(server, publishedDataSetId, &dataSetFieldConfig, &dataSetFieldId);
+
+    memset(&writerGroupConfig, 0, sizeof(writerGroupConfig));
+    writerGroupConfig.name = UA_STRING("Benchmark WriterGroup");
+    writerGroupConfig.publishingInterval = interval_ms;
+    writerGroupConfig.enabled = UA_FALSE;
+    writerGroupConfig.writerGroupId = BENCHMARK_WRITER_GROUP_ID;
+    writerGroupConfig.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+    setGroupCallbackLifecycle(&writerGroupConfig.pubsubManagerCallback);
+    writerGroupMessage = UA_UadpWriterGroupMessageDataType_new();
+    writerGroupMessage->networkMessageContentMask =
+        (UA_UadpNetworkMessageContentMask)(UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID |
+        (UA_UadpNetworkMessageContentMask)UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER);
+    writerGroupConfig.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+    writerGroupConfig.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPWRITERGROUPMESSAGEDATATYPE];
+    writerGroupConfig.messageSettings.content.decoded.data = writerGroupMessage;
+    UA_Server_addWriterGroup(server, connectionId, &writerGroupConfig, &writerGroupId);
+    UA_UadpWriterGroupMessageDataType_delete(writerGroupMessage);
+
+    memset(&dataSetWriterConfig, 0, sizeof(dataSetWriterConfig));
+    dataSetWriterConfig.name = UA_STRING("Benchmark DataSetWriter");
+    dataSetWriterConfig.dataSetWriterId = BENCHMARK_DATASET_WRITER_ID;
+    dataSetWriterConfig.keyFrameCount = 10;
+    UA_Server_addDataSetWriter(server, writerGroupId, publishedDataSetId,
+                               &dataSetWriterConfig, &dataSetWriterId);
+    UA_Server_setWriterGroupOperational(server, writerGroupId);
+}
+
+static void afterWriteSendTimestamp(UA_Server *server,
+                                    const UA_NodeId *sessionId, void *sessionContext,
+                                    const UA_NodeId *nodeId, void *nodeContext,
+                                    const UA_NumericRange *range, const UA_DataValue *data)
+{
+    uint64_t now = getMonotonicNanoSeconds();
+
+    if (data->value.type != &UA_TYPES[UA_TYPES_UINT64])
+        return;
+    if (LATENCY_COUNT < LATENCY_CAPACITY)
+        LATENCY_LIST[LATENCY_COUNT++] = now - *(UA_UInt64 *)data->value.data;
+}
+
+static void addSubscriber(UA_Server *server, UA_NodeId connectionId)
+{
+    UA_NodeId readerGroupId, dataSetReaderId, variableId;
+    UA_ReaderGroupConfig readerGroupConfig;
+    UA_DataSetReaderConfig readerConfig;
+    UA_UInt16 publisherId = BENCHMARK_PUBLISHER_ID;
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    UA_ValueCallback callback;
+    UA_FieldTargetVariable targetVariable;
+
+    memset(&readerGroupConfig, 0, sizeof(readerGroupConfig));
+    readerGroupConfig.name = UA_STRING("Benchmark ReaderGroup");
+    // short receive timeout (us), the benchmark loop polls
+    readerGroupConfig.timeout = 100;
+    setGroupCallbackLifecycle(&readerGroupConfig.pubsubManagerCallback);
+    UA_Server_addReaderGroup(server, connectionId, &readerGroupConfig, &readerGroupId);
+
+    memset(&readerConfig, 0, sizeof(readerConfig));
+    readerConfig.name = UA_STRING("Benchmark DataSetReader");
+    readerConfig.publisherId.type = &UA_TYPES[UA_TYPES_UINT16];
+    readerConfig.publisherId.data = &publisherId;
+    readerConfig.writerGroupId = BENCHMARK_WRITER_GROUP_ID;
+    readerConfig.dataSetWriterId = BENCHMARK_DATASET_WRITER_ID;
+    UA_DataSetMetaDataType_init(&readerConfig.dataSetMetaData);
+    readerConfig.dataSetMetaData.name = UA_STRING("Benchmark DataSet");
+    readerConfig.dataSetMetaData.fieldsSize = 1;
+    readerConfig.dataSetMetaData.fields = (UA_FieldMetaData *)UA_Array_new(1, &UA_TYPES[UA_TYPES_FIELDMETADATA]);
+    UA_FieldMetaData_init(&readerConfig.dataSetMetaData.fields[0]);
+    UA_NodeId_copy(&UA_TYPES[UA_TYPES_UINT64].typeId, &readerConfig.dataSetMetaData.fields[0].dataType);
+    readerConfig.dataSetMetaData.fields[0].builtInType = UA_NS0ID_UINT64;
+    readerConfig.dataSetMetaData.fields[0].name = UA_STRING("send_timestamp");
+    readerConfig.dataSetMetaData.fields[0].valueRank = -1;
+    UA_Server_addDataSetReader(server, readerGroupId, &readerConfig, &dataSetReaderId);
+
+    attr.dataType = UA_TYPES[UA_TYPES_UINT64].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+    UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, 2000),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                              UA_QUALIFIEDNAME(1, "received_send_timestamp"),
+                              UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                              attr, NULL, &variableId);
+    callback.onRead = NULL;
+    callback.onWrite = afterWriteSendTimestamp;
+    UA_Server_setVariableNode_valueCallback(server, variableId, callback);
+
+    UA_FieldTargetDataType_init(&targetVariable.targetVariable);
+    targetVariable.targetVariable.attributeId = UA_ATTRIBUTEID_VALUE;
+    targetVariable.targetVariable.targetNodeId = variableId;
+    UA_Server_DataSetReader_createTargetVariables(server, dataSetReaderId, 1, &targetVariable);
+    UA_free(readerConfig.dataSetMetaData.fields);
+
+    UA_Server_setReaderGroupOperational(server, readerGroupId);
+}
+
+static int compareUInt64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void printLatencyStatistics(const char *transport, long count)
+{
+    long i;
+    uint64_t sum = 0;
+
+    if (LATENCY_COUNT == 0)
+    {
+        printf("%s: no heart beat received\n", transport);
+        return;
+    }
+    qsort(LATENCY_LIST, LATENCY_COUNT, sizeof(uint64_t), compareUInt64);
+    for (i = 0; i < LATENCY_COUNT; i++)
+        sum += LATENCY_LIST[i];
+    printf("%s: received %ld/%ld, one-way latency min %lu avg %lu p50 %lu p99 %lu max %lu ns\n",
+           transport, LATENCY_COUNT, count,
+           (unsigned long)LATENCY_LIST[0], (unsigned long)(sum / LATENCY_COUNT),
+           (unsigned long)LATENCY_LIST[LATENCY_COUNT / 2],
+           (unsigned long)LATENCY_LIST[LATENCY_COUNT * 99 / 100],
+           (unsigned long)LATENCY_LIST[LATENCY_COUNT - 1]);
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    const char *transport, *interface;
+    long count, i;
+    double interval_ms;
+    uint64_t next, deadline;
+    UA_Server *server;
+    UA_ServerConfig *config;
+    UA_NodeId connectionId;
+
+    if (argc < 4 || (strcmp(argv[1], "pub") != 0 && strcmp(argv[1], "sub") != 0) ||
+        selectPubSubTransport(argv[2]) < 0)
+    {
+        printf("Usage: %s <pub|sub> <udp|eth> <interface> [count] [interval ms]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    IS_PUBLISHER = strcmp(argv[1], "pub") == 0;
+    transport = argv[2];
+    interface = argv[3];
+    count = argc > 4 ? atol(argv[4]) : 1000;
+    interval_ms = argc > 5 ? atof(argv[5]) : 1.0;
+
+    server = UA_Server_new();
+    config = UA_Server_getConfig(server);
+    UA_ServerConfig_setMinimal(config, IS_PUBLISHER ? 4851 : 4852, NULL);
+    if (PUBSUB_TRANSPORT == PUBSUB_TRANSPORT_ETH)
+        UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerEthernet());
+    else
+        UA_ServerConfig_addPubSubTransportLayer(config, UA_PubSubTransportLayerUDPMP());
+
+    connectionId = addConnection(server, interface);
+    if (IS_PUBLISHER)
+    {
+        addPublisher(server, connectionId, interval_ms);
+    }
+    else
+    {
+        LATENCY_LIST = calloc(count, sizeof(uint64_t));
+        if (LATENCY_LIST == NULL)
+            return EXIT_FAILURE;
+        LATENCY_CAPACITY = count;
+        addSubscriber(server, connectionId);
+    }
+    UA_Server_run_startup(server);
+    if (GROUP_CALLBACK == NULL)
+    {
+        printf("error: %s group not operational\n", IS_PUBLISHER ? "Writer" : "Reader");
+        return EXIT_FAILURE;
+    }
+
+    next = getMonotonicNanoSeconds();
+    if (IS_PUBLISHER)
+    {
+        for (i = 0; i < count; i++)
+        {
+            sleepUntilMonotonicNanoSeconds(next);
+            SEND_TIMESTAMP = getMonotonicNanoSeconds();
+            GROUP_CALLBACK(server, GROUP_DATA);
+            UA_Server_run_iterate(server, false);
+            next += (uint64_t)(interval_ms * NANO_SECONDS_PER_MILLI_SECOND);
+        }
+        printf("%s: published %ld heart beats on %s\n", transport, count, interface);
+    }
+    else
+    {
+        // the subscriber is started first: wait for the whole publishing run
+        deadline = next + (uint64_t)(count * interval_ms * NANO_SECONDS_PER_MILLI_SECOND) +
+                   BENCHMARK_RECEIVE_GRACE;
+        while (LATENCY_COUNT < count && getMonotonicNanoSeconds() < deadline)
+        {
+            GROUP_CALLBACK(server, GROUP_DATA);
+        }
+        printLatencyStatistics(transport, count);
+    }
+
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    free(LATENCY_LIST);
+    return EXIT_SUCCESS;
+}
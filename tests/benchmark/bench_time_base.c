@@ -0,0 +1,101 @@
+/*
+ * Micro benchmark of the coupler's clocks:
+ *   - legacy: getMilliSecondsSinceEpoch() (gettimeofday, ms resolution, steps with NTP)
+ *   - time base: getTimeBaseNanoSeconds() on CLOCK_MONOTONIC, CLOCK_MONOTONIC_RAW
+ *     and CLOCK_TAI (integer ns)
+ * For every clock the cost of one read and its effective resolution
+ * (smallest non zero difference of two consecutive reads) are measured.
+ *
+ * Usage: ./bench_time_base [iterations]
+ *   ./bench_time_base 10000000
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "../../coupler/time_base.h"
+
+/* ================ Helpers ====================== */
+
+static unsigned long int getMilliSecondsSinceEpoch()
+{
+    /*
+     * Same as getMilliSecondsSinceEpoch of common.h.
+     */
+    struct timeval current_time;
+    gettimeofday(&current_time, NULL);
+    unsigned long int ms = current_time.tv_sec * 1000 + current_time.tv_usec / 1000;
+    return ms;
+}
+
+static void benchmarkLegacyClock(long iterations)
+{
+    long i;
+    uint64_t start, elapsed;
+    unsigned long int value, previous, resolution = 0;
+    volatile unsigned long int sink = 0;
+
+    start = getMonotonicNanoSeconds();
+    for (i = 0; i < iterations; i++)
+        sink += getMilliSecondsSinceEpoch();
+    elapsed = getMonotonicNanoSeconds() - start;
+
+    // wait for the value to change to see its resolution
+    previous = getMilliSecondsSinceEpoch();
+    for (i = 0; i < iterations && resolution == 0; i++)
+    {
+        value = getMilliSecondsSinceEpoch();
+        if (value != previous)
+            resolution = (value - previous) * NANO_SECONDS_PER_MILLI_SECOND;
+        previous = value;
+    }
+    printf("%-28s %8.1f ns/read, resolution %10lu ns\n", "getMilliSecondsSinceEpoch",
+           (double)elapsed / iterations, resolution);
+}
+
+static void benchmarkTimeBaseClock(const char *name, long iterations)
+{
+    long i;
+    uint64_t start, elapsed, value, previous, resolution = UINT64_MAX;
+    volatile uint64_t sink = 0;
+
+    if (setTimeBaseClock(name) < 0)
+    {
+        printf("%-28s not available\n", name);
+        return;
+    }
+
+    start = getMonotonicNanoSeconds();
+    for (i = 0; i < iterations; i++)
+        sink += getTimeBaseNanoSeconds();
+    elapsed = getMonotonicNanoSeconds() - start;
+
+    previous = getTimeBaseNanoSeconds();
+    for (i = 0; i < iterations; i++)
+    {
+        value = getTimeBaseNanoSeconds();
+        if (value != previous && value - previous < resolution)
+            resolution = value - previous;
+        previous = value;
+    }
+    printf("%-28s %8.1f ns/read, resolution %10lu ns (clock_getres %lu ns)\n", name,
+           (double)elapsed / iterations, (unsigned long)resolution,
+           (unsigned long)getTimeBaseResolution());
+}
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+
+    printf("iterations=%ld\n", iterations);
+    benchmarkLegacyClock(iterations);
+    benchmarkTimeBaseClock("monotonic", iterations);
+    benchmarkTimeBaseClock("monotonic_raw", iterations);
+    benchmarkTimeBaseClock("tai", iterations);
+    return EXIT_SUCCESS;
+}
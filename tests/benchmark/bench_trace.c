@@ -0,0 +1,60 @@
+/*
+ * Micro benchmark of event tracing (coupler/trace.h):
+ *   - traceEvent() disabled (no trace file): the cost left in hot paths
+ *   - traceEvent() enabled: one time base read and a record in the
+ *     thread's ring
+ *   - traceSpan() enabled, as used to trace I2C transactions, OPC UA
+ *     callbacks and the I/O scan cycle
+ *   - dump of a full ring
+ *
+ * Usage: ./bench_trace [iterations]
+ *   ./bench_trace 10000000
+ */
+
+/* ================ Includes ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../../coupler/trace.h"
+
+static long ITERATIONS;
+
+/* ================ Benchmark ==================== */
+
+int main(int argc, char **argv)
+{
+    long i;
+    uint64_t start, elapsed;
+    FILE *file;
+
+    ITERATIONS = argc > 1 ? atol(argv[1]) : 10000000;
+    printf("iterations=%ld\n", ITERATIONS);
+
+    start = getMonotonicNanoSeconds();
+    for (i = 0; i < ITERATIONS; i++)
+        traceEvent(TRACE_HEART_BEAT_RX, 1, (uint32_t)i, 0);
+    elapsed = getMonotonicNanoSeconds() - start;
+    printf("%-28s %8.1f ns/event\n", "traceEvent (disabled)", (double)elapsed / ITERATIONS);
+
+    TRACE_ENABLED = true;
+    start = getMonotonicNanoSeconds();
+    for (i = 0; i < ITERATIONS; i++)
+        traceEvent(TRACE_HEART_BEAT_RX, 1, (uint32_t)i, 0);
+    elapsed = getMonotonicNanoSeconds() - start;
+    printf("%-28s %8.1f ns/event\n", "traceEvent", (double)elapsed / ITERATIONS);
+
+    start = getMonotonicNanoSeconds();
+    for (i = 0; i < ITERATIONS; i++)
+        traceSpan(TRACE_I2C_READ, 1, 0, getTimeBaseNanoSeconds());
+    elapsed = getMonotonicNanoSeconds() - start;
+    printf("%-28s %8.1f ns/span\n", "traceSpan", (double)elapsed / ITERATIONS);
+
+    file = fopen("/dev/null", "wb");
+    start = getMonotonicNanoSeconds();
+    dumpTrace(file, 0);
+    elapsed = getMonotonicNanoSeconds() - start;
+    fclose(file);
+    printf("%-28s %8.1f us (%d records)\n", "dumpTrace", elapsed / 1000.0, TRACE_RING_RECORD_COUNT);
+    return EXIT_SUCCESS;
+}
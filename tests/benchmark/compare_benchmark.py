@@ -0,0 +1,45 @@
+"""
+    Compare two CSV benchmark results (i.e. of bench_i2c_dev, bench_opc_ua_load)
+    row by row. Rows are matched by their first two columns (op and slaves or
+    sessions). A latency column (*_us) higher or ops_per_second lower than the
+    baseline by more than the tolerance, or more errors, is a regression.
+    Usage: python3 compare_benchmark.py baseline.csv current.csv [tolerance (0.2 = 20%)]
+    Exits with 1 on a regression.
+"""
+import csv
+import sys
+
+
+def read_result(file_name):
+    with open(file_name, newline="") as f:
+        reader = csv.DictReader(f)
+        key_columns = reader.fieldnames[:2]
+        return key_columns, {tuple(row[c] for c in key_columns): row for row in reader}
+
+
+key_columns, baseline = read_result(sys.argv[1])
+key_columns, current = read_result(sys.argv[2])
+tolerance = float(sys.argv[3]) if len(sys.argv) > 3 else 0.2
+
+regression_count = 0
+for key, row in current.items():
+    if key not in baseline:
+        print("new:        %s" % ",".join(key))
+        continue
+    for column, value in row.items():
+        if column in key_columns or column in ("iterations", "count", "target_per_second"):
+            continue
+        value = float(value)
+        base = float(baseline[key][column])
+        if column.endswith("_us"):
+            regressed = value > base * (1 + tolerance)
+        elif column == "ops_per_second":
+            regressed = value < base * (1 - tolerance)
+        else:
+            regressed = value > base
+        if regressed:
+            regression_count += 1
+            print("regression: %s %s %s -> %s" % (",".join(key), column, baseline[key][column], row[column]))
+
+print("%d regressions (tolerance %.0f%%)" % (regression_count, tolerance * 100))
+sys.exit(1 if regression_count > 0 else 0)
@@ -0,0 +1,45 @@
+#!/bin/sh
+# One-way latency of Pub/Sub heart beats, UDP multicast vs raw Ethernet (ETH UADP),
+# over a veth pair: the publisher sends on veth-hb0, the subscriber receives on
+# veth-hb1 in its own network namespace (same CLOCK_MONOTONIC).
+#
+# Usage (as root): ./run_pubsub_latency.sh [count] [interval ms]
+#   ./run_pubsub_latency.sh 10000 1
+
+COUNT=${1:-1000}
+INTERVAL=${2:-1}
+BENCH=$(dirname "$0")/build/bench_pubsub_latency
+NETNS=coupler-bench
+
+cleanup() {
+    ip link del veth-hb0 2>/dev/null
+    ip netns del $NETNS 2>/dev/null
+}
+
+if [ ! -x "$BENCH" ]; then
+    echo "build first: make bench_pubsub_latency"
+    exit 1
+fi
+
+cleanup
+trap cleanup EXIT
+ip netns add $NETNS || exit 1
+ip link add veth-hb0 type veth peer name veth-hb1
+ip link set veth-hb1 netns $NETNS
+ip addr add 10.99.0.1/24 dev veth-hb0
+ip link set veth-hb0 up
+ip netns exec $NETNS ip addr add 10.99.0.2/24 dev veth-hb1
+ip netns exec $NETNS ip link set veth-hb1 up
+ip netns exec $NETNS ip link set lo up
+# multicast of 224.0.0.0/4 leaves through the veth
+ip route add 224.0.0.0/4 dev veth-hb0 2>/dev/null
+ip netns exec $NETNS ip route add 224.0.0.0/4 dev veth-hb1
+
+for TRANSPORT in udp eth; do
+    ip netns exec $NETNS "$BENCH" sub $TRANSPORT veth-hb1 "$COUNT" "$INTERVAL" &
+    SUBSCRIBER=$!
+    # let the subscriber join before the first heart beat
+    sleep 1
+    "$BENCH" pub $TRANSPORT veth-hb0 "$COUNT" "$INTERVAL" > /dev/null
+    wait $SUBSCRIBER
+done
@@ -0,0 +1,365 @@
+/*
+ * Userspace fake of the kernel's i2c-dev interface (/dev/i2c-N), preloaded
+ * into a coupler, test or benchmark:
+ *   LD_PRELOAD=./build/libi2c_dev_fake.so ./server -s 0x58
+ *
+ * open() of a /dev/i2c-* path returns a descriptor whose ioctl() (I2C_SLAVE,
+ * I2C_SLAVE_FORCE, I2C_FUNCS, I2C_RDWR), read(), write() and close() are
+ * answered by simulated MOD-IOs (coupler/i2c_bus_simulation.h). The coupler
+ * runs its normal mode (-m 0), so its real open / ioctl / read / write path
+ * (the i2c-dev bus backend) is exercised end to end. All other descriptors
+ * are passed to libc.
+ *
+ * The kernel's i2c-stub module is no stand-in here: it only emulates SMBus
+ * commands, plain read() / write() and I2C_RDWR fail with EOPNOTSUPP.
+ *
+ * Environment:
+ *   I2C_DEV_FAKE_SETTINGS   simulation settings as coupler -B, i.e.
+ *                           "clock=400,nak=0.001" (default: 100 kHz)
+ *   I2C_DEV_FAKE_SLAVES     addresses answering, i.e. "0x58,0x59"
+ *                           (default: every address answers)
+ */
+
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include "../../coupler/mod_io_i2c.h"
+
+// the maximal number of faked block devices and of their open descriptors
+#define MAX_I2C_DEV_FAKE_DEVICE_COUNT MAX_I2C_BUS_COUNT
+#define MAX_I2C_DEV_FAKE_FD 1024
+
+// i2c-dev limits
+#define I2C_DEV_FAKE_MAX_LENGTH 8192
+#define I2C_DEV_FAKE_MAX_ADDRESS 0x7F
+
+#define I2C_DEV_FAKE_PATH_PREFIX "/dev/i2c-"
+
+typedef struct {
+    char device[64];
+    i2c_simulated_bus_t simulated_bus;
+} i2c_dev_fake_device_t;
+
+static pthread_mutex_t I2C_DEV_FAKE_LOCK = PTHREAD_MUTEX_INITIALIZER;
+static i2c_dev_fake_device_t I2C_DEV_FAKE_DEVICE_LIST[MAX_I2C_DEV_FAKE_DEVICE_COUNT];
+static int I2C_DEV_FAKE_DEVICE_COUNT = 0;
+
+// bus handle of every faked descriptor (NULL for descriptors of libc)
+static i2c_bus_t *I2C_DEV_FAKE_FD_LIST[MAX_I2C_DEV_FAKE_FD];
+
+static int (*REAL_OPEN)(const char *, int, ...);
+static int (*REAL_CLOSE)(int);
+static ssize_t (*REAL_READ)(int, void *, size_t);
+static ssize_t (*REAL_WRITE)(int, const void *, size_t);
+static int (*REAL_IOCTL)(int, unsigned long, ...);
+
+/* ================ Setup ======================== */
+
+static void attachI2CDevFakeSlaveList(i2c_simulated_bus_t *simulated_bus, const char *slave_list)
+{
+    /*
+     * Attach a MOD-IO at every listed address, no other address answers.
+     */
+    char *copy = strdup(slave_list);
+    char *save;
+    char *token;
+
+    I2C_SIMULATION_CONFIG.auto_attach = true;
+    for (token = strtok_r(copy, ", ", &save); token != NULL; token = strtok_r(NULL, ", ", &save))
+    {
+        findI2CSimulatedModIO(simulated_bus, (int)strtol(token, NULL, 0));
+    }
+    I2C_SIMULATION_CONFIG.auto_attach = false;
+    free(copy);
+}
+
+static void loadRealCallList()
+{
+    /*
+     * Look up the libc calls, also from calls made by constructors that ran
+     * before ours.
+     */
+    if (REAL_IOCTL != NULL)
+        return;
+    REAL_OPEN = dlsym(RTLD_NEXT, "open");
+    REAL_CLOSE = dlsym(RTLD_NEXT, "close");
+    REAL_READ = dlsym(RTLD_NEXT, "read");
+    REAL_WRITE = dlsym(RTLD_NEXT, "write");
+    __atomic_store_n(&REAL_IOCTL, dlsym(RTLD_NEXT, "ioctl"), __ATOMIC_RELEASE);
+}
+
+__attribute__((constructor)) static void setupI2CDevFake()
+{
+    char *settings = getenv("I2C_DEV_FAKE_SETTINGS");
+
+    loadRealCallList();
+    if (settings != NULL && parseI2CSimulationConfig(strdup(settings), &I2C_SIMULATION_CONFIG) < 0)
+    {
+        fprintf(stderr, "Invalid I2C_DEV_FAKE_SETTINGS (%s), partly applied.\n", settings);
+    }
+}
+
+static i2c_simulated_bus_t *getI2CDevFakeBus(const char *device)
+{
+    /*
+     * Return the simulated bus of a block device, set up on first open.
+     */
+    int i;
+    i2c_dev_fake_device_t *fake_device;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    char *slave_list = getenv("I2C_DEV_FAKE_SLAVES");
+
+    for (i = 0; i < I2C_DEV_FAKE_DEVICE_COUNT; i++)
+    {
+        if (strcmp(I2C_DEV_FAKE_DEVICE_LIST[i].device, device) == 0)
+            return &I2C_DEV_FAKE_DEVICE_LIST[i].simulated_bus;
+    }
+    if (I2C_DEV_FAKE_DEVICE_COUNT == MAX_I2C_DEV_FAKE_DEVICE_COUNT ||
+        strlen(device) >= sizeof(fake_device->device))
+        return NULL;
+
+    fake_device = &I2C_DEV_FAKE_DEVICE_LIST[I2C_DEV_FAKE_DEVICE_COUNT];
+    memset(fake_device, 0, sizeof(*fake_device));
+    strcpy(fake_device->device, device);
+    fake_device->simulated_bus.lock = lock;
+    fake_device->simulated_bus.random_state = I2C_SIMULATION_CONFIG.seed + I2C_DEV_FAKE_DEVICE_COUNT;
+    if (slave_list != NULL)
+        attachI2CDevFakeSlaveList(&fake_device->simulated_bus, slave_list);
+    I2C_DEV_FAKE_DEVICE_COUNT++;
+    return &fake_device->simulated_bus;
+}
+
+static i2c_bus_t *getI2CDevFakeFd(int fd)
+{
+    loadRealCallList();
+    return fd >= 0 && fd < MAX_I2C_DEV_FAKE_FD ? I2C_DEV_FAKE_FD_LIST[fd] : NULL;
+}
+
+/* ================ Faked Calls ================== */
+
+static int openI2CDevFake(const char *device)
+{
+    /*
+     * Open a faked block device: a descriptor of /dev/null keeps its number
+     * taken while the bus handle answers for it.
+     */
+    int fd;
+    i2c_bus_t *bus;
+    i2c_simulated_bus_t *simulated_bus;
+
+    pthread_mutex_lock(&I2C_DEV_FAKE_LOCK);
+    simulated_bus = getI2CDevFakeBus(device);
+    pthread_mutex_unlock(&I2C_DEV_FAKE_LOCK);
+    if (simulated_bus == NULL)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    fd = REAL_OPEN("/dev/null", O_RDWR);
+    if (fd < 0)
+        return -1;
+    if (fd >= MAX_I2C_DEV_FAKE_FD)
+    {
+        REAL_CLOSE(fd);
+        errno = EMFILE;
+        return -1;
+    }
+
+    bus = calloc(1, sizeof(*bus));
+    bus->device = strdup(device);
+    bus->fd = fd;
+    bus->slave_addr = I2C_BUS_NO_SLAVE;
+    bus->backend = &I2C_SIMULATED_BUS_BACKEND;
+    bus->context = simulated_bus;
+    __atomic_store_n(&I2C_DEV_FAKE_FD_LIST[fd], bus, __ATOMIC_RELEASE);
+    return fd;
+}
+
+static int transferI2CDevFake(i2c_bus_t *bus, struct i2c_rdwr_ioctl_data *transaction)
+{
+    /*
+     * I2C_RDWR, checked as the kernel does before any message is sent.
+     */
+    unsigned int i;
+
+    if (transaction == NULL || transaction->msgs == NULL ||
+        transaction->nmsgs == 0 || transaction->nmsgs > I2C_RDWR_IOCTL_MAX_MSGS)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < transaction->nmsgs; i++)
+    {
+        if (transaction->msgs[i].len > I2C_DEV_FAKE_MAX_LENGTH || transaction->msgs[i].buf == NULL)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    return bus->backend->transfer(bus, transaction->msgs, transaction->nmsgs);
+}
+
+static int ioctlI2CDevFake(i2c_bus_t *bus, unsigned long request, unsigned long arg)
+{
+    switch (request)
+    {
+    case I2C_SLAVE:
+    case I2C_SLAVE_FORCE:
+        if (arg > I2C_DEV_FAKE_MAX_ADDRESS)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        bus->slave_addr = (int)arg;
+        return 0;
+    case I2C_FUNCS:
+        *(unsigned long *)arg = I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL;
+        return 0;
+    case I2C_RDWR:
+        return transferI2CDevFake(bus, (struct i2c_rdwr_ioctl_data *)arg);
+    case I2C_RETRIES:
+    case I2C_TIMEOUT:
+        return 0;
+    default:
+        errno = ENOTTY;
+        return -1;
+    }
+}
+
+static ssize_t transferI2CDevFakeData(i2c_bus_t *bus, void *buf, size_t count, bool read)
+{
+    /*
+     * read() / write(): one message to the slave set with I2C_SLAVE.
+     */
+    if (count > I2C_DEV_FAKE_MAX_LENGTH)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (bus->slave_addr == I2C_BUS_NO_SLAVE)
+    {
+        // i2c-dev addresses 0x00 then, no MOD-IO answers the general call
+        errno = ENXIO;
+        return -1;
+    }
+    if (read)
+        return bus->backend->read(bus, buf, count);
+    return bus->backend->write(bus, buf, count);
+}
+
+/* ================ Test API ===================== */
+
+// looked up with dlsym() by tests, which so also know they run on the fake
+__attribute__((visibility("default"))) int setI2CDevFakeModIOInput(const char *device, int i2c_addr,
+                                                                   const mod_io_input_t *input)
+{
+    /*
+     * Drive the inputs of a faked MOD-IO. Return -1 if there is none.
+     */
+    i2c_simulated_bus_t *simulated_bus;
+    i2c_simulated_mod_io_t *mod_io = NULL;
+
+    pthread_mutex_lock(&I2C_DEV_FAKE_LOCK);
+    simulated_bus = getI2CDevFakeBus(device);
+    pthread_mutex_unlock(&I2C_DEV_FAKE_LOCK);
+    if (simulated_bus == NULL)
+        return -1;
+    pthread_mutex_lock(&simulated_bus->lock);
+    mod_io = findI2CSimulatedModIO(simulated_bus, i2c_addr);
+    if (mod_io != NULL)
+        mod_io->input = *input;
+    pthread_mutex_unlock(&simulated_bus->lock);
+    return mod_io != NULL ? 0 : -1;
+}
+
+/* ================ Interposed libc ============== */
+
+__attribute__((visibility("default"))) int open(const char *path, int flags, ...)
+{
+    va_list args;
+    mode_t mode = 0;
+
+    loadRealCallList();
+    if (strncmp(path, I2C_DEV_FAKE_PATH_PREFIX, strlen(I2C_DEV_FAKE_PATH_PREFIX)) == 0)
+        return openI2CDevFake(path);
+
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return REAL_OPEN(path, flags, mode);
+}
+
+__attribute__((visibility("default"))) int open64(const char *path, int flags, ...)
+{
+    va_list args;
+    mode_t mode = 0;
+
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return open(path, flags | O_LARGEFILE, mode);
+}
+
+__attribute__((visibility("default"))) int close(int fd)
+{
+    i2c_bus_t *bus = getI2CDevFakeFd(fd);
+
+    if (bus != NULL)
+    {
+        __atomic_store_n(&I2C_DEV_FAKE_FD_LIST[fd], NULL, __ATOMIC_RELEASE);
+        free(bus->device);
+        free(bus);
+    }
+    return REAL_CLOSE(fd);
+}
+
+__attribute__((visibility("default"))) ssize_t read(int fd, void *buf, size_t count)
+{
+    i2c_bus_t *bus = getI2CDevFakeFd(fd);
+
+    if (bus != NULL)
+        return transferI2CDevFakeData(bus, buf, count, true);
+    return REAL_READ(fd, buf, count);
+}
+
+// read() of a buffer of known size when built with _FORTIFY_SOURCE
+__attribute__((visibility("default"))) ssize_t __read_chk(int fd, void *buf, size_t count, size_t size)
+{
+    if (count > size)
+        abort();
+    return read(fd, buf, count);
+}
+
+__attribute__((visibility("default"))) ssize_t write(int fd, const void *buf, size_t count)
+{
+    i2c_bus_t *bus = getI2CDevFakeFd(fd);
+
+    if (bus != NULL)
+        return transferI2CDevFakeData(bus, (void *)buf, count, false);
+    return REAL_WRITE(fd, buf, count);
+}
+
+__attribute__((visibility("default"))) int ioctl(int fd, unsigned long request, ...)
+{
+    va_list args;
+    unsigned long arg;
+    i2c_bus_t *bus = getI2CDevFakeFd(fd);
+
+    va_start(args, request);
+    arg = va_arg(args, unsigned long);
+    va_end(args);
+
+    if (bus != NULL)
+        return ioctlI2CDevFake(bus, request, arg);
+    return REAL_IOCTL(fd, request, arg);
+}
@@ -0,0 +1,138 @@
+/* ================ Includes ===================== */
+#define DOING_UNIT_TESTS
+#include <criterion/criterion.h>
+#include "../../coupler/opc-ua-server/server.c"
+
+static char *writeConfigFile(const char *content)
+{
+    static char filename[] = "/tmp/test_config_file.ini";
+    FILE *file = fopen(filename, "w");
+
+    fputs(content, file);
+    fclose(file);
+    return filename;
+}
+
+/* ================ Function Tests =============== */
+
+// ############# channels of a slave ##############
+
+Test(configfile, parseChannelMask) {
+    uint16_t mask;
+    char all[] = "relay, in, ain";
+    char some[] = "relay2,in0 ain3";
+    char unknown[] = "relay, out0";
+    char range[] = "relay4";
+
+    cr_expect_eq(parseChannelMask(all, &mask), 0);
+    cr_expect_eq(mask, MOD_IO_CHANNEL_MASK_ALL);
+    cr_expect_eq(parseChannelMask(some, &mask), 0);
+    cr_expect_eq(mask, (1U << 2) | (1U << 4) | (1U << 11));
+    cr_expect_eq(parseChannelMask(unknown, &mask), -1);
+    cr_expect_eq(parseChannelMask(range, &mask), -1);
+}
+
+// ############# overlay a file on the command line ##############
+
+Test(configfile, parseCouplerConfig) {
+    coupler_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    config.slave_list[0].address = 0x58;
+    config.slave_list[1].address = 0x59;
+    config.peer_list[1] = 1;
+    config.io_scan_interval = 20;
+
+    cr_expect_eq(parseCouplerConfig(writeConfigFile(
+        "# cell 2\n"
+        "[coupler]\n"
+        "heart-beat-id-list = 2, a\n"
+        "io-scan-interval = 10\n"
+        "analog-deadband = 8\n"
+        "pubsub-transport = eth\n"
+        "\n"
+        "[i2c0]\n"
+        "address = 0x58\n"
+        "; second bus\n"
+        "[i2c3]\n"
+        "address = 5a\n"
+        "device = /dev/i2c-2\n"
+        "channels = relay0, in\n"), &config), 0);
+
+    // the file's slaves replace all slaves of the command line
+    cr_expect_eq(config.slave_list[0].address, 0x58);
+    cr_expect_eq(config.slave_list[0].channel_mask, 0);
+    cr_expect_eq(config.slave_list[1].address, 0);
+    cr_expect_eq(config.slave_list[3].address, 0x5A);
+    cr_expect_str_eq(config.slave_list[3].device, "/dev/i2c-2");
+    cr_expect_eq(config.slave_list[3].channel_mask, 0xF1);
+    // peers are hexadecimal as on the command line
+    cr_expect_eq(config.peer_list[1], 0);
+    cr_expect_eq(config.peer_list[2], 1);
+    cr_expect_eq(config.peer_list[10], 1);
+    cr_expect_eq(config.io_scan_interval, 10);
+    cr_expect_eq(config.analog_deadband, 8);
+    cr_expect_eq(config.pubsub_transport, PUBSUB_TRANSPORT_ETH);
+}
+
+Test(configfile, parseCouplerConfigError) {
+    coupler_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    cr_expect_eq(parseCouplerConfig("/nonexistent/coupler.ini", &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("[coupler]\nunknown = 1\n"), &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("[coupler]\nio-scan-interval = fast\n"), &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("[i2c32]\naddress = 0x58\n"), &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("address = 0x58\n"), &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("[i2c0]\ndevice = /dev/i2c-2\n"), &config), -1);
+    cr_expect_eq(parseCouplerConfig(writeConfigFile("[coupler]\nheart-beat-id-list = 400\n"), &config), -1);
+}
+
+// ############# what changed on reload ##############
+
+Test(configfile, diffConfigSlave) {
+    config_slave_t running, wanted;
+
+    memset(&running, 0, sizeof(running));
+    memset(&wanted, 0, sizeof(wanted));
+    cr_expect_eq(diffConfigSlave(&running, &wanted), CONFIG_SLAVE_UNCHANGED);
+
+    wanted.address = 0x58;
+    cr_expect_eq(diffConfigSlave(&running, &wanted), CONFIG_SLAVE_ADDED);
+    cr_expect_eq(diffConfigSlave(&wanted, &running), CONFIG_SLAVE_REMOVED);
+
+    running = wanted;
+    running.channel_mask = MOD_IO_CHANNEL_MASK_ALL;
+    // all channels either way
+    cr_expect_eq(diffConfigSlave(&running, &wanted), CONFIG_SLAVE_UNCHANGED);
+    wanted.channel_mask = 0x0F;
+    cr_expect_eq(diffConfigSlave(&running, &wanted), CONFIG_SLAVE_CHANNELS_CHANGED);
+    strcpy(wanted.device, "/dev/i2c-2");
+    cr_expect_eq(diffConfigSlave(&running, &wanted), CONFIG_SLAVE_REPLACED);
+}
+
+// ############# command line as base of every reload ##############
+
+Test(configfile, captureCouplerConfig) {
+    coupler_config_t config;
+
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    I2C_SLAVE_DEVICE_LIST[0] = "/dev/i2c-2";
+    I2C_BLOCK_DEVICE_NAME = "/dev/i2c-1";
+    initLivenessTable(&LIVENESS_TABLE);
+    watchPeer(&LIVENESS_TABLE, 5, STATE_NO_INITIAL_HEART_BEAT);
+    captureCouplerConfig(&config);
+
+    cr_expect_eq(config.slave_list[0].address, 0x58);
+    cr_expect_str_eq(config.slave_list[0].device, "/dev/i2c-2");
+    cr_expect_eq(config.slave_list[1].address, 0);
+    cr_expect_eq(config.peer_list[5], 1);
+    cr_expect_str_eq(config.device, "/dev/i2c-1");
+
+    // applied back as is
+    applyStartupCouplerConfig(&config);
+    cr_expect_eq(I2C_SLAVE_ADDR_LIST[0], 0x58);
+    cr_expect_str_eq(I2C_SLAVE_DEVICE_LIST[0], "/dev/i2c-2");
+    cr_expect_eq(LIVENESS_TABLE.watched_count, 1);
+    cr_expect(ENABLE_HEART_BEAT_CHECK);
+}
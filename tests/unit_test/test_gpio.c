@@ -0,0 +1,57 @@
+/* ================ Includes ===================== */
+#define DOING_UNIT_TESTS
+#include <criterion/criterion.h>
+#include "../../coupler/opc-ua-server/server.c"
+
+
+/* ================ Function Tests =============== */
+
+// ############# measurement lines ##############
+
+Test(gpio, parseGPIOLineOffsetList) {
+    int offset_list[GPIO_EVENT_COUNT];
+    char all[] = "7,8,9";
+    char some[] = "-1,3";
+    char invalid[] = "7,x";
+
+    cr_expect_eq(parseGPIOLineOffsetList(all, offset_list), 0);
+    cr_expect_eq(offset_list[GPIO_EVENT_HEART_BEAT_RX], 7);
+    cr_expect_eq(offset_list[GPIO_EVENT_RELAY_WRITE], 8);
+    cr_expect_eq(offset_list[GPIO_EVENT_SAFE_MODE], 9);
+
+    // missing offsets disable their event class
+    cr_expect_eq(parseGPIOLineOffsetList(some, offset_list), 0);
+    cr_expect_eq(offset_list[GPIO_EVENT_HEART_BEAT_RX], -1);
+    cr_expect_eq(offset_list[GPIO_EVENT_RELAY_WRITE], 3);
+    cr_expect_eq(offset_list[GPIO_EVENT_SAFE_MODE], -1);
+
+    cr_expect_eq(parseGPIOLineOffsetList(invalid, offset_list), -1);
+}
+
+Test(gpio, initGPIOLineRequest) {
+    int offset_list[GPIO_EVENT_COUNT] = {7, 8, 7};
+    uint64_t mask_list[GPIO_EVENT_COUNT];
+    struct gpio_v2_line_request request;
+
+    // event classes sharing an offset share its line
+    cr_expect_eq(initGPIOLineRequest(&request, offset_list, mask_list), 2);
+    cr_expect_eq(request.offsets[0], 7);
+    cr_expect_eq(request.offsets[1], 8);
+    cr_expect_eq(request.config.flags, GPIO_V2_LINE_FLAG_OUTPUT);
+    cr_expect_eq(mask_list[GPIO_EVENT_HEART_BEAT_RX], 1);
+    cr_expect_eq(mask_list[GPIO_EVENT_RELAY_WRITE], 2);
+    cr_expect_eq(mask_list[GPIO_EVENT_SAFE_MODE], 1);
+
+    offset_list[0] = offset_list[1] = offset_list[2] = -1;
+    cr_expect_eq(initGPIOLineRequest(&request, offset_list, mask_list), 0);
+    cr_expect_eq(mask_list[GPIO_EVENT_HEART_BEAT_RX], 0);
+}
+
+Test(gpio, toggleGPIO) {
+    // no line requested: nothing to do
+    memset(GPIO_EVENT_MASK_LIST, 0, sizeof(GPIO_EVENT_MASK_LIST));
+    GPIO_LINE_VALUES = 0;
+    toggleGPIO(GPIO_EVENT_HEART_BEAT_RX);
+    setGPIO(GPIO_EVENT_SAFE_MODE, true);
+    cr_expect_eq(GPIO_LINE_VALUES, 0);
+}
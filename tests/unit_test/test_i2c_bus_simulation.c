@@ -0,0 +1,157 @@
+/* ================ Includes ===================== */
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <linux/i2c-dev.h>
+#include <fcntl.h>
+
+#include "../../coupler/mod_io_i2c.h"
+
+/* ================ Helpers ====================== */
+
+static void setupSimulation()
+{
+    // no bus time unless a test wants it
+    I2C_SIMULATION_CONFIG.clock = 0;
+    I2C_BLOCK_DEVICE_NAME = "/dev/i2c-1";
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    setOperationalMode(OPERATIONAL_MODE_SIMULATED);
+}
+
+/* ================ Function Tests =============== */
+
+// ############# parse the simulation settings ##############
+
+Test(i2cbussimulation, parseI2CSimulationConfig) {
+    char text[] = "clock=400,overhead=10,nak=0.01,timeout=0.001,stuck=0.0001,stuck-time=50,loopback=0,seed=7";
+    char invalid[] = "nak=2";
+    char unknown[] = "speed=400";
+    i2c_simulation_config_t config = I2C_SIMULATION_CONFIG;
+
+    cr_expect_eq(parseI2CSimulationConfig(text, &config), 0);
+    cr_expect_eq(config.clock, 400000);
+    cr_expect_eq(config.overhead, 10000);
+    cr_expect_float_eq(config.nak_probability, 0.01, 1e-9);
+    cr_expect_float_eq(config.timeout_probability, 0.001, 1e-9);
+    cr_expect_float_eq(config.stuck_probability, 0.0001, 1e-9);
+    cr_expect_eq(config.stuck_time, 50 * NANO_SECONDS_PER_MILLI_SECOND);
+    cr_expect_eq(config.loopback, false);
+    cr_expect_eq(config.seed, 7);
+
+    cr_expect_eq(parseI2CSimulationConfig(invalid, &config), -1);
+    cr_expect_eq(parseI2CSimulationConfig(unknown, &config), -1);
+}
+
+// ############# simulated mode is the normal mode on simulated buses ##############
+
+Test(i2cbussimulation, setOperationalMode) {
+    setupSimulation();
+
+    cr_expect_eq(getOperationalMode(), OPERATIONAL_MODE_SIMULATED);
+    cr_expect_eq(OPERATIONAL_MODE, 0);
+    cr_expect_eq(I2C_VIRTUAL_MODE, 0);
+    cr_expect_eq(getI2CBus(I2C_BLOCK_DEVICE_NAME)->backend, &I2C_SIMULATED_BUS_BACKEND);
+}
+
+// ############# relay write, inputs follow relays ##############
+
+Test(i2cbussimulation, relayLoopback) {
+    mod_io_input_t input = {0};
+
+    setupSimulation();
+
+    cr_expect_eq(setI2CSlaveRelayState(0, 0x05), 0);
+    cr_expect_eq(getI2CSimulatedModIO(I2C_BLOCK_DEVICE_NAME, 0x58)->relay, 0x05);
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    cr_expect_eq(input.digital_input, 0x05);
+
+    safeShutdownI2CSlaveList();
+    cr_expect_eq(getI2CSimulatedModIO(I2C_BLOCK_DEVICE_NAME, 0x58)->relay, 0x00);
+}
+
+// ############# input registers ##############
+
+Test(i2cbussimulation, inputRegisterList) {
+    mod_io_input_t driven = {0x0A, {0, 1, 512, 1023}};
+    mod_io_input_t input = {0};
+    char *digital_input = NULL;
+    int *analog_input = NULL;
+
+    setupSimulation();
+    I2C_SIMULATION_CONFIG.loopback = false;
+
+    cr_expect_eq(setI2CSimulatedModIOInput(I2C_BLOCK_DEVICE_NAME, 0x58, &driven), 0);
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    cr_expect_eq(input.digital_input, 0x0A);
+    cr_expect_eq(input.analog_input[1], 1);
+    cr_expect_eq(input.analog_input[2], 512);
+    cr_expect_eq(input.analog_input[3], 1023);
+
+    // single register reads
+    cr_expect_eq(getDigitalInputState(0x58, &digital_input), 0);
+    cr_expect_eq(*digital_input, 0x0A);
+    cr_expect_eq(getAnalogInputStateAIN(0x58, &analog_input, 0x33), 0);
+    cr_expect_eq(*analog_input, 1023);
+}
+
+// ############# a missing slave NAKs ##############
+
+Test(i2cbussimulation, missingSlave) {
+    mod_io_input_t input = {0};
+
+    setupSimulation();
+    I2C_SIMULATION_CONFIG.auto_attach = false;
+
+    cr_expect_eq(getI2CSlaveInputState(0, &input), -1);
+    cr_expect_eq(setI2CSlaveRelayState(0, 0x01), -1);
+    cr_expect_eq(getI2CSimulatedBus(I2C_BLOCK_DEVICE_NAME)->nak_count, 2);
+}
+
+// ############# injected faults ##############
+
+Test(i2cbussimulation, injectedNAK) {
+    mod_io_input_t input = {0};
+
+    setupSimulation();
+    I2C_SIMULATION_CONFIG.nak_probability = 1.0;
+
+    cr_expect_eq(getI2CSlaveInputState(0, &input), -1);
+    cr_expect_eq(getI2CSimulatedBus(I2C_BLOCK_DEVICE_NAME)->nak_count, 1);
+}
+
+Test(i2cbussimulation, stuckBus) {
+    mod_io_input_t input = {0};
+    i2c_simulated_bus_t *simulated_bus;
+
+    setupSimulation();
+    I2C_SIMULATION_CONFIG.timeout = 0;
+    simulated_bus = getI2CSimulatedBus(I2C_BLOCK_DEVICE_NAME);
+
+    cr_expect_eq(stickI2CSimulatedBus(I2C_BLOCK_DEVICE_NAME, 20 * NANO_SECONDS_PER_MILLI_SECOND), 0);
+    cr_expect_eq(getI2CSlaveInputState(0, &input), -1);
+    cr_expect_eq(setI2CSlaveRelayState(0, 0x01), -1);
+    cr_expect_eq(simulated_bus->timeout_count, 2);
+
+    // recovered
+    usleep(30000);
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+}
+
+// ############# transactions take their bus time ##############
+
+Test(i2cbussimulation, transactionTime) {
+    mod_io_input_t input = {0};
+    uint64_t start, elapsed;
+
+    setupSimulation();
+    I2C_SIMULATION_CONFIG.clock = 400000;
+    I2C_SIMULATION_CONFIG.overhead = 0;
+
+    // 5 register writes (19 clocks), 9 bytes read in 5 messages, STOP
+    start = getMonotonicNanoSeconds();
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    elapsed = getMonotonicNanoSeconds() - start;
+
+    cr_expect_geq(elapsed, getI2CSimulationTime(5 * 19 + 5 * 10 + 9 * 9 + 1));
+    cr_expect_eq(getI2CSimulatedBus(I2C_BLOCK_DEVICE_NAME)->busy_time,
+                 getI2CSimulationTime(5 * 19 + 5 * 10 + 9 * 9 + 1));
+}
@@ -0,0 +1,134 @@
+/*
+ * End to end tests of the normal mode I2C path (open / ioctl / read / write
+ * of /dev/i2c-N) on the preloaded i2c-dev fake (tests/i2c_dev_fake), run by
+ * "make run" as:
+ *   LD_PRELOAD=../i2c_dev_fake/build/libi2c_dev_fake.so \
+ *   I2C_DEV_FAKE_SETTINGS=clock=0 I2C_DEV_FAKE_SLAVES=0x58,0x59 ./build/test_i2c_dev
+ */
+
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <dlfcn.h>
+#include <linux/i2c-dev.h>
+#include <fcntl.h>
+
+#include "../../coupler/mod_io_i2c.h"
+
+/* ================ Helpers ====================== */
+
+typedef int (*set_mod_io_input_t)(const char *, int, const mod_io_input_t *);
+
+static set_mod_io_input_t setupI2CDev()
+{
+    /*
+     * Attach 0x58 and 0x59 at /dev/i2c-1 in normal mode. Return the fake's
+     * input setter.
+     */
+    set_mod_io_input_t set_input = (set_mod_io_input_t)dlsym(RTLD_DEFAULT, "setI2CDevFakeModIOInput");
+
+    cr_assert_not_null(set_input, "run with LD_PRELOAD=../i2c_dev_fake/build/libi2c_dev_fake.so");
+    setOperationalMode(OPERATIONAL_MODE_NORMAL);
+    I2C_BLOCK_DEVICE_NAME = "/dev/i2c-1";
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    I2C_SLAVE_ADDR_LIST[1] = 0x59;
+    return set_input;
+}
+
+/* ================ Function Tests =============== */
+
+// ############# the i2c-dev interface ##############
+
+Test(i2cdev, i2cDevInterface) {
+    unsigned long funcs = 0;
+    uint8_t buf[2] = {MOD_IO_RELAY_REGISTER, 0x00};
+    int fd;
+
+    setupI2CDev();
+    fd = open(I2C_BLOCK_DEVICE_NAME, O_RDWR);
+    cr_assert_geq(fd, 0);
+
+    cr_expect_eq(ioctl(fd, I2C_FUNCS, &funcs), 0);
+    cr_expect_neq(funcs & I2C_FUNC_I2C, 0);
+    // no slave addressed yet
+    cr_expect_eq(write(fd, buf, 2), -1);
+    cr_expect_eq(errno, ENXIO);
+    cr_expect_eq(ioctl(fd, I2C_SLAVE, 0x80), -1);
+    cr_expect_eq(errno, EINVAL);
+    cr_expect_eq(ioctl(fd, I2C_SLAVE, 0x58), 0);
+    cr_expect_eq(write(fd, buf, 2), 2);
+    cr_expect_eq(close(fd), 0);
+}
+
+// ############# relay write, inputs follow relays ##############
+
+Test(i2cdev, relayLoopback) {
+    mod_io_input_t input = {0};
+
+    setupI2CDev();
+
+    cr_expect_eq(setI2CSlaveRelayState(0, 0x05), 0);
+    cr_expect_eq(setI2CSlaveRelayState(1, 0x0A), 0);
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    cr_expect_eq(input.digital_input, 0x05);
+    cr_expect_eq(getI2CSlaveInputState(1, &input), 0);
+    cr_expect_eq(input.digital_input, 0x0A);
+
+    safeShutdownI2CSlaveList();
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    cr_expect_eq(input.digital_input, 0x00);
+    cr_expect_eq(getI2CSlaveInputState(1, &input), 0);
+    cr_expect_eq(input.digital_input, 0x00);
+}
+
+// ############# input registers ##############
+
+Test(i2cdev, inputRegisterList) {
+    mod_io_input_t driven = {0, {0, 1, 512, 1023}};
+    mod_io_input_t input = {0};
+    char *digital_input = NULL;
+    int *analog_input = NULL;
+    set_mod_io_input_t set_input = setupI2CDev();
+
+    cr_assert_eq(set_input(I2C_BLOCK_DEVICE_NAME, 0x59, &driven), 0);
+    cr_expect_eq(getI2CSlaveInputState(1, &input), 0);
+    cr_expect_eq(input.analog_input[0], 0);
+    cr_expect_eq(input.analog_input[1], 1);
+    cr_expect_eq(input.analog_input[2], 512);
+    cr_expect_eq(input.analog_input[3], 1023);
+
+    // single register reads
+    cr_expect_eq(getDigitalInputState(0x59, &digital_input), 0);
+    cr_expect_eq(*digital_input, 0x00);
+    cr_expect_eq(getAnalogInputStateAIN(0x59, &analog_input, 0x32), 0);
+    cr_expect_eq(*analog_input, 512);
+}
+
+// ############# a missing slave NAKs ##############
+
+Test(i2cdev, missingSlave) {
+    mod_io_input_t input = {0};
+
+    setupI2CDev();
+    I2C_SLAVE_ADDR_LIST[2] = 0x5A;
+
+    cr_expect_eq(getI2CSlaveInputState(2, &input), -1);
+    cr_expect_eq(setI2CSlaveRelayState(2, 0x01), -1);
+    // the others still answer
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+}
+
+// ############# buses are reopened after close ##############
+
+Test(i2cdev, closeI2CBusList) {
+    mod_io_input_t input = {0};
+
+    setupI2CDev();
+
+    cr_expect_eq(setI2CSlaveRelayState(0, 0x03), 0);
+    closeI2CBusList();
+    cr_expect_eq(getI2CSlaveInputState(0, &input), 0);
+    cr_expect_eq(input.digital_input, 0x03);
+    cr_expect_eq(I2C_BUS_COUNT, 1);
+}
@@ -0,0 +1,96 @@
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <linux/i2c-dev.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include "../../coupler/mod_io_i2c.h"
+#include "../../coupler/relay_output.h"
+#include "../../coupler/io_scanner.h"
+
+/* ================ Function Tests =============== */
+
+// ############# scanner thread (only virtual mode) ##############
+
+Test(ioscanner, startIOScanner) {
+    uint64_t scan_count;
+
+    I2C_VIRTUAL_MODE = 1;
+    IO_SCAN_INTERVAL = 1;
+    scan_count = METRIC_LIST[METRIC_IO_SCAN_CYCLE].count;
+
+    cr_expect_eq(startIOScanner(), 0);
+    usleep(50000);
+    stopIOScanner();
+
+    cr_expect_gt(METRIC_LIST[METRIC_IO_SCAN_CYCLE].count, scan_count);
+}
+
+// ############# input change detection ##############
+
+Test(ioscanner, diffInputList) {
+    mod_io_input_t input_list[MAX_I2C_SLAVE_COUNT] = {0};
+    uint8_t digital_input_list[MAX_I2C_SLAVE_COUNT] = {0};
+    uint16_t analog_input_list[MAX_I2C_SLAVE_COUNT][MOD_IO_ANALOG_INPUT_COUNT] = {0};
+    uint16_t change_list[MAX_I2C_SLAVE_COUNT];
+
+    // nothing changed
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 0);
+    cr_expect_eq(change_list[0], 0);
+
+    // only the toggled digital inputs, in any word of the packed list
+    input_list[0].digital_input = 0x05;
+    input_list[9].digital_input = 0x08;
+    input_list[31].digital_input = 0x01;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 3);
+    cr_expect_eq(change_list[0], 0x05);
+    cr_expect_eq(change_list[9], 0x08);
+    cr_expect_eq(change_list[31], 0x01);
+    cr_expect_eq(change_list[1], 0);
+    cr_expect_eq(digital_input_list[9], 0x08);
+
+    input_list[0].digital_input = 0x04;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 1);
+    cr_expect_eq(change_list[0], 0x01);
+    cr_expect_eq(change_list[9], 0);
+
+    // analog inputs only outside of the deadband around the last notified value
+    input_list[2].analog_input[1] = 4;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 0);
+    input_list[2].analog_input[1] = 5;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 1);
+    cr_expect_eq(change_list[2], 1U << (INPUT_CHANGE_ANALOG_SHIFT + 1));
+    cr_expect_eq(analog_input_list[2][1], 5);
+    // a slow drift does not creep past the deadband
+    input_list[2].analog_input[1] = 1;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 0);
+    input_list[2].analog_input[1] = 0;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 4, change_list), 1);
+
+    // no deadband
+    input_list[2].analog_input[3] = 1;
+    cr_expect_eq(diffInputList(input_list, digital_input_list, analog_input_list, 0, change_list), 1);
+    cr_expect_eq(change_list[2], 1U << (INPUT_CHANGE_ANALOG_SHIFT + 3));
+}
+
+Test(ioscanner, takeInputChange) {
+    mod_io_input_t input_list[MAX_I2C_SLAVE_COUNT] = {0};
+    mod_io_input_t input;
+
+    input_list[3].digital_input = 0x02;
+    input_list[3].analog_input[0] = 512;
+    notifyInputChangeList(input_list);
+
+    cr_expect_eq(takeInputChange(3, &input), 0x02 | 1U << INPUT_CHANGE_ANALOG_SHIFT);
+    cr_expect_eq(input.digital_input, 0x02);
+    cr_expect_eq(input.analog_input[0], 512);
+    cr_expect_neq(getInputChangeTime(3, 1), 0);
+    cr_expect_eq(getInputChangeTime(3, 0), 0);
+
+    // taken once, an unchanged scan flags nothing
+    notifyInputChangeList(input_list);
+    cr_expect_eq(takeInputChange(3, &input), 0);
+}
@@ -17,3 +17,32 @@ Test(keepalivepublisher, callbackTicHeartBeat) {
     
     cr_expect_geq(HEART_BEATS, result);
 }
+
+// ############# heart beat payload ##############
+
+Test(keepalivepublisher, callbackTicHeartBeatTimestamp) {
+    UA_UInt32 heart_beats = HEART_BEATS;
+
+    HEART_BEAT_LEGACY_FORMAT = false;
+    HEART_BEAT_TIMESTAMP = 0;
+    callbackTicHeartBeat();
+
+    cr_expect_eq(HEART_BEATS, heart_beats + 1);
+    cr_expect_gt(HEART_BEAT_TIMESTAMP, 0);
+}
+
+Test(keepalivepublisher, encodeLegacyHeartBeat) {
+    cr_expect_float_eq(encodeLegacyHeartBeat(3, 125), 3.125, 0.0001);
+    cr_expect_float_eq(encodeLegacyHeartBeat(1, 10), 1.1, 0.0001);
+    cr_expect_float_eq(encodeLegacyHeartBeat(2, 0), 2.0, 0.0001);
+}
+
+Test(keepalivepublisher, getHeartBeatPublisherId) {
+    HEART_BEAT_LEGACY_FORMAT = false;
+    cr_expect_eq(getHeartBeatPublisherId(0), HEART_BEAT_PUBLISHER_ID_BASE);
+    cr_expect_eq(getHeartBeatPublisherId(63), HEART_BEAT_PUBLISHER_ID_BASE + 63);
+    cr_expect_eq(getHeartBeatPublisherId(MAX_COUPLER_COUNT - 1), HEART_BEAT_PUBLISHER_ID_BASE + MAX_COUPLER_COUNT - 1);
+    HEART_BEAT_LEGACY_FORMAT = true;
+    cr_expect_eq(getHeartBeatPublisherId(63), PUBLISHER_ID);
+    HEART_BEAT_LEGACY_FORMAT = false;
+}
@@ -15,5 +15,79 @@ Test(keepalivepublisher, callbackTicHeartBeat) {
     callbackCheckHeartBeat();
     UA_Server_delete(server);
     
-    cr_expect_geq(HEART_BEAT_ID_LIST[0], result);
-}
\ No newline at end of file
+    cr_expect_geq(LIVENESS_TABLE.watched_count, result);
+}
+// ############# subscribed heart beat fields ##############
+
+Test(keepalivesubscriber, handleSubscribedHeartBeatField) {
+    UA_UInt16 coupler_id = 7;
+    UA_UInt32 sequence = 42;
+    UA_UInt64 timestamp = 1000;
+    UA_Variant value;
+
+    HEART_BEAT_LEGACY_FORMAT = false;
+    UA_Variant_setScalar(&value, &coupler_id, &UA_TYPES[UA_TYPES_UINT16]);
+    handleSubscribedHeartBeatField(HEART_BEAT_FIELD_COUPLER_ID, &value);
+    UA_Variant_setScalar(&value, &sequence, &UA_TYPES[UA_TYPES_UINT32]);
+    handleSubscribedHeartBeatField(HEART_BEAT_FIELD_SEQUENCE, &value);
+    UA_Variant_setScalar(&value, &timestamp, &UA_TYPES[UA_TYPES_UINT64]);
+    handleSubscribedHeartBeatField(HEART_BEAT_FIELD_TIMESTAMP, &value);
+
+    cr_expect_eq(LIVENESS_TABLE.peer_list[7].sequence, 42);
+    cr_expect_eq(LIVENESS_TABLE.peer_list[7].send_timestamp, 1000);
+    cr_expect_eq(LIVENESS_TABLE.peer_list[7].heart_beat_count, 1);
+}
+
+Test(keepalivesubscriber, newSubscribedHeartBeat) {
+    HEART_BEAT_LEGACY_FORMAT = false;
+
+    // one DataSetReader per watched coupler, filtering on its PublisherId
+    cr_expect_neq(newSubscribedHeartBeat(3), NULL);
+    cr_expect_neq(newSubscribedHeartBeat(63), NULL);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_COUNT, 2);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_LIST[3]->coupler_id, 3);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_LIST[63]->publisher_id, HEART_BEAT_PUBLISHER_ID_BASE + 63);
+    cr_expect_str_eq(SUBSCRIBED_HEART_BEAT_LIST[63]->name, "Heartbeat 63 (subscribed)");
+
+    // already existing or out of range
+    cr_expect_eq(newSubscribedHeartBeat(3), NULL);
+    cr_expect_eq(newSubscribedHeartBeat(MAX_COUPLER_COUNT), NULL);
+
+    // peers removed at runtime
+    deleteSubscribedHeartBeat(3);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_LIST[3], NULL);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_COUNT, 1);
+    deleteSubscribedHeartBeat(3);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_COUNT, 1);
+    deleteSubscribedHeartBeat(63);
+
+    // legacy heart beats share one PublisherId
+    HEART_BEAT_LEGACY_FORMAT = true;
+    cr_expect_neq(newSubscribedHeartBeat(0), NULL);
+    cr_expect_eq(SUBSCRIBED_HEART_BEAT_LIST[0]->publisher_id, PUBLISHER_ID);
+    cr_expect_str_eq(SUBSCRIBED_HEART_BEAT_LIST[0]->name, "DataSet 1 (subscribed)");
+    deleteSubscribedHeartBeat(0);
+    HEART_BEAT_LEGACY_FORMAT = false;
+}
+
+Test(keepalivesubscriber, initSubscribedHeartBeatDataValue) {
+    size_t i;
+    subscribed_heart_beat_t subscribed;
+
+    HEART_BEAT_LEGACY_FORMAT = false;
+    memset(&subscribed, 0, sizeof(subscribed));
+    for (i = 0; i < HEART_BEAT_FIELD_COUNT; i++) {
+        subscribed.data_value_reference_list[i] = &subscribed.data_value_list[i];
+        initSubscribedHeartBeatDataValue(&subscribed, i);
+    }
+
+    // the fixed size decoder writes straight into the subscribed values
+    cr_expect_eq(subscribed.data_value_list[HEART_BEAT_FIELD_COUPLER_ID].value.data,
+                 &subscribed.coupler_id_value);
+    cr_expect_eq(subscribed.data_value_list[HEART_BEAT_FIELD_SEQUENCE].value.type,
+                 &UA_TYPES[UA_TYPES_UINT32]);
+    cr_expect_eq(subscribed.data_value_list[HEART_BEAT_FIELD_TIMESTAMP].value.data,
+                 &subscribed.timestamp);
+    cr_expect_eq(subscribed.data_value_list[HEART_BEAT_FIELD_TIMESTAMP].value.storageType,
+                 UA_VARIANT_DATA_NODELETE);
+}
@@ -0,0 +1,220 @@
+/* ================ Includes ===================== */
+#include <criterion/criterion.h>
+#include <stdint.h>
+
+#include "../../coupler/liveness_table.h"
+
+static liveness_table_t TABLE;
+
+/* ================ Function Tests =============== */
+
+// ############# watch peers ##############
+
+Test(livenesstable, watchPeer) {
+    initLivenessTable(&TABLE);
+
+    cr_expect_eq(watchPeer(&TABLE, 3, 2), 0);
+    cr_expect_eq(watchPeer(&TABLE, 700, 2), 0);
+    // watching twice does not duplicate the peer
+    cr_expect_eq(watchPeer(&TABLE, 3, 2), 0);
+    cr_expect_eq(watchPeer(&TABLE, MAX_COUPLER_COUNT, 2), -1);
+
+    cr_expect_eq(TABLE.watched_count, 2);
+    cr_expect_eq(TABLE.watched_id_list[1], 700);
+    cr_expect_eq(TABLE.peer_list[700].state, 2);
+}
+
+Test(livenesstable, unwatchPeer) {
+    initLivenessTable(&TABLE);
+
+    watchPeer(&TABLE, 3, 2);
+    watchPeer(&TABLE, 5, 2);
+    watchPeer(&TABLE, 700, 2);
+    cr_expect_eq(unwatchPeer(&TABLE, 5), 0);
+    // unwatching twice or an unknown peer is harmless
+    cr_expect_eq(unwatchPeer(&TABLE, 5), 0);
+    cr_expect_eq(unwatchPeer(&TABLE, 9), 0);
+    cr_expect_eq(unwatchPeer(&TABLE, MAX_COUPLER_COUNT), -1);
+
+    cr_expect_eq(TABLE.watched_count, 2);
+    cr_expect_eq(TABLE.watched_id_list[0], 3);
+    cr_expect_eq(TABLE.watched_id_list[1], 700);
+    cr_expect_eq(TABLE.peer_list[5].watched, 0);
+}
+
+Test(livenesstable, rewatchPeer) {
+    initLivenessTable(&TABLE);
+    watchPeer(&TABLE, 5, PEER_STATE_NO_INITIAL);
+    updateLiveness(&TABLE, 5, 41, 1000, 1000000000);
+    checkPeerState(&TABLE, 5, 1000000100, 200, 400);
+    unwatchPeer(&TABLE, 5);
+
+    // watched again much later (configuration reload): not DOWN before a heart beat
+    watchPeer(&TABLE, 5, PEER_STATE_NO_INITIAL);
+    cr_expect_eq(getLastSeen(&TABLE, 5), LIVENESS_NEVER_SEEN);
+    cr_expect_eq(TABLE.peer_list[5].heart_beat_count, 0);
+    cr_expect_eq(TABLE.peer_list[5].state, PEER_STATE_NO_INITIAL);
+    cr_expect_eq(checkWatchedPeerList(&TABLE, 9000000000, 200, 400, NULL, NULL), PEER_STATE_NO_INITIAL);
+    updateLiveness(&TABLE, 5, 1, 1000, 9000000000);
+    cr_expect_eq(checkWatchedPeerList(&TABLE, 9000000100, 200, 400, NULL, NULL), PEER_STATE_UP);
+    cr_expect_eq(TABLE.peer_list[5].out_of_order_count, 0);
+}
+
+// ############# register heart beats ##############
+
+Test(livenesstable, updateLiveness) {
+    initLivenessTable(&TABLE);
+
+    cr_expect_eq(getLastSeen(&TABLE, 5), LIVENESS_NEVER_SEEN);
+    cr_expect_eq(updateLiveness(&TABLE, 5, 41, 1000, 123456789), 0);
+    cr_expect_eq(updateLiveness(&TABLE, 5, 42, 2000, 223456789), 0);
+    cr_expect_eq(updateLiveness(&TABLE, MAX_COUPLER_COUNT, 1, 1, 1), -1);
+
+    cr_expect_eq(getLastSeen(&TABLE, 5), 223456789);
+    cr_expect_eq(TABLE.peer_list[5].sequence, 42);
+    cr_expect_eq(TABLE.peer_list[5].send_timestamp, 2000);
+    cr_expect_eq(TABLE.peer_list[5].heart_beat_count, 2);
+    cr_expect_eq(sizeof(liveness_t), CACHE_LINE_SIZE);
+}
+
+// ############# sequence gaps, reordering and duplicates ##############
+
+Test(livenesstable, updateLivenessSequence) {
+    initLivenessTable(&TABLE);
+
+    updateLiveness(&TABLE, 1, 10, 100000000, 1000000000);
+    // two heart beats lost
+    updateLiveness(&TABLE, 1, 13, 400000000, 1300000000);
+    // late and repeated frames only count, but keep the peer alive
+    updateLiveness(&TABLE, 1, 12, 300000000, 1310000000);
+    updateLiveness(&TABLE, 1, 13, 400000000, 1320000000);
+
+    cr_expect_eq(TABLE.peer_list[1].missed_count, 2);
+    cr_expect_eq(TABLE.peer_list[1].out_of_order_count, 1);
+    cr_expect_eq(TABLE.peer_list[1].duplicate_count, 1);
+    cr_expect_eq(TABLE.peer_list[1].heart_beat_count, 2);
+    cr_expect_eq(TABLE.peer_list[1].sequence, 13);
+    cr_expect_eq(getLastSeen(&TABLE, 1), 1320000000);
+}
+
+Test(livenesstable, updateLivenessRestart) {
+    initLivenessTable(&TABLE);
+    watchPeer(&TABLE, 1, PEER_STATE_NO_INITIAL);
+
+    updateLiveness(&TABLE, 1, 1000, 100000000, 1000000000);
+    // the peer reboots, its sequence starts again at 1
+    updateLiveness(&TABLE, 1, 1, 5000000, 1100000000);
+    cr_expect_eq(TABLE.peer_list[1].sequence, 1);
+    cr_expect_eq(TABLE.peer_list[1].out_of_order_count, 0);
+    updateLiveness(&TABLE, 1, 2, 105000000, 1200000000);
+    cr_expect_eq(TABLE.peer_list[1].sequence, 2);
+    cr_expect_eq(TABLE.peer_list[1].missed_count, 0);
+    cr_expect_eq(getLastSeen(&TABLE, 1), 1200000000);
+
+    // a DOWN peer restarting within the reorder window is taken over too
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1650000000, 200000000, 400000000), PEER_STATE_DOWN);
+    updateLiveness(&TABLE, 1, 1, 5000000, 1700000000);
+    cr_expect_eq(TABLE.peer_list[1].sequence, 1);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1700000000, 200000000, 400000000), PEER_STATE_UP);
+    updateLiveness(&TABLE, 1, 2, 105000000, 1800000000);
+    cr_expect_eq(TABLE.peer_list[1].sequence, 2);
+    cr_expect_eq(TABLE.peer_list[1].out_of_order_count, 0);
+    cr_expect_eq(TABLE.peer_list[1].duplicate_count, 0);
+}
+
+// ############# inter-arrival jitter ##############
+
+Test(livenesstable, updateLivenessJitter) {
+    initLivenessTable(&TABLE);
+
+    // sent every 100 ms, second one arrives 16 ms late
+    updateLiveness(&TABLE, 1, 1, 100000000, 1000000000);
+    updateLiveness(&TABLE, 1, 2, 200000000, 1116000000);
+
+    cr_expect_eq(TABLE.peer_list[1].jitter_max, 16000000);
+    cr_expect_eq(TABLE.peer_list[1].jitter_ewma, 1000000);
+    cr_expect_eq(TABLE.peer_list[1].interval, 116000000);
+}
+
+// ############# per peer state machine ##############
+
+Test(livenesstable, checkPeerState) {
+    initLivenessTable(&TABLE);
+    watchPeer(&TABLE, 1, PEER_STATE_NO_INITIAL);
+
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000000, 200, 400), PEER_STATE_NO_INITIAL);
+    updateLiveness(&TABLE, 1, 1, 1, 1000000000);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000100, 200, 400), PEER_STATE_UP);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000300, 200, 400), PEER_STATE_SUSPECT);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000500, 200, 400), PEER_STATE_DOWN);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000600, 200, 400), PEER_STATE_DOWN);
+    cr_expect_eq(TABLE.peer_list[1].down_count, 1);
+
+    // recovered by a fresh heart beat
+    updateLiveness(&TABLE, 1, 2, 2, 1000000700);
+    cr_expect_eq(checkPeerState(&TABLE, 1, 1000000700, 200, 400), PEER_STATE_UP);
+}
+
+// ############# worst state of all watched peers ##############
+
+static int CHANGE_COUNT;
+
+static void countPeerStateChange(liveness_table_t *table, unsigned int coupler_id,
+                                 uint8_t previous_state, uint8_t state, uint64_t now, void *context) {
+    CHANGE_COUNT++;
+    *(unsigned int *)context = coupler_id;
+}
+
+Test(livenesstable, checkWatchedPeerList) {
+    unsigned int changed_id = 0;
+
+    initLivenessTable(&TABLE);
+    CHANGE_COUNT = 0;
+    watchPeer(&TABLE, 1, PEER_STATE_NO_INITIAL);
+    watchPeer(&TABLE, 2, PEER_STATE_NO_INITIAL);
+
+    updateLiveness(&TABLE, 1, 1, 1, 1000000000);
+    cr_expect_eq(checkWatchedPeerList(&TABLE, 1000000100, 200, 400, countPeerStateChange, &changed_id),
+                 PEER_STATE_NO_INITIAL);
+    cr_expect_eq(CHANGE_COUNT, 1);
+    cr_expect_eq(changed_id, 1);
+
+    // a suspect peer does not degrade the coupler
+    updateLiveness(&TABLE, 2, 1, 1, 1000000000);
+    cr_expect_eq(checkWatchedPeerList(&TABLE, 1000000300, 200, 400, countPeerStateChange, &changed_id),
+                 PEER_STATE_UP);
+    updateLiveness(&TABLE, 2, 2, 2, 1000000300);
+    cr_expect_eq(checkWatchedPeerList(&TABLE, 1000000500, 200, 400, NULL, NULL), PEER_STATE_DOWN);
+    cr_expect_eq(TABLE.peer_list[1].state, PEER_STATE_DOWN);
+    cr_expect_eq(TABLE.peer_list[2].state, PEER_STATE_UP);
+}
+
+Test(livenesstable, checkHeartBeatTimeouts) {
+    initLivenessTable(&TABLE);
+    watchPeer(&TABLE, 1, PEER_STATE_NO_INITIAL);
+    updateLiveness(&TABLE, 1, 1, 1, 1000000000);
+
+    // suspect after LIVENESS_SUSPECT_HEART_BEAT_COUNT heart beats
+    cr_expect_eq(checkHeartBeatTimeouts(&TABLE, 1000000150, 100, 400, NULL, NULL), PEER_STATE_UP);
+    cr_expect_eq(TABLE.peer_list[1].state, PEER_STATE_UP);
+    cr_expect_eq(checkHeartBeatTimeouts(&TABLE, 1000000250, 100, 400, NULL, NULL), PEER_STATE_UP);
+    cr_expect_eq(TABLE.peer_list[1].state, PEER_STATE_SUSPECT);
+    // never later than the down timeout
+    cr_expect_eq(checkHeartBeatTimeouts(&TABLE, 1000000150, 100, 120, NULL, NULL), PEER_STATE_DOWN);
+}
+
+Test(livenesstable, copyWatchedPeerList) {
+    uint16_t id_list[MAX_COUPLER_COUNT];
+
+    initLivenessTable(&TABLE);
+    watchPeer(&TABLE, 3, PEER_STATE_NO_INITIAL);
+    watchPeer(&TABLE, 5, PEER_STATE_NO_INITIAL);
+    watchPeer(&TABLE, 700, PEER_STATE_NO_INITIAL);
+    unwatchPeer(&TABLE, 5);
+
+    cr_expect_eq(copyWatchedPeerList(&TABLE, id_list), 2);
+    cr_expect_eq(id_list[0], 3);
+    cr_expect_eq(id_list[1], 700);
+    // every change is complete
+    cr_expect_eq(TABLE.watched_sequence % 2, 0);
+}
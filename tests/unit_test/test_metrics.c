@@ -0,0 +1,79 @@
+/* ================ Includes ===================== */
+#define DOING_UNIT_TESTS
+#include <criterion/criterion.h>
+#include "../../coupler/opc-ua-server/server.c"
+
+
+/* ================ Function Tests =============== */
+
+// ############# HDR style buckets ##############
+
+Test(metrics, getMetricBucket) {
+    uint64_t value;
+    unsigned int bucket;
+
+    // linear below the sub-bucket count
+    cr_expect_eq(getMetricBucket(0), 0);
+    cr_expect_eq(getMetricBucket(7), 7);
+    cr_expect_eq(getMetricBucket(8), 8);
+    cr_expect_eq(getMetricBucket(16), 16);
+    cr_expect_eq(getMetricBucket(17), 16);
+
+    // every value lies within its bucket, at most 12.5% above its lower bound
+    for (value = 1; value < (1ULL << 36); value = value * 3 + 1) {
+        bucket = getMetricBucket(value);
+        cr_expect_leq(value, getMetricBucketUpperBound(bucket));
+        cr_expect_gt(value, bucket > 0 ? getMetricBucketUpperBound(bucket - 1) : 0);
+        cr_expect_leq(getMetricBucketUpperBound(bucket) - value, value / 8);
+    }
+
+    // too large values end in the last bucket
+    cr_expect_eq(getMetricBucket(UINT64_MAX), METRIC_BUCKET_COUNT - 1);
+}
+
+Test(metrics, getMetricPercentile) {
+    int i;
+    metric_histogram_t histogram;
+
+    memset(&histogram, 0, sizeof(histogram));
+    cr_expect_eq(getMetricPercentile(&histogram, 50.0), 0);
+
+    // 99 cycles of 1 us and one of 1 ms
+    for (i = 0; i < 99; i++)
+        recordMetric(&histogram, 1000);
+    recordMetric(&histogram, 1000000);
+
+    cr_expect_eq(histogram.count, 100);
+    cr_expect_eq(histogram.max, 1000000);
+    cr_expect_eq(getMetricMean(&histogram), (99 * 1000 + 1000000) / 100);
+    cr_expect_geq(getMetricPercentile(&histogram, 50.0), 1000);
+    cr_expect_lt(getMetricPercentile(&histogram, 50.0), 1125);
+    cr_expect_lt(getMetricPercentile(&histogram, 99.0), 1125);
+    // never above the maximum
+    cr_expect_eq(getMetricPercentile(&histogram, 100.0), 1000000);
+}
+
+// ############# Prometheus text dump ##############
+
+Test(metrics, dumpMetrics) {
+    char *text = NULL;
+    size_t size = 0;
+    FILE *file = open_memstream(&text, &size);
+
+    memset(METRIC_LIST, 0, sizeof(METRIC_LIST));
+    recordMetric(&METRIC_LIST[METRIC_IO_SCAN_CYCLE], 5);
+    recordMetric(&METRIC_LIST[METRIC_IO_SCAN_CYCLE], 5);
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    recordMetric(&I2C_METRIC_LIST[0][METRIC_I2C_READ], 250000);
+    dumpMetrics(file);
+    fclose(file);
+
+    cr_expect_neq(strstr(text, "# TYPE coupler_io_scan_cycle_seconds histogram\n"), NULL);
+    cr_expect_neq(strstr(text, "coupler_io_scan_cycle_seconds_bucket{le=\"5e-9\"} 2\n"), NULL);
+    cr_expect_neq(strstr(text, "coupler_io_scan_cycle_seconds_bucket{le=\"+Inf\"} 2\n"), NULL);
+    cr_expect_neq(strstr(text, "coupler_io_scan_cycle_seconds_sum{} 10e-9\n"), NULL);
+    cr_expect_neq(strstr(text, "coupler_i2c_transaction_seconds_count{slave=\"0\",address=\"0x58\",op=\"read\"} 1\n"),
+                  NULL);
+    cr_expect_neq(strstr(text, "coupler_safe_mode_total"), NULL);
+    free(text);
+}
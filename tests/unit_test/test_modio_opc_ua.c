@@ -0,0 +1,95 @@
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <linux/i2c-dev.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include "../../coupler/mod_io_i2c.h"
+#include "../../coupler/gpio.h"
+#include "../../coupler/relay_output.h"
+#include "../../coupler/io_scanner.h"
+#include "../../coupler/mod_io_opc_ua.h"
+
+/* ================ Function Tests =============== */
+
+// ############# build channel table for N slaves ##############
+
+Test(modioopcua, initModIOChannelList) {
+    int i;
+    mod_io_channel_t *channel;
+    char node_id[32];
+    char description[64];
+
+    for (i = 0; i < 8; i++)
+        I2C_SLAVE_ADDR_LIST[i] = 0x58 + i;
+    initModIOChannelList();
+
+    cr_expect_eq(MOD_IO_CHANNEL_LIST_LENGTH, 8 * MOD_IO_CHANNEL_COUNT);
+
+    // last analog input of last slave
+    channel = &MOD_IO_CHANNEL_LIST[MOD_IO_CHANNEL_LIST_LENGTH - 1];
+    cr_expect_eq(channel->slave_index, 7);
+    cr_expect_eq(channel->slave_addr, 0x5F);
+    cr_expect_eq(channel->kind, MOD_IO_CHANNEL_ANALOG_INPUT);
+    cr_expect_eq(channel->reg, 0x33);
+    getModIOChannelName(channel, node_id, sizeof(node_id), description, sizeof(description));
+    cr_expect_str_eq(node_id, "i2c7.ain3");
+    cr_expect_str_eq(description, "I2C7 / Analog Input 3");
+}
+
+// ############# resolve string / numeric NodeIds once ##############
+
+Test(modioopcua, resolveModIONodeIdList) {
+    UA_String name = UA_STRING("i2c0.relay0");
+
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    I2C_SLAVE_ADDR_LIST[1] = 0x59;
+
+    ENABLE_NUMERIC_NODE_ID = false;
+    initModIOChannelList();
+    cr_expect_eq(MOD_IO_NODE_ID_LIST[0].node_id.identifierType, UA_NODEIDTYPE_STRING);
+    cr_expect_str_eq(MOD_IO_NODE_ID_LIST[0].name, "i2c0.relay0");
+    cr_expect(UA_String_equal(&MOD_IO_NODE_ID_LIST[0].node_id.identifier.string, &name));
+
+    ENABLE_NUMERIC_NODE_ID = true;
+    initModIOChannelList();
+    cr_expect_eq(MOD_IO_NODE_ID_LIST[0].node_id.identifierType, UA_NODEIDTYPE_NUMERIC);
+    cr_expect_eq(MOD_IO_NODE_ID_LIST[0].node_id.namespaceIndex, COUPLER_NAMESPACE_INDEX);
+    cr_expect_eq(MOD_IO_NODE_ID_LIST[MOD_IO_CHANNEL_COUNT].node_id.identifier.numeric,
+                 MOD_IO_NUMERIC_NODE_ID_BASE + MOD_IO_CHANNEL_COUNT);
+    // string name is kept for the BrowseName compatible id
+    cr_expect_str_eq(MOD_IO_NODE_ID_LIST[MOD_IO_CHANNEL_COUNT].name, "i2c1.relay0");
+    ENABLE_NUMERIC_NODE_ID = false;
+}
+
+// ############# expose a subset of the channels of a slave ##############
+
+Test(modioopcua, initModIOChannelListMask) {
+    int i;
+
+    for (i = 0; i < MAX_I2C_SLAVE_COUNT; i++)
+        I2C_SLAVE_ADDR_LIST[i] = 0;
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+    I2C_SLAVE_ADDR_LIST[2] = 0x5A;
+    // relay1 and ain0 of slave 2 only
+    MOD_IO_CHANNEL_MASK_LIST[2] = (1U << 1) | (1U << (MOD_IO_RELAY_COUNT + MOD_IO_DIGITAL_INPUT_COUNT));
+    initModIOChannelList();
+
+    // each slave keeps its block, the table ends with the last slave
+    cr_expect_eq(MOD_IO_CHANNEL_LIST_LENGTH, 3 * MOD_IO_CHANNEL_COUNT);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[MOD_IO_CHANNEL_COUNT].slave_addr, 0);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT].slave_addr, 0);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT + 1].slave_addr, 0x5A);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT + 1].kind, MOD_IO_CHANNEL_RELAY);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT + 8].kind, MOD_IO_CHANNEL_ANALOG_INPUT);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT + 8].reg, MOD_IO_ANALOG_INPUT_REGISTER);
+    cr_expect_eq(MOD_IO_CHANNEL_LIST[2 * MOD_IO_CHANNEL_COUNT + 9].slave_addr, 0);
+
+    // slave 2 detached
+    I2C_SLAVE_ADDR_LIST[2] = 0;
+    updateModIOChannelListLength();
+    cr_expect_eq(MOD_IO_CHANNEL_LIST_LENGTH, MOD_IO_CHANNEL_COUNT);
+    MOD_IO_CHANNEL_MASK_LIST[2] = 0;
+}
@@ -0,0 +1,84 @@
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <criterion/criterion.h>
+#include <linux/i2c-dev.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include "../../coupler/mod_io_i2c.h"
+#include "../../coupler/keep_alive.h"
+#include "../../coupler/pubsub_transport.h"
+
+/* ================ Function Tests =============== */
+
+// ############# transport selection ##############
+
+Test(pubsubtransport, selectPubSubTransport) {
+    cr_expect_eq(selectPubSubTransport("eth"), 0);
+    cr_expect_eq(PUBSUB_TRANSPORT, PUBSUB_TRANSPORT_ETH);
+    cr_expect_str_eq(DEFAULT_TRANSPORT_PROFILE, ETH_TRANSPORT_PROFILE);
+    cr_expect_eq(selectPubSubTransport("tcp"), -1);
+    cr_expect_eq(PUBSUB_TRANSPORT, PUBSUB_TRANSPORT_ETH);
+    cr_expect_eq(selectPubSubTransport("udp"), 0);
+    cr_expect_eq(PUBSUB_TRANSPORT, PUBSUB_TRANSPORT_UDP);
+    cr_expect_str_eq(DEFAULT_TRANSPORT_PROFILE, UDP_TRANSPORT_PROFILE);
+    cr_expect_str_eq(getPubSubNetworkAddressUrl(), NETWORK_ADDRESS_URL_DATA_TYPE);
+    cr_expect_eq(isSOTxTimeEnabled(), false);
+}
+
+// ############# Ethernet address ##############
+
+Test(pubsubtransport, formatEthernetAddressUrl) {
+    char url[MAX_ETH_ADDRESS_URL_LENGTH];
+
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01-00-5e-00-00-16", 0, 0), 0);
+    cr_expect_str_eq(url, "opc.eth://01-00-5E-00-00-16");
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01:00:5E:7F:00:01", 8, 3), 0);
+    cr_expect_str_eq(url, "opc.eth://01-00-5E-7F-00-01:8.3");
+
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01-00-5E-00-00", 0, 0), -1);
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01-00-5E-00-00-1G", 0, 0), -1);
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01.00.5E.00.00.16", 0, 0), -1);
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01-00-5E-00-00-16", 4095, 0), -1);
+    cr_expect_eq(formatEthernetAddressUrl(url, sizeof(url), "01-00-5E-00-00-16", 8, 8), -1);
+}
+
+Test(pubsubtransport, getPubSubNetworkAddressUrl) {
+    selectPubSubTransport("eth");
+    ETH_DESTINATION_MAC = "01:00:5E:7F:00:01";
+    ETH_VLAN_ID = 8;
+    ETH_PCP = 6;
+    cr_expect_str_eq(getPubSubNetworkAddressUrl(), "opc.eth://01-00-5E-7F-00-01:8.6");
+
+    // invalid destination falls back to the default one
+    ETH_PCP = 9;
+    cr_expect_str_eq(getPubSubNetworkAddressUrl(), "opc.eth://" DEFAULT_ETH_DESTINATION_MAC);
+
+    ETH_TXTIME_OFFSET = 500 * NANO_SECONDS_PER_MICRO_SECOND;
+    cr_expect_eq(isSOTxTimeEnabled(), true);
+    selectPubSubTransport("udp");
+    cr_expect_eq(isSOTxTimeEnabled(), false);
+}
+
+// ############# SO_TXTIME ##############
+
+Test(pubsubtransport, setPubSubConnectionProperties) {
+    UA_PubSubConnectionConfig connectionConfig;
+    UA_WriterGroupConfig writerGroupConfig;
+
+    memset(&connectionConfig, 0, sizeof(connectionConfig));
+    memset(&writerGroupConfig, 0, sizeof(writerGroupConfig));
+    selectPubSubTransport("eth");
+    ETH_TXTIME_OFFSET = 500 * NANO_SECONDS_PER_MICRO_SECOND;
+    ETH_SOCKET_PRIORITY = 5;
+
+    setPubSubConnectionProperties(&connectionConfig);
+    cr_expect_eq(connectionConfig.connectionPropertiesSize, 2);
+    cr_expect_eq(*(UA_UInt32 *)connectionConfig.connectionProperties[0].value.data, 5);
+    cr_expect_eq(*(UA_Boolean *)connectionConfig.connectionProperties[1].value.data, UA_TRUE);
+
+    setWriterGroupTransportSettings(&writerGroupConfig);
+    cr_expect_eq(writerGroupConfig.transportSettings.content.decoded.data, &ETH_WRITER_GROUP_TRANSPORT);
+    cr_expect_eq(writerGroupConfig.pubsubManagerCallback.addCustomCallback, addTxTimePublishCallback);
+    cr_expect_gt(getSOTxTimeLaunchTime(), ETH_TXTIME_OFFSET);
+    selectPubSubTransport("udp");
+}
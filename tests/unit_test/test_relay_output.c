@@ -0,0 +1,38 @@
+/* ================ Includes ===================== */
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <linux/i2c-dev.h>
+#include <open62541/server.h>
+
+#include "../../coupler/mod_io_i2c.h"
+#include "../../coupler/relay_output.h"
+
+/* ================ Function Tests =============== */
+
+// ############# coalesce relay writes (only virtual mode) ##############
+
+Test(relayoutput, flushRelayOutputList) {
+    int relay;
+
+    I2C_VIRTUAL_MODE = 1;
+    I2C_SLAVE_ADDR_LIST[0] = 0x58;
+
+    // a PLC writing all 4 relays in one request
+    for (relay = 0; relay < 4; relay++)
+        setRelayOutput(0, relay, true);
+    flushRelayOutputList();
+
+    cr_expect_eq(getRelayOutput(0), 0x0F);
+    cr_expect_eq(RELAY_OUTPUT_WRITE_COUNTER, 4);
+    cr_expect_eq(RELAY_OUTPUT_FLUSH_COUNTER, 1);
+    cr_expect_eq(RELAY_OUTPUT_COALESCED_COUNTER, 3);
+
+    // nothing dirty, nothing written
+    flushRelayOutputList();
+    cr_expect_eq(RELAY_OUTPUT_FLUSH_COUNTER, 1);
+
+    setRelayOutput(0, 2, false);
+    flushRelayOutputList();
+    cr_expect_eq(getRelayOutput(0), 0x0B);
+    cr_expect_eq(RELAY_OUTPUT_FLUSH_COUNTER, 2);
+}
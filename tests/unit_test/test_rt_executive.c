@@ -0,0 +1,148 @@
+/* ================ Includes ===================== */
+#define _GNU_SOURCE
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <open62541/server.h>
+#include <open62541/plugin/log_stdout.h>
+
+#include "../../coupler/rt_executive.h"
+
+/* ================ Helpers ====================== */
+
+static int TASK_RUN_COUNTER = 0;
+
+static void callbackCountTask(UA_Server *server, void *data)
+{
+    TASK_RUN_COUNTER += (int)(uintptr_t)data;
+}
+
+/* ================ Function Tests =============== */
+
+// ############# task list ##############
+
+Test(rtexecutive, addRemoveRTTask) {
+    uint64_t id_list[MAX_RT_TASK_COUNT];
+    uint64_t id;
+    int i;
+
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        cr_expect_eq(addRTTask(callbackCountTask, NULL, NULL, 1000, &id_list[i]), 0);
+    }
+    // full
+    cr_expect_eq(addRTTask(callbackCountTask, NULL, NULL, 1000, &id), -1);
+
+    removeRTTask(id_list[3]);
+    cr_expect_eq(addRTTask(callbackCountTask, NULL, NULL, 1000, &id), 0);
+    cr_expect_neq(id, id_list[3]);
+    cr_expect_eq(changeRTTask(id_list[3], 2000), -1);
+    cr_expect_eq(changeRTTask(id, 2000), 0);
+
+    removeRTTask(id);
+    for (i = 0; i < MAX_RT_TASK_COUNT; i++)
+    {
+        removeRTTask(id_list[i]);
+    }
+}
+
+Test(rtexecutive, runRTTaskList) {
+    uint64_t fast_id, slow_id, now;
+
+    TASK_RUN_COUNTER = 0;
+    addRTTask(callbackCountTask, NULL, (void *)1, 1 * NANO_SECONDS_PER_MILLI_SECOND, &fast_id);
+    addRTTask(callbackCountTask, NULL, (void *)100, 10 * NANO_SECONDS_PER_MILLI_SECOND, &slow_id);
+    now = getMonotonicNanoSeconds();
+
+    // nothing due yet
+    cr_expect_eq(runRTTaskList(now), 0);
+    cr_expect_eq(TASK_RUN_COUNTER, 0);
+
+    // only the fast task
+    cr_expect_eq(runRTTaskList(now + 2 * NANO_SECONDS_PER_MILLI_SECOND), 1);
+    cr_expect_eq(TASK_RUN_COUNTER, 1);
+
+    // both, a late task runs only once
+    cr_expect_eq(runRTTaskList(now + 50 * NANO_SECONDS_PER_MILLI_SECOND), 2);
+    cr_expect_eq(TASK_RUN_COUNTER, 102);
+    cr_expect_eq(runRTTaskList(now + 50 * NANO_SECONDS_PER_MILLI_SECOND), 0);
+
+    removeRTTask(fast_id);
+    removeRTTask(slow_id);
+}
+
+// ############# real-time thread ##############
+
+Test(rtexecutive, startStopRTExecutive) {
+    uint64_t id;
+
+    // real-time mode disabled
+    RT_PRIORITY = 0;
+    cr_expect_eq(startRTExecutive(), 0);
+    cr_expect_eq(RT_EXECUTIVE_RUNNING, false);
+
+    // without privileges it falls back to normal priority
+    TASK_RUN_COUNTER = 0;
+    RT_PRIORITY = 10;
+    RT_CYCLE_INTERVAL = 500;
+    addRTTask(callbackCountTask, NULL, (void *)1, 1 * NANO_SECONDS_PER_MILLI_SECOND, &id);
+    cr_expect_eq(startRTExecutive(), 0);
+    usleep(50000);
+    stopRTExecutive();
+    removeRTTask(id);
+    munlockall();
+
+    cr_expect_gt(RT_CYCLE_COUNTER, 0);
+    cr_expect_gt(TASK_RUN_COUNTER, 0);
+    cr_expect_leq(TASK_RUN_COUNTER, RT_CYCLE_COUNTER);
+    RT_PRIORITY = 0;
+}
+
+// ############# removal while a callback is in flight ##############
+
+static volatile int SLOW_TASK_STATE = 0;
+
+static void callbackSlowTask(UA_Server *server, void *data)
+{
+    SLOW_TASK_STATE = 1;
+    usleep(20000);
+    SLOW_TASK_STATE = 2;
+}
+
+static void *runSlowTaskList(void *arg)
+{
+    runRTTaskList(getMonotonicNanoSeconds() + NANO_SECONDS_PER_MILLI_SECOND);
+    return NULL;
+}
+
+Test(rtexecutive, removeRTTaskInFlight) {
+    pthread_t thread;
+    uint64_t id;
+
+    SLOW_TASK_STATE = 0;
+    addRTTask(callbackSlowTask, NULL, NULL, 1, &id);
+    pthread_create(&thread, NULL, runSlowTaskList, NULL);
+    while (SLOW_TASK_STATE == 0)
+        usleep(100);
+
+    // the task list is not locked while the callback runs
+    cr_expect_eq(changeRTTask(id, 2), 0);
+    // but removal waits for it
+    removeRTTask(id);
+    cr_expect_eq(SLOW_TASK_STATE, 2);
+    pthread_join(thread, NULL);
+    cr_expect_eq(runRTTaskList(getMonotonicNanoSeconds() + NANO_SECONDS_PER_MILLI_SECOND), 0);
+}
+
+Test(rtexecutive, suspendRTTaskList) {
+    uint64_t id;
+
+    TASK_RUN_COUNTER = 0;
+    addRTTask(callbackCountTask, NULL, (void *)1, 1, &id);
+    suspendRTTaskList();
+    cr_expect_eq(runRTTaskList(getMonotonicNanoSeconds() + NANO_SECONDS_PER_MILLI_SECOND), 0);
+    resumeRTTaskList();
+    cr_expect_eq(runRTTaskList(getMonotonicNanoSeconds() + NANO_SECONDS_PER_MILLI_SECOND), 1);
+    cr_expect_eq(TASK_RUN_COUNTER, 1);
+    removeRTTask(id);
+}
@@ -0,0 +1,50 @@
+/* ================ Includes ===================== */
+#include <criterion/criterion.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../../coupler/time_base.h"
+
+/* ================ Function Tests =============== */
+
+// ############# time base clock ##############
+
+Test(timebase, getTimeBaseNanoSeconds) {
+    uint64_t before, after;
+
+    before = getTimeBaseNanoSeconds();
+    after = getTimeBaseNanoSeconds();
+
+    cr_expect_gt(before, 0);
+    cr_expect_geq(after, before);
+}
+
+Test(timebase, setTimeBaseClock) {
+    cr_expect_eq(setTimeBaseClock("monotonic_raw"), 0);
+    cr_expect_eq(TIME_BASE_CLOCK, CLOCK_MONOTONIC_RAW);
+    cr_expect_eq(setTimeBaseClock("unknown"), -1);
+    cr_expect_eq(TIME_BASE_CLOCK, CLOCK_MONOTONIC_RAW);
+    cr_expect_eq(setTimeBaseClock("monotonic"), 0);
+    cr_expect_eq(TIME_BASE_CLOCK, CLOCK_MONOTONIC);
+    cr_expect_gt(getTimeBaseResolution(), 0);
+}
+
+// ############# conversions ##############
+
+Test(timebase, convertNanoSeconds2Timespec) {
+    struct timespec ts;
+
+    convertNanoSeconds2Timespec(3500000001ULL, &ts);
+    cr_expect_eq(ts.tv_sec, 3);
+    cr_expect_eq(ts.tv_nsec, 500000001);
+    cr_expect_eq(convertTimespec2NanoSeconds(&ts), 3500000001ULL);
+}
+
+// ############# absolute sleep ##############
+
+Test(timebase, sleepUntilMonotonicNanoSeconds) {
+    uint64_t deadline = getMonotonicNanoSeconds() + 2 * NANO_SECONDS_PER_MILLI_SECOND;
+
+    cr_expect_eq(sleepUntilMonotonicNanoSeconds(deadline), 0);
+    cr_expect_geq(getMonotonicNanoSeconds(), deadline);
+}
@@ -0,0 +1,82 @@
+/* ================ Includes ===================== */
+#define DOING_UNIT_TESTS
+#include <criterion/criterion.h>
+#include "../../coupler/opc-ua-server/server.c"
+
+
+/* ================ Function Tests =============== */
+
+// ############# per thread rings ##############
+
+Test(trace, traceEvent) {
+    TRACE_ENABLED = false;
+    traceEvent(TRACE_HEART_BEAT_RX, 1, 2, 3);
+    // disabled: no ring is created
+    cr_expect_null(TRACE_THREAD_RING);
+
+    TRACE_ENABLED = true;
+    traceEvent(TRACE_HEART_BEAT_RX, 1, 2, 3);
+    traceSpan(TRACE_I2C_READ, 4, 0, getTimeBaseNanoSeconds());
+    cr_assert_not_null(TRACE_THREAD_RING);
+    cr_expect_eq(TRACE_THREAD_RING->head, 2);
+    cr_expect_eq(TRACE_THREAD_RING->record_list[0].event, TRACE_HEART_BEAT_RX);
+    cr_expect_eq(TRACE_THREAD_RING->record_list[0].id, 1);
+    cr_expect_eq(TRACE_THREAD_RING->record_list[0].arg, 2);
+    cr_expect_eq(TRACE_THREAD_RING->record_list[0].value, 3);
+    cr_expect_eq(TRACE_THREAD_RING->record_list[1].event, TRACE_I2C_READ);
+    cr_expect_geq(TRACE_THREAD_RING->record_list[1].timestamp, TRACE_THREAD_RING->record_list[0].timestamp);
+    TRACE_ENABLED = false;
+}
+
+Test(trace, copyTraceRing) {
+    uint64_t i, lost_count;
+    size_t length;
+    static trace_ring_t ring;
+    static trace_record_t record_list[TRACE_RING_RECORD_COUNT];
+
+    // not yet wrapped: all records, oldest first
+    for (i = 0; i < 10; i++)
+        ring.record_list[i].arg = i;
+    ring.head = 10;
+    length = copyTraceRing(&ring, record_list, &lost_count);
+    cr_expect_eq(length, 10);
+    cr_expect_eq(lost_count, 0);
+    cr_expect_eq(record_list[9].arg, 9);
+
+    // wrapped: the oldest record may be overwritten by the record being written
+    for (i = 0; i < TRACE_RING_RECORD_COUNT + 5; i++)
+        ring.record_list[i & TRACE_RING_MASK].arg = i;
+    ring.head = TRACE_RING_RECORD_COUNT + 5;
+    length = copyTraceRing(&ring, record_list, &lost_count);
+    cr_expect_eq(length, TRACE_RING_RECORD_COUNT - 1);
+    cr_expect_eq(lost_count, 6);
+    cr_expect_eq(record_list[0].arg, 6);
+    cr_expect_eq(record_list[length - 1].arg, TRACE_RING_RECORD_COUNT + 4);
+}
+
+// ############# dump file ##############
+
+Test(trace, dumpTrace) {
+    char *data = NULL;
+    size_t size = 0;
+    FILE *file = open_memstream(&data, &size);
+    trace_file_header_t *header;
+    trace_ring_header_t *ring_header;
+
+    TRACE_ENABLED = true;
+    traceEvent(TRACE_SAFE_MODE, 0, 1, 0);
+    TRACE_ENABLED = false;
+    cr_assert_eq(dumpTrace(file, 3), 0);
+    fclose(file);
+
+    header = (trace_file_header_t *)data;
+    cr_expect_eq(memcmp(header->magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)), 0);
+    cr_expect_eq(header->record_size, sizeof(trace_record_t));
+    cr_expect_eq(header->coupler_id, 3);
+    cr_assert_eq(header->ring_count, 1);
+    ring_header = (trace_ring_header_t *)(data + sizeof(trace_file_header_t));
+    cr_expect_eq(ring_header->thread_id, TRACE_THREAD_RING->thread_id);
+    cr_expect_eq(size, sizeof(trace_file_header_t) + sizeof(trace_ring_header_t) +
+                       ring_header->record_count * sizeof(trace_record_t));
+    free(data);
+}